@@ -45,6 +45,11 @@
  @note Binary Data fields are not inferred. You must edit the schema on the StackMob website and add a new field of type Binary Data that has the same name as the string attribute in your Xcode data model.  This must be done before you persist any data to avoid inferring a field with type string.
  
  */
+/**
+ Marks the file URL at the end of a reference string returned by <SMBinaryDataConversion> `stringForBinaryDataAtURL:name:contentType:`.
+ */
+extern NSString *const SMBinaryDataReferencePrefix;
+
 @interface SMBinaryDataConversion : NSObject
 
 /**
@@ -58,4 +63,27 @@
  */
 + (NSString *)stringForBinaryData:(NSData *)data name:(NSString *)name contentType:(NSString *)contentType;
 
+/**
+ Returns a reference to a file, to be used in place of <stringForBinaryData:name:contentType:> for large content.
+ 
+ The file is not read until the field is sent, when it is base64 encoded a chunk at a time as the request body is streamed, so the whole content is never held in memory.  The file must still exist when the object is saved.
+ 
+ @param fileURL The file URL of the content.
+ @param name A name for the content.  This can be any arbitrary name.
+ @param contentType The content type of the data.
+ 
+ @return A string which is replaced by the file's content when sent to StackMob.
+ */
++ (NSString *)stringForBinaryDataAtURL:(NSURL *)fileURL name:(NSString *)name contentType:(NSString *)contentType;
+
+/**
+ Returns the headers which come before the base64 encoded content in a Binary Data field.
+ 
+ @param name A name for the content.
+ @param contentType The content type of the data.
+ 
+ @return The headers, ending with a blank line.
+ */
++ (NSString *)headerForBinaryDataWithName:(NSString *)name contentType:(NSString *)contentType;
+
 @end
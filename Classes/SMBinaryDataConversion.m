@@ -18,19 +18,39 @@
 #import <CommonCrypto/CommonHMAC.h>
 #import "Base64EncodedStringFromData.h"
 
+NSString *const SMBinaryDataReferencePrefix = @"stackmob-file:";
+
 @implementation SMBinaryDataConversion
 
-+ (NSString *)stringForBinaryData:(NSData *)data name:(NSString *)name contentType:(NSString *)contentType
++ (NSString *)headerForBinaryDataWithName:(NSString *)name contentType:(NSString *)contentType
 {
-    
     return [NSString stringWithFormat:@"Content-Type: %@\n"
             "Content-Disposition: attachment; filename=%@\n"
-            "Content-Transfer-Encoding: %@\n\n"
-            "%@",
+            "Content-Transfer-Encoding: %@\n\n",
             contentType,
             name,
-            @"base64",
-            Base64EncodedStringFromData(data)];
+            @"base64"];
+}
+
++ (NSString *)stringForBinaryData:(NSData *)data name:(NSString *)name contentType:(NSString *)contentType
+{
+    NSString *header = [self headerForBinaryDataWithName:name contentType:contentType];
+    
+    // Encode straight after the header in one buffer, instead of encoding to a string and copying that into the result
+    NSData *headerData = [header dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger length = [headerData length] + Base64EncodedLength([data length]);
+    char *bytes = malloc(length);
+    if (bytes == NULL) {
+        return nil;
+    }
+    memcpy(bytes, [headerData bytes], [headerData length]);
+    Base64EncodeBytes([data bytes], [data length], bytes + [headerData length]);
+    return [[NSString alloc] initWithBytesNoCopy:bytes length:length encoding:NSUTF8StringEncoding freeWhenDone:YES];
+}
+
++ (NSString *)stringForBinaryDataAtURL:(NSURL *)fileURL name:(NSString *)name contentType:(NSString *)contentType
+{
+    return [NSString stringWithFormat:@"%@%@%@", [self headerForBinaryDataWithName:name contentType:contentType], SMBinaryDataReferencePrefix, [fileURL absoluteString]];
 }
 
 @end
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+typedef enum {
+    SMCircuitStateClosed = 0,
+    SMCircuitStateOpen = 1,
+    SMCircuitStateHalfOpen = 2,
+} SMCircuitState;
+
+/**
+ `SMCircuitBreaker` stops requests from being sent to a schema which is failing, so that callers hear about it straight away instead of after a full timeout.
+ 
+ Requests are grouped by host and schema (the first component of the path).  Each group starts _closed_, letting every request through.  It _opens_ after <consecutiveFailureThreshold> failures in a row, or once at least <minimumNumberOfRequests> of its recent requests have been recorded and the share which failed reaches <errorRateThreshold>.  While open, requests are refused.  After <openInterval> the group goes _half-open_ and lets a single probe request through: if the probe succeeds the group closes again, otherwise it reopens for another <openInterval>.
+ 
+ Only 5xx responses and timeouts or dropped connections count as failures.  Any other response shows the service is up, and counts as a success.
+ 
+ @note You should not need to create your own `SMCircuitBreaker`.  One is created with each <SMUserSession>.  Refused requests fail with an `SMErrorNetworkNotReachable` error, so that the Core Data integration falls back to the cache when its policy allows it.
+ */
+@interface SMCircuitBreaker : NSObject
+
+/**
+ The number of failures in a row which opens the circuit.  Default is 5.
+ */
+@property (nonatomic) NSUInteger consecutiveFailureThreshold;
+
+/**
+ The share of recent requests which must fail to open the circuit, between 0 and 1.  Default is 0.5.
+ */
+@property (nonatomic) double errorRateThreshold;
+
+/**
+ The number of recent requests which must have been recorded before <errorRateThreshold> is applied.  Default is 10.
+ */
+@property (nonatomic) NSUInteger minimumNumberOfRequests;
+
+/**
+ How long, in seconds, the circuit stays open before a probe request is let through.  Default is 30.
+ */
+@property (nonatomic) NSTimeInterval openInterval;
+
+/**
+ The key requests to the same host and schema are grouped under.
+ 
+ @param request The request.
+ 
+ @return The lowercase host and first path component, joined by a slash.
+ */
++ (NSString *)keyForRequest:(NSURLRequest *)request;
+
+/**
+ Whether a request may be sent.
+ 
+ A half-open circuit lets the first request through as its probe, so a request which is allowed should be sent, and its outcome recorded with <recordResponse:error:forRequest:>.
+ 
+ @param request The request about to be sent.
+ 
+ @return `YES` if the request should be sent, `NO` if it should fail straight away.
+ */
+- (BOOL)allowRequest:(NSURLRequest *)request;
+
+/**
+ Record the outcome of a request which was allowed.
+ 
+ @param response The response, if one was received.
+ @param error The error, if the request failed.
+ @param request The request.
+ */
+- (void)recordResponse:(NSHTTPURLResponse *)response error:(NSError *)error forRequest:(NSURLRequest *)request;
+
+/**
+ The state of the circuit for a given key.
+ 
+ @param key A key returned by <keyForRequest:>.
+ 
+ @return The circuit's state.
+ */
+- (SMCircuitState)stateForKey:(NSString *)key;
+
+/**
+ Close every circuit and forget all recorded outcomes.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMCircuitBreaker.h"
+
+#define CONSECUTIVE_FAILURE_THRESHOLD 5
+#define ERROR_RATE_THRESHOLD 0.5
+#define MINIMUM_NUMBER_OF_REQUESTS 10
+#define ERROR_RATE_WINDOW 20
+#define OPEN_INTERVAL 30.0
+
+/*
+ The state of a single host and schema.
+ */
+@interface SMCircuit : NSObject
+
+@property (nonatomic) SMCircuitState state;
+@property (nonatomic) NSUInteger consecutiveFailures;
+@property (nonatomic, strong) NSMutableArray *recentOutcomes;
+@property (nonatomic, strong) NSDate *openedDate;
+@property (nonatomic, strong) NSDate *probeDate;
+
+@end
+
+@implementation SMCircuit
+
+@synthesize state = _SM_state;
+@synthesize consecutiveFailures = _SM_consecutiveFailures;
+@synthesize recentOutcomes = _SM_recentOutcomes;
+@synthesize openedDate = _SM_openedDate;
+@synthesize probeDate = _SM_probeDate;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.state = SMCircuitStateClosed;
+        self.recentOutcomes = [NSMutableArray arrayWithCapacity:ERROR_RATE_WINDOW];
+    }
+    return self;
+}
+
+@end
+
+@interface SMCircuitBreaker ()
+
+@property (nonatomic, strong) NSMutableDictionary *circuits;
+
+- (void)SM_openCircuit:(SMCircuit *)circuit;
+- (void)SM_closeCircuit:(SMCircuit *)circuit;
+- (BOOL)SM_isFailureResponse:(NSHTTPURLResponse *)response error:(NSError *)error;
+
+@end
+
+@implementation SMCircuitBreaker
+
+@synthesize consecutiveFailureThreshold = _SM_consecutiveFailureThreshold;
+@synthesize errorRateThreshold = _SM_errorRateThreshold;
+@synthesize minimumNumberOfRequests = _SM_minimumNumberOfRequests;
+@synthesize openInterval = _SM_openInterval;
+@synthesize circuits = _SM_circuits;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.consecutiveFailureThreshold = CONSECUTIVE_FAILURE_THRESHOLD;
+        self.errorRateThreshold = ERROR_RATE_THRESHOLD;
+        self.minimumNumberOfRequests = MINIMUM_NUMBER_OF_REQUESTS;
+        self.openInterval = OPEN_INTERVAL;
+        self.circuits = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
++ (NSString *)keyForRequest:(NSURLRequest *)request
+{
+    NSURL *url = [request URL];
+    NSString *schema = @"";
+    for (NSString *component in [[url path] pathComponents]) {
+        if (![component isEqualToString:@"/"]) {
+            schema = component;
+            break;
+        }
+    }
+    return [[NSString stringWithFormat:@"%@/%@", [url host], schema] lowercaseString];
+}
+
+- (BOOL)allowRequest:(NSURLRequest *)request
+{
+    NSString *key = [SMCircuitBreaker keyForRequest:request];
+    @synchronized(self) {
+        SMCircuit *circuit = [self.circuits objectForKey:key];
+        if (circuit == nil || circuit.state == SMCircuitStateClosed) {
+            return YES;
+        }
+        
+        NSDate *now = [NSDate date];
+        if (circuit.state == SMCircuitStateOpen) {
+            if ([now timeIntervalSinceDate:circuit.openedDate] < self.openInterval) {
+                return NO;
+            }
+            circuit.state = SMCircuitStateHalfOpen;
+            circuit.probeDate = nil;
+        }
+        
+        // Half-open: one probe at a time.  A probe whose outcome never arrives is given up on after another interval.
+        if (circuit.probeDate && [now timeIntervalSinceDate:circuit.probeDate] < self.openInterval) {
+            return NO;
+        }
+        circuit.probeDate = now;
+        return YES;
+    }
+}
+
+- (void)recordResponse:(NSHTTPURLResponse *)response error:(NSError *)error forRequest:(NSURLRequest *)request
+{
+    NSString *key = [SMCircuitBreaker keyForRequest:request];
+    BOOL failed = [self SM_isFailureResponse:response error:error];
+    BOOL neutral = !failed && response == nil;
+    
+    @synchronized(self) {
+        SMCircuit *circuit = [self.circuits objectForKey:key];
+        if (circuit == nil) {
+            if (!failed) {
+                return;
+            }
+            circuit = [[SMCircuit alloc] init];
+            [self.circuits setObject:circuit forKey:key];
+        }
+        
+        if (circuit.state == SMCircuitStateHalfOpen) {
+            if (neutral) {
+                // A cancelled or offline probe says nothing about the service, so let another one through
+                circuit.probeDate = nil;
+            } else if (failed) {
+                [self SM_openCircuit:circuit];
+            } else {
+                [self SM_closeCircuit:circuit];
+            }
+            return;
+        }
+        
+        if (neutral || circuit.state == SMCircuitStateOpen) {
+            // Stragglers sent before the circuit opened do not move it
+            return;
+        }
+        
+        [circuit.recentOutcomes addObject:[NSNumber numberWithBool:failed]];
+        if ([circuit.recentOutcomes count] > ERROR_RATE_WINDOW) {
+            [circuit.recentOutcomes removeObjectAtIndex:0];
+        }
+        circuit.consecutiveFailures = failed ? circuit.consecutiveFailures + 1 : 0;
+        
+        if (!failed) {
+            return;
+        }
+        
+        NSUInteger numberOfFailures = 0;
+        for (NSNumber *outcome in circuit.recentOutcomes) {
+            numberOfFailures += [outcome boolValue] ? 1 : 0;
+        }
+        NSUInteger numberOfOutcomes = [circuit.recentOutcomes count];
+        BOOL tooManyInARow = circuit.consecutiveFailures >= self.consecutiveFailureThreshold;
+        BOOL errorRateTooHigh = numberOfOutcomes >= self.minimumNumberOfRequests && (double)numberOfFailures / numberOfOutcomes >= self.errorRateThreshold;
+        if (tooManyInARow || errorRateTooHigh) {
+            [self SM_openCircuit:circuit];
+        }
+    }
+}
+
+- (SMCircuitState)stateForKey:(NSString *)key
+{
+    @synchronized(self) {
+        SMCircuit *circuit = [self.circuits objectForKey:key];
+        return circuit ? circuit.state : SMCircuitStateClosed;
+    }
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        [self.circuits removeAllObjects];
+    }
+}
+
+- (void)SM_openCircuit:(SMCircuit *)circuit
+{
+    circuit.state = SMCircuitStateOpen;
+    circuit.openedDate = [NSDate date];
+    circuit.probeDate = nil;
+}
+
+- (void)SM_closeCircuit:(SMCircuit *)circuit
+{
+    circuit.state = SMCircuitStateClosed;
+    circuit.consecutiveFailures = 0;
+    circuit.probeDate = nil;
+    [circuit.recentOutcomes removeAllObjects];
+}
+
+- (BOOL)SM_isFailureResponse:(NSHTTPURLResponse *)response error:(NSError *)error
+{
+    if (response) {
+        return [response statusCode] >= 500;
+    }
+    if (![[error domain] isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    switch ([error code]) {
+        case NSURLErrorTimedOut:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorBadServerResponse:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+@end
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMCompressionMetrics` keeps running totals of how many bytes compression has saved, for request bodies gzipped by <SMOAuth2Client> and for compressed responses.
+ 
+ Response savings are only counted when the server reports the compressed size with a `Content-Length` header; chunked compressed responses are counted as if they were uncompressed.
+ 
+ Nothing is recorded unless <enabled> is `YES`.  All counters may be read and recorded from any thread.
+ 
+ @note You should not need to create your own `SMCompressionMetrics`.  One is created with each <SMUserSession>.
+ */
+@interface SMCompressionMetrics : NSObject
+
+///-------------------------------
+/// @name Properties
+///-------------------------------
+
+/**
+ Whether the SDK records requests and responses here.  Default is `NO`.
+ */
+@property (atomic) BOOL enabled;
+
+/**
+ Total size of request bodies before compression.  Includes bodies which were sent uncompressed.
+ */
+@property (readonly) int64_t requestBytesBeforeCompression;
+
+/**
+ Total size of request bodies as sent.
+ */
+@property (readonly) int64_t requestBytesSent;
+
+/**
+ Total size of response bodies as received over the network.
+ */
+@property (readonly) int64_t responseBytesReceived;
+
+/**
+ Total size of response bodies after decompression.
+ */
+@property (readonly) int64_t responseBytesDecoded;
+
+/**
+ `requestBytesBeforeCompression` less `requestBytesSent`.
+ */
+@property (readonly) int64_t requestBytesSaved;
+
+/**
+ `responseBytesDecoded` less `responseBytesReceived`.
+ */
+@property (readonly) int64_t responseBytesSaved;
+
+///-------------------------------
+/// @name Recording
+///-------------------------------
+
+/**
+ Record a request body.
+ 
+ @param originalLength The size of the body before compression.
+ @param sentLength The size of the body as sent.
+ */
+- (void)recordRequestBodyWithOriginalLength:(NSUInteger)originalLength sentLength:(NSUInteger)sentLength;
+
+/**
+ Record a response body.
+ 
+ @param response The response the body belongs to.  Its `Content-Encoding` and `Content-Length` headers give the size received over the network.
+ @param decodedLength The size of the body after decompression.
+ */
+- (void)recordResponse:(NSHTTPURLResponse *)response decodedLength:(long long)decodedLength;
+
+/**
+ Set every counter back to zero.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMCompressionMetrics.h"
+
+@interface SMCompressionMetrics ()
+
+@property (readwrite) int64_t requestBytesBeforeCompression;
+@property (readwrite) int64_t requestBytesSent;
+@property (readwrite) int64_t responseBytesReceived;
+@property (readwrite) int64_t responseBytesDecoded;
+
+@end
+
+@implementation SMCompressionMetrics
+
+@synthesize enabled = _SM_enabled;
+@synthesize requestBytesBeforeCompression = _SM_requestBytesBeforeCompression;
+@synthesize requestBytesSent = _SM_requestBytesSent;
+@synthesize responseBytesReceived = _SM_responseBytesReceived;
+@synthesize responseBytesDecoded = _SM_responseBytesDecoded;
+
+- (int64_t)requestBytesSaved
+{
+    @synchronized(self) {
+        return self.requestBytesBeforeCompression - self.requestBytesSent;
+    }
+}
+
+- (int64_t)responseBytesSaved
+{
+    @synchronized(self) {
+        return self.responseBytesDecoded - self.responseBytesReceived;
+    }
+}
+
+- (void)recordRequestBodyWithOriginalLength:(NSUInteger)originalLength sentLength:(NSUInteger)sentLength
+{
+    @synchronized(self) {
+        self.requestBytesBeforeCompression += originalLength;
+        self.requestBytesSent += sentLength;
+    }
+}
+
+- (void)recordResponse:(NSHTTPURLResponse *)response decodedLength:(long long)decodedLength
+{
+    long long receivedLength = decodedLength;
+    NSString *contentEncoding = [[response allHeaderFields] valueForKey:@"Content-Encoding"];
+    if (contentEncoding && [contentEncoding caseInsensitiveCompare:@"identity"] != NSOrderedSame && [response expectedContentLength] > 0) {
+        // Content-Length is the size of the body before NSURLConnection decoded it
+        receivedLength = [response expectedContentLength];
+    }
+    @synchronized(self) {
+        self.responseBytesReceived += receivedLength;
+        self.responseBytesDecoded += decodedLength;
+    }
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        self.requestBytesBeforeCompression = 0;
+        self.requestBytesSent = 0;
+        self.responseBytesReceived = 0;
+        self.responseBytesDecoded = 0;
+    }
+}
+
+@end
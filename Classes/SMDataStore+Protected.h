@@ -19,6 +19,18 @@
 #import "SMResponseBlocks.h"
 #import "AFJSONRequestOperation.h"
 
+/**
+ Internal state backing the single-flight behaviour of `queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:`.
+ */
+@interface SMDataStore ()
+
+/**
+ GET requests currently on the wire, keyed by <singleFlightKeyForRequest:>.  Only ever accessed on `inFlightReadsQueue`.
+ */
+@property (nonatomic, strong) NSMutableDictionary *inFlightReads;
+@property (nonatomic) dispatch_queue_t inFlightReadsQueue;
+
+@end
 
 /**
  Supplemental methods for <SMDataStore>.  In essence they add an extra layer of logic to existing `SMDataStore` methods for special conditions. 
@@ -74,10 +86,47 @@
                onSuccess:(SMDataStoreSuccessBlock)successBlock 
                onFailure:(SMDataStoreObjectIdFailureBlock)failureBlock;
 
+/**
+ Refreshes the access token and queues request again.
+
+ The retry is sent with a copy of options, so it keeps settings such as its streaming batch block, but does not try to refresh again.
+ */
+- (void)refreshAndRetry:(NSURLRequest *)request options:(SMRequestOptions *)requestOptions originalError:(NSError *)originalError requestSuccessCallbackQueue:(dispatch_queue_t)successCallbackQueue requestFailureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock;
+
+/**
+ Returns the key used to match identical GET requests while one of them is in flight.
+ 
+ The key is built from the URL and every header field except `Authorization`, which carries a fresh nonce and timestamp each time a request is signed.
+ 
+ @param request The request to build a key for.
+ 
+ @return A string identifying the request.
+ */
+- (NSString *)singleFlightKeyForRequest:(NSURLRequest *)request;
+
+/**
+ Signs and enqueues request, handling token refresh and 503 retries.
+ 
+ GET requests are single-flight: if an identical GET (see <singleFlightKeyForRequest:>) is already in flight, no new operation is enqueued.  The caller is instead attached to the existing operation and its blocks are called on its own callback queues with the shared response.  Retry behaviour is governed by the options of the request that went on the wire first.  Streaming requests (see `streamingBatchBlock` on <SMRequestOptions>) are never shared.
+ */
 - (void)queueRequest:(NSURLRequest *)request options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)onSuccess onFailure:(SMFullResponseFailureBlock)onFailure;
 
 - (NSString *)URLEncodedStringFromValue:(NSString *)value;
 
+/**
+ Builds the signed GET request for query, applying its headers.
+ */
+- (NSMutableURLRequest *)requestFromQuery:(SMQuery *)query options:(SMRequestOptions *)options;
+
+/**
+ Reads the range set on query with `fromIndex:toIndex:`, if any.
+ 
+ @param query The query to inspect.
+ @param startIndex Set to the first index requested.  Left untouched if the query has no range.
+ @param endIndex Set to one past the last index requested.  Left untouched if the query has no range or the range is open ended.
+ */
+- (void)getRangeOfQuery:(SMQuery *)query startIndex:(NSUInteger *)startIndex endIndex:(NSUInteger *)endIndex;
+
 - (AFJSONRequestOperation *)newOperationForRequest:(NSURLRequest *)request options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock;
 
 - (AFJSONRequestOperation *)postOperationForObject:(NSDictionary *)theObject inSchema:(NSString *)schema options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultSuccessBlock)successBlock onFailure:(SMCoreDataSaveFailureBlock)failureBlock;
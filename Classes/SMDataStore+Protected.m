@@ -17,8 +17,46 @@
 #import "SMDataStore+Protected.h"
 #import "SMError.h"
 #import "SMJSONRequestOperation.h"
+#import "SMStreamingJSONRequestOperation.h"
 #import "SMRequestOptions.h"
 #import "SMNetworkReachability.h"
+#import "SMRetryBudget.h"
+#import "SMCircuitBreaker.h"
+#import "SMRequestMetrics.h"
+#import "SMCompressionMetrics.h"
+#import "SMTracer.h"
+#import "SMLogger.h"
+
+/*
+ Bookkeeping for a GET which is on the wire.  The shared blocks are the ones handed to the operation; the waiter blocks belong to callers who asked for the same request while it was in flight.
+ */
+@interface SMInFlightRead : NSObject
+
+@property (nonatomic, copy) SMFullResponseSuccessBlock sharedSuccessBlock;
+@property (nonatomic, copy) SMFullResponseFailureBlock sharedFailureBlock;
+@property (nonatomic, strong) NSMutableArray *successWaiters;
+@property (nonatomic, strong) NSMutableArray *failureWaiters;
+
+@end
+
+@implementation SMInFlightRead
+
+@synthesize sharedSuccessBlock = _SM_sharedSuccessBlock;
+@synthesize sharedFailureBlock = _SM_sharedFailureBlock;
+@synthesize successWaiters = _SM_successWaiters;
+@synthesize failureWaiters = _SM_failureWaiters;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.successWaiters = [NSMutableArray array];
+        self.failureWaiters = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
 
 @implementation SMDataStore (SpecialCondition)
 
@@ -181,7 +219,7 @@
     }
 }
 
-- (void)refreshAndRetry:(NSURLRequest *)request originalError:(NSError *)originalError requestSuccessCallbackQueue:(dispatch_queue_t)successCallbackQueue requestFailureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock
+- (void)refreshAndRetry:(NSURLRequest *)request options:(SMRequestOptions *)requestOptions originalError:(NSError *)originalError requestSuccessCallbackQueue:(dispatch_queue_t)successCallbackQueue requestFailureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock
 {
     if (self.session.refreshing) {
         if (failureBlock) {
@@ -191,8 +229,10 @@
             });
         }
     } else {
-        __block SMRequestOptions *options = [SMRequestOptions options];
+        // A copy keeps everything about the original request, such as its streaming batch block, apart from trying to refresh again
+        __block SMRequestOptions *options = [requestOptions copy];
         [options setTryRefreshToken:NO];
+        [options setTokenRefreshed:YES];
         __block dispatch_queue_t newQueueForRefresh = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
         [self.session refreshTokenWithSuccessCallbackQueue:newQueueForRefresh failureCallbackQueue:newQueueForRefresh onSuccess:^(NSDictionary *userObject) {
             [self queueRequest:[self.session signRequest:request] options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:successBlock onFailure:failureBlock];
@@ -211,6 +251,129 @@
     }
 }
 
+- (BOOL)SM_isTransientNetworkError:(NSError *)error
+{
+    if (![[error domain] isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    switch ([error code]) {
+        case NSURLErrorTimedOut:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorDNSLookupFailed:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (BOOL)SM_scheduleRetryOfRequest:(NSURLRequest *)request response:(NSHTTPURLResponse *)response error:(NSError *)error JSON:(id)JSON options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock
+{
+    if (options.numberOfRetries <= 0) {
+        return NO;
+    }
+    
+    BOOL serviceUnavailable = [response statusCode] == SMErrorServiceUnavailable;
+    NSString *retryAfter = serviceUnavailable ? [[response allHeaderFields] valueForKey:@"Retry-After"] : nil;
+    NSString *method = [request HTTPMethod];
+    BOOL idempotent = [method isEqualToString:@"GET"] || [method isEqualToString:@"PUT"] || [method isEqualToString:@"DELETE"];
+    
+    double delayInSeconds = 0;
+    if (retryAfter) {
+        // The server has said when to come back, so any method may be retried
+        delayInSeconds = [retryAfter doubleValue];
+    } else if (idempotent && (serviceUnavailable || (response == nil && [self SM_isTransientNetworkError:error]))) {
+        // Exponential backoff with full jitter
+        double ceiling = MIN(options.retryMaxDelay, options.retryBaseDelay * pow(2, options.retriesAttempted));
+        delayInSeconds = ceiling * ((double)arc4random() / ((double)UINT32_MAX + 1));
+    } else {
+        return NO;
+    }
+    
+    if (![self.session.retryBudget withdrawRetry]) {
+        return NO;
+    }
+    
+    [options setNumberOfRetries:(options.numberOfRetries - 1)];
+    [options setRetriesAttempted:(options.retriesAttempted + 1)];
+    SMLogDebug(SMLogSubsystemNetwork, @"Retrying %@ %@ in %.2fs (attempt %lu), status %d, error %@", [request HTTPMethod], [[request URL] path], delayInSeconds, (unsigned long)options.retriesAttempted, (int)[response statusCode], error);
+    dispatch_time_t popTime = dispatch_time(DISPATCH_TIME_NOW, delayInSeconds * NSEC_PER_SEC);
+    dispatch_after(popTime, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void){
+        if (options.retryBlock && serviceUnavailable) {
+            options.retryBlock(request, response, error, JSON, options, successBlock, failureBlock);
+        } else {
+            [self queueRequest:[self.session signRequest:request] options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:successBlock onFailure:failureBlock];
+        }
+    });
+    return YES;
+}
+
+- (SMFullResponseSuccessBlock)SM_successBlockRecordingCircuitOutcome:(SMFullResponseSuccessBlock)successBlock
+{
+    SMCircuitBreaker *circuitBreaker = self.session.circuitBreaker;
+    if (circuitBreaker == nil) {
+        return successBlock;
+    }
+    return ^(NSURLRequest *successRequest, NSHTTPURLResponse *response, id JSON) {
+        [circuitBreaker recordResponse:response error:nil forRequest:successRequest];
+        if (successBlock) {
+            successBlock(successRequest, response, JSON);
+        }
+    };
+}
+
+- (SMRequestMetricsSample *)SM_metricsSampleForRequest:(NSURLRequest *)request options:(SMRequestOptions *)options
+{
+    SMRequestMetricsSample *sample = [[SMRequestMetricsSample alloc] init];
+    NSString *schema = @"";
+    for (NSString *component in [[[request URL] path] pathComponents]) {
+        if (![component isEqualToString:@"/"]) {
+            schema = component;
+            break;
+        }
+    }
+    sample.schema = schema;
+    sample.method = [request HTTPMethod];
+    // Streamed bodies declare their length up front
+    sample.requestBytes = [request HTTPBody] ? [[request HTTPBody] length] : [[request valueForHTTPHeaderField:@"Content-Length"] longLongValue];
+    sample.retryCount = options.retriesAttempted;
+    sample.tokenRefreshed = options.tokenRefreshed;
+    return sample;
+}
+
+- (AFJSONRequestOperation *)SM_JSONRequestOperationWithRequest:(NSURLRequest *)request options:(SMRequestOptions *)options success:(SMFullResponseSuccessBlock)successBlock failure:(SMFullResponseFailureBlock)failureBlock
+{
+    AFJSONRequestOperation *op = nil;
+    if (options.streamingBatchBlock) {
+        op = [SMStreamingJSONRequestOperation JSONRequestOperationWithRequest:request batchSize:options.streamingBatchSize batchBlock:options.streamingBatchBlock success:successBlock failure:failureBlock];
+    } else {
+        op = [SMJSONRequestOperation JSONRequestOperationWithRequest:request success:successBlock failure:failureBlock];
+    }
+    // The scheduler reads the request's priority class back off the operation
+    [op setQueuePriority:[SMRequestScheduler queuePriorityForRequestPriority:options.priority]];
+    
+    SMRequestMetrics *requestMetrics = self.session.requestMetrics;
+    if (requestMetrics.isCollecting) {
+        [(SMJSONRequestOperation *)op reportMetricsTo:requestMetrics sample:[self SM_metricsSampleForRequest:request options:options]];
+    }
+    
+    SMCompressionMetrics *compressionMetrics = self.session.compressionMetrics;
+    if (compressionMetrics.enabled) {
+        [(SMJSONRequestOperation *)op reportCompressionTo:compressionMetrics];
+    }
+    
+    SMTracer *tracer = [SMTracer sharedTracer];
+    if (tracer.enabled) {
+        if (!options.parentTraceSpan) {
+            // Kept on the options so retries, which are sent from callback queues, stay under the same parent
+            options.parentTraceSpan = [tracer currentSpan];
+        }
+        [(SMJSONRequestOperation *)op traceWithParentSpan:options.parentTraceSpan];
+    }
+    return op;
+}
+
 - (AFJSONRequestOperation *)newOperationForRequest:(NSURLRequest *)request options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)successBlock onFailure:(SMFullResponseFailureBlock)failureBlock
 {
     if (options.headers && [options.headers count] > 0) {
@@ -225,26 +388,17 @@
         options.headers = [NSDictionary dictionary];
     }
     
+    // Set once the operation exists; read and cleared by retryBlock, which the operation releases after calling it
+    __block SMStreamingJSONRequestOperation *streamingOperation = nil;
     SMFullResponseFailureBlock retryBlock = ^(NSURLRequest *originalRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
-        if ([response statusCode] == SMErrorServiceUnavailable && options.numberOfRetries > 0) {
-            NSString *retryAfter = [[response allHeaderFields] valueForKey:@"Retry-After"];
-            if (retryAfter) {
-                [options setNumberOfRetries:(options.numberOfRetries - 1)];
-                double delayInSeconds = [retryAfter doubleValue];
-                dispatch_time_t popTime = dispatch_time(DISPATCH_TIME_NOW, delayInSeconds * NSEC_PER_SEC);
-                dispatch_after(popTime, dispatch_get_main_queue(), ^(void){
-                    if (options.retryBlock) {
-                        options.retryBlock(originalRequest, response, error, JSON, options, successBlock, failureBlock);
-                    } else {
-                        [self queueRequest:[self.session signRequest:originalRequest] options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:successBlock onFailure:failureBlock];
-                    }
-                });
-            } else {
-                if (failureBlock) {
-                    failureBlock(originalRequest, response, error, JSON);
-                }
-            }
-        } else if ([error domain] == NSURLErrorDomain && [error code] == -1009) {
+        [self.session.circuitBreaker recordResponse:response error:error forRequest:originalRequest];
+        // Rows streamed before the failure have already reached the caller, and a retry would deliver them again
+        BOOL deliveredRows = streamingOperation.hasDeliveredRows;
+        streamingOperation = nil;
+        if (!deliveredRows && [self SM_scheduleRetryOfRequest:originalRequest response:response error:error JSON:JSON options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:successBlock onFailure:failureBlock]) {
+            return;
+        }
+        if ([error domain] == NSURLErrorDomain && [error code] == -1009) {
             if (failureBlock) {
                 NSError *networkNotReachableError = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorNetworkNotReachable userInfo:[error userInfo]];
                 failureBlock(originalRequest, response, networkNotReachableError, JSON);
@@ -256,18 +410,45 @@
         }
     };
     
-    AFJSONRequestOperation *op = [SMJSONRequestOperation JSONRequestOperationWithRequest:request success:successBlock failure:retryBlock];
+    AFJSONRequestOperation *op = [self SM_JSONRequestOperationWithRequest:request options:options success:[self SM_successBlockRecordingCircuitOutcome:successBlock] failure:retryBlock];
+    if ([op isKindOfClass:[SMStreamingJSONRequestOperation class]]) {
+        streamingOperation = (SMStreamingJSONRequestOperation *)op;
+    }
     if (successCallbackQueue) {
         [op setSuccessCallbackQueue:successCallbackQueue];
     }
     if (failureCallbackQueue) {
         [op setFailureCallbackQueue:failureCallbackQueue];
     }
+    [self.session.retryBudget recordRequest];
     
     return op;
     
 }
 
+- (NSString *)singleFlightKeyForRequest:(NSURLRequest *)request
+{
+    NSMutableString *key = [NSMutableString stringWithFormat:@"%@ %@", [request HTTPMethod], [[request URL] absoluteString]];
+    NSDictionary *headers = [request allHTTPHeaderFields];
+    NSArray *sortedHeaderFields = [[headers allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)];
+    for (NSString *headerField in sortedHeaderFields) {
+        if ([headerField caseInsensitiveCompare:@"Authorization"] != NSOrderedSame) {
+            [key appendFormat:@"\n%@: %@", [headerField lowercaseString], [headers objectForKey:headerField]];
+        }
+    }
+    return key;
+}
+
+- (SMInFlightRead *)SM_removeInFlightReadForKey:(NSString *)key
+{
+    __block SMInFlightRead *inFlightRead = nil;
+    dispatch_sync(self.inFlightReadsQueue, ^{
+        inFlightRead = [self.inFlightReads objectForKey:key];
+        [self.inFlightReads removeObjectForKey:key];
+    });
+    return inFlightRead;
+}
+
 - (void)queueRequest:(NSURLRequest *)request options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMFullResponseSuccessBlock)onSuccess onFailure:(SMFullResponseFailureBlock)onFailure
 {
     if (options.headers && [options.headers count] > 0) {
@@ -290,33 +471,101 @@
         options.headers = [NSDictionary dictionary];
     }
     
-    
+    if ([[request HTTPMethod] isEqualToString:@"GET"] && !options.streamingBatchBlock) {
+        // Single-flight: identical GETs share one operation and the response is fanned out to every caller.
+        NSString *singleFlightKey = [self singleFlightKeyForRequest:request];
+        __block BOOL joinedInFlightRead = NO;
+        __block SMInFlightRead *newInFlightRead = nil;
+        dispatch_sync(self.inFlightReadsQueue, ^{
+            SMInFlightRead *inFlightRead = [self.inFlightReads objectForKey:singleFlightKey];
+            if (inFlightRead == nil) {
+                newInFlightRead = [[SMInFlightRead alloc] init];
+                [self.inFlightReads setObject:newInFlightRead forKey:singleFlightKey];
+            } else if (inFlightRead.sharedSuccessBlock != onSuccess) {
+                // Anything other than the shared blocks coming back around on a retry joins the request already on the wire.
+                dispatch_queue_t waiterSuccessQueue = successCallbackQueue ? successCallbackQueue : dispatch_get_main_queue();
+                dispatch_queue_t waiterFailureQueue = failureCallbackQueue ? failureCallbackQueue : dispatch_get_main_queue();
+                [inFlightRead.successWaiters addObject:[^(NSURLRequest *successRequest, NSHTTPURLResponse *response, id JSON) {
+                    if (onSuccess) {
+                        dispatch_async(waiterSuccessQueue, ^{
+                            onSuccess(successRequest, response, JSON);
+                        });
+                    }
+                } copy]];
+                [inFlightRead.failureWaiters addObject:[^(NSURLRequest *failedRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
+                    if (onFailure) {
+                        dispatch_async(waiterFailureQueue, ^{
+                            onFailure(failedRequest, response, error, JSON);
+                        });
+                    }
+                } copy]];
+                joinedInFlightRead = YES;
+            }
+        });
+        
+        if (joinedInFlightRead) {
+            return;
+        }
+        
+        if (newInFlightRead) {
+            // The shared blocks run on the first caller's queues, so the first caller is called directly and everyone else is dispatched to their own queue.
+            SMFullResponseSuccessBlock originalSuccessBlock = onSuccess;
+            SMFullResponseFailureBlock originalFailureBlock = onFailure;
+            onSuccess = ^(NSURLRequest *successRequest, NSHTTPURLResponse *response, id JSON) {
+                SMInFlightRead *finishedRead = [self SM_removeInFlightReadForKey:singleFlightKey];
+                if (originalSuccessBlock) {
+                    originalSuccessBlock(successRequest, response, JSON);
+                }
+                for (SMFullResponseSuccessBlock waiter in finishedRead.successWaiters) {
+                    waiter(successRequest, response, JSON);
+                }
+            };
+            onFailure = ^(NSURLRequest *failedRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
+                SMInFlightRead *finishedRead = [self SM_removeInFlightReadForKey:singleFlightKey];
+                if (originalFailureBlock) {
+                    originalFailureBlock(failedRequest, response, error, JSON);
+                }
+                for (SMFullResponseFailureBlock waiter in finishedRead.failureWaiters) {
+                    waiter(failedRequest, response, error, JSON);
+                }
+            };
+            newInFlightRead.sharedSuccessBlock = onSuccess;
+            newInFlightRead.sharedFailureBlock = onFailure;
+        }
+    }
     
     if (self.session.refreshToken != nil && options.tryRefreshToken && [self.session accessTokenHasExpired]) {
-        [self refreshAndRetry:request originalError:nil requestSuccessCallbackQueue:successCallbackQueue requestFailureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure];
+        [self refreshAndRetry:request options:options originalError:nil requestSuccessCallbackQueue:successCallbackQueue requestFailureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure];
     } 
     else {
+        SMCircuitBreaker *circuitBreaker = self.session.circuitBreaker;
+        if (circuitBreaker && ![circuitBreaker allowRequest:request]) {
+            // The schema has been failing, so report it as unreachable now rather than after a timeout
+            if (onFailure) {
+                NSDictionary *userInfo = [NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Requests to %@ are failing.  Not sending any more until it recovers.", [SMCircuitBreaker keyForRequest:request]] forKey:NSLocalizedDescriptionKey];
+                NSError *circuitOpenError = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorNetworkNotReachable userInfo:userInfo];
+                dispatch_async(failureCallbackQueue ? failureCallbackQueue : dispatch_get_main_queue(), ^{
+                    onFailure(request, nil, circuitOpenError, nil);
+                });
+            }
+            return;
+        }
+        
+        // Set once the operation exists; read and cleared by retryBlock, which the operation releases after calling it
+        __block SMStreamingJSONRequestOperation *streamingOperation = nil;
         SMFullResponseFailureBlock retryBlock = ^(NSURLRequest *originalRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
-            if ([response statusCode] == SMErrorUnauthorized && options.tryRefreshToken) {
-                [self refreshAndRetry:originalRequest originalError:[self errorFromResponse:response JSON:JSON] requestSuccessCallbackQueue:successCallbackQueue requestFailureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure];
-            } else if ([response statusCode] == SMErrorServiceUnavailable && options.numberOfRetries > 0) {
-                NSString *retryAfter = [[response allHeaderFields] valueForKey:@"Retry-After"];
-                if (retryAfter) {
-                    [options setNumberOfRetries:(options.numberOfRetries - 1)];
-                    double delayInSeconds = [retryAfter doubleValue];
-                    dispatch_time_t popTime = dispatch_time(DISPATCH_TIME_NOW, delayInSeconds * NSEC_PER_SEC);
-                    dispatch_after(popTime, dispatch_get_main_queue(), ^(void){
-                        if (options.retryBlock) {
-                            options.retryBlock(originalRequest, response, error, JSON, options, onSuccess, onFailure);
-                        } else {
-                            [self queueRequest:[self.session signRequest:originalRequest] options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure];
-                        }
-                    });
-                } else {
-                    if (onFailure) {
-                        onFailure(originalRequest, response, error, JSON);
-                    }
+            [circuitBreaker recordResponse:response error:error forRequest:originalRequest];
+            // Rows streamed before the failure have already reached the caller, and sending the request again would deliver them twice
+            BOOL deliveredRows = streamingOperation.hasDeliveredRows;
+            streamingOperation = nil;
+            if (deliveredRows) {
+                if (onFailure) {
+                    onFailure(originalRequest, response, error, JSON);
                 }
+            } else if ([response statusCode] == SMErrorUnauthorized && options.tryRefreshToken) {
+                [self refreshAndRetry:originalRequest options:options originalError:[self errorFromResponse:response JSON:JSON] requestSuccessCallbackQueue:successCallbackQueue requestFailureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure];
+            } else if ([self SM_scheduleRetryOfRequest:originalRequest response:response error:error JSON:JSON options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:onSuccess onFailure:onFailure]) {
+                // A retry has been scheduled
             } else if ([error domain] == NSURLErrorDomain && [error code] == -1009) {
                 if (onFailure) {
                     NSError *networkNotReachableError = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorNetworkNotReachable userInfo:[error userInfo]];
@@ -329,13 +578,17 @@
             }
         };
         
-        AFJSONRequestOperation *op = [SMJSONRequestOperation JSONRequestOperationWithRequest:request success:onSuccess failure:retryBlock];
+        AFJSONRequestOperation *op = [self SM_JSONRequestOperationWithRequest:request options:options success:[self SM_successBlockRecordingCircuitOutcome:onSuccess] failure:retryBlock];
+        if ([op isKindOfClass:[SMStreamingJSONRequestOperation class]]) {
+            streamingOperation = (SMStreamingJSONRequestOperation *)op;
+        }
         if (successCallbackQueue) {
             [op setSuccessCallbackQueue:successCallbackQueue];
         }
         if (failureCallbackQueue) {
             [op setFailureCallbackQueue:failureCallbackQueue];
         }
+        [self.session.retryBudget recordRequest];
         [[self.session oauthClientWithHTTPS:options.isSecure] enqueueHTTPRequestOperation:op];
     }
     
@@ -366,7 +619,14 @@
             theSchema = [theSchema lowercaseString];
         }
         
-        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObject];
+        NSError *requestError = nil;
+        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObject error:&requestError];
+        if (request == nil) {
+            if (failureBlock) {
+                failureBlock(nil, requestError, theObject, options, nil);
+            }
+            return nil;
+        }
         SMFullResponseSuccessBlock urlSuccessBlock = [self SMFullResponseSuccessBlockForResultSuccessBlock:successBlock];
         SMFullResponseFailureBlock urlFailureBlock = [self SMFullResponseFailureBlockForObject:theObject options:options originalSuccessBlock:successBlock coreDataSaveFailureBlock:failureBlock];
         return [self newOperationForRequest:request options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:urlSuccessBlock onFailure:urlFailureBlock];
@@ -384,7 +644,14 @@
     } else {
         NSString *path = [[schema lowercaseString] stringByAppendingPathComponent:[self URLEncodedStringFromValue:theObjectId]];
         
-        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"PUT" path:path parameters:updatedFields];
+        NSError *requestError = nil;
+        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"PUT" path:path parameters:updatedFields error:&requestError];
+        if (request == nil) {
+            if (failureBlock) {
+                failureBlock(nil, requestError, updatedFields, options, nil);
+            }
+            return nil;
+        }
         
         SMFullResponseSuccessBlock urlSuccessBlock = [self SMFullResponseSuccessBlockForResultSuccessBlock:successBlock];
         SMFullResponseFailureBlock urlFailureBlock = [self SMFullResponseFailureBlockForObject:updatedFields options:options originalSuccessBlock:successBlock coreDataSaveFailureBlock:failureBlock];
@@ -27,6 +27,7 @@
 @class SMUserSession;
 @class SMRequestOptions;
 @class SMCustomCodeRequest;
+@class SMQueryCursor;
 
 /**
  `SMDataStore` exposes an interface for performing CRUD operations on known StackMob objects and for executing an <SMQuery> or <SMCustomCodeRequest>.
@@ -379,6 +380,73 @@
 - (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options successCallbackQueue:(dispatch_queue_t)successCallbackQueue
 failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
 
+/**
+ Execute a query against your StackMob Datastore, receiving the results in batches as the response downloads.
+ 
+ Rows are parsed as soon as they arrive rather than after the whole response has been received, so large result sets can be processed while the download continues and are never held in memory as one array.
+ 
+ @param query An `SMQuery` object describing the query to perform.
+ @param options An options object contains headers and other configuration for this request.
+ @param batchSize The number of rows passed to batchBlock at a time.
+ @param successCallbackQueue The dispatch queue used to execute the batch and success blocks. Should be serial so batches arrive in order. If nil is passed, the main queue is used.
+ @param failureCallbackQueue The dispatch queue used to execute the failure block. If nil is passed, the main queue is used.
+ @param batchBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i>. A block object to invoke on the successCallbackQueue with each batch of object dictionaries, in order.
+ @param successBlock <i>typedef void (^SMSuccessBlock)()</i>. A block object to invoke on the successCallbackQueue after the last batch.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i>. A block object to invoke on the failureCallbackQueue if the Datastore fails to perform the query. Passed the error returned by StackMob.  Batches delivered before a failure are not retracted.
+ */
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options batchSize:(NSUInteger)batchSize successCallbackQueue:(dispatch_queue_t)successCallbackQueue
+failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Execute a query against your StackMob Datastore, fetching a large result set as several pages in parallel.
+ 
+ The first page is requested on its own.  If its `Content-Range` header gives the size of the result set, the remaining pages are requested with up to maxConcurrentPages in flight at once; otherwise pages are requested one after another until a short page is returned.  Any range already set on the query with `fromIndex:toIndex:` is respected.  Results are reassembled in order.
+ 
+ Pages are separate requests, so the query should be ordered on a unique field (or end its ordering with one) for rows not to be repeated or skipped between pages.
+ 
+ @param query An `SMQuery` object describing the query to perform.
+ @param options An options object contains headers and other configuration for this request.  A copy is used for each page.
+ @param pageSize The number of objects to request per page.
+ @param maxConcurrentPages The maximum number of page requests in flight at once.
+ @param successCallbackQueue The dispatch queue used to execute the success block. If nil is passed, the main queue is used.
+ @param failureCallbackQueue The dispatch queue used to execute the failure block. If nil is passed, the main queue is used.
+ @param successBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i>. A block object to invoke on the successCallbackQueue once every page has been received. Passed an array of object dictionaries returned from StackMob (if any).
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i>. A block object to invoke on the failureCallbackQueue if any page fails. Passed the error returned by StackMob.
+ */
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize maxConcurrentPages:(NSUInteger)maxConcurrentPages successCallbackQueue:(dispatch_queue_t)successCallbackQueue
+failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Execute a query against your StackMob Datastore, fetching a large result set as several pages in parallel and handing the rows over in order as they arrive.
+ 
+ See `performQuery:options:pageSize:maxConcurrentPages:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:` for how pages are requested.  Each page is parsed as it downloads, in batches of the options' `streamingBatchSize`.  Rows of the earliest unfinished page are handed over straight away; rows of later pages are held until every page before them has been handed over.
+ 
+ @param query An `SMQuery` object describing the query to perform.
+ @param options An options object contains headers and other configuration for this request.  A copy is used for each page.
+ @param pageSize The number of objects to request per page.
+ @param maxConcurrentPages The maximum number of page requests in flight at once.
+ @param successCallbackQueue The dispatch queue used to execute the page and success blocks. Should be serial so pages arrive in order. If nil is passed, the main queue is used.
+ @param failureCallbackQueue The dispatch queue used to execute the failure block. If nil is passed, the main queue is used.
+ @param pageBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i>. A block object to invoke on the successCallbackQueue with each non-empty batch of object dictionaries, in order.
+ @param successBlock <i>typedef void (^SMSuccessBlock)()</i>. A block object to invoke on the successCallbackQueue after the last page.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i>. A block object to invoke on the failureCallbackQueue if any page fails. Passed the error returned by StackMob.  Pages delivered before a failure are not retracted.
+ */
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize maxConcurrentPages:(NSUInteger)maxConcurrentPages successCallbackQueue:(dispatch_queue_t)successCallbackQueue
+failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onPage:(SMResultsSuccessBlock)pageBlock onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Create a cursor which walks the results of a query one page at a time, fetching the next page ahead of time.
+ 
+ See <SMQueryCursor> for details.
+ 
+ @param query An `SMQuery` object describing the query to page through.
+ @param options An options object contains headers and other configuration used for every page request.
+ @param pageSize The number of objects to request per page.
+ 
+ @return A new `SMQueryCursor` positioned at the first page.
+ */
+- (SMQueryCursor *)cursorForQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize;
+
 /** 
  Count the results that would be returned by a query against your StackMob Datastore.
   
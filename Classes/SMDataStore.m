@@ -27,6 +27,7 @@
 #import "SMUserSession.h"
 #import "SMCustomCodeRequest.h"
 #import "SMResponseBlocks.h"
+#import "SMQueryCursor.h"
 
 @interface SMDataStore ()
 
@@ -38,6 +39,8 @@
 
 @synthesize apiVersion = _SM_apiVersion;
 @synthesize session = _SM_session;
+@synthesize inFlightReads = _SM_inFlightReads;
+@synthesize inFlightReadsQueue = _SM_inFlightReadsQueue;
 
 - (id)initWithAPIVersion:(NSString *)apiVersion session:(SMUserSession *)session
 {
@@ -45,10 +48,19 @@
     if (self) {
         self.apiVersion = apiVersion;
 		self.session = session;
+        self.inFlightReads = [NSMutableDictionary dictionary];
+        self.inFlightReadsQueue = dispatch_queue_create("com.stackmob.inFlightReadsQueue", NULL);
     }
     return self;
 }
 
+- (void)dealloc
+{
+    if (_SM_inFlightReadsQueue) {
+        dispatch_release(_SM_inFlightReadsQueue);
+    }
+}
+
 - (void)createObject:(NSDictionary *)theObject inSchema:(NSString *)schema onSuccess:(SMDataStoreSuccessBlock)successBlock onFailure:(SMDataStoreFailureBlock)failureBlock
 {
     [self createObject:theObject inSchema:schema options:[SMRequestOptions options] onSuccess:successBlock onFailure:failureBlock];
@@ -79,7 +91,14 @@ failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue
             theSchema = [theSchema lowercaseString];
         }
         
-        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObject];
+        NSError *requestError = nil;
+        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObject error:&requestError];
+        if (request == nil) {
+            if (failureBlock) {
+                failureBlock(requestError, theObject, schema);
+            }
+            return;
+        }
         SMFullResponseSuccessBlock urlSuccessBlock = [self SMFullResponseSuccessBlockForSchema:schema withSuccessBlock:successBlock];
         SMFullResponseFailureBlock urlFailureBlock = [self SMFullResponseFailureBlockForObject:theObject ofSchema:schema withFailureBlock:failureBlock];
         [self queueRequest:request options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:urlSuccessBlock onFailure:urlFailureBlock];
@@ -119,10 +138,9 @@ failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue
         //see https://github.com/AFNetworking/AFNetworking/issues/363 which suggests the approach of calling requestWithMethod followed by
         //setHTTPBody with the JSON array data. The parameters object can't be nil so we pass the first object, but this arbitrary and
         //will get over-written in the call to setHTTPBody below
-        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObjects[0]];
-        
         NSError *error = nil;
-        NSData *jsonData = [NSJSONSerialization dataWithJSONObject:theObjects options:0 error:&error];
+        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"POST" path:theSchema parameters:theObjects[0] error:&error];
+        NSData *jsonData = request ? [NSJSONSerialization dataWithJSONObject:theObjects options:0 error:&error] : nil;
         if(error != nil) {
             failureBlock(error, theObjects, schema);
         } else {
@@ -172,7 +190,14 @@ failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue
     } else {
         NSString *path = [[schema lowercaseString] stringByAppendingPathComponent:[self URLEncodedStringFromValue:theObjectId]];
         
-        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"PUT" path:path parameters:updatedFields];
+        NSError *requestError = nil;
+        NSMutableURLRequest *request = [[self.session oauthClientWithHTTPS:options.isSecure] requestWithMethod:@"PUT" path:path parameters:updatedFields error:&requestError];
+        if (request == nil) {
+            if (failureBlock) {
+                failureBlock(requestError, updatedFields, schema);
+            }
+            return;
+        }
         
         SMFullResponseSuccessBlock urlSuccessBlock = [self SMFullResponseSuccessBlockForSchema:schema withSuccessBlock:successBlock];
         SMFullResponseFailureBlock urlFailureBlock = [self SMFullResponseFailureBlockForObject:updatedFields ofSchema:schema withFailureBlock:failureBlock];
@@ -247,6 +272,21 @@ failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue
     return request;
 }
 
+- (void)getRangeOfQuery:(SMQuery *)query startIndex:(NSUInteger *)startIndex endIndex:(NSUInteger *)endIndex
+{
+    // Range headers look like objects=0-9, or objects=10- when open ended.  endIndex is exclusive.
+    NSString *rangeHeader = [query.requestHeaders objectForKey:@"Range"];
+    if ([rangeHeader hasPrefix:@"objects="]) {
+        NSArray *bounds = [[rangeHeader substringFromIndex:[@"objects=" length]] componentsSeparatedByString:@"-"];
+        if ([bounds count] == 2) {
+            *startIndex = [[bounds objectAtIndex:0] integerValue];
+            if ([[bounds objectAtIndex:1] length] > 0) {
+                *endIndex = [[bounds objectAtIndex:1] integerValue] + 1;
+            }
+        }
+    }
+}
+
 - (void)performQuery:(SMQuery *)query onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
 {
     [self performQuery:query options:[SMRequestOptions options] onSuccess:successBlock onFailure:failureBlock];
@@ -267,6 +307,209 @@ failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue
     [self queueRequest:request options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:urlSuccessBlock onFailure:urlFailureBlock];
 }
 
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options batchSize:(NSUInteger)batchSize successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    options.streamingBatchSize = batchSize;
+    options.streamingBatchBlock = batchBlock ? batchBlock : ^(NSArray *results) {};
+    
+    NSMutableURLRequest *request = [self requestFromQuery:query options:options];
+    
+    SMFullResponseSuccessBlock urlSuccessBlock = [self SMFullResponseSuccessBlockForSuccessBlock:successBlock];
+    SMFullResponseFailureBlock urlFailureBlock = [self SMFullResponseFailureBlockForFailureBlock:failureBlock];
+    
+    [self queueRequest:request options:options successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onSuccess:urlSuccessBlock onFailure:urlFailureBlock];
+}
+
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize maxConcurrentPages:(NSUInteger)maxConcurrentPages successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    // Pages are collected on a serial queue, whatever kind of queue the caller asked for
+    dispatch_queue_t collectQueue = dispatch_queue_create("Paged Query Results Queue", NULL);
+    __block NSMutableArray *allResults = [NSMutableArray array];
+    
+    [self performQuery:query options:options pageSize:pageSize maxConcurrentPages:maxConcurrentPages successCallbackQueue:collectQueue failureCallbackQueue:failureCallbackQueue onPage:^(NSArray *results) {
+        [allResults addObjectsFromArray:results];
+    } onSuccess:^{
+        if (successBlock) {
+            dispatch_async(successCallbackQueue ? successCallbackQueue : dispatch_get_main_queue(), ^{
+                successBlock(allResults);
+            });
+        }
+        dispatch_release(collectQueue);
+    } onFailure:^(NSError *error) {
+        if (failureBlock) {
+            failureBlock(error);
+        }
+        dispatch_release(collectQueue);
+    }];
+}
+
+- (void)performQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize maxConcurrentPages:(NSUInteger)maxConcurrentPages successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onPage:(SMResultsSuccessBlock)pageBlock onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    if (query == nil || pageSize == 0) {
+        if (failureBlock) {
+            NSError *error = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorInvalidArguments userInfo:nil];
+            failureBlock(error);
+        }
+        return;
+    }
+    
+    if (!successCallbackQueue) {
+        successCallbackQueue = dispatch_get_main_queue();
+    }
+    if (!failureCallbackQueue) {
+        failureCallbackQueue = dispatch_get_main_queue();
+    }
+    
+    __block NSUInteger startIndex = 0;
+    __block NSUInteger endIndex = NSNotFound;
+    [self getRangeOfQuery:query startIndex:&startIndex endIndex:&endIndex];
+    
+    // All of the bookkeeping below is only touched on pageQueue
+    dispatch_queue_t pageQueue = dispatch_queue_create("Paged Query Queue", NULL);
+    // Rows streamed for pages which are not yet next in line, and the number of rows each page has received, keyed by page start
+    __block NSMutableDictionary *rowsAwaitingDelivery = [NSMutableDictionary dictionary];
+    __block NSMutableDictionary *rowCounts = [NSMutableDictionary dictionary];
+    __block NSMutableSet *completedPages = [NSMutableSet set];
+    __block NSUInteger nextPageToRequest = startIndex;
+    __block NSUInteger nextPageToDeliver = startIndex;
+    __block NSUInteger pagesInFlight = 0;
+    // One page at a time until the first response tells us the total
+    __block NSUInteger concurrentPageLimit = 1;
+    __block BOOL finished = NO;
+    __block void (^requestPages)(void) = nil;
+    
+    void (^deliverRows)(NSArray *) = ^(NSArray *rows) {
+        if (pageBlock && [rows count] > 0) {
+            dispatch_async(successCallbackQueue, ^{
+                pageBlock(rows);
+            });
+        }
+    };
+    
+    // Hand over whatever the page next in line has streamed so far, and move past every page which has finished
+    void (^deliverPages)(void) = ^{
+        while (YES) {
+            NSNumber *pageKey = [NSNumber numberWithUnsignedInteger:nextPageToDeliver];
+            NSMutableArray *rows = [rowsAwaitingDelivery objectForKey:pageKey];
+            if ([rows count] > 0) {
+                deliverRows([rows copy]);
+                [rows removeAllObjects];
+            }
+            if (![completedPages containsObject:pageKey]) {
+                break;
+            }
+            [completedPages removeObject:pageKey];
+            [rowsAwaitingDelivery removeObjectForKey:pageKey];
+            [rowCounts removeObjectForKey:pageKey];
+            nextPageToDeliver += pageSize;
+        }
+    };
+    
+    requestPages = [^{
+        while (!finished && pagesInFlight < concurrentPageLimit && nextPageToRequest < endIndex) {
+            NSUInteger pageStart = nextPageToRequest;
+            NSUInteger pageEnd = MIN(pageStart + pageSize, endIndex);
+            NSNumber *pageKey = [NSNumber numberWithUnsignedInteger:pageStart];
+            nextPageToRequest = pageEnd;
+            pagesInFlight++;
+            [rowsAwaitingDelivery setObject:[NSMutableArray array] forKey:pageKey];
+            [rowCounts setObject:[NSNumber numberWithUnsignedInteger:0] forKey:pageKey];
+            
+            SMQuery *pageQuery = [[SMQuery alloc] initWithSchema:query.schemaName];
+            pageQuery.requestParameters = query.requestParameters;
+            pageQuery.requestHeaders = [query.requestHeaders copy];
+            [pageQuery fromIndex:pageStart toIndex:(pageEnd - 1)];
+            // queueRequest: consumes the headers and retry count of the options it is given, so each page needs its own
+            SMRequestOptions *pageOptions = [options copy];
+            
+            // Each page is parsed as it downloads.  Rows of the page next in line go straight to the caller; later pages hold on to theirs until it is their turn.
+            void (^receiveRows)(NSArray *) = ^(NSArray *rows) {
+                if (finished) {
+                    return;
+                }
+                [rowCounts setObject:[NSNumber numberWithUnsignedInteger:[[rowCounts objectForKey:pageKey] unsignedIntegerValue] + [rows count]] forKey:pageKey];
+                if (pageStart == nextPageToDeliver) {
+                    deliverRows(rows);
+                } else {
+                    [[rowsAwaitingDelivery objectForKey:pageKey] addObjectsFromArray:rows];
+                }
+            };
+            pageOptions.streamingBatchBlock = receiveRows;
+            NSMutableURLRequest *request = [self requestFromQuery:pageQuery options:pageOptions];
+            
+            SMFullResponseSuccessBlock pageSuccessBlock = ^(NSURLRequest *pageRequest, NSHTTPURLResponse *response, id JSON) {
+                pagesInFlight--;
+                if (!finished) {
+                    // A streamed array has already been delivered through receiveRows
+                    if ([JSON isKindOfClass:[NSArray class]]) {
+                        receiveRows(JSON);
+                    }
+                    NSUInteger rowCount = [[rowCounts objectForKey:pageKey] unsignedIntegerValue];
+                    if (pageStart == startIndex) {
+                        NSString *rangeHeader = [response.allHeaderFields valueForKey:@"Content-Range"];
+                        int count = [self countFromRangeHeader:rangeHeader results:nil];
+                        if (rangeHeader && count >= 0) {
+                            // The total is known, so the remaining pages can be fetched in parallel
+                            endIndex = MIN(endIndex, (NSUInteger)count);
+                            concurrentPageLimit = MAX(maxConcurrentPages, (NSUInteger)1);
+                        }
+                    }
+                    if (rowCount < pageEnd - pageStart) {
+                        // A short page means the end of the collection was reached
+                        endIndex = MIN(endIndex, pageStart + rowCount);
+                    }
+                    
+                    [completedPages addObject:pageKey];
+                    deliverPages();
+                    
+                    if (nextPageToRequest >= endIndex && pagesInFlight == 0) {
+                        finished = YES;
+                        if (successBlock) {
+                            dispatch_async(successCallbackQueue, ^{
+                                successBlock();
+                            });
+                        }
+                    } else {
+                        requestPages();
+                    }
+                }
+                if (finished && pagesInFlight == 0) {
+                    requestPages = nil;
+                    dispatch_release(pageQueue);
+                }
+            };
+            
+            SMFullResponseFailureBlock pageFailureBlock = ^(NSURLRequest *pageRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
+                pagesInFlight--;
+                if (!finished) {
+                    finished = YES;
+                    if (failureBlock) {
+                        NSError *pageError = response == nil ? error : [self errorFromResponse:response JSON:JSON];
+                        dispatch_async(failureCallbackQueue, ^{
+                            failureBlock(pageError);
+                        });
+                    }
+                }
+                if (pagesInFlight == 0) {
+                    requestPages = nil;
+                    dispatch_release(pageQueue);
+                }
+            };
+            
+            [self queueRequest:request options:pageOptions successCallbackQueue:pageQueue failureCallbackQueue:pageQueue onSuccess:pageSuccessBlock onFailure:pageFailureBlock];
+        }
+    } copy];
+    
+    dispatch_async(pageQueue, ^{
+        requestPages();
+    });
+}
+
+- (SMQueryCursor *)cursorForQuery:(SMQuery *)query options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize
+{
+    return [[SMQueryCursor alloc] initWithQuery:query dataStore:self options:options pageSize:pageSize];
+}
+
 - (void)performCount:(SMQuery *)query onSuccess:(SMCountSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
 {
     [self performCount:query options:[SMRequestOptions options] onSuccess:successBlock onFailure:failureBlock];    
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMJSONBodyStream` is the request body for a JSON object whose Binary Data fields are <SMStreamingBinaryData> values or reference strings from <SMBinaryDataConversion>.
+ 
+ The rest of the object is serialized up front.  Each binary field's content is read and base64 encoded a chunk at a time as the body is read, so memory use does not grow with the size of the content.
+ 
+ @note Used internally by <SMOAuth2Client>.  Copying the stream gives a fresh one which starts again from the beginning, so that a request can be retried.
+ */
+@interface SMJSONBodyStream : NSInputStream <NSCopying>
+
+/**
+ The total length of the body in bytes, for the Content-Length header.
+ */
+@property (nonatomic, readonly) unsigned long long contentLength;
+
+/**
+ Whether any of an object's fields have to be streamed.
+ 
+ Only the object's own fields are looked at, as those are the only ones the stream encodes as it is read.  Binary values nested in arrays or dictionaries are serialized as they are.
+ 
+ @param object The fields of a request body.
+ 
+ @return `YES` if any field is an <SMStreamingBinaryData> or a reference string.
+ */
++ (BOOL)JSONObjectRequiresStreaming:(NSDictionary *)object;
+
+/**
+ Initialize a body stream.
+ 
+ @param object The fields of the request body.
+ 
+ @return A new body stream, or nil if the object cannot be serialized or a referenced file cannot be read.
+ */
+- (id)initWithJSONObject:(NSDictionary *)object;
+
+@end
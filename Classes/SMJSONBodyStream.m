@@ -0,0 +1,289 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMJSONBodyStream.h"
+#import "SMStreamingBinaryData.h"
+#import "SMBinaryDataConversion.h"
+#import "Base64EncodedStringFromData.h"
+
+// Read from binary content per chunk; a multiple of 3 so chunks encode without padding
+#define BINARY_CHUNK_SIZE (3 * 8192)
+
+@interface SMJSONBodyStream () {
+    uint8_t _SM_inputBuffer[BINARY_CHUNK_SIZE];
+    char _SM_outputBuffer[Base64EncodedLength(BINARY_CHUNK_SIZE)];
+    NSUInteger _SM_carriedLength;
+    NSUInteger _SM_outputOffset;
+    NSUInteger _SM_outputLength;
+    NSUInteger _SM_segmentOffset;
+}
+
+@property (nonatomic, readwrite) NSStreamStatus streamStatus;
+@property (nonatomic, readwrite, strong) NSError *streamError;
+@property (nonatomic, readwrite) unsigned long long contentLength;
+
+// NSData for serialized JSON, SMStreamingBinaryData for content which is encoded as it is read
+@property (nonatomic, strong) NSArray *segments;
+@property (nonatomic) NSUInteger segmentIndex;
+@property (nonatomic, strong) NSInputStream *binaryStream;
+
+- (id)initWithSegments:(NSArray *)segments contentLength:(unsigned long long)contentLength;
+- (NSInteger)SM_fillOutputBufferFromBinaryData:(SMStreamingBinaryData *)binaryData;
+
+@end
+
+@implementation SMJSONBodyStream
+
+@synthesize streamStatus = _SM_streamStatus;
+@synthesize streamError = _SM_streamError;
+@synthesize contentLength = _SM_contentLength;
+@synthesize segments = _SM_segments;
+@synthesize segmentIndex = _SM_segmentIndex;
+@synthesize binaryStream = _SM_binaryStream;
+
++ (SMStreamingBinaryData *)SM_binaryDataForValue:(id)value
+{
+    if ([value isKindOfClass:[SMStreamingBinaryData class]]) {
+        return value;
+    }
+    if ([value isKindOfClass:[NSString class]] && [SMStreamingBinaryData isReferenceString:value]) {
+        return [SMStreamingBinaryData binaryDataWithReferenceString:value];
+    }
+    return nil;
+}
+
++ (BOOL)JSONObjectRequiresStreaming:(NSDictionary *)object
+{
+    if (![object isKindOfClass:[NSDictionary class]]) {
+        return NO;
+    }
+    for (id value in [object objectEnumerator]) {
+        if ([value isKindOfClass:[SMStreamingBinaryData class]] || ([value isKindOfClass:[NSString class]] && [SMStreamingBinaryData isReferenceString:value])) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (id)initWithJSONObject:(NSDictionary *)object
+{
+    // Each binary field is serialized as its headers followed by a unique token, and the body is then split around the tokens
+    NSString *tokenPrefix = [NSString stringWithFormat:@"SMStreamingBinaryData%08x%08x", arc4random(), arc4random()];
+    NSMutableDictionary *serializableObject = [NSMutableDictionary dictionaryWithCapacity:[object count]];
+    NSMutableDictionary *binaryDataForTokens = [NSMutableDictionary dictionary];
+    __block BOOL unreadableBinaryData = NO;
+    [object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+        SMStreamingBinaryData *binaryData = [SMJSONBodyStream SM_binaryDataForValue:value];
+        if (binaryData) {
+            NSString *token = [NSString stringWithFormat:@"%@x%lu", tokenPrefix, (unsigned long)[binaryDataForTokens count]];
+            [binaryDataForTokens setObject:binaryData forKey:token];
+            [serializableObject setObject:[[SMBinaryDataConversion headerForBinaryDataWithName:binaryData.name contentType:binaryData.contentType] stringByAppendingString:token] forKey:key];
+        } else if ([value isKindOfClass:[NSString class]] && [SMStreamingBinaryData isReferenceString:value]) {
+            unreadableBinaryData = YES;
+            *stop = YES;
+        } else {
+            [serializableObject setObject:value forKey:key];
+        }
+    }];
+    if (unreadableBinaryData) {
+        return nil;
+    }
+    
+    NSData *JSON = [NSJSONSerialization dataWithJSONObject:serializableObject options:0 error:nil];
+    if (JSON == nil) {
+        return nil;
+    }
+    
+    NSMutableArray *segments = [NSMutableArray array];
+    unsigned long long contentLength = 0;
+    NSData *tokenPrefixData = [tokenPrefix dataUsingEncoding:NSUTF8StringEncoding];
+    NSRange remaining = NSMakeRange(0, [JSON length]);
+    while (remaining.length > 0) {
+        NSRange tokenStart = [JSON rangeOfData:tokenPrefixData options:0 range:remaining];
+        if (tokenStart.location == NSNotFound) {
+            [segments addObject:[JSON subdataWithRange:remaining]];
+            contentLength += remaining.length;
+            break;
+        }
+        
+        // The token runs up to the closing quote of the string
+        NSRange tokenEnd = [JSON rangeOfData:[NSData dataWithBytes:"\"" length:1] options:0 range:NSMakeRange(tokenStart.location, NSMaxRange(remaining) - tokenStart.location)];
+        NSString *token = [[NSString alloc] initWithData:[JSON subdataWithRange:NSMakeRange(tokenStart.location, tokenEnd.location - tokenStart.location)] encoding:NSUTF8StringEncoding];
+        SMStreamingBinaryData *binaryData = [binaryDataForTokens objectForKey:token];
+        
+        [segments addObject:[JSON subdataWithRange:NSMakeRange(remaining.location, tokenStart.location - remaining.location)]];
+        [segments addObject:binaryData];
+        contentLength += (tokenStart.location - remaining.location) + Base64EncodedLength(binaryData.length);
+        remaining = NSMakeRange(tokenEnd.location, NSMaxRange(remaining) - tokenEnd.location);
+    }
+    
+    return [self initWithSegments:segments contentLength:contentLength];
+}
+
+- (id)initWithSegments:(NSArray *)segments contentLength:(unsigned long long)contentLength
+{
+    self = [super init];
+    if (self) {
+        self.segments = segments;
+        self.contentLength = contentLength;
+        self.streamStatus = NSStreamStatusNotOpen;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return [[SMJSONBodyStream allocWithZone:zone] initWithSegments:self.segments contentLength:self.contentLength];
+}
+
+#pragma mark - NSInputStream
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)length
+{
+    if (self.streamStatus != NSStreamStatusOpen) {
+        return self.streamStatus == NSStreamStatusError ? -1 : 0;
+    }
+    
+    NSUInteger bytesRead = 0;
+    while (bytesRead < length) {
+        if (_SM_outputOffset < _SM_outputLength) {
+            NSUInteger count = MIN(length - bytesRead, _SM_outputLength - _SM_outputOffset);
+            memcpy(buffer + bytesRead, _SM_outputBuffer + _SM_outputOffset, count);
+            _SM_outputOffset += count;
+            bytesRead += count;
+            continue;
+        }
+        
+        if (self.segmentIndex >= [self.segments count]) {
+            self.streamStatus = NSStreamStatusAtEnd;
+            break;
+        }
+        
+        id segment = [self.segments objectAtIndex:self.segmentIndex];
+        if ([segment isKindOfClass:[NSData class]]) {
+            NSUInteger count = MIN(length - bytesRead, [segment length] - _SM_segmentOffset);
+            [segment getBytes:buffer + bytesRead range:NSMakeRange(_SM_segmentOffset, count)];
+            _SM_segmentOffset += count;
+            bytesRead += count;
+            if (_SM_segmentOffset == [segment length]) {
+                self.segmentIndex++;
+                _SM_segmentOffset = 0;
+            }
+        } else if ([self SM_fillOutputBufferFromBinaryData:segment] < 0) {
+            self.streamStatus = NSStreamStatusError;
+            return -1;
+        }
+    }
+    
+    return bytesRead;
+}
+
+- (NSInteger)SM_fillOutputBufferFromBinaryData:(SMStreamingBinaryData *)binaryData
+{
+    if (self.binaryStream == nil) {
+        self.binaryStream = [binaryData inputStream];
+        [self.binaryStream open];
+        _SM_carriedLength = 0;
+    }
+    
+    NSInteger bytesRead = [self.binaryStream read:_SM_inputBuffer + _SM_carriedLength maxLength:BINARY_CHUNK_SIZE - _SM_carriedLength];
+    if (bytesRead < 0) {
+        self.streamError = [self.binaryStream streamError];
+        [self.binaryStream close];
+        self.binaryStream = nil;
+        return -1;
+    }
+    
+    // Only whole 3-byte groups are encoded until the content runs out, when the rest is encoded with padding
+    NSUInteger available = _SM_carriedLength + bytesRead;
+    NSUInteger encodable = bytesRead == 0 ? available : available - (available % 3);
+    _SM_outputLength = Base64EncodeBytes(_SM_inputBuffer, encodable, _SM_outputBuffer);
+    _SM_outputOffset = 0;
+    _SM_carriedLength = available - encodable;
+    memmove(_SM_inputBuffer, _SM_inputBuffer + encodable, _SM_carriedLength);
+    
+    if (bytesRead == 0) {
+        [self.binaryStream close];
+        self.binaryStream = nil;
+        self.segmentIndex++;
+    }
+    return _SM_outputLength;
+}
+
+- (BOOL)getBuffer:(uint8_t **)buffer length:(NSUInteger *)len
+{
+    return NO;
+}
+
+- (BOOL)hasBytesAvailable
+{
+    return self.streamStatus == NSStreamStatusOpen;
+}
+
+#pragma mark - NSStream
+
+- (void)open
+{
+    if (self.streamStatus != NSStreamStatusNotOpen) {
+        return;
+    }
+    self.streamStatus = NSStreamStatusOpen;
+}
+
+- (void)close
+{
+    [self.binaryStream close];
+    self.binaryStream = nil;
+    self.streamStatus = NSStreamStatusClosed;
+}
+
+- (id)propertyForKey:(NSString *)key
+{
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSString *)key
+{
+    return NO;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode
+{
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode
+{
+}
+
+#pragma mark - Undocumented CFReadStream Bridged Methods
+
+// NSURLConnection treats body streams as CFReadStreams, so these have to be answered just as AFMultipartBodyStream does
+
+- (void)_scheduleInCFRunLoop:(CFRunLoopRef)aRunLoop forMode:(CFStringRef)aMode
+{
+}
+
+- (void)_unscheduleFromCFRunLoop:(CFRunLoopRef)aRunLoop forMode:(CFStringRef)aMode
+{
+}
+
+- (BOOL)_setCFClientFlags:(CFOptionFlags)inFlags callback:(CFReadStreamClientCallBack)inCallback context:(CFStreamClientContext *)inContext
+{
+    return NO;
+}
+
+@end
@@ -16,6 +16,35 @@
 
 #import "AFJSONRequestOperation.h"
 
+@class SMCompressionMetrics;
+@class SMRequestMetrics;
+@class SMRequestMetricsSample;
+@class SMTraceSpan;
+
 @interface SMJSONRequestOperation : AFJSONRequestOperation
 
+/**
+ Measure this operation and record it with the given metrics when the response finishes or the connection fails.
+ 
+ Queue wait and total time are measured from when this is called, so it should be called as the operation is created.  Status, timings and response size are filled in on the sample; anything else, such as the schema, should be set by the caller.
+ 
+ @param metrics The metrics to record the sample with.
+ @param sample The sample to fill in.
+ */
+- (void)reportMetricsTo:(SMRequestMetrics *)metrics sample:(SMRequestMetricsSample *)sample;
+
+/**
+ Record the size of the response body as received and as decoded with the given metrics when the response finishes.
+ 
+ @param metrics The metrics to record the response with.
+ */
+- (void)reportCompressionTo:(SMCompressionMetrics *)metrics;
+
+/**
+ Record this operation as a span with <SMTracer> from when it starts until the response finishes or the connection fails.  Does nothing if the tracer is disabled.
+ 
+ @param parent The span to record it under, or `nil`.
+ */
+- (void)traceWithParentSpan:(SMTraceSpan *)parent;
+
 @end
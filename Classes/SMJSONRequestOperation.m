@@ -15,12 +15,142 @@
  */
 
 #import "SMJSONRequestOperation.h"
+#import "SMCompressionMetrics.h"
+#import "SMRequestMetrics.h"
+#import "SMTracer.h"
+
+@interface SMJSONRequestOperation ()
+
+@property (nonatomic) long long decodedBytesRead;
+@property (nonatomic, strong) SMRequestMetrics *requestMetrics;
+@property (nonatomic, strong) SMCompressionMetrics *compressionMetrics;
+@property (nonatomic, strong) SMRequestMetricsSample *metricsSample;
+@property (nonatomic) NSTimeInterval createdTime;
+@property (nonatomic) NSTimeInterval startedTime;
+@property (nonatomic) NSTimeInterval firstByteTime;
+@property (nonatomic) BOOL traced;
+@property (nonatomic, strong) SMTraceSpan *parentTraceSpan;
+@property (nonatomic, strong) SMTraceSpan *traceSpan;
+
+- (void)SM_recordMetricsWithError:(NSError *)error;
+- (void)SM_endTraceSpanWithError:(NSError *)error;
+
+@end
 
 @implementation SMJSONRequestOperation
 
+@synthesize decodedBytesRead = _SM_decodedBytesRead;
+@synthesize requestMetrics = _SM_requestMetrics;
+@synthesize compressionMetrics = _SM_compressionMetrics;
+@synthesize metricsSample = _SM_metricsSample;
+@synthesize createdTime = _SM_createdTime;
+@synthesize startedTime = _SM_startedTime;
+@synthesize firstByteTime = _SM_firstByteTime;
+@synthesize traced = _SM_traced;
+@synthesize parentTraceSpan = _SM_parentTraceSpan;
+@synthesize traceSpan = _SM_traceSpan;
+
 + (NSSet *)acceptableContentTypes {
     NSSet *defaultAcceptableContentTypes = [super acceptableContentTypes];
     return [defaultAcceptableContentTypes setByAddingObject:@"application/vnd.stackmob+json"];
 }
 
+- (void)reportMetricsTo:(SMRequestMetrics *)metrics sample:(SMRequestMetricsSample *)sample
+{
+    self.createdTime = SMRequestMetricsTimestamp();
+    self.metricsSample = sample;
+    self.requestMetrics = metrics;
+}
+
+- (void)reportCompressionTo:(SMCompressionMetrics *)metrics
+{
+    self.compressionMetrics = metrics;
+}
+
+- (void)traceWithParentSpan:(SMTraceSpan *)parent
+{
+    self.traced = [SMTracer sharedTracer].enabled;
+    self.parentTraceSpan = parent;
+}
+
+- (void)start
+{
+    if (self.requestMetrics && self.startedTime == 0) {
+        self.startedTime = SMRequestMetricsTimestamp();
+    }
+    if (self.traced && !self.traceSpan) {
+        NSString *name = [NSString stringWithFormat:@"%@ %@", [self.request HTTPMethod], [[self.request URL] path]];
+        // The connection runs on AFNetworking's network thread and may overlap others there
+        self.traceSpan = [[SMTracer sharedTracer] beginDetachedSpanWithName:name category:@"http" parent:self.parentTraceSpan];
+        self.parentTraceSpan = nil;
+    }
+    [super start];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response
+{
+    if (self.requestMetrics) {
+        self.firstByteTime = SMRequestMetricsTimestamp();
+    }
+    [super connection:connection didReceiveResponse:response];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data
+{
+    self.decodedBytesRead += [data length];
+    [super connection:connection didReceiveData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection
+{
+    [self.compressionMetrics recordResponse:(NSHTTPURLResponse *)self.response decodedLength:self.decodedBytesRead];
+    [self SM_recordMetricsWithError:nil];
+    [self SM_endTraceSpanWithError:nil];
+    [super connectionDidFinishLoading:connection];
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
+{
+    [self SM_recordMetricsWithError:error];
+    [self SM_endTraceSpanWithError:error];
+    [super connection:connection didFailWithError:error];
+}
+
+- (void)SM_recordMetricsWithError:(NSError *)error
+{
+    SMRequestMetrics *metrics = self.requestMetrics;
+    if (metrics == nil) {
+        return;
+    }
+    // Only the first of finishing and failing is recorded
+    self.requestMetrics = nil;
+    
+    NSTimeInterval now = SMRequestMetricsTimestamp();
+    NSTimeInterval startedTime = self.startedTime == 0 ? now : self.startedTime;
+    SMRequestMetricsSample *sample = self.metricsSample;
+    sample.statusCode = [(NSHTTPURLResponse *)self.response statusCode];
+    sample.error = error;
+    sample.queueWait = startedTime - self.createdTime;
+    sample.timeToFirstByte = self.firstByteTime == 0 ? 0 : self.firstByteTime - startedTime;
+    sample.totalTime = now - self.createdTime;
+    sample.responseBytes = self.decodedBytesRead;
+    [metrics recordSample:sample];
+}
+
+- (void)SM_endTraceSpanWithError:(NSError *)error
+{
+    SMTraceSpan *span = self.traceSpan;
+    if (span == nil) {
+        return;
+    }
+    self.traceSpan = nil;
+    
+    [span setArgument:[NSNumber numberWithInteger:[(NSHTTPURLResponse *)self.response statusCode]] forKey:@"status_code"];
+    [span setArgument:[NSNumber numberWithLongLong:self.decodedBytesRead] forKey:@"response_bytes"];
+    if (error) {
+        [span setArgument:[error localizedDescription] forKey:@"error"];
+    }
+    [span end];
+}
+
 @end
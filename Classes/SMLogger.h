@@ -0,0 +1,182 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef enum {
+    SMLogLevelOff = 0,
+    SMLogLevelError = 1,
+    SMLogLevelWarning = 2,
+    SMLogLevelInfo = 3,
+    SMLogLevelDebug = 4,
+    SMLogLevelTrace = 5,
+} SMLogLevel;
+
+typedef enum {
+    SMLogSubsystemCoreData = 0,
+    SMLogSubsystemCache = 1,
+    SMLogSubsystemNetwork = 2,
+    SMLogSubsystemAuth = 3,
+} SMLogSubsystem;
+
+#define SMLogSubsystemCount 4
+
+/*
+ The most verbose level compiled in.  Log statements above it are removed by the compiler, arguments and all.  Release builds keep warnings and errors only; define SM_LOG_MAX_LEVEL before importing this header to change that.
+ */
+#ifndef SM_LOG_MAX_LEVEL
+#ifdef DEBUG
+#define SM_LOG_MAX_LEVEL SMLogLevelTrace
+#else
+#define SM_LOG_MAX_LEVEL SMLogLevelWarning
+#endif
+#endif
+
+/*
+ The level of each subsystem, read by the logging macros.  Change it with -[SMLogger setLevel:forSubsystem:].
+ */
+extern volatile SMLogLevel SMLogSubsystemLevels[SMLogSubsystemCount];
+
+#define SMLogIsEnabled(subsystem, level) ((level) <= SM_LOG_MAX_LEVEL && (level) <= SMLogSubsystemLevels[(subsystem)])
+
+/*
+ The format arguments are only evaluated when the level is enabled for the subsystem, so descriptions of large objects cost nothing otherwise.
+ */
+#define SMLog(subsystem, level, ...) do { if (SMLogIsEnabled(subsystem, level)) { SMLogWrite((subsystem), (level), __PRETTY_FUNCTION__, __LINE__, __VA_ARGS__); } } while (0)
+
+#define SMLogError(subsystem, ...) SMLog(subsystem, SMLogLevelError, __VA_ARGS__)
+#define SMLogWarning(subsystem, ...) SMLog(subsystem, SMLogLevelWarning, __VA_ARGS__)
+#define SMLogInfo(subsystem, ...) SMLog(subsystem, SMLogLevelInfo, __VA_ARGS__)
+#define SMLogDebug(subsystem, ...) SMLog(subsystem, SMLogLevelDebug, __VA_ARGS__)
+#define SMLogTrace(subsystem, ...) SMLog(subsystem, SMLogLevelTrace, __VA_ARGS__)
+
+/*
+ Logs the name of the enclosing method at trace level.
+ */
+#define SMLogEnter(subsystem) SMLog(subsystem, SMLogLevelTrace, @"%s", "")
+
+/**
+ Formats a message and hands it to <[SMLogger sharedLogger]>.  Call it through the `SMLog` macros, which skip the call entirely for disabled levels.
+ 
+ @param subsystem The subsystem logging the message.
+ @param level The message's level.
+ @param function The name of the calling function.
+ @param line The line it was logged from.
+ @param format A format string, followed by its arguments.
+ */
+void SMLogWrite(SMLogSubsystem subsystem, SMLogLevel level, const char *function, int line, NSString *format, ...) NS_FORMAT_FUNCTION(5, 6);
+
+/**
+ `SMLogger` collects log messages from the SDK.
+ 
+ Each subsystem has its own level, and messages above it are never formatted.  Messages which pass are kept in a ring buffer of the last <bufferCapacity> messages, which can be read with <recentMessages> or printed with <dumpRecentMessages> when something goes wrong, and are written to the console if they are at or below <consoleLevel>.  Console output is written from a background queue, so logging does not wait on `NSLog`.
+ 
+ By default every subsystem records warnings and errors to the buffer and nothing is written to the console.  To follow what the SDK is doing, turn both up:
+ 
+    [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+    [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
+ 
+ Levels above `SM_LOG_MAX_LEVEL` are compiled out; in builds without `DEBUG` defined that is everything above `SMLogLevelWarning`.
+ */
+@interface SMLogger : NSObject
+
+/**
+ The most verbose level written to the console.  Default is `SMLogLevelOff`.
+ */
+@property (atomic) SMLogLevel consoleLevel;
+
+/**
+ The number of messages kept for <recentMessages>.  Default is 500.  Changing it discards the messages kept so far.
+ */
+@property (nonatomic) NSUInteger bufferCapacity;
+
+/**
+ Messages longer than this many characters are truncated and end with `<MAX_LOG_LENGTH_REACHED>`.  Default is 10000.
+ */
+@property (atomic) NSUInteger maximumMessageLength;
+
+/**
+ Whether an error level message also prints every message in the buffer to the console.  Default is `NO`.
+ */
+@property (atomic) BOOL dumpsOnError;
+
+/**
+ The logger used by the SDK.
+ 
+ @return The shared `SMLogger` instance.
+ */
++ (SMLogger *)sharedLogger;
+
+/**
+ The name used for a subsystem in log messages, such as `CoreData`.
+ 
+ @param subsystem The subsystem.
+ 
+ @return Its name.
+ */
++ (NSString *)nameForSubsystem:(SMLogSubsystem)subsystem;
+
+/**
+ The most verbose level recorded for a subsystem.
+ 
+ @param subsystem The subsystem.
+ 
+ @return Its level.
+ */
+- (SMLogLevel)levelForSubsystem:(SMLogSubsystem)subsystem;
+
+/**
+ Set the most verbose level recorded for a subsystem.
+ 
+ @param level The level.
+ @param subsystem The subsystem.
+ */
+- (void)setLevel:(SMLogLevel)level forSubsystem:(SMLogSubsystem)subsystem;
+
+/**
+ Set the most verbose level recorded for every subsystem.
+ 
+ @param level The level.
+ */
+- (void)setLevelForAllSubsystems:(SMLogLevel)level;
+
+/**
+ Record a message which has already been formatted.  Used by `SMLogWrite`.
+ 
+ @param message The message.
+ @param subsystem The subsystem logging it.
+ @param level Its level.
+ */
+- (void)logMessage:(NSString *)message subsystem:(SMLogSubsystem)subsystem level:(SMLogLevel)level;
+
+/**
+ The messages in the buffer, oldest first, each prefixed with its time, level and subsystem.
+ 
+ @return An array of strings.
+ */
+- (NSArray *)recentMessages;
+
+/**
+ Print every message in the buffer to the console.
+ */
+- (void)dumpRecentMessages;
+
+/**
+ Empty the buffer.
+ */
+- (void)clearRecentMessages;
+
+@end
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMLogger.h"
+#import <sys/time.h>
+
+#define DEFAULT_BUFFER_CAPACITY 500
+#define DEFAULT_MAXIMUM_MESSAGE_LENGTH 10000
+#define TRUNCATION_MARKER @" <MAX_LOG_LENGTH_REACHED>"
+
+volatile SMLogLevel SMLogSubsystemLevels[SMLogSubsystemCount] = {
+    SMLogLevelWarning,
+    SMLogLevelWarning,
+    SMLogLevelWarning,
+    SMLogLevelWarning,
+};
+
+static NSString *SMLogLevelName(SMLogLevel level)
+{
+    switch (level) {
+        case SMLogLevelError:
+            return @"ERROR";
+        case SMLogLevelWarning:
+            return @"WARN";
+        case SMLogLevelInfo:
+            return @"INFO";
+        case SMLogLevelDebug:
+            return @"DEBUG";
+        case SMLogLevelTrace:
+            return @"TRACE";
+        default:
+            return @"";
+    }
+}
+
+void SMLogWrite(SMLogSubsystem subsystem, SMLogLevel level, const char *function, int line, NSString *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    NSString *body = [[NSString alloc] initWithFormat:format arguments:arguments];
+    va_end(arguments);
+    
+    NSString *message = [body length] > 0 ? [NSString stringWithFormat:@"%s [Line %d] %@", function, line, body] : [NSString stringWithFormat:@"%s [Line %d]", function, line];
+    [[SMLogger sharedLogger] logMessage:message subsystem:subsystem level:level];
+}
+
+@interface SMLogger ()
+
+@property (nonatomic, strong) NSMutableArray *buffer;
+// Index in buffer of the oldest message once it is full
+@property (nonatomic) NSUInteger bufferStart;
+@property (nonatomic) dispatch_queue_t consoleQueue;
+
+- (void)SM_writeToConsole:(NSArray *)lines;
+
+@end
+
+@implementation SMLogger
+
+@synthesize consoleLevel = _SM_consoleLevel;
+@synthesize bufferCapacity = _SM_bufferCapacity;
+@synthesize maximumMessageLength = _SM_maximumMessageLength;
+@synthesize dumpsOnError = _SM_dumpsOnError;
+@synthesize buffer = _SM_buffer;
+@synthesize bufferStart = _SM_bufferStart;
+@synthesize consoleQueue = _SM_consoleQueue;
+
++ (SMLogger *)sharedLogger
+{
+    static SMLogger *sharedLogger = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedLogger = [[SMLogger alloc] init];
+    });
+    return sharedLogger;
+}
+
++ (NSString *)nameForSubsystem:(SMLogSubsystem)subsystem
+{
+    switch (subsystem) {
+        case SMLogSubsystemCoreData:
+            return @"CoreData";
+        case SMLogSubsystemCache:
+            return @"Cache";
+        case SMLogSubsystemNetwork:
+            return @"Network";
+        case SMLogSubsystemAuth:
+            return @"Auth";
+        default:
+            return @"";
+    }
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.consoleLevel = SMLogLevelOff;
+        self.maximumMessageLength = DEFAULT_MAXIMUM_MESSAGE_LENGTH;
+        self.bufferCapacity = DEFAULT_BUFFER_CAPACITY;
+        self.consoleQueue = dispatch_queue_create("com.stackmob.logger.console", NULL);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_consoleQueue);
+}
+
+- (void)setBufferCapacity:(NSUInteger)bufferCapacity
+{
+    @synchronized(self) {
+        _SM_bufferCapacity = bufferCapacity;
+        self.buffer = [NSMutableArray arrayWithCapacity:MIN(bufferCapacity, (NSUInteger)DEFAULT_BUFFER_CAPACITY)];
+        self.bufferStart = 0;
+    }
+}
+
+- (SMLogLevel)levelForSubsystem:(SMLogSubsystem)subsystem
+{
+    if (subsystem >= SMLogSubsystemCount) {
+        [NSException raise:NSInvalidArgumentException format:@"Unknown log subsystem %d", (int)subsystem];
+    }
+    return SMLogSubsystemLevels[subsystem];
+}
+
+- (void)setLevel:(SMLogLevel)level forSubsystem:(SMLogSubsystem)subsystem
+{
+    if (subsystem >= SMLogSubsystemCount) {
+        [NSException raise:NSInvalidArgumentException format:@"Unknown log subsystem %d", (int)subsystem];
+    }
+    SMLogSubsystemLevels[subsystem] = level;
+}
+
+- (void)setLevelForAllSubsystems:(SMLogLevel)level
+{
+    for (int subsystem = 0; subsystem < SMLogSubsystemCount; subsystem++) {
+        SMLogSubsystemLevels[subsystem] = level;
+    }
+}
+
+- (void)logMessage:(NSString *)message subsystem:(SMLogSubsystem)subsystem level:(SMLogLevel)level
+{
+    NSUInteger maximumMessageLength = self.maximumMessageLength;
+    if ([message length] > maximumMessageLength) {
+        message = [[message substringToIndex:maximumMessageLength] stringByAppendingString:TRUNCATION_MARKER];
+    }
+    
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    struct tm localNow;
+    localtime_r(&now.tv_sec, &localNow);
+    NSString *line = [NSString stringWithFormat:@"%02d:%02d:%02d.%03d %@ [%@] %@", localNow.tm_hour, localNow.tm_min, localNow.tm_sec, (int)(now.tv_usec / 1000), SMLogLevelName(level), [SMLogger nameForSubsystem:subsystem], message];
+    
+    @synchronized(self) {
+        NSUInteger capacity = self.bufferCapacity;
+        if (capacity > 0) {
+            if ([self.buffer count] < capacity) {
+                [self.buffer addObject:line];
+            } else {
+                [self.buffer replaceObjectAtIndex:self.bufferStart withObject:line];
+                self.bufferStart = (self.bufferStart + 1) % capacity;
+            }
+        }
+    }
+    
+    if (level == SMLogLevelError && self.dumpsOnError) {
+        [self dumpRecentMessages];
+    } else if (level <= self.consoleLevel) {
+        [self SM_writeToConsole:[NSArray arrayWithObject:line]];
+    }
+}
+
+- (NSArray *)recentMessages
+{
+    @synchronized(self) {
+        NSUInteger count = [self.buffer count];
+        NSMutableArray *messages = [NSMutableArray arrayWithCapacity:count];
+        for (NSUInteger i = 0; i < count; i++) {
+            [messages addObject:[self.buffer objectAtIndex:(self.bufferStart + i) % count]];
+        }
+        return messages;
+    }
+}
+
+- (void)dumpRecentMessages
+{
+    [self SM_writeToConsole:[self recentMessages]];
+}
+
+- (void)clearRecentMessages
+{
+    @synchronized(self) {
+        [self.buffer removeAllObjects];
+        self.bufferStart = 0;
+    }
+}
+
+- (void)SM_writeToConsole:(NSArray *)lines
+{
+    dispatch_async(self.consoleQueue, ^{
+        for (NSString *line in lines) {
+            NSLog(@"%@", line);
+        }
+    });
+}
+
+@end
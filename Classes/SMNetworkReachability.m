@@ -16,8 +16,7 @@
 
 #import "SMNetworkReachability.h"
 #import "SMIncrementalStore.h"
-
-#define DLog(fmt, ...) NSLog((@"Performing %s [Line %d] " fmt), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__);
+#import "SMLogger.h"
 
 NSString * SMNetworkStatusDidChangeNotification = @"SMNetworkStatusDidChangeNotification";
 NSString * SMCurrentNetworkStatusKey = @"SMCurrentNetworkStatusKey";
@@ -85,7 +84,7 @@ typedef SMCachePolicy (^SMCachePolicyReturnBlock)(SMNetworkStatus status);
     
     if (self.networkStatus != notificationNetworkStatus) {
         self.networkStatus = notificationNetworkStatus;
-        if (SM_CORE_DATA_DEBUG) {DLog(@"STACKMOB SYSTEM UPDATE: Network reachability has changed to %d", notificationNetworkStatus)};
+        SMLogInfo(SMLogSubsystemNetwork, @"STACKMOB SYSTEM UPDATE: Network reachability has changed to %d", notificationNetworkStatus);
         if (self.localNetworkStatusBlock) {
             self.localNetworkStatusBlock(self.networkStatus);
         }
@@ -17,8 +17,10 @@
 #import <Foundation/Foundation.h>
 #import "AFHTTPClient.h"
 
+@class SMCompressionMetrics;
 @class SMCustomCodeRequest;
 @class SMRequestOptions;
+@class SMRequestScheduler;
 
 /**
  An interface for creating OAuth2 signed requests.
@@ -31,6 +33,28 @@
 @property (nonatomic, copy) NSString *accessToken;
 @property (nonatomic, copy) NSString *macKey;
 
+/**
+ Whether request bodies of at least <requestCompressionThreshold> bytes are sent gzipped, with a `Content-Encoding: gzip` header.  Default is `NO`.
+ 
+ Only turn this on if the API host accepts compressed request bodies.  The MAC signature covers only the method, path, host and port, so compressing a body does not affect it.
+ */
+@property (nonatomic) BOOL compressesRequestBodies;
+
+/**
+ The smallest request body, in bytes, which is compressed.  Default is 1024.
+ */
+@property (nonatomic) NSUInteger requestCompressionThreshold;
+
+/**
+ If set and enabled, the size of every request body before and after compression is recorded here.  Set by <SMUserSession>.
+ */
+@property (nonatomic, strong) SMCompressionMetrics *compressionMetrics;
+
+/**
+ If set, operations passed to `enqueueHTTPRequestOperation:` are started by the scheduler instead of going straight onto the client's operation queue.  Set by <SMUserSession>.
+ */
+@property (nonatomic, strong) SMRequestScheduler *requestScheduler;
+
 /**
  Initialize method used by <SMUserSession>.
  @param version The API version of your StackMob application which this client instance should use.
@@ -47,16 +71,48 @@
 /**
  Creates a signed request using the given parameters.
  
+ Bodies of at least <requestCompressionThreshold> bytes are gzipped if <compressesRequestBodies> is `YES`.  Bytes saved are recorded in <compressionMetrics> when it is enabled.
+ 
  @param method The HTTP verb to use, either `POST`,`GET`, `PUT`, or `DELETE`.
  @param path The REST path.
  @param parameters A dictionary to be used as the body of the request.
  
- @return A signed request to be placed on an operation queue.
+ @return A signed request to be placed on an operation queue, or nil if a binary field could not be read (see <requestWithMethod:path:parameters:error:>).
  */
 - (NSMutableURLRequest *)requestWithMethod:(NSString *)method 
                                        path:(NSString *)path 
                                  parameters:(NSDictionary *)parameters;
 
+/**
+ Creates a signed request using the given parameters, reporting why it could not be made.
+ 
+ Binary Data fields holding an <SMStreamingBinaryData> or a reference string are read and encoded as the body is sent.  If the content of one of them cannot be read, no request is made, rather than sending the reference string in its place.
+ 
+ @param method The HTTP verb to use, either `POST`,`GET`, `PUT`, or `DELETE`.
+ @param path The REST path.
+ @param parameters A dictionary to be used as the body of the request.
+ @param error Set to an `SMErrorInvalidArguments` error if the request could not be made.
+ 
+ @return A signed request to be placed on an operation queue, or nil if a binary field could not be read.
+ */
+- (NSMutableURLRequest *)requestWithMethod:(NSString *)method
+                                       path:(NSString *)path
+                                 parameters:(NSDictionary *)parameters
+                                      error:(NSError *__autoreleasing *)error;
+
+/**
+ Cancels operations for the given method and path, including those still waiting to be started by <requestScheduler>.
+ 
+ @param method The HTTP method to match, or `nil` to match any method.
+ @param path The path to match.
+ */
+- (void)cancelAllHTTPOperationsWithMethod:(NSString *)method path:(NSString *)path;
+
+/**
+ Cancels every operation enqueued through this client, including those still waiting to be started by <requestScheduler>.
+ */
+- (void)cancelAllHTTPOperations;
+
 /**
  Creates a signed request for a custom code method using the given parameters.
  
@@ -89,10 +145,19 @@
  */
 - (NSString *)getPort;
 
+/**
+ Creates a nonce for a MAC header.
+ 
+ Nonces carry 64 random bits, so they do not repeat even when thousands of requests are signed each second.
+ 
+ @return A new nonce.
+ */
+- (NSString *)createNonce;
+
 /**
  Creates the MAC header for OAuth2 authorization.
  
- The current timestamp and a random nonce are used.
+ The current timestamp and a nonce from <createNonce> are used.
  
  @param method The HTTP verb to use, either `POST`,`GET`, `PUT`, or `DELETE`.
  @param path The REST path.
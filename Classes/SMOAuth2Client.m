@@ -20,8 +20,24 @@
 #import "SMCustomCodeRequest.h"
 #import "SMRequestOptions.h"
 #import "Base64EncodedStringFromData.h"
+#import "GzipCompressedDataFromData.h"
+#import "SMCompressionMetrics.h"
+#import "SMRequestScheduler.h"
+#import "SMJSONBodyStream.h"
+#import "SMError.h"
 #import "SystemInformation.h"
 
+#define REQUEST_COMPRESSION_THRESHOLD 1024
+
+@interface SMOAuth2Client ()
+
+// The mac key as UTF-8, encoded once rather than for every signature
+@property (atomic, strong) NSData *macKeyData;
+// The constant tail of every MAC base string: host, port and the empty ext field
+@property (nonatomic, strong) NSData *baseStringSuffix;
+
+@end
+
 @implementation SMOAuth2Client
 
 @synthesize version = _SM_version;
@@ -29,6 +45,12 @@
 @synthesize apiHost = _SM_apiHost;
 @synthesize accessToken = _SM_accessToken;
 @synthesize macKey = _SM_macKey;
+@synthesize compressesRequestBodies = _SM_compressesRequestBodies;
+@synthesize requestCompressionThreshold = _SM_requestCompressionThreshold;
+@synthesize requestScheduler = _SM_requestScheduler;
+@synthesize compressionMetrics = _SM_compressionMetrics;
+@synthesize macKeyData = _SM_macKeyData;
+@synthesize baseStringSuffix = _SM_baseStringSuffix;
 
 - (id)initWithAPIVersion:(NSString *)version
                    scheme:(NSString *)scheme
@@ -44,24 +66,113 @@
         [self setDefaultHeader:@"Accept" value:acceptHeader]; 
         [self setDefaultHeader:@"X-StackMob-API-Key" value:self.publicKey];
         [self setDefaultHeader:@"User-Agent" value:[NSString stringWithFormat:@"StackMob/%@ (%@/%@; %@;)", SDK_VERSION, smDeviceModel(), smSystemVersion(), [[NSLocale currentLocale] localeIdentifier]]];
+        [self setDefaultHeader:@"Accept-Encoding" value:@"gzip, deflate"];
         self.parameterEncoding = AFJSONParameterEncoding;
+        self.compressesRequestBodies = NO;
+        self.requestCompressionThreshold = REQUEST_COMPRESSION_THRESHOLD;
+        self.baseStringSuffix = [[NSString stringWithFormat:@"%@\n%@\n\n", [[self baseURL] host], [self getPort]] dataUsingEncoding:NSUTF8StringEncoding];
     }
     return self;
 }
 
+- (void)setMacKey:(NSString *)macKey
+{
+    _SM_macKey = [macKey copy];
+    self.macKeyData = [_SM_macKey dataUsingEncoding:NSUTF8StringEncoding];
+}
+
 - (NSMutableURLRequest *)requestWithMethod:(NSString *)method 
                                        path:(NSString *)path 
                                  parameters:(NSDictionary *)parameters
 {
+    return [self requestWithMethod:method path:path parameters:parameters error:NULL];
+}
+
+- (NSMutableURLRequest *)requestWithMethod:(NSString *)method
+                                       path:(NSString *)path
+                                 parameters:(NSDictionary *)parameters
+                                      error:(NSError *__autoreleasing *)error
+{
+    
+    BOOL hasBody = [method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"];
+    SMJSONBodyStream *bodyStream = nil;
+    if (hasBody && [SMJSONBodyStream JSONObjectRequiresStreaming:parameters]) {
+        bodyStream = [[SMJSONBodyStream alloc] initWithJSONObject:parameters];
+        if (bodyStream == nil) {
+            // Sending the body as it is would upload the reference strings in place of the content
+            if (error != NULL) {
+                NSDictionary *userInfo = [NSDictionary dictionaryWithObject:@"The content of a binary field could not be read." forKey:NSLocalizedDescriptionKey];
+                *error = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorInvalidArguments userInfo:userInfo];
+            }
+            return nil;
+        }
+    }
     
-    NSMutableURLRequest *request = [super requestWithMethod:method path:path parameters:parameters];
-    if ([method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"]) {
+    NSMutableURLRequest *request = [super requestWithMethod:method path:path parameters:bodyStream ? nil : parameters];
+    if (hasBody) {
         [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
     }
+    if (bodyStream) {
+        // Binary content is encoded as the body is sent, so it is neither held in memory nor compressed
+        [request setHTTPBodyStream:bodyStream];
+        [request setValue:[NSString stringWithFormat:@"%llu", bodyStream.contentLength] forHTTPHeaderField:@"Content-Length"];
+    } else {
+        [self SM_compressBodyOfRequest:request];
+    }
     [self signRequest:request path:[NSString stringWithFormat:@"/%@", path]];
     return request;
 }
 
+- (void)SM_compressBodyOfRequest:(NSMutableURLRequest *)request
+{
+    NSData *body = [request HTTPBody];
+    if ([body length] == 0) {
+        return;
+    }
+    
+    NSData *sentBody = body;
+    if (self.compressesRequestBodies && [body length] >= self.requestCompressionThreshold) {
+        NSData *compressedBody = GzipCompressedDataFromData(body);
+        // Small or already compressed payloads (such as base64 encoded images) may not shrink
+        if (compressedBody && [compressedBody length] < [body length]) {
+            [request setHTTPBody:compressedBody];
+            [request setValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+            sentBody = compressedBody;
+        }
+    }
+    SMCompressionMetrics *compressionMetrics = self.compressionMetrics;
+    if (compressionMetrics.enabled) {
+        [compressionMetrics recordRequestBodyWithOriginalLength:[body length] sentLength:[sentBody length]];
+    }
+}
+
+- (void)enqueueHTTPRequestOperation:(AFHTTPRequestOperation *)operation
+{
+    if (self.requestScheduler) {
+        [self.requestScheduler enqueueOperation:operation onQueue:self.operationQueue];
+    } else {
+        [super enqueueHTTPRequestOperation:operation];
+    }
+}
+
+- (void)cancelAllHTTPOperationsWithMethod:(NSString *)method path:(NSString *)path
+{
+    // Operations waiting in the scheduler are not in operationQueue yet, so the superclass can't see them
+    NSString *URLStringToMatch = [[[super requestWithMethod:(method ? method : @"GET") path:path parameters:nil] URL] absoluteString];
+    [self.requestScheduler cancelPendingOperationsOnQueue:self.operationQueue passingTest:^BOOL(AFHTTPRequestOperation *operation) {
+        BOOL hasMatchingMethod = !method || [method isEqualToString:[[operation request] HTTPMethod]];
+        BOOL hasMatchingURL = [[[[operation request] URL] absoluteString] isEqualToString:URLStringToMatch];
+        return hasMatchingMethod && hasMatchingURL;
+    }];
+    [super cancelAllHTTPOperationsWithMethod:method path:path];
+}
+
+- (void)cancelAllHTTPOperations
+{
+    [self.requestScheduler cancelPendingOperationsOnQueue:self.operationQueue passingTest:nil];
+    [self.operationQueue cancelAllOperations];
+}
+
 - (NSMutableURLRequest *)customCodeRequest:(SMCustomCodeRequest *)aRequest options:(SMRequestOptions *)options
 {
     NSURL *url = [NSURL URLWithString:aRequest.method relativeToURL:self.baseURL];
@@ -115,37 +226,50 @@
     }
 }
 
-- (NSString *)createMACHeaderForHttpMethod:(NSString *)method path:(NSString *)path timestamp:(double)timestamp nonce:(NSString *)nonce
+static void SMHmacUpdateWithString(CCHmacContext *context, NSString *string)
 {
+    const char *bytes = [string UTF8String];
+    CCHmacUpdate(context, bytes, strlen(bytes));
+}
 
-    NSString *host = [[self baseURL] host];
-    NSString *port = [self getPort];
-    
-    // create base
-    NSArray *baseArray = [NSArray arrayWithObjects:[NSString stringWithFormat:@"%.f", timestamp], nonce, method, path, host, port, nil];
-    unichar newline = 0x0A;
-    NSString *baseString = [baseArray componentsJoinedByString:[NSString stringWithFormat:@"%C", newline]];
-    baseString = [baseString stringByAppendingString:[NSString stringWithFormat:@"%C", newline]];
-    baseString = [baseString stringByAppendingString:[NSString stringWithFormat:@"%C", newline]];
+- (NSString *)createMACHeaderForHttpMethod:(NSString *)method path:(NSString *)path timestamp:(double)timestamp nonce:(NSString *)nonce
+{
+    // The base string is timestamp, nonce, method, path, host, port and ext, each followed by a newline.  It is fed straight into the HMAC rather than built up first.
+    CCHmacContext context;
+    NSData *macKeyData = self.macKeyData;
+    CCHmacInit(&context, kCCHmacAlgSHA1, macKeyData ? [macKeyData bytes] : "", [macKeyData length]);
     
-    const char *keyCString = [self.macKey cStringUsingEncoding:NSUTF8StringEncoding];
-    const char *baseCString = [baseString cStringUsingEncoding:NSUTF8StringEncoding];
+    char timestampBuffer[32];
+    int timestampLength = snprintf(timestampBuffer, sizeof(timestampBuffer), "%.f\n", timestamp);
+    CCHmacUpdate(&context, timestampBuffer, timestampLength);
+    SMHmacUpdateWithString(&context, nonce);
+    CCHmacUpdate(&context, "\n", 1);
+    SMHmacUpdateWithString(&context, method);
+    CCHmacUpdate(&context, "\n", 1);
+    SMHmacUpdateWithString(&context, path);
+    CCHmacUpdate(&context, "\n", 1);
+    CCHmacUpdate(&context, [self.baseStringSuffix bytes], [self.baseStringSuffix length]);
     
+    uint8_t digest[CC_SHA1_DIGEST_LENGTH];
+    CCHmacFinal(&context, digest);
+    char mac[Base64EncodedLength(CC_SHA1_DIGEST_LENGTH) + 1];
+    mac[Base64EncodeBytes(digest, CC_SHA1_DIGEST_LENGTH, mac)] = '\0';
     
-    char buffer[CC_SHA1_DIGEST_LENGTH];
-    CCHmac(kCCHmacAlgSHA1, keyCString, strlen(keyCString), baseCString, strlen(baseCString), buffer); 
-    NSData *digestData = [NSData dataWithBytes:buffer length:CC_SHA1_DIGEST_LENGTH];
-    NSString *mac = Base64EncodedStringFromData(digestData); 
-    //return 'MAC id="' + id + '",ts="' + ts + '",nonce="' + nonce + '",mac="' + mac + '"'
-    unichar quotes = 0x22;
-    NSString *returnString = [NSString stringWithFormat:@"MAC id=%C%@%C,ts=%C%.f%C,nonce=%C%@%C,mac=%C%@%C", quotes, self.accessToken, quotes, quotes, timestamp, quotes, quotes, nonce, quotes, quotes, mac, quotes];
-    return returnString; 
+    timestampBuffer[timestampLength - 1] = '\0';
+    return [NSString stringWithFormat:@"MAC id=\"%@\",ts=\"%s\",nonce=\"%@\",mac=\"%s\"", self.accessToken, timestampBuffer, nonce, mac];
 }
 
+- (NSString *)createNonce
+{
+    // 64 random bits, so nonces do not repeat within the server's replay window no matter how many requests are signed each second
+    uint64_t value;
+    arc4random_buf(&value, sizeof(value));
+    return [NSString stringWithFormat:@"n%016llx", (unsigned long long)value];
+}
 
 - (NSString *)createMACHeaderForHttpMethod:(NSString *)method path:(NSString *)path
 {
-    return [self createMACHeaderForHttpMethod:method path:path timestamp:[[NSDate date] timeIntervalSince1970] nonce:[NSString stringWithFormat:@"n%d", arc4random() % 10000]];
+    return [self createMACHeaderForHttpMethod:method path:path timestamp:[[NSDate date] timeIntervalSince1970] nonce:[self createNonce]];
 }
 
 @end
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import "SMResponseBlocks.h"
+
+@class SMDataStore;
+@class SMQuery;
+@class SMRequestOptions;
+
+/**
+ `SMQueryCursor` walks the results of an <SMQuery> one page at a time, using `fromIndex:toIndex:` ranges.
+ 
+ While you work through one page the next is already being fetched, so at most one page beyond the one you were handed is held in memory.  Pages you have been given are not kept by the cursor, which makes it suitable for exporting result sets too large to hold at once.
+ 
+ Obtain a cursor from <SMDataStore> with `cursorForQuery:options:pageSize:`:
+ 
+    SMQueryCursor *cursor = [[[SMClient defaultClient] dataStore] cursorForQuery:query options:[SMRequestOptions options] pageSize:500];
+    [cursor nextPageOnSuccess:^(NSArray *results) {
+        // export results, then ask for the next page if [cursor hasMore]
+    } onFailure:^(NSError *error) {
+        // the same page is requested again on the next call
+    }];
+ 
+ If the query already has a range set with `fromIndex:toIndex:`, the cursor stays within it.
+ */
+@interface SMQueryCursor : NSObject
+
+///-------------------------------
+/// @name Properties
+///-------------------------------
+
+/**
+ The number of objects requested per page.
+ */
+@property (nonatomic, readonly) NSUInteger pageSize;
+
+/**
+ Whether there may be more results to fetch.
+ 
+ Becomes `NO` once the cursor knows every result has been handed over, either from the total reported by StackMob or because a short page was received.  A final call to <nextPageOnSuccess:onFailure:> may still return an empty page when the total was not known in advance.
+ */
+@property (nonatomic, readonly) BOOL hasMore;
+
+///-------------------------------
+/// @name Initialize
+///-------------------------------
+
+/**
+ Initialize a cursor.  Prefer `cursorForQuery:options:pageSize:` on <SMDataStore>.
+ 
+ The first page is requested straight away.
+ 
+ @param query The query to page through.  Later changes to the query do not affect the cursor.
+ @param dataStore The datastore to send requests through.
+ @param options Options used for every page request.  A copy is used for each page.
+ @param pageSize The number of objects to request per page.  Must be greater than 0.
+ 
+ @return A new cursor positioned at the first page.
+ */
+- (id)initWithQuery:(SMQuery *)query dataStore:(SMDataStore *)dataStore options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize;
+
+///-------------------------------
+/// @name Paging
+///-------------------------------
+
+/**
+ Fetch the next page of results.  Callbacks are performed on the main thread.
+ 
+ @param successBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i>. A block object to invoke with the next page of object dictionaries.  Passed an empty array once there are no more results.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i>. A block object to invoke if the page could not be fetched.  The cursor does not move, so the next call requests the same page again.
+ */
+- (void)nextPageOnSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Fetch the next page of results.
+ 
+ Calls are answered in the order they were made, each with the page after the previous one.
+ 
+ @param successCallbackQueue The dispatch queue used to execute the success block. If nil is passed, the main queue is used.
+ @param failureCallbackQueue The dispatch queue used to execute the failure block. If nil is passed, the main queue is used.
+ @param successBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i>. A block object to invoke with the next page of object dictionaries.  Passed an empty array once there are no more results.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i>. A block object to invoke if the page could not be fetched.  The cursor does not move, so the next call requests the same page again.
+ */
+- (void)nextPageWithSuccessCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+@end
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMQueryCursor.h"
+#import "SMDataStore+Protected.h"
+#import "SMQuery.h"
+#import "SMRequestOptions.h"
+
+typedef void (^SMQueryCursorWaiter)(NSArray *page, NSError *error);
+
+@interface SMQueryCursor ()
+
+@property (nonatomic, strong) SMQuery *query;
+@property (nonatomic, strong) SMDataStore *dataStore;
+@property (nonatomic, strong) SMRequestOptions *options;
+@property (nonatomic, readwrite) NSUInteger pageSize;
+
+// Everything below is only touched on cursorQueue
+@property (nonatomic) dispatch_queue_t cursorQueue;
+@property (nonatomic) NSUInteger nextIndex;
+@property (nonatomic) NSUInteger endIndex;
+@property (nonatomic) BOOL requestInFlight;
+@property (nonatomic, strong) NSArray *prefetchedPage;
+@property (nonatomic, strong) NSError *prefetchError;
+@property (nonatomic, strong) NSMutableArray *waiters;
+
+- (void)SM_fetchNextPage;
+- (void)SM_deliverPages;
+
+@end
+
+@implementation SMQueryCursor
+
+@synthesize query = _SM_query;
+@synthesize dataStore = _SM_dataStore;
+@synthesize options = _SM_options;
+@synthesize pageSize = _SM_pageSize;
+@synthesize cursorQueue = _SM_cursorQueue;
+@synthesize nextIndex = _SM_nextIndex;
+@synthesize endIndex = _SM_endIndex;
+@synthesize requestInFlight = _SM_requestInFlight;
+@synthesize prefetchedPage = _SM_prefetchedPage;
+@synthesize prefetchError = _SM_prefetchError;
+@synthesize waiters = _SM_waiters;
+
+- (id)initWithQuery:(SMQuery *)query dataStore:(SMDataStore *)dataStore options:(SMRequestOptions *)options pageSize:(NSUInteger)pageSize
+{
+    if (query == nil || dataStore == nil || pageSize == 0) {
+        [NSException raise:NSInvalidArgumentException format:@"SMQueryCursor needs a query, a datastore and a page size greater than 0"];
+    }
+    
+    self = [super init];
+    if (self) {
+        self.query = [[SMQuery alloc] initWithSchema:query.schemaName];
+        self.query.requestParameters = query.requestParameters;
+        self.query.requestHeaders = [query.requestHeaders copy];
+        self.dataStore = dataStore;
+        self.options = options ? options : [SMRequestOptions options];
+        self.pageSize = pageSize;
+        
+        NSUInteger startIndex = 0;
+        NSUInteger endIndex = NSNotFound;
+        [dataStore getRangeOfQuery:query startIndex:&startIndex endIndex:&endIndex];
+        self.nextIndex = startIndex;
+        self.endIndex = endIndex;
+        self.waiters = [NSMutableArray array];
+        self.cursorQueue = dispatch_queue_create("com.stackmob.queryCursorQueue", NULL);
+        
+        dispatch_async(self.cursorQueue, ^{
+            [self SM_fetchNextPage];
+        });
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_cursorQueue);
+}
+
+- (BOOL)hasMore
+{
+    __block BOOL hasMore = NO;
+    dispatch_sync(self.cursorQueue, ^{
+        hasMore = self.prefetchedPage != nil || self.prefetchError != nil || self.nextIndex < self.endIndex;
+    });
+    return hasMore;
+}
+
+- (void)nextPageOnSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    [self nextPageWithSuccessCallbackQueue:dispatch_get_main_queue() failureCallbackQueue:dispatch_get_main_queue() onSuccess:successBlock onFailure:failureBlock];
+}
+
+- (void)nextPageWithSuccessCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    if (!successCallbackQueue) {
+        successCallbackQueue = dispatch_get_main_queue();
+    }
+    if (!failureCallbackQueue) {
+        failureCallbackQueue = dispatch_get_main_queue();
+    }
+    
+    SMQueryCursorWaiter waiter = [^(NSArray *page, NSError *error) {
+        if (error) {
+            if (failureBlock) {
+                dispatch_async(failureCallbackQueue, ^{
+                    failureBlock(error);
+                });
+            }
+        } else if (successBlock) {
+            dispatch_async(successCallbackQueue, ^{
+                successBlock(page);
+            });
+        }
+    } copy];
+    
+    dispatch_async(self.cursorQueue, ^{
+        [self.waiters addObject:waiter];
+        [self SM_deliverPages];
+    });
+}
+
+- (void)SM_deliverPages
+{
+    // Answer waiters in order for as long as there is something to give them
+    while ([self.waiters count] > 0) {
+        SMQueryCursorWaiter waiter = [self.waiters objectAtIndex:0];
+        NSArray *page = nil;
+        NSError *error = nil;
+        if (self.prefetchedPage) {
+            page = self.prefetchedPage;
+            self.prefetchedPage = nil;
+        } else if (self.prefetchError) {
+            error = self.prefetchError;
+            self.prefetchError = nil;
+        } else if (!self.requestInFlight && self.nextIndex >= self.endIndex) {
+            page = [NSArray array];
+        } else {
+            break;
+        }
+        [self.waiters removeObjectAtIndex:0];
+        waiter(page, error);
+        [self SM_fetchNextPage];
+    }
+    [self SM_fetchNextPage];
+}
+
+- (void)SM_fetchNextPage
+{
+    // Only ever one page held or in flight ahead of the consumer
+    if (self.requestInFlight || self.prefetchedPage || self.prefetchError || self.nextIndex >= self.endIndex) {
+        return;
+    }
+    
+    NSUInteger pageStart = self.nextIndex;
+    NSUInteger pageEnd = MIN(pageStart + self.pageSize, self.endIndex);
+    self.requestInFlight = YES;
+    
+    SMQuery *pageQuery = [[SMQuery alloc] initWithSchema:self.query.schemaName];
+    pageQuery.requestParameters = self.query.requestParameters;
+    pageQuery.requestHeaders = [self.query.requestHeaders copy];
+    [pageQuery fromIndex:pageStart toIndex:(pageEnd - 1)];
+    SMRequestOptions *pageOptions = [self.options copy];
+    NSMutableURLRequest *request = [self.dataStore requestFromQuery:pageQuery options:pageOptions];
+    
+    SMFullResponseSuccessBlock pageSuccessBlock = ^(NSURLRequest *pageRequest, NSHTTPURLResponse *response, id JSON) {
+        self.requestInFlight = NO;
+        NSArray *results = JSON ? (NSArray *)JSON : [NSArray array];
+        self.nextIndex = pageEnd;
+        
+        NSString *rangeHeader = [response.allHeaderFields valueForKey:@"Content-Range"];
+        int count = [self.dataStore countFromRangeHeader:rangeHeader results:results];
+        if (rangeHeader && count >= 0) {
+            self.endIndex = MIN(self.endIndex, (NSUInteger)count);
+        }
+        if ([results count] < pageEnd - pageStart) {
+            // A short page means the end of the collection was reached
+            self.endIndex = MIN(self.endIndex, pageStart + [results count]);
+        }
+        if ([results count] > 0) {
+            self.prefetchedPage = results;
+        }
+        [self SM_deliverPages];
+    };
+    
+    SMFullResponseFailureBlock pageFailureBlock = ^(NSURLRequest *pageRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
+        // nextIndex is left alone so the page is requested again
+        self.requestInFlight = NO;
+        self.prefetchError = response == nil ? error : [self.dataStore errorFromResponse:response JSON:JSON];
+        [self SM_deliverPages];
+    };
+    
+    [self.dataStore queueRequest:request options:pageOptions successCallbackQueue:self.cursorQueue failureCallbackQueue:self.cursorQueue onSuccess:pageSuccessBlock onFailure:pageFailureBlock];
+}
+
+@end
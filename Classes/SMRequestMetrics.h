@@ -0,0 +1,283 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class SMRequestMetrics;
+
+/**
+ The key under which <[SMRequestMetrics snapshot]> summarizes every request, whatever its schema and method.
+ */
+extern NSString *const SMRequestMetricsAllRequestsKey;
+
+/**
+ Returns a monotonic timestamp, in seconds, suitable for measuring intervals between two calls.
+ 
+ @return Seconds since an arbitrary point in the past.
+ */
+NSTimeInterval SMRequestMetricsTimestamp(void);
+
+/**
+ `SMHistogram` summarizes a stream of non-negative values in constant space.
+ 
+ Values are counted in buckets which grow by a factor of 2^(1/8) from one to the next, so percentiles are accurate to within about 9%.  Count, sum, minimum and maximum are exact.
+ 
+ A histogram is not thread safe.  <SMRequestMetrics> only hands out copies.
+ */
+@interface SMHistogram : NSObject <NSCopying>
+
+/**
+ The number of values recorded.
+ */
+@property (nonatomic, readonly) unsigned long long count;
+
+/**
+ The sum of the values recorded.
+ */
+@property (nonatomic, readonly) double sum;
+
+/**
+ The smallest value recorded, or 0 if there are none.
+ */
+@property (nonatomic, readonly) double minimum;
+
+/**
+ The largest value recorded, or 0 if there are none.
+ */
+@property (nonatomic, readonly) double maximum;
+
+/**
+ The mean of the values recorded, or 0 if there are none.
+ */
+@property (nonatomic, readonly) double mean;
+
+/**
+ Record a value.  Negative values are recorded as 0.
+ 
+ @param value The value to record.
+ */
+- (void)recordValue:(double)value;
+
+/**
+ An estimate of the value below which a given percentage of the recorded values fall.
+ 
+ @param percentile Between 0 and 100.
+ 
+ @return The estimate, never less than <minimum> or more than <maximum>.  0 if no values have been recorded.
+ */
+- (double)valueAtPercentile:(double)percentile;
+
+/**
+ Forget every value recorded.
+ */
+- (void)reset;
+
+@end
+
+/**
+ `SMRequestMetricsSample` describes one HTTP attempt made through <SMDataStore>.  A request which is retried, or sent again after its access token is refreshed, produces a sample for each attempt.
+ */
+@interface SMRequestMetricsSample : NSObject
+
+/**
+ The schema, or the first component of the path for requests such as custom code.
+ */
+@property (nonatomic, copy) NSString *schema;
+
+/**
+ The HTTP method.
+ */
+@property (nonatomic, copy) NSString *method;
+
+/**
+ The HTTP status code, or 0 if no response was received.
+ */
+@property (nonatomic) NSInteger statusCode;
+
+/**
+ The error the connection failed with, if any.  HTTP error statuses are reported through <statusCode> alone.
+ */
+@property (nonatomic, strong) NSError *error;
+
+/**
+ Seconds from the operation being created to it being started by its queue.
+ */
+@property (nonatomic) NSTimeInterval queueWait;
+
+/**
+ Seconds from the operation being started to the response headers arriving, or 0 if none arrived.
+ */
+@property (nonatomic) NSTimeInterval timeToFirstByte;
+
+/**
+ Seconds from the operation being created to the response finishing or the connection failing.
+ */
+@property (nonatomic) NSTimeInterval totalTime;
+
+/**
+ The size of the request body as sent.
+ */
+@property (nonatomic) long long requestBytes;
+
+/**
+ The size of the response body after decompression.
+ */
+@property (nonatomic) long long responseBytes;
+
+/**
+ The number of retries which came before this attempt.
+ */
+@property (nonatomic) NSUInteger retryCount;
+
+/**
+ Whether the access token was refreshed before this attempt was sent.
+ */
+@property (nonatomic) BOOL tokenRefreshed;
+
+/**
+ Whether the attempt failed, either with an error or an HTTP status of 400 or more.
+ */
+- (BOOL)failed;
+
+@end
+
+/**
+ `SMRequestMetricsSummary` aggregates every sample recorded for one schema and method.  Times are recorded in microseconds and sizes in bytes.
+ */
+@interface SMRequestMetricsSummary : NSObject <NSCopying>
+
+/**
+ The number of samples recorded.
+ */
+@property (nonatomic, readonly) unsigned long long requestCount;
+
+/**
+ The number of samples which <[SMRequestMetricsSample failed]>.
+ */
+@property (nonatomic, readonly) unsigned long long failureCount;
+
+/**
+ The number of samples which were retries.
+ */
+@property (nonatomic, readonly) unsigned long long retryCount;
+
+/**
+ The number of samples sent after the access token was refreshed.
+ */
+@property (nonatomic, readonly) unsigned long long tokenRefreshCount;
+
+/**
+ Queue wait, in microseconds.
+ */
+@property (nonatomic, readonly, strong) SMHistogram *queueWait;
+
+/**
+ Time to first byte, in microseconds.  Only attempts which received a response are counted.
+ */
+@property (nonatomic, readonly, strong) SMHistogram *timeToFirstByte;
+
+/**
+ Total time, in microseconds.
+ */
+@property (nonatomic, readonly, strong) SMHistogram *totalTime;
+
+/**
+ Request body sizes, in bytes.
+ */
+@property (nonatomic, readonly, strong) SMHistogram *requestBytes;
+
+/**
+ Response body sizes, in bytes.
+ */
+@property (nonatomic, readonly, strong) SMHistogram *responseBytes;
+
+/**
+ Add a sample to the summary.
+ 
+ @param sample The sample to add.
+ */
+- (void)recordSample:(SMRequestMetricsSample *)sample;
+
+@end
+
+/**
+ Implemented by objects which want to hear about every request <SMRequestMetrics> records.
+ */
+@protocol SMRequestMetricsObserver <NSObject>
+
+/**
+ Called once for every HTTP attempt, on a private serial queue, after the sample has been added to the histograms.
+ 
+ @param metrics The metrics which recorded the sample.
+ @param sample The sample.
+ */
+- (void)requestMetrics:(SMRequestMetrics *)metrics didRecordSample:(SMRequestMetricsSample *)sample;
+
+@end
+
+/**
+ `SMRequestMetrics` measures where the time goes in requests sent through <SMDataStore>: how long each waits to be sent, how long the server takes to answer and how much is sent each way.  Samples are summarized in streaming histograms per schema and method, which can be read with <snapshot>, and passed to any attached observers.
+ 
+ Nothing is measured unless an observer is attached or <enabled> is `YES`, so an idle `SMRequestMetrics` costs one check per request.
+ 
+ @note You should not need to create your own `SMRequestMetrics`.  One is created with each <SMUserSession>.
+ */
+@interface SMRequestMetrics : NSObject
+
+/**
+ Whether samples are collected for <snapshot> when no observer is attached.  Default is `NO`.
+ */
+@property (atomic) BOOL enabled;
+
+/**
+ Whether requests are currently being measured: `YES` if <enabled> is set or any observer is attached.
+ */
+@property (atomic, readonly) BOOL isCollecting;
+
+/**
+ Start passing samples to an observer.  Observers are retained until removed.
+ 
+ @param observer The observer.
+ */
+- (void)addObserver:(id<SMRequestMetricsObserver>)observer;
+
+/**
+ Stop passing samples to an observer.
+ 
+ @param observer The observer.
+ */
+- (void)removeObserver:(id<SMRequestMetricsObserver>)observer;
+
+/**
+ Add a sample to the histograms and pass it to every observer.  Called by <SMJSONRequestOperation> when an attempt finishes.
+ 
+ @param sample The sample.
+ */
+- (void)recordSample:(SMRequestMetricsSample *)sample;
+
+/**
+ A copy of the histograms collected so far.
+ 
+ @return A dictionary of <SMRequestMetricsSummary> keyed by method and schema, such as `@"GET todo"`, with the summary of every request under `SMRequestMetricsAllRequestsKey`.
+ */
+- (NSDictionary *)snapshot;
+
+/**
+ Forget every sample collected so far.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,349 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMRequestMetrics.h"
+#import <mach/mach_time.h>
+
+#define HISTOGRAM_BUCKETS_PER_DOUBLING 8
+// Bucket 0 holds values below 1; the rest cover 1 up to 2^64
+#define HISTOGRAM_BUCKET_COUNT (1 + 64 * HISTOGRAM_BUCKETS_PER_DOUBLING)
+
+NSString *const SMRequestMetricsAllRequestsKey = @"*";
+
+NSTimeInterval SMRequestMetricsTimestamp(void)
+{
+    static double secondsPerTick = 0;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        secondsPerTick = (double)timebase.numer / timebase.denom / NSEC_PER_SEC;
+    });
+    return mach_absolute_time() * secondsPerTick;
+}
+
+@interface SMHistogram ()
+
+@property (nonatomic, readwrite) unsigned long long count;
+@property (nonatomic, readwrite) double sum;
+@property (nonatomic, readwrite) double minimum;
+@property (nonatomic, readwrite) double maximum;
+
+@end
+
+@implementation SMHistogram
+{
+    unsigned long long _SM_buckets[HISTOGRAM_BUCKET_COUNT];
+}
+
+@synthesize count = _SM_count;
+@synthesize sum = _SM_sum;
+@synthesize minimum = _SM_minimum;
+@synthesize maximum = _SM_maximum;
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    SMHistogram *copy = [[SMHistogram allocWithZone:zone] init];
+    copy.count = self.count;
+    copy.sum = self.sum;
+    copy.minimum = self.minimum;
+    copy.maximum = self.maximum;
+    memcpy(copy->_SM_buckets, _SM_buckets, sizeof(_SM_buckets));
+    return copy;
+}
+
+- (double)mean
+{
+    return self.count == 0 ? 0 : self.sum / self.count;
+}
+
+- (void)recordValue:(double)value
+{
+    if (!(value > 0)) {
+        value = 0;
+    }
+    int bucket = 0;
+    if (value >= 1) {
+        bucket = 1 + (int)(log2(value) * HISTOGRAM_BUCKETS_PER_DOUBLING);
+        bucket = MIN(bucket, HISTOGRAM_BUCKET_COUNT - 1);
+    }
+    _SM_buckets[bucket]++;
+    
+    if (self.count == 0 || value < self.minimum) {
+        self.minimum = value;
+    }
+    if (self.count == 0 || value > self.maximum) {
+        self.maximum = value;
+    }
+    self.count++;
+    self.sum += value;
+}
+
+- (double)valueAtPercentile:(double)percentile
+{
+    if (self.count == 0) {
+        return 0;
+    }
+    unsigned long long rank = (unsigned long long)ceil(MAX(0, MIN(100, percentile)) / 100 * self.count);
+    rank = MAX(rank, 1);
+    
+    unsigned long long seen = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKET_COUNT; bucket++) {
+        seen += _SM_buckets[bucket];
+        if (seen >= rank) {
+            // Report the top of the bucket, which is an overestimate by less than one bucket's width
+            double upperBound = bucket == 0 ? 1 : exp2((double)bucket / HISTOGRAM_BUCKETS_PER_DOUBLING);
+            return MAX(self.minimum, MIN(self.maximum, upperBound));
+        }
+    }
+    return self.maximum;
+}
+
+- (void)reset
+{
+    self.count = 0;
+    self.sum = 0;
+    self.minimum = 0;
+    self.maximum = 0;
+    memset(_SM_buckets, 0, sizeof(_SM_buckets));
+}
+
+@end
+
+@implementation SMRequestMetricsSample
+
+@synthesize schema = _SM_schema;
+@synthesize method = _SM_method;
+@synthesize statusCode = _SM_statusCode;
+@synthesize error = _SM_error;
+@synthesize queueWait = _SM_queueWait;
+@synthesize timeToFirstByte = _SM_timeToFirstByte;
+@synthesize totalTime = _SM_totalTime;
+@synthesize requestBytes = _SM_requestBytes;
+@synthesize responseBytes = _SM_responseBytes;
+@synthesize retryCount = _SM_retryCount;
+@synthesize tokenRefreshed = _SM_tokenRefreshed;
+
+- (BOOL)failed
+{
+    return self.error != nil || self.statusCode >= 400;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@: %p> %@ %@ %d in %.3fs (queued %.3fs, first byte %.3fs), %lld bytes out, %lld bytes in, %u retries%@", [self class], self, self.method, self.schema, (int)self.statusCode, self.totalTime, self.queueWait, self.timeToFirstByte, self.requestBytes, self.responseBytes, (unsigned)self.retryCount, self.tokenRefreshed ? @", token refreshed" : @""];
+}
+
+@end
+
+@interface SMRequestMetricsSummary ()
+
+@property (nonatomic, readwrite) unsigned long long requestCount;
+@property (nonatomic, readwrite) unsigned long long failureCount;
+@property (nonatomic, readwrite) unsigned long long retryCount;
+@property (nonatomic, readwrite) unsigned long long tokenRefreshCount;
+@property (nonatomic, readwrite, strong) SMHistogram *queueWait;
+@property (nonatomic, readwrite, strong) SMHistogram *timeToFirstByte;
+@property (nonatomic, readwrite, strong) SMHistogram *totalTime;
+@property (nonatomic, readwrite, strong) SMHistogram *requestBytes;
+@property (nonatomic, readwrite, strong) SMHistogram *responseBytes;
+
+@end
+
+@implementation SMRequestMetricsSummary
+
+@synthesize requestCount = _SM_requestCount;
+@synthesize failureCount = _SM_failureCount;
+@synthesize retryCount = _SM_retryCount;
+@synthesize tokenRefreshCount = _SM_tokenRefreshCount;
+@synthesize queueWait = _SM_queueWait;
+@synthesize timeToFirstByte = _SM_timeToFirstByte;
+@synthesize totalTime = _SM_totalTime;
+@synthesize requestBytes = _SM_requestBytes;
+@synthesize responseBytes = _SM_responseBytes;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.queueWait = [[SMHistogram alloc] init];
+        self.timeToFirstByte = [[SMHistogram alloc] init];
+        self.totalTime = [[SMHistogram alloc] init];
+        self.requestBytes = [[SMHistogram alloc] init];
+        self.responseBytes = [[SMHistogram alloc] init];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    SMRequestMetricsSummary *copy = [[SMRequestMetricsSummary allocWithZone:zone] init];
+    copy.requestCount = self.requestCount;
+    copy.failureCount = self.failureCount;
+    copy.retryCount = self.retryCount;
+    copy.tokenRefreshCount = self.tokenRefreshCount;
+    copy.queueWait = [self.queueWait copy];
+    copy.timeToFirstByte = [self.timeToFirstByte copy];
+    copy.totalTime = [self.totalTime copy];
+    copy.requestBytes = [self.requestBytes copy];
+    copy.responseBytes = [self.responseBytes copy];
+    return copy;
+}
+
+- (void)recordSample:(SMRequestMetricsSample *)sample
+{
+    self.requestCount++;
+    if ([sample failed]) {
+        self.failureCount++;
+    }
+    if (sample.retryCount > 0) {
+        self.retryCount++;
+    }
+    if (sample.tokenRefreshed) {
+        self.tokenRefreshCount++;
+    }
+    [self.queueWait recordValue:sample.queueWait * USEC_PER_SEC];
+    if (sample.statusCode != 0) {
+        [self.timeToFirstByte recordValue:sample.timeToFirstByte * USEC_PER_SEC];
+    }
+    [self.totalTime recordValue:sample.totalTime * USEC_PER_SEC];
+    [self.requestBytes recordValue:sample.requestBytes];
+    [self.responseBytes recordValue:sample.responseBytes];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@: %p> %llu requests, %llu failed, total time p50 %.0fus p99 %.0fus", [self class], self, self.requestCount, self.failureCount, [self.totalTime valueAtPercentile:50], [self.totalTime valueAtPercentile:99]];
+}
+
+@end
+
+@interface SMRequestMetrics ()
+
+// Replaced rather than mutated, so it can be read without holding the lock
+@property (atomic, strong) NSArray *observers;
+@property (atomic, readwrite) BOOL isCollecting;
+@property (nonatomic, strong) NSMutableDictionary *summaries;
+@property (nonatomic) dispatch_queue_t recordingQueue;
+
+- (void)SM_updateIsCollecting;
+
+@end
+
+@implementation SMRequestMetrics
+
+@synthesize enabled = _SM_enabled;
+@synthesize isCollecting = _SM_isCollecting;
+@synthesize observers = _SM_observers;
+@synthesize summaries = _SM_summaries;
+@synthesize recordingQueue = _SM_recordingQueue;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.observers = [NSArray array];
+        self.summaries = [NSMutableDictionary dictionary];
+        self.recordingQueue = dispatch_queue_create("com.stackmob.requestMetricsQueue", NULL);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_SM_recordingQueue) {
+        dispatch_release(_SM_recordingQueue);
+    }
+}
+
+- (void)setEnabled:(BOOL)enabled
+{
+    @synchronized(self) {
+        _SM_enabled = enabled;
+        [self SM_updateIsCollecting];
+    }
+}
+
+- (void)SM_updateIsCollecting
+{
+    self.isCollecting = _SM_enabled || [self.observers count] > 0;
+}
+
+- (void)addObserver:(id<SMRequestMetricsObserver>)observer
+{
+    @synchronized(self) {
+        if (![self.observers containsObject:observer]) {
+            self.observers = [self.observers arrayByAddingObject:observer];
+        }
+        [self SM_updateIsCollecting];
+    }
+}
+
+- (void)removeObserver:(id<SMRequestMetricsObserver>)observer
+{
+    @synchronized(self) {
+        NSMutableArray *observers = [self.observers mutableCopy];
+        [observers removeObject:observer];
+        self.observers = observers;
+        [self SM_updateIsCollecting];
+    }
+}
+
+- (void)recordSample:(SMRequestMetricsSample *)sample
+{
+    // Callers are usually on the network thread, so the work is done elsewhere
+    dispatch_async(self.recordingQueue, ^{
+        NSString *key = [NSString stringWithFormat:@"%@ %@", sample.method, sample.schema];
+        SMRequestMetricsSummary *summary = [self.summaries objectForKey:key];
+        if (summary == nil) {
+            summary = [[SMRequestMetricsSummary alloc] init];
+            [self.summaries setObject:summary forKey:key];
+        }
+        [summary recordSample:sample];
+        
+        SMRequestMetricsSummary *allRequests = [self.summaries objectForKey:SMRequestMetricsAllRequestsKey];
+        if (allRequests == nil) {
+            allRequests = [[SMRequestMetricsSummary alloc] init];
+            [self.summaries setObject:allRequests forKey:SMRequestMetricsAllRequestsKey];
+        }
+        [allRequests recordSample:sample];
+        
+        for (id<SMRequestMetricsObserver> observer in self.observers) {
+            [observer requestMetrics:self didRecordSample:sample];
+        }
+    });
+}
+
+- (NSDictionary *)snapshot
+{
+    __block NSMutableDictionary *snapshot = nil;
+    dispatch_sync(self.recordingQueue, ^{
+        snapshot = [NSMutableDictionary dictionaryWithCapacity:[self.summaries count]];
+        [self.summaries enumerateKeysAndObjectsUsingBlock:^(id key, id summary, BOOL *stop) {
+            [snapshot setObject:[summary copy] forKey:key];
+        }];
+    });
+    return snapshot;
+}
+
+- (void)reset
+{
+    dispatch_sync(self.recordingQueue, ^{
+        [self.summaries removeAllObjects];
+    });
+}
+
+@end
@@ -15,6 +15,9 @@
  */
 
 #import "SMResponseBlocks.h"
+#import "SMRequestScheduler.h"
+
+@class SMTraceSpan;
 
 /**
  `SMRequestOptions` is a class designed to supply various choices to requests, including:
@@ -25,7 +28,7 @@
  * The ability to disable automatic login refresh
  
  */
-@interface SMRequestOptions : NSObject
+@interface SMRequestOptions : NSObject <NSCopying>
 
 ///-------------------------------
 /// @name Properties
@@ -47,12 +50,39 @@
 @property(nonatomic, readwrite) BOOL tryRefreshToken;
 
 /**
- In the case that a 503 `SMErrorServiceUnavailable` response is returned, the number of times to retry.  The default is 3 times.
+ The number of times to retry a failed request.  The default is 3 times.
+ 
+ A 503 `SMErrorServiceUnavailable` response with a `Retry-After` header is retried after the time the server asks for, whatever the request method.  A 503 without one, or a transient network failure such as a timeout or a dropped connection, is retried with exponential backoff (see <retryBaseDelay>), but only for `GET`, `PUT` and `DELETE` requests, which are safe to send twice.  A streamed request (see <streamingBatchBlock>) is not retried once any rows have been passed to its batch block, since they would be delivered again.  Retries also draw on the session's <SMRetryBudget>, so they stop when too large a share of recent requests have been retries.
  
  The default retry action is to send the original request, resigned with up to date arguments. If a <retryBlock> has been added it is used in place of the default.
  */
 @property(nonatomic, readwrite) NSInteger numberOfRetries;
 
+/**
+ The delay before the first backoff retry, in seconds.  Each later retry doubles it, up to <retryMaxDelay>, and the actual wait is chosen at random between zero and that value so clients don't retry in lockstep.  The default is 0.5 seconds.
+ */
+@property(nonatomic, readwrite) NSTimeInterval retryBaseDelay;
+
+/**
+ The longest delay before a backoff retry, in seconds.  The default is 30 seconds.
+ */
+@property(nonatomic, readwrite) NSTimeInterval retryMaxDelay;
+
+/**
+ The number of retries made so far.  Maintained by the SDK and used to compute the backoff delay.
+ */
+@property(nonatomic, readwrite) NSUInteger retriesAttempted;
+
+/**
+ Whether the access token was refreshed before the request was sent.  Maintained by the SDK and reported in <SMRequestMetrics>.
+ */
+@property(nonatomic, readwrite) BOOL tokenRefreshed;
+
+/**
+ The span which HTTP operations for the request are recorded under when <SMTracer> is enabled.  If not set, the span current on the thread which sends the request is used.
+ */
+@property(nonatomic, strong) SMTraceSpan *parentTraceSpan;
+
 /**
  An optional block to call if the response returns a 503 `SMErrorServiceUnavailable`. Use <addSMErrorServiceUnavailableRetryBlock:> to set.
  
@@ -63,6 +93,23 @@
  */
 @property (nonatomic, strong) SMFailureRetryBlock retryBlock;
 
+/**
+ If set, a query response is parsed as it downloads and handed to this block in batches of <streamingBatchSize> rows, instead of being delivered as a single array.  Batches are called on the success callback queue, in order, before the success block.
+ 
+ Usually set for you by `performQuery:options:batchSize:successCallbackQueue:failureCallbackQueue:onBatch:onSuccess:onFailure:` on <SMDataStore>.
+ */
+@property (nonatomic, copy) SMResultsSuccessBlock streamingBatchBlock;
+
+/**
+ The number of rows passed to <streamingBatchBlock> at a time.  The default is 100.
+ */
+@property (nonatomic, readwrite) NSUInteger streamingBatchSize;
+
+/**
+ How soon the request is sent relative to others waiting in the <SMRequestScheduler>.  Use `SMRequestPriorityInteractive` for requests the user is waiting on and `SMRequestPriorityBackground` for bulk work such as syncing.  The default is `SMRequestPriorityDefault`.
+ */
+@property (nonatomic, readwrite) SMRequestPriority priority;
+
 ///-------------------------------
 /// @name Initialize
 ///-------------------------------
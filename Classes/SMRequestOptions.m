@@ -23,6 +23,14 @@
 @synthesize tryRefreshToken = _SM_tryRefreshToken;
 @synthesize numberOfRetries = _SM_numberOfRetries;
 @synthesize retryBlock = _SM_retryBlock;
+@synthesize streamingBatchBlock = _SM_streamingBatchBlock;
+@synthesize streamingBatchSize = _SM_streamingBatchSize;
+@synthesize priority = _SM_priority;
+@synthesize retryBaseDelay = _SM_retryBaseDelay;
+@synthesize retryMaxDelay = _SM_retryMaxDelay;
+@synthesize retriesAttempted = _SM_retriesAttempted;
+@synthesize tokenRefreshed = _SM_tokenRefreshed;
+@synthesize parentTraceSpan = _SM_parentTraceSpan;
 
 
 + (SMRequestOptions *)options
@@ -32,7 +40,12 @@
     opts.isSecure = NO;
     opts.tryRefreshToken = YES;
     opts.numberOfRetries = 3;
+    opts.retryBaseDelay = 0.5;
+    opts.retryMaxDelay = 30.0;
     opts.retryBlock = nil;
+    opts.streamingBatchBlock = nil;
+    opts.streamingBatchSize = 100;
+    opts.priority = SMRequestPriorityDefault;
     return opts;
 }
 
@@ -65,6 +78,23 @@
     return opt;
 }
 
+- (id)copyWithZone:(NSZone *)zone
+{
+    SMRequestOptions *opts = [[SMRequestOptions allocWithZone:zone] init];
+    opts.headers = self.headers;
+    opts.isSecure = self.isSecure;
+    opts.tryRefreshToken = self.tryRefreshToken;
+    opts.numberOfRetries = self.numberOfRetries;
+    opts.retryBaseDelay = self.retryBaseDelay;
+    opts.retryMaxDelay = self.retryMaxDelay;
+    opts.retryBlock = self.retryBlock;
+    opts.streamingBatchBlock = self.streamingBatchBlock;
+    opts.streamingBatchSize = self.streamingBatchSize;
+    opts.priority = self.priority;
+    opts.parentTraceSpan = self.parentTraceSpan;
+    return opts;
+}
+
 - (void)setExpandDepth:(NSUInteger)depth
 {
     if (!self.headers) {
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class AFHTTPRequestOperation;
+
+typedef enum {
+    SMRequestPriorityBackground = 0,
+    SMRequestPriorityDefault = 1,
+    SMRequestPriorityInteractive = 2,
+} SMRequestPriority;
+
+/**
+ `SMRequestScheduler` decides when requests sent through the <SMOAuth2Client> instances of an <SMUserSession> go on the wire.
+ 
+ Requests wait in one of three priority classes (see `SMRequestPriority`) and are started highest class first, oldest first within a class, while fewer than <maxConcurrentRequests> are in flight overall and fewer than <maxConcurrentRequestsPerHost> are in flight to the request's host.  A request is in flight from the time it is started until its operation finishes.
+ 
+ Operations waiting to be started are not yet in their operation queue, so they are not seen by `-[NSOperationQueue operations]`.  Cancel them with <cancelPendingOperationsOnQueue:passingTest:>, which <SMOAuth2Client> calls from `cancelAllHTTPOperationsWithMethod:path:`.
+ 
+ Set a request's priority with the `priority` property of <SMRequestOptions>.  Token requests are sent by the session's `tokenClient`, which is not scheduled, so a token refresh never waits behind queued requests.
+ 
+ @note You should not need to create your own `SMRequestScheduler`.  One is created with each <SMUserSession>.
+ */
+@interface SMRequestScheduler : NSObject
+
+///-------------------------------
+/// @name Properties
+///-------------------------------
+
+/**
+ The most requests in flight at once, across every host.  Default is 8.
+ */
+@property (nonatomic) NSUInteger maxConcurrentRequests;
+
+/**
+ The most requests in flight at once to any one host.  Default is 6.
+ */
+@property (nonatomic) NSUInteger maxConcurrentRequestsPerHost;
+
+/**
+ The number of requests started and not yet finished.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfRequestsInFlight;
+
+/**
+ The number of requests waiting to be started.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfPendingRequests;
+
+///-------------------------------
+/// @name Scheduling
+///-------------------------------
+
+/**
+ The `NSOperationQueuePriority` used to carry a request priority on its operation.
+ 
+ @param priority A request priority.
+ 
+ @return The matching queue priority.
+ */
++ (NSOperationQueuePriority)queuePriorityForRequestPriority:(SMRequestPriority)priority;
+
+/**
+ Add an operation to the schedule.  It is added to queue once it may start.
+ 
+ The operation's priority class is read from its `queuePriority`, as set from <queuePriorityForRequestPriority:>.
+ 
+ @param operation The operation to schedule.
+ @param queue The queue to run the operation on.
+ */
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation onQueue:(NSOperationQueue *)queue;
+
+/**
+ Cancel operations which are still waiting to be started.
+ 
+ Each cancelled operation is taken out of the schedule and added to its queue straight away, where it finishes without going on the wire.  Operations already started are left alone.
+ 
+ @param queue Only operations bound for this queue are considered.
+ @param test Returns `YES` for each operation to cancel, or `nil` to cancel every operation bound for queue.
+ */
+- (void)cancelPendingOperationsOnQueue:(NSOperationQueue *)queue passingTest:(BOOL (^)(AFHTTPRequestOperation *operation))test;
+
+@end
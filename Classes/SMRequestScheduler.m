@@ -0,0 +1,197 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMRequestScheduler.h"
+#import "AFHTTPRequestOperation.h"
+
+#define MAX_CONCURRENT_REQUESTS 8
+#define MAX_CONCURRENT_REQUESTS_PER_HOST 6
+
+/**
+ An operation waiting for its turn, along with where it will run.
+ */
+@interface SMScheduledRequest : NSObject
+
+@property (nonatomic, strong) AFHTTPRequestOperation *operation;
+@property (nonatomic, strong) NSOperationQueue *queue;
+@property (nonatomic, copy) NSString *host;
+
+@end
+
+@implementation SMScheduledRequest
+
+@synthesize operation = _SM_operation;
+@synthesize queue = _SM_queue;
+@synthesize host = _SM_host;
+
+@end
+
+@interface SMRequestScheduler ()
+
+// Everything below is only touched on schedulerQueue
+@property (nonatomic) dispatch_queue_t schedulerQueue;
+@property (nonatomic, strong) NSArray *pendingRequestsByPriority;
+@property (nonatomic, strong) NSCountedSet *requestsInFlightByHost;
+@property (nonatomic, readwrite) NSUInteger numberOfRequestsInFlight;
+
+- (SMRequestPriority)SM_priorityForOperation:(NSOperation *)operation;
+- (SMScheduledRequest *)SM_dequeueNextStartableRequest;
+- (void)SM_startPendingRequests;
+- (void)SM_startRequest:(SMScheduledRequest *)request;
+
+@end
+
+@implementation SMRequestScheduler
+
+@synthesize maxConcurrentRequests = _SM_maxConcurrentRequests;
+@synthesize maxConcurrentRequestsPerHost = _SM_maxConcurrentRequestsPerHost;
+@synthesize numberOfRequestsInFlight = _SM_numberOfRequestsInFlight;
+@synthesize schedulerQueue = _SM_schedulerQueue;
+@synthesize pendingRequestsByPriority = _SM_pendingRequestsByPriority;
+@synthesize requestsInFlightByHost = _SM_requestsInFlightByHost;
+
++ (NSOperationQueuePriority)queuePriorityForRequestPriority:(SMRequestPriority)priority
+{
+    switch (priority) {
+        case SMRequestPriorityInteractive:
+            return NSOperationQueuePriorityHigh;
+        case SMRequestPriorityBackground:
+            return NSOperationQueuePriorityLow;
+        default:
+            return NSOperationQueuePriorityNormal;
+    }
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.maxConcurrentRequests = MAX_CONCURRENT_REQUESTS;
+        self.maxConcurrentRequestsPerHost = MAX_CONCURRENT_REQUESTS_PER_HOST;
+        self.schedulerQueue = dispatch_queue_create("com.stackmob.requestSchedulerQueue", NULL);
+        // Indexed by SMRequestPriority
+        self.pendingRequestsByPriority = [NSArray arrayWithObjects:[NSMutableArray array], [NSMutableArray array], [NSMutableArray array], nil];
+        self.requestsInFlightByHost = [NSCountedSet set];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_schedulerQueue);
+}
+
+- (NSUInteger)numberOfPendingRequests
+{
+    __block NSUInteger numberOfPendingRequests = 0;
+    dispatch_sync(self.schedulerQueue, ^{
+        for (NSArray *pendingRequests in self.pendingRequestsByPriority) {
+            numberOfPendingRequests += [pendingRequests count];
+        }
+    });
+    return numberOfPendingRequests;
+}
+
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation onQueue:(NSOperationQueue *)queue
+{
+    SMScheduledRequest *request = [[SMScheduledRequest alloc] init];
+    request.operation = operation;
+    request.queue = queue;
+    request.host = [[[operation request] URL] host] ? [[[operation request] URL] host] : @"";
+    SMRequestPriority priority = [self SM_priorityForOperation:operation];
+    
+    dispatch_async(self.schedulerQueue, ^{
+        [[self.pendingRequestsByPriority objectAtIndex:priority] addObject:request];
+        [self SM_startPendingRequests];
+    });
+}
+
+- (void)cancelPendingOperationsOnQueue:(NSOperationQueue *)queue passingTest:(BOOL (^)(AFHTTPRequestOperation *operation))test
+{
+    NSMutableArray *cancelledRequests = [NSMutableArray array];
+    dispatch_sync(self.schedulerQueue, ^{
+        for (NSMutableArray *pendingRequests in self.pendingRequestsByPriority) {
+            NSIndexSet *indexes = [pendingRequests indexesOfObjectsPassingTest:^BOOL(id request, NSUInteger idx, BOOL *stop) {
+                return [request queue] == queue && (!test || test([request operation]));
+            }];
+            [cancelledRequests addObjectsFromArray:[pendingRequests objectsAtIndexes:indexes]];
+            [pendingRequests removeObjectsAtIndexes:indexes];
+        }
+    });
+    
+    // Cancelled operations finish as soon as they are started, so anything waiting on them is released
+    for (SMScheduledRequest *request in cancelledRequests) {
+        [request.operation cancel];
+        [request.queue addOperation:request.operation];
+    }
+}
+
+- (SMRequestPriority)SM_priorityForOperation:(NSOperation *)operation
+{
+    if ([operation queuePriority] > NSOperationQueuePriorityNormal) {
+        return SMRequestPriorityInteractive;
+    } else if ([operation queuePriority] < NSOperationQueuePriorityNormal) {
+        return SMRequestPriorityBackground;
+    }
+    return SMRequestPriorityDefault;
+}
+
+- (SMScheduledRequest *)SM_dequeueNextStartableRequest
+{
+    // Highest priority first, then oldest first, skipping requests whose host is at its limit
+    for (NSMutableArray *pendingRequests in [self.pendingRequestsByPriority reverseObjectEnumerator]) {
+        for (NSUInteger i = 0; i < [pendingRequests count]; i++) {
+            SMScheduledRequest *request = [pendingRequests objectAtIndex:i];
+            if ([self.requestsInFlightByHost countForObject:request.host] < self.maxConcurrentRequestsPerHost) {
+                [pendingRequests removeObjectAtIndex:i];
+                return request;
+            }
+        }
+    }
+    return nil;
+}
+
+- (void)SM_startPendingRequests
+{
+    while (self.numberOfRequestsInFlight < self.maxConcurrentRequests) {
+        SMScheduledRequest *request = [self SM_dequeueNextStartableRequest];
+        if (!request) {
+            break;
+        }
+        [self SM_startRequest:request];
+    }
+}
+
+- (void)SM_startRequest:(SMScheduledRequest *)request
+{
+    self.numberOfRequestsInFlight++;
+    [self.requestsInFlightByHost addObject:request.host];
+    
+    __block id observer = [[NSNotificationCenter defaultCenter] addObserverForName:AFNetworkingOperationDidFinishNotification object:request.operation queue:nil usingBlock:^(NSNotification *note) {
+        [[NSNotificationCenter defaultCenter] removeObserver:observer];
+        observer = nil;
+        dispatch_async(self.schedulerQueue, ^{
+            self.numberOfRequestsInFlight--;
+            [self.requestsInFlightByHost removeObject:request.host];
+            [self SM_startPendingRequests];
+        });
+    }];
+    
+    [request.queue addOperation:request.operation];
+}
+
+@end
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMRetryBudget` caps automatic retries as a share of overall traffic, so that during an outage retries cannot multiply the load on StackMob.
+ 
+ Every request sent deposits <retryRatio> of a token, up to <maxTokens>, and every retry withdraws a whole token.  When less than a token is left, failures are reported straight away instead of being retried.  The budget starts full.
+ 
+ @note You should not need to create your own `SMRetryBudget`.  One is created with each <SMUserSession> and shared by every request sent through it.
+ */
+@interface SMRetryBudget : NSObject
+
+/**
+ The share of requests which may be retries, over time.  Default is 0.1.
+ */
+@property (nonatomic) double retryRatio;
+
+/**
+ The largest number of retries which may be saved up.  Default is 10.
+ */
+@property (nonatomic) double maxTokens;
+
+/**
+ Record that a request was sent.
+ */
+- (void)recordRequest;
+
+/**
+ Take a token for a retry, if one is available.
+ 
+ @return `YES` if the retry may go ahead, otherwise `NO`.
+ */
+- (BOOL)withdrawRetry;
+
+@end
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMRetryBudget.h"
+
+#define RETRY_RATIO 0.1
+#define MAX_RETRY_TOKENS 10.0
+
+@interface SMRetryBudget ()
+
+@property (nonatomic) double tokens;
+
+@end
+
+@implementation SMRetryBudget
+
+@synthesize retryRatio = _SM_retryRatio;
+@synthesize maxTokens = _SM_maxTokens;
+@synthesize tokens = _SM_tokens;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.retryRatio = RETRY_RATIO;
+        self.maxTokens = MAX_RETRY_TOKENS;
+        self.tokens = MAX_RETRY_TOKENS;
+    }
+    return self;
+}
+
+- (void)recordRequest
+{
+    @synchronized(self) {
+        self.tokens = MIN(self.tokens + self.retryRatio, self.maxTokens);
+    }
+}
+
+- (BOOL)withdrawRetry
+{
+    @synchronized(self) {
+        if (self.tokens < 1.0) {
+            return NO;
+        }
+        self.tokens -= 1.0;
+        return YES;
+    }
+}
+
+@end
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMStreamingBinaryData` is the value of a Binary Data field whose content is read from a file or stream while the request is being sent, instead of being base64 encoded into a string up front.  Peak memory stays flat however large the content is.
+ 
+ Use it as a field value with <SMDataStore>:
+ 
+    NSURL *videoURL = [[NSBundle mainBundle] URLForResource:@"video" withExtension:@"mov"];
+    SMStreamingBinaryData *video = [SMStreamingBinaryData binaryDataWithContentsOfURL:videoURL name:@"video.mov" contentType:@"video/quicktime"];
+    NSDictionary *clip = [NSDictionary dictionaryWithObjectsAndKeys:@"Holiday", @"title", video, @"video", nil];
+    [[[SMClient defaultClient] dataStore] createObject:clip inSchema:@"clip" onSuccess:... onFailure:...];
+ 
+ With Core Data, set the attribute to the reference string returned by <SMBinaryDataConversion> `stringForBinaryDataAtURL:name:contentType:`, which is replaced by the file's content when the object is saved.
+ */
+@interface SMStreamingBinaryData : NSObject
+
+@property (nonatomic, readonly, copy) NSString *name;
+@property (nonatomic, readonly, copy) NSString *contentType;
+@property (nonatomic, readonly, strong) NSURL *fileURL;
+
+/**
+ The length of the content in bytes, before it is base64 encoded.
+ */
+@property (nonatomic, readonly) unsigned long long length;
+
+/**
+ Binary data read from a file.
+ 
+ @param fileURL The file URL of the content.
+ @param name A name for the content.  This can be any arbitrary name.
+ @param contentType The content type of the data.
+ 
+ @return A new instance, or nil if the file cannot be read.
+ */
++ (id)binaryDataWithContentsOfURL:(NSURL *)fileURL name:(NSString *)name contentType:(NSString *)contentType;
+
+/**
+ Binary data read from streams made on demand.
+ 
+ A stream can only be read once, and a request may be sent more than once if it is retried or its access token is refreshed, so streamProvider is called for a new stream, positioned at the start of the content, each time the body is sent.
+ 
+ @param streamProvider Returns a new, unopened stream for the content each time it is called.
+ @param length The exact number of bytes each stream will provide, which is needed to send the Content-Length.
+ @param name A name for the content.  This can be any arbitrary name.
+ @param contentType The content type of the data.
+ 
+ @return A new instance.
+ */
++ (id)binaryDataWithStreamProvider:(NSInputStream *(^)(void))streamProvider length:(unsigned long long)length name:(NSString *)name contentType:(NSString *)contentType;
+
+/**
+ Binary data described by a reference string from <SMBinaryDataConversion> `stringForBinaryDataAtURL:name:contentType:`.
+ 
+ @param string A field value.
+ 
+ @return A new instance, or nil if the string is not a reference to a readable file.
+ */
++ (id)binaryDataWithReferenceString:(NSString *)string;
+
+/**
+ Whether a field value is a reference string from <SMBinaryDataConversion> `stringForBinaryDataAtURL:name:contentType:`.
+ 
+ @param string A field value.
+ 
+ @return `YES` if the string is a reference to a file.
+ */
++ (BOOL)isReferenceString:(NSString *)string;
+
+/**
+ Returns a new stream for the content, ready to be opened.
+ 
+ @return A stream for the content.
+ */
+- (NSInputStream *)inputStream;
+
+@end
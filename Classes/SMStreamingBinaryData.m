@@ -0,0 +1,105 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMStreamingBinaryData.h"
+#import "SMBinaryDataConversion.h"
+
+@interface SMStreamingBinaryData ()
+
+@property (nonatomic, readwrite, copy) NSString *name;
+@property (nonatomic, readwrite, copy) NSString *contentType;
+@property (nonatomic, readwrite, strong) NSURL *fileURL;
+@property (nonatomic, readwrite) unsigned long long length;
+@property (nonatomic, copy) NSInputStream *(^streamProvider)(void);
+
+@end
+
+@implementation SMStreamingBinaryData
+
+@synthesize name = _SM_name;
+@synthesize contentType = _SM_contentType;
+@synthesize fileURL = _SM_fileURL;
+@synthesize length = _SM_length;
+@synthesize streamProvider = _SM_streamProvider;
+
++ (id)binaryDataWithContentsOfURL:(NSURL *)fileURL name:(NSString *)name contentType:(NSString *)contentType
+{
+    if (![fileURL isFileURL]) {
+        return nil;
+    }
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[fileURL path] error:nil];
+    if (attributes == nil) {
+        return nil;
+    }
+    
+    SMStreamingBinaryData *binaryData = [[SMStreamingBinaryData alloc] init];
+    binaryData.fileURL = fileURL;
+    binaryData.length = [attributes fileSize];
+    binaryData.name = name;
+    binaryData.contentType = contentType;
+    return binaryData;
+}
+
++ (id)binaryDataWithStreamProvider:(NSInputStream *(^)(void))streamProvider length:(unsigned long long)length name:(NSString *)name contentType:(NSString *)contentType
+{
+    SMStreamingBinaryData *binaryData = [[SMStreamingBinaryData alloc] init];
+    binaryData.streamProvider = streamProvider;
+    binaryData.length = length;
+    binaryData.name = name;
+    binaryData.contentType = contentType;
+    return binaryData;
+}
+
++ (BOOL)isReferenceString:(NSString *)string
+{
+    // Checked against every string field of every request, so the cheap prefix test comes first
+    return [string hasPrefix:@"Content-Type: "] && [string rangeOfString:SMBinaryDataReferencePrefix options:NSBackwardsSearch].location != NSNotFound;
+}
+
++ (id)binaryDataWithReferenceString:(NSString *)string
+{
+    if (![self isReferenceString:string]) {
+        return nil;
+    }
+    
+    NSString *name = nil;
+    NSString *contentType = nil;
+    NSString *reference = nil;
+    for (NSString *line in [string componentsSeparatedByString:@"\n"]) {
+        if ([line hasPrefix:@"Content-Type: "]) {
+            contentType = [line substringFromIndex:[@"Content-Type: " length]];
+        } else if ([line hasPrefix:@"Content-Disposition: attachment; filename="]) {
+            name = [line substringFromIndex:[@"Content-Disposition: attachment; filename=" length]];
+        } else if ([line hasPrefix:SMBinaryDataReferencePrefix]) {
+            reference = [line substringFromIndex:[SMBinaryDataReferencePrefix length]];
+        }
+    }
+    if (reference == nil) {
+        return nil;
+    }
+    return [self binaryDataWithContentsOfURL:[NSURL URLWithString:reference] name:name contentType:contentType];
+}
+
+- (NSInputStream *)inputStream
+{
+    if (self.fileURL) {
+        return [NSInputStream inputStreamWithURL:self.fileURL];
+    }
+    return self.streamProvider();
+}
+
+@end
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMStreamingJSONParser` parses a JSON response body incrementally as data arrives.
+ 
+ When the body is a top-level JSON array, each element is parsed as soon as its closing byte is seen and handed to the batch block in groups of <batchSize>, so only the element currently being received is kept in memory.  Any other body (a single object, or an error response) is buffered and parsed in one go by <finish>, and is then available from <bufferedObject>.
+ 
+ @note You should not need to use this class directly.  It is used by <SMStreamingJSONRequestOperation>.
+ */
+@interface SMStreamingJSONParser : NSObject
+
+/**
+ The number of array elements handed to the batch block at a time.
+ */
+@property (nonatomic, readonly) NSUInteger batchSize;
+
+/**
+ `YES` once the first significant byte of the body was `[`.
+ */
+@property (nonatomic, readonly) BOOL isStreamingArray;
+
+/**
+ The number of array elements parsed so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfParsedObjects;
+
+/**
+ The parsed body when it was not a top-level array.  Set by <finish>.
+ */
+@property (nonatomic, readonly, strong) id bufferedObject;
+
+/**
+ The first parse error encountered, if any.
+ */
+@property (nonatomic, readonly, strong) NSError *error;
+
+/**
+ Initialize a parser.
+ 
+ @param batchSize The number of array elements to collect before calling batchBlock.  Must be greater than 0.
+ @param batchBlock Called synchronously from <appendData:> and <finish> with each batch of parsed elements, in order.
+ 
+ @return An instance of `SMStreamingJSONParser`.
+ */
+- (id)initWithBatchSize:(NSUInteger)batchSize batchBlock:(void (^)(NSArray *batch))batchBlock;
+
+/**
+ Feeds the next chunk of the response body to the parser.
+ 
+ @param data The bytes received.
+ 
+ @return `NO` if the body could not be parsed, in which case <error> is set and further data is ignored.
+ */
+- (BOOL)appendData:(NSData *)data;
+
+/**
+ Signals the end of the body.  Delivers any partial batch, or parses the buffered body if it was not an array.
+ 
+ @return `NO` if the body was malformed or truncated, in which case <error> is set.
+ */
+- (BOOL)finish;
+
+@end
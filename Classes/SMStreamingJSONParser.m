@@ -0,0 +1,254 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMStreamingJSONParser.h"
+
+typedef enum {
+    SMStreamingJSONParserStateStart = 0,
+    SMStreamingJSONParserStateArray = 1,
+    SMStreamingJSONParserStateBuffering = 2,
+    SMStreamingJSONParserStateDone = 3,
+    SMStreamingJSONParserStateFailed = 4,
+} SMStreamingJSONParserState;
+
+static inline BOOL SMIsJSONWhitespace(uint8_t byte)
+{
+    return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r';
+}
+
+@interface SMStreamingJSONParser ()
+
+@property (nonatomic, readwrite) BOOL isStreamingArray;
+@property (nonatomic, readwrite) NSUInteger numberOfParsedObjects;
+@property (nonatomic, readwrite, strong) id bufferedObject;
+@property (nonatomic, readwrite, strong) NSError *error;
+@property (nonatomic, copy) void (^batchBlock)(NSArray *batch);
+@property (nonatomic) SMStreamingJSONParserState state;
+@property (nonatomic) NSUInteger depth;
+@property (nonatomic) BOOL insideString;
+@property (nonatomic) BOOL escapingCharacter;
+@property (nonatomic, strong) NSMutableData *pendingData;
+@property (nonatomic, strong) NSMutableArray *currentBatch;
+
+- (BOOL)SM_finishElementWithBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+- (void)SM_deliverCurrentBatch;
+- (void)SM_failWithError:(NSError *)error;
+
+@end
+
+@implementation SMStreamingJSONParser
+
+@synthesize batchSize = _SM_batchSize;
+@synthesize isStreamingArray = _SM_isStreamingArray;
+@synthesize numberOfParsedObjects = _SM_numberOfParsedObjects;
+@synthesize bufferedObject = _SM_bufferedObject;
+@synthesize error = _SM_error;
+@synthesize batchBlock = _SM_batchBlock;
+@synthesize state = _SM_state;
+@synthesize depth = _SM_depth;
+@synthesize insideString = _SM_insideString;
+@synthesize escapingCharacter = _SM_escapingCharacter;
+@synthesize pendingData = _SM_pendingData;
+@synthesize currentBatch = _SM_currentBatch;
+
+- (id)initWithBatchSize:(NSUInteger)batchSize batchBlock:(void (^)(NSArray *batch))batchBlock
+{
+    self = [super init];
+    if (self) {
+        _SM_batchSize = batchSize > 0 ? batchSize : 1;
+        self.batchBlock = batchBlock;
+        self.state = SMStreamingJSONParserStateStart;
+        self.pendingData = [NSMutableData data];
+        self.currentBatch = [NSMutableArray arrayWithCapacity:_SM_batchSize];
+    }
+    return self;
+}
+
+- (BOOL)appendData:(NSData *)data
+{
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    NSUInteger elementStart = 0;
+    
+    for (NSUInteger i = 0; i < length; i++) {
+        uint8_t byte = bytes[i];
+        
+        switch (self.state) {
+            case SMStreamingJSONParserStateStart:
+                if (SMIsJSONWhitespace(byte)) {
+                    continue;
+                }
+                if (byte == '[') {
+                    self.state = SMStreamingJSONParserStateArray;
+                    self.isStreamingArray = YES;
+                    self.depth = 1;
+                    elementStart = i + 1;
+                } else {
+                    // Not an array, keep everything and parse it in one go at the end
+                    self.state = SMStreamingJSONParserStateBuffering;
+                    [self.pendingData appendBytes:&bytes[i] length:(length - i)];
+                    return YES;
+                }
+                break;
+            case SMStreamingJSONParserStateArray:
+                if (self.insideString) {
+                    if (self.escapingCharacter) {
+                        self.escapingCharacter = NO;
+                    } else if (byte == '\\') {
+                        self.escapingCharacter = YES;
+                    } else if (byte == '"') {
+                        self.insideString = NO;
+                    }
+                    continue;
+                }
+                switch (byte) {
+                    case '"':
+                        self.insideString = YES;
+                        break;
+                    case '{':
+                    case '[':
+                        self.depth++;
+                        break;
+                    case '}':
+                    case ']':
+                        self.depth--;
+                        if (self.depth == 0) {
+                            // Closing bracket of the top-level array
+                            if (![self SM_finishElementWithBytes:&bytes[elementStart] length:(i - elementStart)]) {
+                                return NO;
+                            }
+                            self.state = SMStreamingJSONParserStateDone;
+                            return YES;
+                        }
+                        break;
+                    case ',':
+                        if (self.depth == 1) {
+                            if (![self SM_finishElementWithBytes:&bytes[elementStart] length:(i - elementStart)]) {
+                                return NO;
+                            }
+                            elementStart = i + 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            case SMStreamingJSONParserStateBuffering:
+                [self.pendingData appendBytes:&bytes[i] length:(length - i)];
+                return YES;
+            case SMStreamingJSONParserStateDone:
+                return YES;
+            case SMStreamingJSONParserStateFailed:
+                return NO;
+        }
+    }
+    
+    if (self.state == SMStreamingJSONParserStateArray && elementStart < length) {
+        // Carry the unfinished element over to the next chunk
+        [self.pendingData appendBytes:&bytes[elementStart] length:(length - elementStart)];
+    }
+    
+    return YES;
+}
+
+- (BOOL)finish
+{
+    switch (self.state) {
+        case SMStreamingJSONParserStateStart:
+            // Empty body
+            return YES;
+        case SMStreamingJSONParserStateArray:
+            [self SM_failWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSPropertyListReadCorruptError userInfo:[NSDictionary dictionaryWithObject:@"Response ended before the JSON array was closed." forKey:NSLocalizedDescriptionKey]]];
+            return NO;
+        case SMStreamingJSONParserStateBuffering: {
+            NSError *parseError = nil;
+            id object = [NSJSONSerialization JSONObjectWithData:self.pendingData options:0 error:&parseError];
+            self.pendingData = nil;
+            if (parseError) {
+                [self SM_failWithError:parseError];
+                return NO;
+            }
+            self.bufferedObject = object;
+            self.state = SMStreamingJSONParserStateDone;
+            return YES;
+        }
+        case SMStreamingJSONParserStateDone:
+            [self SM_deliverCurrentBatch];
+            return YES;
+        case SMStreamingJSONParserStateFailed:
+            return NO;
+    }
+    return NO;
+}
+
+- (BOOL)SM_finishElementWithBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    NSData *elementData = nil;
+    if ([self.pendingData length] > 0) {
+        [self.pendingData appendBytes:bytes length:length];
+        elementData = self.pendingData;
+    } else {
+        elementData = [NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO];
+    }
+    
+    // Skip the empty element of `[]`
+    const uint8_t *elementBytes = [elementData bytes];
+    BOOL isEmpty = YES;
+    for (NSUInteger i = 0; i < [elementData length]; i++) {
+        if (!SMIsJSONWhitespace(elementBytes[i])) {
+            isEmpty = NO;
+            break;
+        }
+    }
+    
+    if (!isEmpty) {
+        NSError *parseError = nil;
+        id element = [NSJSONSerialization JSONObjectWithData:elementData options:NSJSONReadingAllowFragments error:&parseError];
+        if (element == nil) {
+            [self SM_failWithError:parseError];
+            return NO;
+        }
+        [self.currentBatch addObject:element];
+        self.numberOfParsedObjects++;
+        if ([self.currentBatch count] >= self.batchSize) {
+            [self SM_deliverCurrentBatch];
+        }
+    }
+    
+    [self.pendingData setLength:0];
+    return YES;
+}
+
+- (void)SM_deliverCurrentBatch
+{
+    if ([self.currentBatch count] > 0) {
+        NSArray *batch = [self.currentBatch copy];
+        self.currentBatch = [NSMutableArray arrayWithCapacity:self.batchSize];
+        if (self.batchBlock) {
+            self.batchBlock(batch);
+        }
+    }
+}
+
+- (void)SM_failWithError:(NSError *)error
+{
+    self.state = SMStreamingJSONParserStateFailed;
+    self.error = error;
+    self.pendingData = nil;
+    self.currentBatch = nil;
+}
+
+@end
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMJSONRequestOperation.h"
+
+/**
+ `SMStreamingJSONRequestOperation` is an <SMJSONRequestOperation> which parses a JSON array response while it downloads, rather than buffering the whole body and parsing it once the connection finishes.
+ 
+ Rows are handed to the batch block in order, on the operation's `successCallbackQueue` (the main queue if none is set), and every batch is dispatched before the success block.  Use a serial callback queue to keep that ordering.  Because the rows have already been delivered, the success block receives `nil` for a streamed array.  A response body which is not an array, such as an error, is buffered and delivered to the success or failure block as usual.
+ */
+@interface SMStreamingJSONRequestOperation : SMJSONRequestOperation
+
+/**
+ Creates a streaming JSON request operation.
+ 
+ @param urlRequest The request to send.
+ @param batchSize The number of rows to collect before calling batchBlock.
+ @param batchBlock Called with each batch of parsed rows.
+ @param success Called once the response has been fully received and parsed.
+ @param failure Called if the request failed or the response could not be parsed.
+ 
+ @return A new `SMStreamingJSONRequestOperation`.
+ */
++ (SMStreamingJSONRequestOperation *)JSONRequestOperationWithRequest:(NSURLRequest *)urlRequest
+                                                            batchSize:(NSUInteger)batchSize
+                                                           batchBlock:(void (^)(NSArray *batch))batchBlock
+                                                              success:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, id JSON))success
+                                                              failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error, id JSON))failure;
+
+/**
+ Whether any batch of rows has been handed to the batch block.
+ 
+ A request which fails after this is set must not be sent again, since the rows already delivered would be delivered a second time.
+ */
+@property (readonly) BOOL hasDeliveredRows;
+
+@end
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMStreamingJSONRequestOperation.h"
+#import "SMStreamingJSONParser.h"
+
+@interface SMStreamingJSONRequestOperation ()
+
+@property (nonatomic, strong) SMStreamingJSONParser *parser;
+@property (nonatomic, strong) id bufferedJSON;
+@property (nonatomic, strong) NSError *streamingError;
+@property (readwrite) BOOL hasDeliveredRows;
+
+@end
+
+@implementation SMStreamingJSONRequestOperation
+
+@synthesize parser = _SM_parser;
+@synthesize bufferedJSON = _SM_bufferedJSON;
+@synthesize streamingError = _SM_streamingError;
+@synthesize hasDeliveredRows = _SM_hasDeliveredRows;
+
++ (SMStreamingJSONRequestOperation *)JSONRequestOperationWithRequest:(NSURLRequest *)urlRequest
+                                                            batchSize:(NSUInteger)batchSize
+                                                           batchBlock:(void (^)(NSArray *batch))batchBlock
+                                                              success:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, id JSON))success
+                                                              failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error, id JSON))failure
+{
+    SMStreamingJSONRequestOperation *operation = (SMStreamingJSONRequestOperation *)[self JSONRequestOperationWithRequest:urlRequest success:success failure:failure];
+    
+    // The parser keeps whatever it needs, so the body doesn't also need to be accumulated in memory
+    operation.outputStream = [NSOutputStream outputStreamToFileAtPath:@"/dev/null" append:NO];
+    
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Warc-retain-cycles"
+    // The cycle is broken when the connection finishes or fails and the parser is released
+    operation.parser = [[SMStreamingJSONParser alloc] initWithBatchSize:batchSize batchBlock:^(NSArray *batch) {
+        if (batchBlock) {
+            operation.hasDeliveredRows = YES;
+            dispatch_async(operation.successCallbackQueue ? operation.successCallbackQueue : dispatch_get_main_queue(), ^{
+                batchBlock(batch);
+            });
+        }
+    }];
+#pragma clang diagnostic pop
+    
+    return operation;
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data
+{
+    [self.parser appendData:data];
+    [super connection:connection didReceiveData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection
+{
+    // Runs before the completion block, so the last batch is queued ahead of the success block
+    [self.parser finish];
+    self.bufferedJSON = self.parser.bufferedObject;
+    self.streamingError = self.parser.error;
+    self.parser = nil;
+    
+    [super connectionDidFinishLoading:connection];
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
+{
+    self.parser = nil;
+    [super connection:connection didFailWithError:error];
+}
+
+- (id)responseJSON
+{
+    return self.bufferedJSON;
+}
+
+- (NSError *)error
+{
+    NSError *error = [super error];
+    return error ? error : self.streamingError;
+}
+
+@end
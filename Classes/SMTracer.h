@@ -0,0 +1,158 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class SMTracer;
+
+/**
+ `SMTraceSpan` is one timed piece of work recorded by <SMTracer>.  Spans are created with the tracer and finished with <end>; every method is safe to call on `nil`, which is what the tracer hands out while it is disabled.
+ */
+@interface SMTraceSpan : NSObject
+
+/**
+ The span's name, such as `executeRequest`.
+ */
+@property (nonatomic, readonly, copy) NSString *name;
+
+/**
+ The span's category, such as `coredata` or `http`.
+ */
+@property (nonatomic, readonly, copy) NSString *category;
+
+/**
+ Unique within a trace.
+ */
+@property (nonatomic, readonly) unsigned long long spanID;
+
+/**
+ The span this one was started under, if any.
+ */
+@property (nonatomic, readonly, strong) SMTraceSpan *parent;
+
+/**
+ The Mach thread the span was started on.
+ */
+@property (nonatomic, readonly) unsigned int threadID;
+
+/**
+ Attach a value which is shown with the span in trace viewers.
+ 
+ @param value A string or number.
+ @param key The name to show it under.
+ */
+- (void)setArgument:(id)value forKey:(NSString *)key;
+
+/**
+ Finish the span and add it to the trace.  Only the first call has any effect.
+ */
+- (void)end;
+
+@end
+
+/**
+ `SMTracer` records spans of work in the SDK, such as Core Data requests, predicate translation, token refreshes, HTTP operations, response deserialization and cache writes, and writes them out in the Chrome trace-event format.  Load the file in `chrome://tracing` or any viewer which reads the format to see the critical path of a fetch or save.
+ 
+ Spans started with <beginSpanWithName:category:> nest under whichever span is current on the calling thread, and must be ended on that thread.  A span started on one thread under a parent from another, with <beginSpanWithName:category:parent:>, is linked to it by a flow arrow.  Work which may finish on a different thread from the one it started on, such as an HTTP operation, uses <beginDetachedSpanWithName:category:parent:> and is drawn as an async slice.
+ 
+ Tracing is off by default.  While it is off, spans are `nil` and cost one check each.
+ */
+@interface SMTracer : NSObject
+
+/**
+ Whether spans are being recorded.  Default is `NO`.
+ */
+@property (atomic) BOOL enabled;
+
+/**
+ The most spans kept in memory.  Spans beyond this are dropped and counted in <droppedSpanCount>.  Default is 100000.
+ */
+@property (atomic) NSUInteger maximumSpanCount;
+
+/**
+ The number of spans dropped because <maximumSpanCount> was reached.
+ */
+@property (atomic, readonly) NSUInteger droppedSpanCount;
+
+/**
+ The tracer used by the SDK.
+ 
+ @return The shared `SMTracer` instance.
+ */
++ (SMTracer *)sharedTracer;
+
+/**
+ Start a span under the calling thread's current span, and make it current until it ends.
+ 
+ @param name The span's name.
+ @param category The span's category.
+ 
+ @return The span, or `nil` if tracing is disabled.
+ */
+- (SMTraceSpan *)beginSpanWithName:(NSString *)name category:(NSString *)category;
+
+/**
+ Start a span under a given parent, and make it current on the calling thread until it ends.  Use this for work handed to another queue, passing the span which was current where the work was dispatched.
+ 
+ @param name The span's name.
+ @param category The span's category.
+ @param parent The span to record as its parent, or `nil`.
+ 
+ @return The span, or `nil` if tracing is disabled.
+ */
+- (SMTraceSpan *)beginSpanWithName:(NSString *)name category:(NSString *)category parent:(SMTraceSpan *)parent;
+
+/**
+ Start a span which may end on any thread.  It does not become the current span.
+ 
+ @param name The span's name.
+ @param category The span's category.
+ @param parent The span to record as its parent, or `nil`.
+ 
+ @return The span, or `nil` if tracing is disabled.
+ */
+- (SMTraceSpan *)beginDetachedSpanWithName:(NSString *)name category:(NSString *)category parent:(SMTraceSpan *)parent;
+
+/**
+ The innermost span started with <beginSpanWithName:category:> on the calling thread which has not ended.
+ 
+ @return The span, or `nil`.
+ */
+- (SMTraceSpan *)currentSpan;
+
+/**
+ The trace recorded so far, as a trace-event JSON object.
+ 
+ @return A dictionary with a `traceEvents` array.
+ */
+- (NSDictionary *)traceEventObject;
+
+/**
+ Write the trace recorded so far to a file.
+ 
+ @param path Where to write the JSON.
+ @param error On failure, the reason.
+ 
+ @return `YES` if the file was written.
+ */
+- (BOOL)writeTraceToPath:(NSString *)path error:(NSError *__autoreleasing *)error;
+
+/**
+ Forget every span recorded so far.
+ */
+- (void)reset;
+
+@end
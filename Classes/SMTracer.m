@@ -0,0 +1,351 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMTracer.h"
+#import "SMRequestMetrics.h"
+#import <pthread.h>
+
+#define DEFAULT_MAXIMUM_SPAN_COUNT 100000
+#define SPAN_STACK_KEY @"SMTracerSpanStack"
+
+static unsigned int SMCurrentThreadID(void)
+{
+    return pthread_mach_thread_np(pthread_self());
+}
+
+static NSNumber *SMTraceMicroseconds(NSTimeInterval seconds)
+{
+    return [NSNumber numberWithLongLong:(long long)(seconds * 1000000.0)];
+}
+
+@interface SMTracer ()
+
+@property (atomic, readwrite) NSUInteger droppedSpanCount;
+@property (nonatomic, strong) NSMutableArray *finishedSpans;
+// Mach thread ID -> thread name, for the thread_name metadata events
+@property (nonatomic, strong) NSMutableDictionary *threadNames;
+@property (atomic) unsigned long long lastSpanID;
+
+- (void)SM_finishSpan:(SMTraceSpan *)span;
+
+@end
+
+@interface SMTraceSpan ()
+
+@property (nonatomic, readwrite, copy) NSString *name;
+@property (nonatomic, readwrite, copy) NSString *category;
+@property (nonatomic, readwrite) unsigned long long spanID;
+@property (nonatomic, readwrite, strong) SMTraceSpan *parent;
+@property (nonatomic, readwrite) unsigned int threadID;
+@property (nonatomic) unsigned int endThreadID;
+@property (nonatomic) NSTimeInterval startTime;
+@property (nonatomic) NSTimeInterval endTime;
+@property (nonatomic) BOOL detached;
+@property (atomic) BOOL ended;
+@property (nonatomic, strong) NSMutableDictionary *arguments;
+@property (nonatomic, strong) SMTracer *tracer;
+
+- (NSArray *)SM_traceEventsWithProcessID:(NSNumber *)processID;
+
+@end
+
+@implementation SMTraceSpan
+
+@synthesize name = _SM_name;
+@synthesize category = _SM_category;
+@synthesize spanID = _SM_spanID;
+@synthesize parent = _SM_parent;
+@synthesize threadID = _SM_threadID;
+@synthesize endThreadID = _SM_endThreadID;
+@synthesize startTime = _SM_startTime;
+@synthesize endTime = _SM_endTime;
+@synthesize detached = _SM_detached;
+@synthesize ended = _SM_ended;
+@synthesize arguments = _SM_arguments;
+@synthesize tracer = _SM_tracer;
+
+- (void)setArgument:(id)value forKey:(NSString *)key
+{
+    if (!value || !key) {
+        return;
+    }
+    @synchronized(self) {
+        if (!self.arguments) {
+            self.arguments = [NSMutableDictionary dictionary];
+        }
+        [self.arguments setObject:value forKey:key];
+    }
+}
+
+- (void)end
+{
+    @synchronized(self) {
+        if (self.ended) {
+            return;
+        }
+        self.ended = YES;
+    }
+    self.endTime = SMRequestMetricsTimestamp();
+    self.endThreadID = SMCurrentThreadID();
+    
+    if (!self.detached) {
+        NSMutableArray *stack = [[[NSThread currentThread] threadDictionary] objectForKey:SPAN_STACK_KEY];
+        NSUInteger index = [stack indexOfObjectIdenticalTo:self];
+        if (index != NSNotFound) {
+            // Spans ended out of order take any children left open with them
+            [stack removeObjectsInRange:NSMakeRange(index, [stack count] - index)];
+        }
+    }
+    
+    [self.tracer SM_finishSpan:self];
+    self.tracer = nil;
+}
+
+- (NSArray *)SM_traceEventsWithProcessID:(NSNumber *)processID
+{
+    NSMutableDictionary *args = nil;
+    @synchronized(self) {
+        args = self.arguments ? [self.arguments mutableCopy] : [NSMutableDictionary dictionary];
+    }
+    [args setObject:[NSNumber numberWithUnsignedLongLong:self.spanID] forKey:@"span_id"];
+    if (self.parent) {
+        [args setObject:[NSNumber numberWithUnsignedLongLong:self.parent.spanID] forKey:@"parent_id"];
+    }
+    
+    NSNumber *startThread = [NSNumber numberWithUnsignedInt:self.threadID];
+    NSNumber *start = SMTraceMicroseconds(self.startTime);
+    NSString *category = self.category ? self.category : @"default";
+    NSMutableArray *events = [NSMutableArray arrayWithCapacity:3];
+    
+    if (self.detached) {
+        // Detached spans may overlap others on the same thread, such as concurrent connections on the network thread, so they are drawn as async slices
+        NSString *asyncID = [NSString stringWithFormat:@"0x%llx", self.spanID];
+        [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                           self.name, @"name",
+                           category, @"cat",
+                           @"b", @"ph",
+                           asyncID, @"id",
+                           start, @"ts",
+                           processID, @"pid",
+                           startThread, @"tid",
+                           args, @"args", nil]];
+        [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                           self.name, @"name",
+                           category, @"cat",
+                           @"e", @"ph",
+                           asyncID, @"id",
+                           SMTraceMicroseconds(self.endTime), @"ts",
+                           processID, @"pid",
+                           [NSNumber numberWithUnsignedInt:self.endThreadID], @"tid", nil]];
+        return events;
+    }
+    
+    [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                       self.name, @"name",
+                       category, @"cat",
+                       @"X", @"ph",
+                       start, @"ts",
+                       SMTraceMicroseconds(self.endTime - self.startTime), @"dur",
+                       processID, @"pid",
+                       startThread, @"tid",
+                       args, @"args", nil]];
+    
+    if (self.parent && !self.parent.detached && self.parent.threadID != self.threadID) {
+        // A flow arrow from the parent's slice to this one, since viewers only nest slices on the same thread
+        NSNumber *flowID = [NSNumber numberWithUnsignedLongLong:self.spanID];
+        [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                           @"child", @"name",
+                           category, @"cat",
+                           @"s", @"ph",
+                           flowID, @"id",
+                           start, @"ts",
+                           processID, @"pid",
+                           [NSNumber numberWithUnsignedInt:self.parent.threadID], @"tid", nil]];
+        [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                           @"child", @"name",
+                           category, @"cat",
+                           @"f", @"ph",
+                           @"e", @"bp",
+                           flowID, @"id",
+                           start, @"ts",
+                           processID, @"pid",
+                           startThread, @"tid", nil]];
+    }
+    return events;
+}
+
+@end
+
+@implementation SMTracer
+
+@synthesize enabled = _SM_enabled;
+@synthesize maximumSpanCount = _SM_maximumSpanCount;
+@synthesize droppedSpanCount = _SM_droppedSpanCount;
+@synthesize finishedSpans = _SM_finishedSpans;
+@synthesize threadNames = _SM_threadNames;
+@synthesize lastSpanID = _SM_lastSpanID;
+
++ (SMTracer *)sharedTracer
+{
+    static SMTracer *sharedTracer = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedTracer = [[SMTracer alloc] init];
+    });
+    return sharedTracer;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.maximumSpanCount = DEFAULT_MAXIMUM_SPAN_COUNT;
+        self.finishedSpans = [NSMutableArray array];
+        self.threadNames = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (SMTraceSpan *)SM_spanWithName:(NSString *)name category:(NSString *)category parent:(SMTraceSpan *)parent
+{
+    SMTraceSpan *span = [[SMTraceSpan alloc] init];
+    span.name = name;
+    span.category = category;
+    span.parent = parent;
+    span.threadID = SMCurrentThreadID();
+    span.tracer = self;
+    
+    @synchronized(self) {
+        self.lastSpanID += 1;
+        span.spanID = self.lastSpanID;
+        NSNumber *thread = [NSNumber numberWithUnsignedInt:span.threadID];
+        if (![self.threadNames objectForKey:thread]) {
+            NSString *threadName = [[NSThread currentThread] name];
+            if ([NSThread isMainThread]) {
+                threadName = @"main";
+            } else if ([threadName length] == 0) {
+                threadName = [NSString stringWithFormat:@"thread %u", span.threadID];
+            }
+            [self.threadNames setObject:threadName forKey:thread];
+        }
+    }
+    
+    span.startTime = SMRequestMetricsTimestamp();
+    return span;
+}
+
+- (SMTraceSpan *)beginSpanWithName:(NSString *)name category:(NSString *)category
+{
+    if (!self.enabled) {
+        return nil;
+    }
+    return [self beginSpanWithName:name category:category parent:[self currentSpan]];
+}
+
+- (SMTraceSpan *)beginSpanWithName:(NSString *)name category:(NSString *)category parent:(SMTraceSpan *)parent
+{
+    if (!self.enabled) {
+        return nil;
+    }
+    
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSMutableArray *stack = [threadDictionary objectForKey:SPAN_STACK_KEY];
+    if (!stack) {
+        stack = [NSMutableArray array];
+        [threadDictionary setObject:stack forKey:SPAN_STACK_KEY];
+    }
+    
+    SMTraceSpan *span = [self SM_spanWithName:name category:category parent:parent];
+    [stack addObject:span];
+    return span;
+}
+
+- (SMTraceSpan *)beginDetachedSpanWithName:(NSString *)name category:(NSString *)category parent:(SMTraceSpan *)parent
+{
+    if (!self.enabled) {
+        return nil;
+    }
+    
+    SMTraceSpan *span = [self SM_spanWithName:name category:category parent:parent];
+    span.detached = YES;
+    return span;
+}
+
+- (SMTraceSpan *)currentSpan
+{
+    return [[[[NSThread currentThread] threadDictionary] objectForKey:SPAN_STACK_KEY] lastObject];
+}
+
+- (void)SM_finishSpan:(SMTraceSpan *)span
+{
+    @synchronized(self) {
+        if ([self.finishedSpans count] >= self.maximumSpanCount) {
+            self.droppedSpanCount += 1;
+        } else {
+            [self.finishedSpans addObject:span];
+        }
+    }
+}
+
+- (NSDictionary *)traceEventObject
+{
+    NSArray *spans = nil;
+    NSDictionary *threadNames = nil;
+    NSUInteger droppedSpanCount = 0;
+    @synchronized(self) {
+        spans = [self.finishedSpans copy];
+        threadNames = [self.threadNames copy];
+        droppedSpanCount = self.droppedSpanCount;
+    }
+    
+    NSNumber *processID = [NSNumber numberWithInt:getpid()];
+    NSMutableArray *events = [NSMutableArray arrayWithCapacity:[spans count] + [threadNames count]];
+    [threadNames enumerateKeysAndObjectsUsingBlock:^(id thread, id threadName, BOOL *stop) {
+        [events addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                           @"thread_name", @"name",
+                           @"M", @"ph",
+                           processID, @"pid",
+                           thread, @"tid",
+                           [NSDictionary dictionaryWithObject:threadName forKey:@"name"], @"args", nil]];
+    }];
+    for (SMTraceSpan *span in spans) {
+        [events addObjectsFromArray:[span SM_traceEventsWithProcessID:processID]];
+    }
+    
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            events, @"traceEvents",
+            @"ms", @"displayTimeUnit",
+            [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:droppedSpanCount] forKey:@"droppedSpanCount"], @"otherData", nil];
+}
+
+- (BOOL)writeTraceToPath:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    NSData *data = [NSJSONSerialization dataWithJSONObject:[self traceEventObject] options:0 error:error];
+    if (!data) {
+        return NO;
+    }
+    return [data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        [self.finishedSpans removeAllObjects];
+        self.droppedSpanCount = 0;
+    }
+}
+
+@end
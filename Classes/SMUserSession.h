@@ -17,9 +17,14 @@
 #import "SMResponseBlocks.h"
 #import "AFHTTPClient.h"
 
+@class SMCircuitBreaker;
+@class SMCompressionMetrics;
 @class SMNetworkReachability;
 @class SMOAuth2Client;
 @class SMRequestOptions;
+@class SMRequestMetrics;
+@class SMRequestScheduler;
+@class SMRetryBudget;
 
 /**
  An `SMUserSession` holds all the OAuth2 credentials and configurations for the current client.  It is responsible for:
@@ -36,7 +41,12 @@
 @property (nonatomic, readwrite, strong) SMOAuth2Client *regularOAuthClient;
 @property (nonatomic, readwrite, strong) SMOAuth2Client *secureOAuthClient;
 @property (nonatomic, readwrite, strong) AFHTTPClient *tokenClient;
+@property (nonatomic, readwrite, strong) SMRequestScheduler *requestScheduler;
+@property (nonatomic, readwrite, strong) SMRetryBudget *retryBudget;
+@property (nonatomic, readwrite, strong) SMCircuitBreaker *circuitBreaker;
 @property (nonatomic, readwrite, strong) SMNetworkReachability *networkMonitor;
+@property (nonatomic, readwrite, strong) SMRequestMetrics *requestMetrics;
+@property (nonatomic, readwrite, strong) SMCompressionMetrics *compressionMetrics;
 @property (nonatomic, strong) NSMutableDictionary *userIdentifierMap;
 @property (nonatomic, copy) NSString *userSchema;
 @property (nonatomic, copy) NSString *userPrimaryKeyField;
@@ -18,6 +18,7 @@
 #import "AFJSONRequestOperation.h"
 #import "SMVersion.h"
 #import "SystemInformation.h"
+#import "SMJSONBodyStream.h"
 
 #define ACCESS_TOKEN @"access_token"
 #define EXPIRES_IN @"expires_in"
@@ -40,6 +41,9 @@
 @synthesize regularOAuthClient = _SM_regularOAuthClient;
 @synthesize secureOAuthClient = _SM_secureOAuthClient;
 @synthesize tokenClient = _SM_tokenClient;
+@synthesize requestScheduler = _SM_requestScheduler;
+@synthesize retryBudget = _SM_retryBudget;
+@synthesize circuitBreaker = _SM_circuitBreaker;
 @synthesize userSchema = _SM_userSchema;
 @synthesize userPrimaryKeyField = _userPrimaryKeyField;
 @synthesize userPasswordField = _SM_userPasswordField;
@@ -48,6 +52,8 @@
 @synthesize refreshing = _SM_refreshing;
 @synthesize oauthStorageKey = _SM_oauthStorageKey;
 @synthesize networkMonitor = _SM_networkMonitor;
+@synthesize requestMetrics = _SM_requestMetrics;
+@synthesize compressionMetrics = _SM_compressionMetrics;
 @synthesize userIdentifierMap = _SM_userIdentifierMap;
 
 - (id)initWithAPIVersion:(NSString *)version
@@ -61,6 +67,12 @@
     if (self) {
         self.regularOAuthClient = [[SMOAuth2Client alloc] initWithAPIVersion:version scheme:@"http" apiHost:apiHost publicKey:publicKey];
         self.secureOAuthClient = [[SMOAuth2Client alloc] initWithAPIVersion:version scheme:@"https" apiHost:apiHost publicKey:publicKey];
+        // One schedule for both clients, so limits and priorities apply across http and https.  The token client is left unscheduled so a refresh never waits.
+        self.requestScheduler = [[SMRequestScheduler alloc] init];
+        self.regularOAuthClient.requestScheduler = self.requestScheduler;
+        self.secureOAuthClient.requestScheduler = self.requestScheduler;
+        self.retryBudget = [[SMRetryBudget alloc] init];
+        self.circuitBreaker = [[SMCircuitBreaker alloc] init];
         self.tokenClient = [[AFHTTPClient alloc] initWithBaseURL:[NSURL URLWithString:[NSString stringWithFormat:@"https://%@", apiHost]]];
         NSString *acceptHeader = [NSString stringWithFormat:@"application/vnd.stackmob+json; version=%@", version];
         [self.tokenClient setDefaultHeader:@"Accept" value:acceptHeader];
@@ -68,6 +80,10 @@
         [self.tokenClient setDefaultHeader:@"Content-Type" value:@"application/x-www-form-urlencoded"];
         [self.tokenClient setDefaultHeader:@"User-Agent" value:[NSString stringWithFormat:@"StackMob/%@ (%@/%@; %@;)", SDK_VERSION, smDeviceModel(), smSystemVersion(), [[NSLocale currentLocale] localeIdentifier]]];
         self.networkMonitor = [[SMNetworkReachability alloc] init];
+        self.requestMetrics = [[SMRequestMetrics alloc] init];
+        self.compressionMetrics = [[SMCompressionMetrics alloc] init];
+        self.regularOAuthClient.compressionMetrics = self.compressionMetrics;
+        self.secureOAuthClient.compressionMetrics = self.compressionMetrics;
         self.userSchema = userSchema;
         self.userPrimaryKeyField = userPrimaryKeyField;
         self.userPasswordField = userPasswordField;
@@ -142,12 +158,21 @@
     [options.headers enumerateKeysAndObjectsUsingBlock:^(id headerField, id headerValue, BOOL *stop) {
         [request setValue:headerValue forHTTPHeaderField:headerField];
     }];
+    SMTracer *tracer = [SMTracer sharedTracer];
+    SMTraceSpan *traceSpan = nil;
+    if (tracer.enabled) {
+        traceSpan = [tracer beginDetachedSpanWithName:endpoint category:@"auth" parent:options.parentTraceSpan ? options.parentTraceSpan : [tracer currentSpan]];
+    }
     SMFullResponseSuccessBlock successHandler = ^void(NSURLRequest *req, NSHTTPURLResponse *response, id JSON) {
+        [traceSpan end];
         if (successBlock) {
             successBlock([self parseTokenResults:JSON]);
         }
     };
     SMFullResponseFailureBlock failureHandler = ^void(NSURLRequest *req, NSHTTPURLResponse *response, NSError *error, id JSON) {
+        [traceSpan setArgument:[NSNumber numberWithInteger:response.statusCode] forKey:@"status_code"];
+        [traceSpan end];
+        SMLogWarning(SMLogSubsystemAuth, @"%@ request failed with status %d, error %@", endpoint, (int)response.statusCode, error);
         self.refreshing = NO;
         if (failureBlock) {
             if (response == nil) {
@@ -166,6 +191,9 @@
         }
     };
     AFJSONRequestOperation * op = [SMJSONRequestOperation JSONRequestOperationWithRequest:request success:successHandler failure:failureHandler];
+    if (traceSpan) {
+        [(SMJSONRequestOperation *)op traceWithParentSpan:traceSpan];
+    }
     if (successCallbackQueue) {
         [op setSuccessCallbackQueue:successCallbackQueue];
     }
@@ -204,6 +232,10 @@
 - (NSURLRequest *) signRequest:(NSURLRequest *)request
 {
     NSMutableURLRequest *newRequest = [request mutableCopy];
+    if ([[request HTTPBodyStream] isKindOfClass:[SMJSONBodyStream class]]) {
+        // The original body stream has been read, so a retry needs one which starts from the beginning
+        [newRequest setHTTPBodyStream:[[request HTTPBodyStream] copy]];
+    }
     // Both requests have the same credentials so it doesn't matter which we use here
     [self.regularOAuthClient signRequest:newRequest path:[[request URL] path]];
     return newRequest;
@@ -18,15 +18,25 @@
 
 #import "SMDataStore.h"
 #import "SMQuery.h"
+#import "SMQueryCursor.h"
 #import "SMCustomCodeRequest.h"
 #import "SMBinaryDataConversion.h"
+#import "SMStreamingBinaryData.h"
 
 #import "SMUserSession.h"
 #import "SMOAuth2Client.h"
 #import "SMJSONRequestOperation.h"
+#import "SMStreamingJSONRequestOperation.h"
 
 #import "SMError.h"
 #import "SMRequestOptions.h"
+#import "SMRequestScheduler.h"
+#import "SMRetryBudget.h"
+#import "SMCircuitBreaker.h"
+#import "SMCompressionMetrics.h"
+#import "SMRequestMetrics.h"
+#import "SMTracer.h"
+#import "SMLogger.h"
 #import "SMResponseBlocks.h"
 #import "SMNetworkReachability.h"
 #import "Synchronization.h"
@@ -37,6 +47,10 @@
 #import "SMUserManagedObject.h"
 #import "NSManagedObject+StackMobSerialization.h"
 #import "NSEntityDescription+StackMobSerialization.h"
+#import "SMEntityMetadata.h"
+#import "SMCacheStatistics.h"
+#import "SMAutosaveCoordinator.h"
+#import "SMContextObserver.h"
 #import "NSManagedObjectContext+Concurrency.h"
 #import "AFHTTPClient+StackMob.h"
 #import "SMIncrementalStore+Query.h"
\ No newline at end of file
@@ -17,16 +17,26 @@
 #import "NSEntityDescription+StackMobSerialization.h"
 #import "SMUserManagedObject.h"
 #import "SMError.h"
+#import "SMEntityMetadata.h"
 
 @implementation NSEntityDescription (StackMobSerialization)
 
 - (NSString *)SMSchema
 {
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:self];
+    if (metadata) {
+        return metadata.schema;
+    }
     return [[self name] lowercaseString];
 }
 
 - (NSString *)primaryKeyField
 {
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:self];
+    if (metadata.declaredPrimaryKeyField) {
+        return metadata.declaredPrimaryKeyField;
+    }
+    
     NSString *objectIdField = nil;
      
     // Search for schemanameId
@@ -48,11 +58,21 @@
 
 - (NSString *)SMPrimaryKeyField
 {
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:self];
+    if (metadata.declaredPrimaryKeyField) {
+        return [metadata fieldNameForPropertyName:metadata.declaredPrimaryKeyField];
+    }
     return [self SMFieldNameForProperty:[[self propertiesByName] objectForKey:[self primaryKeyField]]];
 }
 
 - (NSString *)SMFieldNameForProperty:(NSPropertyDescription *)property 
 {
+    // The field name only depends on the property's name, so the compiled one can be used whichever entity the property came from
+    NSString *fieldName = [[SMEntityMetadata metadataForEntity:self] fieldNameForPropertyName:[property name]];
+    if (fieldName) {
+        return fieldName;
+    }
+    
     NSCharacterSet *uppercaseSet = [NSCharacterSet uppercaseLetterCharacterSet];
     NSMutableString *stringToReturn = [[property name] mutableCopy];
     
@@ -72,6 +92,11 @@
 
 - (NSPropertyDescription *)propertyForSMFieldName:(NSString *)fieldName
 {
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:self];
+    if (metadata) {
+        return [metadata propertyForFieldName:fieldName];
+    }
+    
     // Look for matching names with all lowercase or underscores first
     NSPropertyDescription *propertyToReturn = [[self propertiesByName] objectForKey:fieldName];
     if (propertyToReturn) {
@@ -19,6 +19,7 @@
 #import "SMUserManagedObject.h"
 #import "SMError.h"
 #import "NSEntityDescription+StackMobSerialization.h"
+#import "SMEntityMetadata.h"
 
 @implementation NSManagedObject (StackMobSerialization)
 
@@ -48,6 +49,11 @@
 
 - (NSString *)primaryKeyField
 {
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:[self entity]];
+    if (metadata.declaredPrimaryKeyField) {
+        return metadata.declaredPrimaryKeyField;
+    }
+    
     NSString *objectIdField = nil;
     
     // Search for schemanameId
@@ -69,145 +75,145 @@
 
 - (NSString *)SMPrimaryKeyField
 {
-    return [[self entity] SMFieldNameForProperty:[[[self entity] propertiesByName] objectForKey:[self primaryKeyField]]];
+    // primaryKeyField is overridden for user objects, so the compiled field name is only used when it names the same attribute
+    NSString *primaryKeyField = [self primaryKeyField];
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:[self entity]];
+    if (metadata.primaryKeyField && [primaryKeyField isEqualToString:metadata.primaryKeyField]) {
+        return metadata.SMPrimaryKeyField;
+    }
+    return [[self entity] SMFieldNameForProperty:[[[self entity] propertiesByName] objectForKey:primaryKeyField]];
 }
 
 - (NSDictionary *)SMDictionarySerialization
 {
-    NSMutableArray *arrayOfRelationshipHeaders = [NSMutableArray array];
-    NSMutableDictionary *contentsOfSerializedObject = [NSMutableDictionary dictionaryWithObject:[self SMDictionarySerializationByTraversingRelationshipsExcludingObjects:nil entities:nil relationshipHeaderValues:&arrayOfRelationshipHeaders relationshipKeyPath:nil] forKey:@"SerializedDict"];
+    // Every relationship in the graph appends key path=schema to one header, rather than formatting a string each and joining them at the end
+    NSMutableString *relationshipHeader = [NSMutableString string];
+    NSDictionary *serializedObject = [self SMDictionarySerializationByTraversingRelationshipsExcludingObjects:[NSMutableSet set] relationshipHeader:relationshipHeader relationshipKeyPath:nil];
     
-    if ([arrayOfRelationshipHeaders count] > 0) {
-        
-        // add array joined by & to contentsDict
-        [contentsOfSerializedObject setObject:[arrayOfRelationshipHeaders componentsJoinedByString:@"&"] forKey:@"X-StackMob-Relations"];
+    if ([relationshipHeader length] > 0) {
+        return [NSDictionary dictionaryWithObjectsAndKeys:serializedObject, @"SerializedDict", relationshipHeader, @"X-StackMob-Relations", nil];
     }
-    
-    return contentsOfSerializedObject;
-    
+    return [NSDictionary dictionaryWithObject:serializedObject forKey:@"SerializedDict"];
 }
 
-- (NSDictionary *)SMDictionarySerializationByTraversingRelationshipsExcludingObjects:(NSMutableSet *)processedObjects entities:(NSMutableSet *)processedEntities relationshipHeaderValues:(NSMutableArray *__autoreleasing *)values relationshipKeyPath:(NSString *)keyPath
+static NSString * SMSerializedFieldName(NSEntityDescription *entity, SMEntityMetadata *metadata, NSPropertyDescription *property)
 {
-    if (processedObjects == nil) {
-        processedObjects = [NSMutableSet set];
+    NSString *fieldName = [metadata fieldNameForPropertyName:[property name]];
+    if (fieldName) {
+        return fieldName;
     }
-    if (processedEntities == nil) {
-        processedEntities = [NSMutableSet set];
+    return [entity SMFieldNameForProperty:property];
+}
+
+static void SMAppendRelationshipHeader(NSMutableString *header, NSString *relationshipKeyPath, NSRelationshipDescription *relationship)
+{
+    if ([header length] > 0) {
+        [header appendString:@"&"];
     }
-    
+    [header appendString:relationshipKeyPath];
+    [header appendString:@"="];
+    [header appendString:[[relationship destinationEntity] SMSchema]];
+}
+
+- (NSString *)SM_objectIdForPrimaryKeyField:(NSString *)primaryKeyField
+{
+    if ([[[self entity] attributesByName] objectForKey:primaryKeyField] == nil) {
+        [NSException raise:SMExceptionIncompatibleObject format:@"Unable to locate a primary key field for %@, expected %@.  If this is an Entity which describes user objects, and your managed object subclass inherits from SMUserManagedObject, make sure to include an attribute that matches the value returned by your SMClient's userPrimaryKeyField property.", [self description], primaryKeyField];
+    }
+    return [self valueForKey:primaryKeyField];
+}
+
+- (NSDictionary *)SMDictionarySerializationByTraversingRelationshipsExcludingObjects:(NSMutableSet *)processedObjects relationshipHeader:(NSMutableString *)relationshipHeader relationshipKeyPath:(NSString *)keyPath
+{
     [processedObjects addObject:self];
     
     NSEntityDescription *selfEntity = [self entity];
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:selfEntity];
+    NSDictionary *propertiesByName = [selfEntity propertiesByName];
+    NSDictionary *changedValues = [self changedValues];
+    
+    // The primary key is looked up once per object, instead of once for each related object and again when attaching it
+    NSString *primaryKeyField = [self primaryKeyField];
+    NSString *SMPrimaryKeyField = nil;
+    if (metadata.primaryKeyField && [primaryKeyField isEqualToString:metadata.primaryKeyField]) {
+        SMPrimaryKeyField = metadata.SMPrimaryKeyField;
+    } else {
+        SMPrimaryKeyField = [selfEntity SMFieldNameForProperty:[propertiesByName objectForKey:primaryKeyField]];
+    }
     
-    NSMutableDictionary *objectDictionary = [NSMutableDictionary dictionary];
-    [self.changedValues enumerateKeysAndObjectsUsingBlock:^(id propertyKey, id propertyValue, BOOL *stop) {
-        NSPropertyDescription *property = [[selfEntity propertiesByName] objectForKey:propertyKey];
+    NSMutableDictionary *objectDictionary = [NSMutableDictionary dictionaryWithCapacity:[changedValues count] + 1];
+    [changedValues enumerateKeysAndObjectsUsingBlock:^(id propertyKey, id propertyValue, BOOL *stop) {
+        NSPropertyDescription *property = [propertiesByName objectForKey:propertyKey];
         if ([property isKindOfClass:[NSAttributeDescription class]]) {
-            NSAttributeDescription *attributeDescription = (NSAttributeDescription *)property;
-            if (attributeDescription.attributeType != NSUndefinedAttributeType) {
-                if (attributeDescription.attributeType == NSDateAttributeType) {
-                    NSDate *dateValue = propertyValue;
-                    if (dateValue != nil) {
-                        unsigned long long convertedDate = (unsigned long long)[dateValue timeIntervalSince1970] * 1000;
-                        NSNumber *numberToSet = [NSNumber numberWithUnsignedLongLong:convertedDate];
-                        [objectDictionary setObject:numberToSet forKey:[selfEntity SMFieldNameForProperty:property]];
-                    }
-                } else if (attributeDescription.attributeType == NSBooleanAttributeType) {
+            NSAttributeType attributeType = [(NSAttributeDescription *)property attributeType];
+            if (attributeType != NSUndefinedAttributeType && propertyValue != nil) {
+                NSString *fieldName = SMSerializedFieldName(selfEntity, metadata, property);
+                if (attributeType == NSDateAttributeType) {
+                    unsigned long long convertedDate = (unsigned long long)[propertyValue timeIntervalSince1970] * 1000;
+                    [objectDictionary setObject:[NSNumber numberWithUnsignedLongLong:convertedDate] forKey:fieldName];
+                } else if (attributeType == NSBooleanAttributeType) {
                     // make sure that boolean values are serialized as true or false
-                    id value = propertyValue;
-                    if (value != nil) {
-                        if ([value boolValue]) {
-                            [objectDictionary setObject:[NSNumber numberWithBool:YES] forKey:[selfEntity SMFieldNameForProperty:property]];
-                        }
-                        else {
-                            [objectDictionary setObject:[NSNumber numberWithBool:NO] forKey:[selfEntity SMFieldNameForProperty:property]];
-                        }
-                    }
+                    [objectDictionary setObject:[NSNumber numberWithBool:[propertyValue boolValue]] forKey:fieldName];
                 } else {
-                    id value = propertyValue;
-                    if (value != nil) {
-                        [objectDictionary setObject:value forKey:[selfEntity SMFieldNameForProperty:property]];
-                    }
+                    [objectDictionary setObject:propertyValue forKey:fieldName];
                 }
             }
         }
         else if ([property isKindOfClass:[NSRelationshipDescription class]]) {
             NSRelationshipDescription *relationship = (NSRelationshipDescription *)property;
+            NSString *fieldName = SMSerializedFieldName(selfEntity, metadata, property);
+            NSString *relationshipKeyPath = [keyPath length] > 0 ? [NSString stringWithFormat:@"%@.%@", keyPath, fieldName] : fieldName;
             if ([relationship isToMany]) {
-                NSMutableArray *relatedObjectDictionaries = [NSMutableArray array];
-                [(NSSet *)propertyValue enumerateObjectsUsingBlock:^(id child, BOOL *stopRelEnum) {
-                    NSString *childObjectId = [child SMObjectId];
+                NSMutableArray *relatedObjectIds = [NSMutableArray arrayWithCapacity:[(NSSet *)propertyValue count]];
+                NSEntityDescription *childEntity = nil;
+                NSString *childPrimaryKeyField = nil;
+                for (NSManagedObject *child in (NSSet *)propertyValue) {
+                    // Related objects almost always share an entity, so the primary key field is only looked up again when it changes
+                    if ([child entity] != childEntity) {
+                        childEntity = [child entity];
+                        childPrimaryKeyField = [child primaryKeyField];
+                    }
+                    NSString *childObjectId = [child SM_objectIdForPrimaryKeyField:childPrimaryKeyField];
                     if (childObjectId == nil) {
-                        *stopRelEnum = YES;
                         [NSException raise:SMExceptionIncompatibleObject format:@"Trying to serialize an object with a to-many relationship whose value references an object with a nil value for it's primary key field.  Please make sure you assign object ids with assignObjectId before attaching to relationships.  The object in question is %@", [child description]];
                     }
-                    [relatedObjectDictionaries addObject:[child SMObjectId]];
-                }];
+                    [relatedObjectIds addObject:childObjectId];
+                }
                 
                 // add relationship header only if there are actual keys
-                if ([relatedObjectDictionaries count] > 0) {
-                    NSMutableString *relationshipKeyPath = [NSMutableString string];
-                    if (keyPath && [keyPath length] > 0) {
-                        [relationshipKeyPath appendFormat:@"%@.", keyPath];
-                    }
-                    [relationshipKeyPath appendString:[selfEntity SMFieldNameForProperty:relationship]];
-                    
-                    [*values addObject:[NSString stringWithFormat:@"%@=%@", relationshipKeyPath, [[relationship destinationEntity] SMSchema]]];
+                if ([relatedObjectIds count] > 0) {
+                    SMAppendRelationshipHeader(relationshipHeader, relationshipKeyPath, relationship);
                 }
-                [objectDictionary setObject:relatedObjectDictionaries forKey:[selfEntity SMFieldNameForProperty:property]];
+                [objectDictionary setObject:relatedObjectIds forKey:fieldName];
             } else {
                 if (propertyValue == [NSNull null]) {
-                    [objectDictionary setObject:propertyValue forKey:[selfEntity SMFieldNameForProperty:property]];
+                    [objectDictionary setObject:propertyValue forKey:fieldName];
                 }
                 else if ([processedObjects containsObject:propertyValue]) {
-                    // add relationship header
-                    NSMutableString *relationshipKeyPath = [NSMutableString string];
-                    if (keyPath && [keyPath length] > 0) {
-                        [relationshipKeyPath appendFormat:@"%@.", keyPath];
-                    }
-                    [relationshipKeyPath appendString:[selfEntity SMFieldNameForProperty:relationship]];
-                    
-                    [*values addObject:[NSString stringWithFormat:@"%@=%@", relationshipKeyPath, [[relationship destinationEntity] SMSchema]]];
-                    
+                    SMAppendRelationshipHeader(relationshipHeader, relationshipKeyPath, relationship);
                     
-                    NSPropertyDescription *primaryKeyProperty = [[[relationship destinationEntity] propertiesByName] objectForKey:[propertyValue primaryKeyField]];
-                    [objectDictionary setObject:[NSDictionary dictionaryWithObject:[propertyValue SMObjectId] forKey:[[relationship destinationEntity] SMFieldNameForProperty:primaryKeyProperty]] forKey:[selfEntity SMFieldNameForProperty:property]];
+                    NSString *relatedPrimaryKeyField = [propertyValue primaryKeyField];
+                    NSEntityDescription *destinationEntity = [relationship destinationEntity];
+                    NSString *relatedSMPrimaryKeyField = [destinationEntity SMFieldNameForProperty:[[destinationEntity propertiesByName] objectForKey:relatedPrimaryKeyField]];
+                    [objectDictionary setObject:[NSDictionary dictionaryWithObject:[propertyValue SM_objectIdForPrimaryKeyField:relatedPrimaryKeyField] forKey:relatedSMPrimaryKeyField] forKey:fieldName];
                 }
                 else {
-                    NSMutableString *relationshipKeyPath = [NSMutableString string];
-                    if (keyPath && [keyPath length] > 0) {
-                        [relationshipKeyPath appendFormat:@"%@.", keyPath];
-                    }
-                    [relationshipKeyPath appendString:[selfEntity SMFieldNameForProperty:relationship]];
-                    
-                    [*values addObject:[NSString stringWithFormat:@"%@=%@", relationshipKeyPath, [[relationship destinationEntity] SMSchema]]];
+                    SMAppendRelationshipHeader(relationshipHeader, relationshipKeyPath, relationship);
                     
-                    [objectDictionary setObject:[propertyValue SMDictionarySerializationByTraversingRelationshipsExcludingObjects:processedObjects entities:processedEntities relationshipHeaderValues:values relationshipKeyPath:relationshipKeyPath] forKey:[selfEntity SMFieldNameForProperty:property]];
+                    [objectDictionary setObject:[propertyValue SMDictionarySerializationByTraversingRelationshipsExcludingObjects:processedObjects relationshipHeader:relationshipHeader relationshipKeyPath:relationshipKeyPath] forKey:fieldName];
                 }
             }
         }
     }];
     
     // Add value for primary key field if needed
-    NSString *primaryKeyField = [self SMPrimaryKeyField];
-    if (![objectDictionary valueForKey:primaryKeyField]) {
-        [self attachObjectIdToDictionary:&objectDictionary];
+    if (![objectDictionary objectForKey:SMPrimaryKeyField]) {
+        [objectDictionary setObject:[self SM_objectIdForPrimaryKeyField:primaryKeyField] forKey:SMPrimaryKeyField];
     }
     
-    
     return objectDictionary;
 }
 
-- (void)attachObjectIdToDictionary:(NSDictionary **)objectDictionary
-{
-    NSMutableDictionary *dictionaryToReturn = [*objectDictionary mutableCopy];
-    
-    [dictionaryToReturn setObject:[self SMObjectId] forKey:[self SMPrimaryKeyField]];
-    
-    *objectDictionary = dictionaryToReturn;
-}
-
 - (id)valueForRelationshipKey:(NSString *)key error:(NSError *__autoreleasing*)error
 {
     id result = nil;
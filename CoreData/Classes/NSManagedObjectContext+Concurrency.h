@@ -41,11 +41,17 @@
  
  To specify queues to callbacks, use <executeFetchRequest:returnManagedObjectIDs:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:>.
  
+ IDs are turned into objects on the calling context's own queue, so the asynchronous methods only call back once that queue is free: don't block it, or for the main queue context the main thread, waiting for them.  Objects the context already has in memory are refreshed, everything else is returned as a fault.  If the request's `returnsObjectsAsFaults` is `NO`, the faults are fired before the objects are returned; with caching on, the store fills them from the cache the fetch has just written.
+ 
+ For large result sets, set the request's `fetchBatchSize` and use <executeFetchRequest:successCallbackQueue:failureCallbackQueue:onBatch:onSuccess:onFailure:>.  Objects are then materialized and handed back `fetchBatchSize` at a time, and the calling context's queue is free between batches.  The store itself always returns every matching ID at once.
+ 
  The <executeFetchRequestAndWait:error:> and <executeFetchRequestAndWait:returnManagedObjectIDs:error:> methods work similarly to the Core Data executeFetchRequest:error: method.
  
  ## Observing Contexts ##
  
  <observeContext:> and <stopObservingContext:> are helper methods which simply add / remove observers for `NSManagedObjectContextDidSaveNotification`, if you need to implement manual merging.
+
+ <observeContext:> merges every object in every save.  When a context only shows some of the data, use <observeContext:entityNames:predicate:mergeInterval:> instead.  Only changes to the given entities which match the predicate are merged.  Saves close together are merged as one, on the context's own queue.  Updates and deletions only touch objects the context already has registered, so a large import elsewhere does not refault everything it holds.
  
  ## Hooking Up to the Chain Of Contexts ##
  
@@ -131,6 +137,21 @@
  */
 - (void)executeFetchRequest:(NSFetchRequest *)request returnManagedObjectIDs:(BOOL)returnIDs successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
 
+/**
+ Asynchronous fetch method which hands back results in batches.
+ 
+ Works like <executeFetchRequest:returnManagedObjectIDs:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:>, but turns managed object IDs into objects `fetchBatchSize` at a time, in separate blocks on the calling context's queue.  Each batch is passed to batchBlock as soon as it is ready.  If the request's `fetchBatchSize` is 0, every result is materialized in one batch.
+ 
+ Blocks are dispatched to successCallbackQueue in order, so on a serial queue every batch block runs before the success block.
+ 
+ @param request The fetch request to perform against the database.
+ @param successCallbackQueue The queue to perform the batch and success blocks on.
+ @param failureCallbackQueue Upon unsuccessful fetch, the queue to perform the failure block on.
+ @param batchBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i> A block object to call with each batch of instances of NSManagedObject.
+ @param successBlock <i>typedef void (^SMResultsSuccessBlock)(NSArray *results)</i> A block object to call once every batch has been materialized, containing all of the results.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i> A block object to call upon unsuccessful fetch.
+ */
+- (void)executeFetchRequest:(NSFetchRequest *)request successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
 /**
  Synchronous fetch method.
  
@@ -165,9 +186,26 @@
  */
 - (void)observeContext:(NSManagedObjectContext *)contextToObserve;
 
+/**
+ Merges selected changes from contextToObserve's saves into the receiver.
+ 
+ Saved objects are filtered on the saving context's queue, as the save happens.  An object is kept only if its entity, or one of its superentities, is named in entityNames.  Inserted and updated objects must also match predicate, evaluated against their saved values.
+ 
+ Kept changes are gathered for mergeInterval seconds and merged in one block on the receiver's queue.  When an object is both inserted and deleted within the window, it is never merged.  Updated objects are refreshed, and deleted objects are merged, only if the receiver has them registered.  The merge goes through mergeChangesFromContextDidSaveNotification:, so the receiver's change notifications are posted as usual.
+ 
+ Call <stopObservingContext:> to stop.  Changes which have not been merged yet are dropped.
+ 
+ @param contextToObserve The context whose saves to merge.
+ @param entityNames The names of the entities whose changes to merge, or nil for every entity.
+ @param predicate The predicate inserted and updated objects must match, or nil.
+ @param mergeInterval How long, in seconds, to gather changes before merging them.  Pass 0 to merge each save as soon as the receiver's queue is free.
+ */
+- (void)observeContext:(NSManagedObjectContext *)contextToObserve entityNames:(NSArray *)entityNames predicate:(NSPredicate *)predicate mergeInterval:(NSTimeInterval)mergeInterval;
 /**
  Removes context from observing NSManagedObjectContextDidSaveNotification notifications from contextToStopObserving.
  
+ Also stops any observation started with <observeContext:entityNames:predicate:mergeInterval:>.
+ 
  @param contextToStopObserving The object to stop observing for notification posts.
  */
 - (void)stopObservingContext:(NSManagedObjectContext *)contextToStopObserving;
@@ -16,12 +16,20 @@
 
 #import "NSManagedObjectContext+Concurrency.h"
 #import "SMClient.h"
+#import "SMTracer.h"
+#import "SMContextObserver.h"
+#import <objc/runtime.h>
+
+static char SMContextObserversKey;
 
 @implementation NSManagedObjectContext (Concurrency)
 
 - (void)dealloc
 {
     [self setContextShouldObtainPermanentIDsBeforeSaving:NO];
+    for (SMContextObserver *observer in objc_getAssociatedObject(self, &SMContextObserversKey)) {
+        [observer invalidate];
+    }
 }
 
 - (void)observeContext:(NSManagedObjectContext *)contextToObserve
@@ -29,9 +37,36 @@
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(SM_mergeChangesFromNotification:) name:NSManagedObjectContextDidSaveNotification object:contextToObserve];
 }
 
+- (void)observeContext:(NSManagedObjectContext *)contextToObserve entityNames:(NSArray *)entityNames predicate:(NSPredicate *)predicate mergeInterval:(NSTimeInterval)mergeInterval
+{
+    if ([self concurrencyType] == NSConfinementConcurrencyType) {
+        [NSException raise:SMExceptionIncompatibleObject format:@"Method observeContext:entityNames:predicate:mergeInterval: observing context should be of type NSMainQueueConcurrencyType or NSPrivateQueueConcurrencyType"];
+    }
+    
+    SMContextObserver *observer = [[SMContextObserver alloc] initWithObservingContext:self observedContext:contextToObserve entityNames:entityNames predicate:predicate mergeInterval:mergeInterval];
+    @synchronized(self) {
+        NSMutableArray *observers = objc_getAssociatedObject(self, &SMContextObserversKey);
+        if (!observers) {
+            observers = [NSMutableArray array];
+            objc_setAssociatedObject(self, &SMContextObserversKey, observers, OBJC_ASSOCIATION_RETAIN);
+        }
+        [observers addObject:observer];
+    }
+}
+
 - (void)stopObservingContext:(NSManagedObjectContext *)contextToStopObserving
 {
     [[NSNotificationCenter defaultCenter] removeObserver:self name:NSManagedObjectContextDidSaveNotification object:contextToStopObserving];
+    
+    @synchronized(self) {
+        NSMutableArray *observers = objc_getAssociatedObject(self, &SMContextObserversKey);
+        for (SMContextObserver *observer in [observers copy]) {
+            if (observer.observedContext == contextToStopObserving) {
+                [observer invalidate];
+                [observers removeObject:observer];
+            }
+        }
+    }
 }
 
 - (void)SM_mergeChangesFromNotification:(NSNotification *)notification
@@ -227,7 +262,16 @@
 
 - (void)executeFetchRequest:(NSFetchRequest *)request returnManagedObjectIDs:(BOOL)returnIDs successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
 {
-    dispatch_queue_t aQueue = dispatch_queue_create("Fetch Queue", NULL);
+    [self SM_executeFetchRequest:request returnManagedObjectIDs:returnIDs successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onBatch:nil onSuccess:successBlock onFailure:failureBlock];
+}
+
+- (void)executeFetchRequest:(NSFetchRequest *)request successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    [self SM_executeFetchRequest:request returnManagedObjectIDs:NO successCallbackQueue:successCallbackQueue failureCallbackQueue:failureCallbackQueue onBatch:batchBlock onSuccess:successBlock onFailure:failureBlock];
+}
+
+- (void)SM_executeFetchRequest:(NSFetchRequest *)request returnManagedObjectIDs:(BOOL)returnIDs successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMResultsSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
     __block NSManagedObjectContext *mainContext = [self concurrencyType] == NSMainQueueConcurrencyType ? self : self.parentContext;
     
     // Error checks
@@ -235,12 +279,11 @@
         [NSException raise:SMExceptionIncompatibleObject format:@"Method saveAndWait: main context should be of type NSMainQueueConcurrencyType"];
     }
     
-    dispatch_async(aQueue, ^{
+    NSManagedObjectContext *backgroundContext = mainContext.parentContext;
+    NSFetchRequest *fetchCopy = [self SM_objectIDFetchRequestForRequest:request];
+    
+    [backgroundContext performBlock:^{
         NSError *fetchError = nil;
-        NSManagedObjectContext *backgroundContext = mainContext.parentContext;
-        NSFetchRequest *fetchCopy = [request copy];
-        [fetchCopy setResultType:NSManagedObjectIDResultType];
-        
         NSArray *resultsOfFetch = [backgroundContext executeFetchRequest:fetchCopy error:&fetchError];
         if (fetchError) {
             if (failureBlock) {
@@ -248,26 +291,77 @@
                     failureBlock(fetchError);
                 });
             }
-        } else {
+        } else if (returnIDs) {
             if (successBlock) {
-                if (returnIDs) {
-                    dispatch_async(successCallbackQueue, ^{
-                        successBlock(resultsOfFetch);
-                    });
-                } else {
-                    __block NSArray *managedObjectsToReturn = [resultsOfFetch map:^id(id item) {
-                        NSManagedObject *objectFromCurrentContext = [self objectWithID:item];
-                        [self refreshObject:objectFromCurrentContext mergeChanges:YES];
-                        return objectFromCurrentContext;
-                    }];
-                    dispatch_async(successCallbackQueue, ^{
-                        successBlock(managedObjectsToReturn);
-                    });
-                }
+                dispatch_async(successCallbackQueue, ^{
+                    successBlock(resultsOfFetch);
+                });
             }
+        } else if (successBlock || batchBlock) {
+            // Objects belong to the receiving context, so they are materialized on its queue
+            [self SM_materializeObjectsWithIDs:resultsOfFetch fromIndex:0 fetchRequest:request materializedObjects:[NSMutableArray arrayWithCapacity:[resultsOfFetch count]] successCallbackQueue:successCallbackQueue onBatch:batchBlock onSuccess:successBlock];
+        }
+    }];
+    
+}
+
+- (void)SM_materializeObjectsWithIDs:(NSArray *)objectIDs fromIndex:(NSUInteger)index fetchRequest:(NSFetchRequest *)request materializedObjects:(NSMutableArray *)materializedObjects successCallbackQueue:(dispatch_queue_t)successCallbackQueue onBatch:(SMResultsSuccessBlock)batchBlock onSuccess:(SMResultsSuccessBlock)successBlock
+{
+    [self performBlock:^{
+        NSUInteger batchSize = [request fetchBatchSize] > 0 ? [request fetchBatchSize] : [objectIDs count];
+        NSUInteger length = MIN(batchSize, [objectIDs count] - index);
+        NSArray *batch = [self SM_objectsWithIDs:[objectIDs subarrayWithRange:NSMakeRange(index, length)] returnsObjectsAsFaults:[request returnsObjectsAsFaults]];
+        [materializedObjects addObjectsFromArray:batch];
+        
+        if (batchBlock && [batch count] > 0) {
+            dispatch_async(successCallbackQueue, ^{
+                batchBlock(batch);
+            });
+        }
+        
+        if (index + length < [objectIDs count]) {
+            // Each batch is a separate block, so other work on the context's queue can run in between
+            [self SM_materializeObjectsWithIDs:objectIDs fromIndex:index + length fetchRequest:request materializedObjects:materializedObjects successCallbackQueue:successCallbackQueue onBatch:batchBlock onSuccess:successBlock];
+        } else if (successBlock) {
+            dispatch_async(successCallbackQueue, ^{
+                successBlock(materializedObjects);
+            });
+        }
+    }];
+}
+
+- (NSFetchRequest *)SM_objectIDFetchRequestForRequest:(NSFetchRequest *)request
+{
+    NSFetchRequest *fetchCopy = [request copy];
+    [fetchCopy setResultType:NSManagedObjectIDResultType];
+    // The batch size only controls how results are materialized in the receiving context, the store always returns every ID
+    [fetchCopy setFetchBatchSize:0];
+    return fetchCopy;
+}
+
+- (NSArray *)SM_objectsWithIDs:(NSArray *)objectIDs returnsObjectsAsFaults:(BOOL)returnsObjectsAsFaults
+{
+    SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"materialize" category:@"coredata"];
+    [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[objectIDs count]] forKey:@"count"];
+    
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[objectIDs count]];
+    for (NSManagedObjectID *objectID in objectIDs) {
+        NSManagedObject *registeredObject = [self objectRegisteredForID:objectID];
+        NSManagedObject *object = registeredObject ? registeredObject : [self objectWithID:objectID];
+        
+        // Only objects already in memory can be stale, a new fault reads the latest values when it fires
+        if (registeredObject && ![registeredObject isFault]) {
+            [self refreshObject:registeredObject mergeChanges:YES];
+        }
+        // With caching on, the store fills these from the cache the fetch has just written rather than asking the server again
+        if (!returnsObjectsAsFaults && [object isFault]) {
+            [object willAccessValueForKey:nil];
         }
-    });
+        [objects addObject:object];
+    }
     
+    [traceSpan end];
+    return objects;
 }
 
 - (NSArray *)executeFetchRequestAndWait:(NSFetchRequest *)request error:(NSError *__autoreleasing *)error
@@ -277,8 +371,6 @@
 
 - (NSArray *)executeFetchRequestAndWait:(NSFetchRequest *)request returnManagedObjectIDs:(BOOL)returnIDs error:(NSError *__autoreleasing *)error
 {
-    dispatch_queue_t queue = dispatch_queue_create("Fetch And Wait Queue", NULL);
-    dispatch_group_t group = dispatch_group_create();
     __block NSManagedObjectContext *mainContext = [self concurrencyType] == NSMainQueueConcurrencyType ? self : self.parentContext;
     
     // Error checks
@@ -290,33 +382,23 @@
     __block NSError *fetchError = nil;
     
     NSManagedObjectContext *backgroundContext = mainContext.parentContext;
-    NSFetchRequest *fetchCopy = [request copy];
-    [fetchCopy setResultType:NSManagedObjectIDResultType];
-    
-    if ([request fetchBatchSize] > 0) {
-        [fetchCopy setFetchBatchSize:[request fetchBatchSize]];
-    }
+    NSFetchRequest *fetchCopy = [self SM_objectIDFetchRequestForRequest:request];
     
     [backgroundContext performBlockAndWait:^{
         resultsOfFetch = [backgroundContext executeFetchRequest:fetchCopy error:&fetchError];
     }];
     
-    if (fetchError && error != NULL) {
-        *error = fetchError;
+    if (fetchError) {
+        if (error != NULL) {
+            *error = fetchError;
+        }
         return nil;
     }
     
-    dispatch_release(queue);
-    dispatch_release(group);
-    
     if (returnIDs) {
         return resultsOfFetch;
     } else {
-        return [resultsOfFetch map:^id(id item) {
-            NSManagedObject *objectFromCurrentContext = [self objectWithID:item];
-            [self refreshObject:objectFromCurrentContext mergeChanges:YES];
-            return objectFromCurrentContext;
-        }];
+        return [self SM_objectsWithIDs:resultsOfFetch returnsObjectsAsFaults:[request returnsObjectsAsFaults]];
     }
 }
 
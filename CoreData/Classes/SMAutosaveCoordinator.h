@@ -0,0 +1,96 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <CoreData/CoreData.h>
+#import "SMResponseBlocks.h"
+
+/**
+ `SMAutosaveCoordinator` coalesces many small saves into one save to the persistent store.
+ 
+ A save with <saveContext:onSuccess:onFailure:> pushes a context's changes into the main context straight away, which costs no more than a save in memory.  Pushing the main context's changes to the persistent store, which for StackMob means network requests, waits until no save has come in for <debounceInterval> seconds, but never more than <maximumLatency> seconds after the first save still waiting.  Every save which came in before then shares that one store save, and its callbacks run once it finishes.
+ 
+ This suits interfaces which save after nearly every edit: an editing session turns into a handful of batched requests instead of one for every change.
+ 
+ Use <flush> to start the store save immediately, for example when the application enters the background.
+ 
+ Changes which fail to save stay in the main context's parent, and go out with the next store save.
+ 
+ @note You should not need to create your own `SMAutosaveCoordinator`.  Use <[SMCoreDataStore autosaveCoordinator]>.
+ */
+@interface SMAutosaveCoordinator : NSObject
+
+/**
+ How long, in seconds, to wait after the latest save before saving to the persistent store.  Default is 1.
+ */
+@property (atomic) NSTimeInterval debounceInterval;
+
+/**
+ The longest, in seconds, a save may wait for the persistent store to be saved, however often saves keep coming in.  Default is 10.
+ */
+@property (atomic) NSTimeInterval maximumLatency;
+
+/**
+ The context whose parent is saved to the persistent store.
+ */
+@property (nonatomic, readonly, strong) NSManagedObjectContext *mainContext;
+
+/**
+ The number of saves waiting for the next store save.
+ */
+@property (atomic, readonly) NSUInteger pendingSaveCount;
+
+/**
+ The number of saves sent to the persistent store, whether or not they succeeded.  Store saves with no changes to send are not counted.
+ */
+@property (atomic, readonly) NSUInteger persistentStoreSaveCount;
+
+/**
+ Initializes a coordinator.
+ 
+ @param mainContext A context initialized with a NSMainQueueConcurrencyType, whose parent has the persistent store coordinator set.
+ 
+ @return An initialized coordinator.
+ */
+- (id)initWithMainContext:(NSManagedObjectContext *)mainContext;
+
+/**
+ Saves a context, batching the persistent store save with others which come in around the same time.
+ 
+ Callbacks are performed on the main thread.
+ 
+ @param context The main context, or a context whose parent is the main context.
+ @param successBlock <i>typedef void (^SMSuccessBlock)())</i> A block object to call once the changes have been saved to the persistent store.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i> A block object to call if the changes could not be saved.
+ */
+- (void)saveContext:(NSManagedObjectContext *)context onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Saves a context, batching the persistent store save with others which come in around the same time.
+ 
+ @param context The main context, or a context whose parent is the main context.
+ @param successCallbackQueue The queue to perform the success block on.
+ @param failureCallbackQueue The queue to perform the failure block on.
+ @param successBlock <i>typedef void (^SMSuccessBlock)())</i> A block object to call once the changes have been saved to the persistent store.
+ @param failureBlock <i>typedef void (^SMFailureBlock)(NSError *error)</i> A block object to call if the changes could not be saved.
+ */
+- (void)saveContext:(NSManagedObjectContext *)context successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
+
+/**
+ Starts saving to the persistent store now, without waiting for the debounce window.  Does nothing if no saves are waiting.
+ */
+- (void)flush;
+
+@end
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMAutosaveCoordinator.h"
+#import "SMError.h"
+#import "SMTracer.h"
+#import "SMLogger.h"
+
+#define DEFAULT_DEBOUNCE_INTERVAL 1.0
+#define DEFAULT_MAXIMUM_LATENCY 10.0
+
+@interface SMAutosaveCoordinator ()
+
+@property (nonatomic, readwrite, strong) NSManagedObjectContext *mainContext;
+@property (atomic, readwrite) NSUInteger pendingSaveCount;
+@property (atomic, readwrite) NSUInteger persistentStoreSaveCount;
+// Everything below is only touched on autosaveQueue
+@property (nonatomic) dispatch_queue_t autosaveQueue;
+@property (nonatomic, strong) NSMutableArray *pendingCompletions;
+@property (nonatomic) dispatch_time_t firstPendingSaveTime;
+@property (nonatomic) dispatch_time_t latestSaveTime;
+@property (nonatomic) BOOL flushScheduled;
+@property (nonatomic) BOOL flushing;
+
+- (void)SM_addPendingSaveWithCompletion:(void (^)(NSError *error))completion;
+- (dispatch_time_t)SM_flushDeadline;
+- (void)SM_scheduleFlush;
+- (void)SM_startFlush;
+- (void)SM_finishFlushWithCompletions:(NSArray *)completions error:(NSError *)error;
+
+@end
+
+@implementation SMAutosaveCoordinator
+
+@synthesize debounceInterval = _SM_debounceInterval;
+@synthesize maximumLatency = _SM_maximumLatency;
+@synthesize mainContext = _SM_mainContext;
+@synthesize pendingSaveCount = _SM_pendingSaveCount;
+@synthesize persistentStoreSaveCount = _SM_persistentStoreSaveCount;
+@synthesize autosaveQueue = _SM_autosaveQueue;
+@synthesize pendingCompletions = _SM_pendingCompletions;
+@synthesize firstPendingSaveTime = _SM_firstPendingSaveTime;
+@synthesize latestSaveTime = _SM_latestSaveTime;
+@synthesize flushScheduled = _SM_flushScheduled;
+@synthesize flushing = _SM_flushing;
+
+- (id)initWithMainContext:(NSManagedObjectContext *)mainContext
+{
+    self = [super init];
+    if (self) {
+        if ([mainContext concurrencyType] != NSMainQueueConcurrencyType || ![mainContext parentContext]) {
+            [NSException raise:SMExceptionIncompatibleObject format:@"Autosave main context should be of type NSMainQueueConcurrencyType, with a parent with set persistent store coordinator"];
+        }
+        self.mainContext = mainContext;
+        self.debounceInterval = DEFAULT_DEBOUNCE_INTERVAL;
+        self.maximumLatency = DEFAULT_MAXIMUM_LATENCY;
+        self.autosaveQueue = dispatch_queue_create("com.stackmob.autosaveQueue", NULL);
+        self.pendingCompletions = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_autosaveQueue);
+}
+
+- (void)saveContext:(NSManagedObjectContext *)context onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    [self saveContext:context successCallbackQueue:dispatch_get_main_queue() failureCallbackQueue:dispatch_get_main_queue() onSuccess:successBlock onFailure:failureBlock];
+}
+
+- (void)saveContext:(NSManagedObjectContext *)context successCallbackQueue:(dispatch_queue_t)successCallbackQueue failureCallbackQueue:(dispatch_queue_t)failureCallbackQueue onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    if (context != self.mainContext && [context parentContext] != self.mainContext) {
+        [NSException raise:SMExceptionIncompatibleObject format:@"Autosaved contexts should be the main context or one of its children"];
+    }
+    
+    void (^completion)(NSError *) = ^(NSError *error) {
+        if (error) {
+            if (failureBlock) {
+                dispatch_async(failureCallbackQueue, ^{
+                    failureBlock(error);
+                });
+            }
+        } else if (successBlock) {
+            dispatch_async(successCallbackQueue, ^{
+                successBlock();
+            });
+        }
+    };
+    
+    if (context == self.mainContext) {
+        [self SM_addPendingSaveWithCompletion:completion];
+    } else {
+        // Saving a child only pushes its changes into the main context, so it happens right away
+        [context performBlock:^{
+            NSError *saveError = nil;
+            if ([context save:&saveError]) {
+                [self SM_addPendingSaveWithCompletion:completion];
+            } else {
+                completion(saveError);
+            }
+        }];
+    }
+}
+
+- (void)flush
+{
+    dispatch_async(self.autosaveQueue, ^{
+        if (!self.flushing && [self.pendingCompletions count] > 0) {
+            [self SM_startFlush];
+        }
+    });
+}
+
+- (void)SM_addPendingSaveWithCompletion:(void (^)(NSError *error))completion
+{
+    dispatch_async(self.autosaveQueue, ^{
+        dispatch_time_t now = dispatch_time(DISPATCH_TIME_NOW, 0);
+        if ([self.pendingCompletions count] == 0) {
+            self.firstPendingSaveTime = now;
+        }
+        self.latestSaveTime = now;
+        [self.pendingCompletions addObject:[completion copy]];
+        self.pendingSaveCount = [self.pendingCompletions count];
+        [self SM_scheduleFlush];
+    });
+}
+
+- (dispatch_time_t)SM_flushDeadline
+{
+    dispatch_time_t debounceDeadline = dispatch_time(self.latestSaveTime, (int64_t)(self.debounceInterval * NSEC_PER_SEC));
+    dispatch_time_t latencyDeadline = dispatch_time(self.firstPendingSaveTime, (int64_t)(self.maximumLatency * NSEC_PER_SEC));
+    return MIN(debounceDeadline, latencyDeadline);
+}
+
+- (void)SM_scheduleFlush
+{
+    if (self.flushScheduled || self.flushing || [self.pendingCompletions count] == 0) {
+        return;
+    }
+    
+    // Only one timer is ever outstanding.  Saves which come in while it waits move the deadline back, so it may fire early and set itself again.
+    self.flushScheduled = YES;
+    dispatch_after([self SM_flushDeadline], self.autosaveQueue, ^{
+        self.flushScheduled = NO;
+        if (self.flushing || [self.pendingCompletions count] == 0) {
+            return;
+        }
+        if (dispatch_time(DISPATCH_TIME_NOW, 0) < [self SM_flushDeadline]) {
+            [self SM_scheduleFlush];
+        } else {
+            [self SM_startFlush];
+        }
+    });
+}
+
+- (void)SM_startFlush
+{
+    NSArray *completions = [self.pendingCompletions copy];
+    [self.pendingCompletions removeAllObjects];
+    self.pendingSaveCount = 0;
+    self.flushing = YES;
+    
+    SMLogDebug(SMLogSubsystemCoreData, @"Autosaving %d saves to the persistent store", [completions count]);
+    
+    NSManagedObjectContext *mainContext = self.mainContext;
+    NSManagedObjectContext *privateContext = [mainContext parentContext];
+    SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginDetachedSpanWithName:@"autosave" category:@"coredata" parent:nil];
+    [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[completions count]] forKey:@"saves"];
+    
+    [mainContext performBlock:^{
+        NSError *saveError = nil;
+        if ([mainContext hasChanges] && ![mainContext save:&saveError]) {
+            [traceSpan end];
+            [self SM_finishFlushWithCompletions:completions error:saveError];
+            return;
+        }
+        
+        [privateContext performBlock:^{
+            NSError *storeSaveError = nil;
+            BOOL saved = YES;
+            if ([privateContext hasChanges]) {
+                self.persistentStoreSaveCount = self.persistentStoreSaveCount + 1;
+                saved = [privateContext save:&storeSaveError];
+                if (!saved) {
+                    SMLogWarning(SMLogSubsystemCoreData, @"Autosave to the persistent store failed: %@", storeSaveError);
+                }
+            }
+            [traceSpan end];
+            [self SM_finishFlushWithCompletions:completions error:saved ? nil : storeSaveError];
+        }];
+    }];
+}
+
+- (void)SM_finishFlushWithCompletions:(NSArray *)completions error:(NSError *)error
+{
+    dispatch_async(self.autosaveQueue, ^{
+        self.flushing = NO;
+        for (void (^completion)(NSError *) in completions) {
+            completion(error);
+        }
+        // Saves which came in during the flush go out with the next one
+        [self SM_scheduleFlush];
+    });
+}
+
+@end
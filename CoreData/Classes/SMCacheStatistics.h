@@ -0,0 +1,133 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef enum {
+    // Values served from the cache
+    SMCacheEventHit = 0,
+    // Values which were not in the cache, and so came from the network or not at all
+    SMCacheEventMiss = 1,
+    // Cached rows which only held a reference, with no primary key, so the values were fetched from the network
+    SMCacheEventReferenceOnlyFetch = 2,
+    // Relationship faults filled from the cache
+    SMCacheEventRelationshipFaultFromCache = 3,
+    // Relationship faults filled from the network
+    SMCacheEventRelationshipFaultFromNetwork = 4,
+    // Objects removed from the cache
+    SMCacheEventPurge = 5,
+    // Saves of the cache, counted once for each entity the save wrote changes to
+    SMCacheEventSave = 6,
+} SMCacheEvent;
+
+#define SMCacheEventCount 7
+
+/**
+ Fulfilling a fault through `newValuesForObjectWithID:withContext:error:`.
+ */
+extern NSString *const SMCacheCodePathObjectValues;
+
+/**
+ Fulfilling a relationship fault through `newValueForRelationship:forObjectWithID:withContext:error:`.
+ */
+extern NSString *const SMCacheCodePathRelationship;
+
+/**
+ Executing a fetch request.
+ */
+extern NSString *const SMCacheCodePathFetch;
+
+/**
+ Saving a managed object context.
+ */
+extern NSString *const SMCacheCodePathSave;
+
+/**
+ Purging the cache through the methods on <SMCoreDataStore>.
+ */
+extern NSString *const SMCacheCodePathPurgeRequest;
+
+/**
+ `SMCacheStatistics` counts how well the <SMIncrementalStore> cache is doing: how often values are served from it rather than the network, how often a cached row turns out to be a bare reference, where relationship faults are filled from, and how often the cache is purged and saved.
+ 
+ Every event is counted three ways: in a total, per entity and per code path, so that cache policies and prefetching can be tuned for the entities and paths which miss most.  Events without an entity or code path are only counted in the totals and whichever breakdown applies.
+ 
+ Nothing is counted unless the cache is enabled.  All methods may be called from any thread.
+ 
+ @note You should not need to create your own `SMCacheStatistics`.  Read them from <[SMCoreDataStore cacheStatistics]>.
+ */
+@interface SMCacheStatistics : NSObject
+
+/**
+ Count an event.
+ 
+ @param event The event.
+ @param entityName The entity the event concerns, or nil.
+ @param codePath One of the `SMCacheCodePath` constants, or nil.
+ */
+- (void)recordEvent:(SMCacheEvent)event entityName:(NSString *)entityName codePath:(NSString *)codePath;
+
+/**
+ The number of times an event has happened.
+ 
+ @param event The event.
+ 
+ @return The count across every entity and code path.
+ */
+- (unsigned long long)countForEvent:(SMCacheEvent)event;
+
+/**
+ The number of times an event has happened to one entity.
+ 
+ @param event The event.
+ @param entityName The name of the entity.
+ 
+ @return The count.
+ */
+- (unsigned long long)countForEvent:(SMCacheEvent)event entityName:(NSString *)entityName;
+
+/**
+ The number of times an event has happened on one code path.
+ 
+ @param event The event.
+ @param codePath One of the `SMCacheCodePath` constants.
+ 
+ @return The count.
+ */
+- (unsigned long long)countForEvent:(SMCacheEvent)event codePath:(NSString *)codePath;
+
+/**
+ The share of lookups for an entity which were served from the cache: hits divided by hits, misses and reference-only fetches.
+ 
+ @param entityName The name of the entity, or nil for every entity.
+ 
+ @return Between 0 and 1, or 0 if there have been no lookups.
+ */
+- (double)hitRateForEntityName:(NSString *)entityName;
+
+/**
+ Every count, for logging or reporting.
+ 
+ @return A dictionary with `total`, `entities` and `codePaths` keys.  `total` maps event names such as `hits` to counts; the others map entity names and code paths to dictionaries of the same form.
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+/**
+ Set every count back to zero.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMCacheStatistics.h"
+
+NSString *const SMCacheCodePathObjectValues = @"newValuesForObjectWithID";
+NSString *const SMCacheCodePathRelationship = @"newValueForRelationship";
+NSString *const SMCacheCodePathFetch = @"fetch";
+NSString *const SMCacheCodePathSave = @"save";
+NSString *const SMCacheCodePathPurgeRequest = @"purgeRequest";
+
+static NSString *SMCacheEventName(SMCacheEvent event)
+{
+    switch (event) {
+        case SMCacheEventHit:
+            return @"hits";
+        case SMCacheEventMiss:
+            return @"misses";
+        case SMCacheEventReferenceOnlyFetch:
+            return @"referenceOnlyFetches";
+        case SMCacheEventRelationshipFaultFromCache:
+            return @"relationshipFaultsFromCache";
+        case SMCacheEventRelationshipFaultFromNetwork:
+            return @"relationshipFaultsFromNetwork";
+        case SMCacheEventPurge:
+            return @"purges";
+        case SMCacheEventSave:
+            return @"saves";
+    }
+    return nil;
+}
+
+@interface SMCacheStatistics ()
+
+// Each NSMutableData holds SMCacheEventCount counters
+@property (nonatomic, strong) NSMutableData *totalCounts;
+@property (nonatomic, strong) NSMutableDictionary *countsByEntityName;
+@property (nonatomic, strong) NSMutableDictionary *countsByCodePath;
+
+- (unsigned long long *)SM_countsForKey:(NSString *)key inDictionary:(NSMutableDictionary *)dictionary;
+- (NSDictionary *)SM_dictionaryForCounts:(NSData *)counts;
+
+@end
+
+@implementation SMCacheStatistics
+
+@synthesize totalCounts = _SM_totalCounts;
+@synthesize countsByEntityName = _SM_countsByEntityName;
+@synthesize countsByCodePath = _SM_countsByCodePath;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.totalCounts = [NSMutableData dataWithLength:SMCacheEventCount * sizeof(unsigned long long)];
+        self.countsByEntityName = [NSMutableDictionary dictionary];
+        self.countsByCodePath = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (unsigned long long *)SM_countsForKey:(NSString *)key inDictionary:(NSMutableDictionary *)dictionary
+{
+    NSMutableData *counts = [dictionary objectForKey:key];
+    if (counts == nil) {
+        counts = [NSMutableData dataWithLength:SMCacheEventCount * sizeof(unsigned long long)];
+        [dictionary setObject:counts forKey:key];
+    }
+    return (unsigned long long *)[counts mutableBytes];
+}
+
+- (void)recordEvent:(SMCacheEvent)event entityName:(NSString *)entityName codePath:(NSString *)codePath
+{
+    if (event < 0 || event >= SMCacheEventCount) {
+        [NSException raise:NSInvalidArgumentException format:@"Unknown cache event %d", event];
+    }
+    @synchronized(self) {
+        ((unsigned long long *)[self.totalCounts mutableBytes])[event]++;
+        if (entityName) {
+            [self SM_countsForKey:entityName inDictionary:self.countsByEntityName][event]++;
+        }
+        if (codePath) {
+            [self SM_countsForKey:codePath inDictionary:self.countsByCodePath][event]++;
+        }
+    }
+}
+
+- (unsigned long long)countForEvent:(SMCacheEvent)event
+{
+    @synchronized(self) {
+        return ((const unsigned long long *)[self.totalCounts bytes])[event];
+    }
+}
+
+- (unsigned long long)countForEvent:(SMCacheEvent)event entityName:(NSString *)entityName
+{
+    @synchronized(self) {
+        NSData *counts = [self.countsByEntityName objectForKey:entityName];
+        return counts ? ((const unsigned long long *)[counts bytes])[event] : 0;
+    }
+}
+
+- (unsigned long long)countForEvent:(SMCacheEvent)event codePath:(NSString *)codePath
+{
+    @synchronized(self) {
+        NSData *counts = [self.countsByCodePath objectForKey:codePath];
+        return counts ? ((const unsigned long long *)[counts bytes])[event] : 0;
+    }
+}
+
+- (double)hitRateForEntityName:(NSString *)entityName
+{
+    @synchronized(self) {
+        NSData *countsData = entityName ? [self.countsByEntityName objectForKey:entityName] : self.totalCounts;
+        if (countsData == nil) {
+            return 0;
+        }
+        const unsigned long long *counts = [countsData bytes];
+        unsigned long long lookups = counts[SMCacheEventHit] + counts[SMCacheEventMiss] + counts[SMCacheEventReferenceOnlyFetch];
+        return lookups == 0 ? 0 : (double)counts[SMCacheEventHit] / lookups;
+    }
+}
+
+- (NSDictionary *)SM_dictionaryForCounts:(NSData *)counts
+{
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:SMCacheEventCount];
+    for (int event = 0; event < SMCacheEventCount; event++) {
+        [dictionary setObject:[NSNumber numberWithUnsignedLongLong:((const unsigned long long *)[counts bytes])[event]] forKey:SMCacheEventName(event)];
+    }
+    return dictionary;
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    @synchronized(self) {
+        NSMutableDictionary *entities = [NSMutableDictionary dictionaryWithCapacity:[self.countsByEntityName count]];
+        [self.countsByEntityName enumerateKeysAndObjectsUsingBlock:^(id entityName, id counts, BOOL *stop) {
+            [entities setObject:[self SM_dictionaryForCounts:counts] forKey:entityName];
+        }];
+        NSMutableDictionary *codePaths = [NSMutableDictionary dictionaryWithCapacity:[self.countsByCodePath count]];
+        [self.countsByCodePath enumerateKeysAndObjectsUsingBlock:^(id codePath, id counts, BOOL *stop) {
+            [codePaths setObject:[self SM_dictionaryForCounts:counts] forKey:codePath];
+        }];
+        return [NSDictionary dictionaryWithObjectsAndKeys:[self SM_dictionaryForCounts:self.totalCounts], @"total", entities, @"entities", codePaths, @"codePaths", nil];
+    }
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        [self.totalCounts resetBytesInRange:NSMakeRange(0, [self.totalCounts length])];
+        [self.countsByEntityName removeAllObjects];
+        [self.countsByCodePath removeAllObjects];
+    }
+}
+
+@end
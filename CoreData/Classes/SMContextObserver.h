@@ -0,0 +1,71 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <CoreData/CoreData.h>
+
+/**
+ `SMContextObserver` merges the saves of one context into another, passing on only the changes the observing context cares about.
+ 
+ Saved objects are filtered as the save happens, on the saving context's queue: only objects whose entity, or one of its superentities, is in <entityNames> are passed on, and <predicate> is evaluated against the saved values.  Changes to objects are gathered for <mergeInterval> seconds and merged in one block on the observing context's queue.  There, every updated or deleted object the observing context has registered is refreshed, whether or not it still matches <predicate>.  Inserted objects, and updated objects the context has not registered, are merged only if they match <predicate>; with no predicate, unregistered updates are skipped without being faulted in.
+ 
+ @note You should not need to create your own `SMContextObserver`.  Use <[NSManagedObjectContext(Concurrency) observeContext:entityNames:predicate:mergeInterval:]>.
+ */
+@interface SMContextObserver : NSObject
+
+/**
+ The context changes are merged into.  Not retained, and nil once the observer has been invalidated, which the context does when it is deallocated.
+ */
+@property (nonatomic, readonly, assign) NSManagedObjectContext *observingContext;
+
+/**
+ The context whose saves are observed.  Not retained.
+ */
+@property (nonatomic, readonly, assign) NSManagedObjectContext *observedContext;
+
+/**
+ The names of the entities whose changes are merged, or nil for every entity.
+ */
+@property (nonatomic, readonly, copy) NSSet *entityNames;
+
+/**
+ Inserted objects, and updated objects the observing context has not registered, are merged only if they match this predicate, evaluated against their saved values.  Updated objects the context has registered are always refreshed, so an object edited so it no longer matches is not left stale.  Deleted objects are not checked.  nil matches every inserted object.
+ */
+@property (nonatomic, readonly, strong) NSPredicate *predicate;
+
+/**
+ How long, in seconds, changes are gathered before they are merged.  0 merges each save as soon as the observing context's queue is free.
+ */
+@property (nonatomic, readonly) NSTimeInterval mergeInterval;
+
+/**
+ Initializes an observer and starts observing.
+ 
+ @param observingContext The context to merge changes into.  It must be initialized with a NSMainQueueConcurrencyType or NSPrivateQueueConcurrencyType.
+ @param observedContext The context whose saves to observe.
+ @param entityNames The names of the entities whose changes to merge, or nil for every entity.
+ @param predicate The predicate inserted and updated objects must match, or nil.
+ @param mergeInterval How long, in seconds, to gather changes before merging them.
+ 
+ @return An initialized observer.
+ */
+- (id)initWithObservingContext:(NSManagedObjectContext *)observingContext observedContext:(NSManagedObjectContext *)observedContext entityNames:(NSArray *)entityNames predicate:(NSPredicate *)predicate mergeInterval:(NSTimeInterval)mergeInterval;
+
+/**
+ Stops observing.  Changes gathered but not yet merged are dropped.
+ */
+- (void)invalidate;
+
+@end
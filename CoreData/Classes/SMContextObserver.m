@@ -0,0 +1,251 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "SMContextObserver.h"
+#import "SMTracer.h"
+
+@interface SMContextObserver ()
+
+@property (nonatomic, readwrite, assign) NSManagedObjectContext *observingContext;
+@property (nonatomic, readwrite, assign) NSManagedObjectContext *observedContext;
+@property (nonatomic, readwrite, copy) NSSet *entityNames;
+@property (nonatomic, readwrite, strong) NSPredicate *predicate;
+@property (nonatomic, readwrite) NSTimeInterval mergeInterval;
+// Everything below is only touched on observerQueue
+@property (nonatomic) dispatch_queue_t observerQueue;
+@property (nonatomic, strong) NSMutableSet *pendingInsertedObjectIDs;
+@property (nonatomic, strong) NSMutableSet *pendingUpdatedObjectIDs;
+@property (nonatomic, strong) NSMutableSet *pendingUnmatchedUpdatedObjectIDs;
+@property (nonatomic, strong) NSMutableSet *pendingDeletedObjectIDs;
+@property (nonatomic) BOOL mergeScheduled;
+@property (nonatomic) BOOL invalidated;
+
+- (void)SM_contextDidSave:(NSNotification *)notification;
+- (NSSet *)SM_objectIDsOfObjects:(NSSet *)objects evaluatingPredicate:(BOOL)evaluatePredicate unmatchedObjectIDs:(NSMutableSet *)unmatchedObjectIDs;
+- (BOOL)SM_observesEntity:(NSEntityDescription *)entity;
+- (void)SM_addPendingInsertedObjectIDs:(NSSet *)insertedObjectIDs updatedObjectIDs:(NSSet *)updatedObjectIDs unmatchedUpdatedObjectIDs:(NSSet *)unmatchedUpdatedObjectIDs deletedObjectIDs:(NSSet *)deletedObjectIDs;
+- (void)SM_mergePendingChanges;
+
+@end
+
+@implementation SMContextObserver
+
+@synthesize observingContext = _SM_observingContext;
+@synthesize observedContext = _SM_observedContext;
+@synthesize entityNames = _SM_entityNames;
+@synthesize predicate = _SM_predicate;
+@synthesize mergeInterval = _SM_mergeInterval;
+@synthesize observerQueue = _SM_observerQueue;
+@synthesize pendingInsertedObjectIDs = _SM_pendingInsertedObjectIDs;
+@synthesize pendingUpdatedObjectIDs = _SM_pendingUpdatedObjectIDs;
+@synthesize pendingUnmatchedUpdatedObjectIDs = _SM_pendingUnmatchedUpdatedObjectIDs;
+@synthesize pendingDeletedObjectIDs = _SM_pendingDeletedObjectIDs;
+@synthesize mergeScheduled = _SM_mergeScheduled;
+@synthesize invalidated = _SM_invalidated;
+
+- (id)initWithObservingContext:(NSManagedObjectContext *)observingContext observedContext:(NSManagedObjectContext *)observedContext entityNames:(NSArray *)entityNames predicate:(NSPredicate *)predicate mergeInterval:(NSTimeInterval)mergeInterval
+{
+    self = [super init];
+    if (self) {
+        self.observingContext = observingContext;
+        self.observedContext = observedContext;
+        self.entityNames = entityNames ? [NSSet setWithArray:entityNames] : nil;
+        self.predicate = predicate;
+        self.mergeInterval = mergeInterval;
+        self.observerQueue = dispatch_queue_create("com.stackmob.contextObserverQueue", NULL);
+        self.pendingInsertedObjectIDs = [NSMutableSet set];
+        self.pendingUpdatedObjectIDs = [NSMutableSet set];
+        self.pendingUnmatchedUpdatedObjectIDs = [NSMutableSet set];
+        self.pendingDeletedObjectIDs = [NSMutableSet set];
+        
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(SM_contextDidSave:) name:NSManagedObjectContextDidSaveNotification object:observedContext];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    dispatch_release(_SM_observerQueue);
+}
+
+- (void)invalidate
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSManagedObjectContextDidSaveNotification object:self.observedContext];
+    // Waits out a merge being handed to the observing context, so none starts after this returns and the context can safely go away
+    dispatch_sync(self.observerQueue, ^{
+        self.invalidated = YES;
+        self.observingContext = nil;
+        [self.pendingInsertedObjectIDs removeAllObjects];
+        [self.pendingUpdatedObjectIDs removeAllObjects];
+        [self.pendingUnmatchedUpdatedObjectIDs removeAllObjects];
+        [self.pendingDeletedObjectIDs removeAllObjects];
+    });
+}
+
+- (void)SM_contextDidSave:(NSNotification *)notification
+{
+    // Posted on the saving context's queue, so its objects can be read here but nowhere else
+    NSDictionary *userInfo = [notification userInfo];
+    NSSet *insertedObjectIDs = [self SM_objectIDsOfObjects:[userInfo objectForKey:NSInsertedObjectsKey] evaluatingPredicate:YES unmatchedObjectIDs:nil];
+    // Whether the observing context has an updated object registered is only known on its queue, so updates which no longer match are kept aside rather than dropped
+    NSMutableSet *unmatchedUpdatedObjectIDs = [NSMutableSet set];
+    NSSet *updatedObjectIDs = [self SM_objectIDsOfObjects:[userInfo objectForKey:NSUpdatedObjectsKey] evaluatingPredicate:YES unmatchedObjectIDs:unmatchedUpdatedObjectIDs];
+    NSSet *deletedObjectIDs = [self SM_objectIDsOfObjects:[userInfo objectForKey:NSDeletedObjectsKey] evaluatingPredicate:NO unmatchedObjectIDs:nil];
+    
+    if ([insertedObjectIDs count] > 0 || [updatedObjectIDs count] > 0 || [unmatchedUpdatedObjectIDs count] > 0 || [deletedObjectIDs count] > 0) {
+        [self SM_addPendingInsertedObjectIDs:insertedObjectIDs updatedObjectIDs:updatedObjectIDs unmatchedUpdatedObjectIDs:unmatchedUpdatedObjectIDs deletedObjectIDs:deletedObjectIDs];
+    }
+}
+
+- (NSSet *)SM_objectIDsOfObjects:(NSSet *)objects evaluatingPredicate:(BOOL)evaluatePredicate unmatchedObjectIDs:(NSMutableSet *)unmatchedObjectIDs
+{
+    NSMutableSet *objectIDs = [NSMutableSet setWithCapacity:[objects count]];
+    for (NSManagedObject *object in objects) {
+        if (![self SM_observesEntity:[object entity]]) {
+            continue;
+        }
+        if (evaluatePredicate && self.predicate && ![self.predicate evaluateWithObject:object]) {
+            [unmatchedObjectIDs addObject:[object objectID]];
+            continue;
+        }
+        [objectIDs addObject:[object objectID]];
+    }
+    return objectIDs;
+}
+
+- (BOOL)SM_observesEntity:(NSEntityDescription *)entity
+{
+    if (!self.entityNames) {
+        return YES;
+    }
+    for (NSEntityDescription *candidate = entity; candidate != nil; candidate = [candidate superentity]) {
+        if ([self.entityNames containsObject:[candidate name]]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (void)SM_addPendingInsertedObjectIDs:(NSSet *)insertedObjectIDs updatedObjectIDs:(NSSet *)updatedObjectIDs unmatchedUpdatedObjectIDs:(NSSet *)unmatchedUpdatedObjectIDs deletedObjectIDs:(NSSet *)deletedObjectIDs
+{
+    dispatch_async(self.observerQueue, ^{
+        if (self.invalidated) {
+            return;
+        }
+        
+        // Later saves in the window supersede earlier ones: an update to an object inserted in the window is part of its insert, and an object inserted and deleted in the window is never seen
+        [self.pendingInsertedObjectIDs unionSet:insertedObjectIDs];
+        for (NSManagedObjectID *objectID in updatedObjectIDs) {
+            if (![self.pendingInsertedObjectIDs containsObject:objectID]) {
+                [self.pendingUnmatchedUpdatedObjectIDs removeObject:objectID];
+                [self.pendingUpdatedObjectIDs addObject:objectID];
+            }
+        }
+        for (NSManagedObjectID *objectID in unmatchedUpdatedObjectIDs) {
+            if (![self.pendingInsertedObjectIDs containsObject:objectID]) {
+                [self.pendingUpdatedObjectIDs removeObject:objectID];
+                [self.pendingUnmatchedUpdatedObjectIDs addObject:objectID];
+            }
+        }
+        for (NSManagedObjectID *objectID in deletedObjectIDs) {
+            if ([self.pendingInsertedObjectIDs containsObject:objectID]) {
+                [self.pendingInsertedObjectIDs removeObject:objectID];
+            } else {
+                [self.pendingUpdatedObjectIDs removeObject:objectID];
+                [self.pendingUnmatchedUpdatedObjectIDs removeObject:objectID];
+                [self.pendingDeletedObjectIDs addObject:objectID];
+            }
+        }
+        
+        if (!self.mergeScheduled) {
+            self.mergeScheduled = YES;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.mergeInterval * NSEC_PER_SEC)), self.observerQueue, ^{
+                self.mergeScheduled = NO;
+                [self SM_mergePendingChanges];
+            });
+        }
+    });
+}
+
+- (void)SM_mergePendingChanges
+{
+    if (self.invalidated) {
+        return;
+    }
+    
+    NSSet *insertedObjectIDs = [self.pendingInsertedObjectIDs copy];
+    NSSet *updatedObjectIDs = [self.pendingUpdatedObjectIDs copy];
+    NSSet *unmatchedUpdatedObjectIDs = [self.pendingUnmatchedUpdatedObjectIDs copy];
+    NSSet *deletedObjectIDs = [self.pendingDeletedObjectIDs copy];
+    [self.pendingInsertedObjectIDs removeAllObjects];
+    [self.pendingUpdatedObjectIDs removeAllObjects];
+    [self.pendingUnmatchedUpdatedObjectIDs removeAllObjects];
+    [self.pendingDeletedObjectIDs removeAllObjects];
+    
+    // Held until the merge has run.  The context invalidates its observers when it is deallocated, so while this is not invalidated the context is still alive.
+    NSManagedObjectContext *observingContext = self.observingContext;
+    
+    NSPredicate *predicate = self.predicate;
+    [observingContext performBlock:^{
+        SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"mergeChanges" category:@"coredata"];
+        
+        NSMutableSet *insertedObjects = [NSMutableSet setWithCapacity:[insertedObjectIDs count]];
+        for (NSManagedObjectID *objectID in insertedObjectIDs) {
+            [insertedObjects addObject:[observingContext objectWithID:objectID]];
+        }
+        
+        // Registered objects are refreshed whether or not they still match.  Without a predicate, objects the context has never seen have nothing to refresh; with one, an object edited so it now matches is brought in.
+        NSMutableSet *updatedObjects = [NSMutableSet setWithCapacity:[updatedObjectIDs count] + [unmatchedUpdatedObjectIDs count]];
+        for (NSManagedObjectID *objectID in updatedObjectIDs) {
+            NSManagedObject *object = [observingContext objectRegisteredForID:objectID];
+            if (object) {
+                [observingContext refreshObject:object mergeChanges:YES];
+                [updatedObjects addObject:object];
+            } else if (predicate) {
+                [updatedObjects addObject:[observingContext objectWithID:objectID]];
+            }
+        }
+        for (NSManagedObjectID *objectID in unmatchedUpdatedObjectIDs) {
+            NSManagedObject *object = [observingContext objectRegisteredForID:objectID];
+            if (object) {
+                [observingContext refreshObject:object mergeChanges:YES];
+                [updatedObjects addObject:object];
+            }
+        }
+        
+        NSMutableSet *deletedObjects = [NSMutableSet setWithCapacity:[deletedObjectIDs count]];
+        for (NSManagedObjectID *objectID in deletedObjectIDs) {
+            NSManagedObject *object = [observingContext objectRegisteredForID:objectID];
+            if (object) {
+                [deletedObjects addObject:object];
+            }
+        }
+        
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[insertedObjects count] + [updatedObjects count] + [deletedObjects count]] forKey:@"objects"];
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[insertedObjectIDs count] + [updatedObjectIDs count] + [unmatchedUpdatedObjectIDs count] + [deletedObjectIDs count]] forKey:@"saved_objects"];
+        
+        if ([insertedObjects count] > 0 || [updatedObjects count] > 0 || [deletedObjects count] > 0) {
+            // The context's own objects go through the regular merge, so observers of its changes hear about them as usual
+            NSDictionary *userInfo = [NSDictionary dictionaryWithObjectsAndKeys:insertedObjects, NSInsertedObjectsKey, updatedObjects, NSUpdatedObjectsKey, deletedObjects, NSDeletedObjectsKey, nil];
+            [observingContext mergeChangesFromContextDidSaveNotification:[NSNotification notificationWithName:NSManagedObjectContextDidSaveNotification object:nil userInfo:userInfo]];
+        }
+        
+        [traceSpan end];
+    }];
+}
+
+@end
@@ -27,6 +27,8 @@ typedef enum {
 } SMCachePolicy;
 
 @class SMIncrementalStore;
+@class SMCacheStatistics;
+@class SMAutosaveCoordinator;
 
 /**
  The `SMCoreDataStore` class provides all the necessary properties and methods to interact with StackMob's Core Data integration.
@@ -35,7 +37,11 @@ typedef enum {
  
  With your `SMCoreDataStore` object you can retrieve a managed object context configured with a `SMIncrementalStore` as it's persistent store to allow communication to StackMob from Core Data.  Obtain a managed object context for your thread using <contextForCurrentThread>.  You can obtain the managed object context for the main thread at any time with <mainThreadContext>.
  
+ For work on GCD queues, prefer <contextForQueue:>, which ties a context to a queue rather than to whichever pool thread the queue happens to run on, or <performBlockWithPooledContext:> for one-off background work, which borrows one of a few reusable contexts.
+ 
  When saving or fetching from the context, use methods from the <NSManagedObjectContext+Concurrency> category to ensure proper asynchronous saving and fetching off of the main thread.
+
+ If your interface saves after nearly every edit, save through <autosaveCoordinator> instead, so that many saves close together share one round trip to StackMob.
  
  If you want to do your own context creation, use the <persistentStoreCoordinator> property to ensure your objects are being saved to the StackMob server.
  
@@ -133,6 +139,21 @@ typedef enum {
  */
 @property (nonatomic) SMCachePolicy cachePolicy;
 
+/**
+ Counts of cache hits, misses, purges and saves, per entity and per code path, for tuning <cachePolicy> and prefetching.
+ */
+@property (nonatomic, readonly, strong) SMCacheStatistics *cacheStatistics;
+
+/**
+ The most contexts <performBlockWithPooledContext:> and <performBlockAndWaitWithPooledContext:> keep.  Blocks wait for a context when all of them are in use.  Default is 4.  Changes made after the pool is first used have no effect.
+ */
+@property (nonatomic) NSUInteger maxPooledContexts;
+
+/**
+ Coalesces saves made around the same time into one save to StackMob.  Created on first use, with <mainThreadContext> as its main context.  See <SMAutosaveCoordinator>.
+ */
+@property (nonatomic, readonly, strong) SMAutosaveCoordinator *autosaveCoordinator;
+
 
 ///-------------------------------
 /// @name Initialize
@@ -156,11 +177,43 @@ typedef enum {
  
  Merge policy is set to NSMergeByPropertyObjectTrumpMergePolicy.
  
- If the current thread is the main thread, returns a context initialized with a NSMainQueueConcurrencyType.  Otherwise, returns a context initialized with a NSPrivateQueueConcurrencyType, with the mainThreadContext as its parent.
+ If the current thread is the main thread, returns a context initialized with a NSMainQueueConcurrencyType.  If it is running a block on a queue passed to <contextForQueue:>, returns that queue's context.  Otherwise, returns a context initialized with a NSPrivateQueueConcurrencyType, with the mainThreadContext as its parent, which is kept for the life of the thread.
  
+ @note GCD runs queues on a pool of threads, so a context kept per thread may be handed to unrelated work and is not released while the thread lives.  On queues, use <contextForQueue:> or <performBlockWithPooledContext:> instead.
  */
 - (NSManagedObjectContext *)contextForCurrentThread;
 
+/**
+ Returns the context for a dispatch queue, creating it on first use.
+ 
+ For the main queue this is <mainThreadContext>.  For any other queue it is a context initialized with a NSPrivateQueueConcurrencyType, with the mainThreadContext as its parent, which is released along with the queue.  Blocks running on the queue also get it from <contextForCurrentThread>.
+ 
+ The context has its own private queue, so use `performBlock:` or `performBlockAndWait:` to work with it.
+ 
+ @param queue The queue.
+ 
+ @return The queue's context.
+ */
+- (NSManagedObjectContext *)contextForQueue:(dispatch_queue_t)queue;
+
+/**
+ Runs a block asynchronously on a context borrowed from a small pool of background contexts.
+ 
+ Pooled contexts are initialized with a NSPrivateQueueConcurrencyType, with the mainThreadContext as their parent.  The block runs on the context's queue.  When it returns the context is reset and handed back to the pool, so save any changes before returning and do not keep the context or its objects.  At most <maxPooledContexts> blocks run at once; the rest wait for a context.
+ 
+ @param block The work to do.
+ */
+- (void)performBlockWithPooledContext:(void (^)(NSManagedObjectContext *context))block;
+
+/**
+ Runs a block on a context borrowed from the pool, and waits for it to finish.  See <performBlockWithPooledContext:>.
+ 
+ @warning If every pooled context is in use, this blocks the calling thread, with no time limit, until one is handed back.  Pooled contexts save into the mainThreadContext, which needs the main thread, so calling this on the main thread while other pooled blocks are saving can deadlock.  Use <performBlockWithPooledContext:> from the main thread.
+ 
+ @param block The work to do.
+ */
+- (void)performBlockAndWaitWithPooledContext:(void (^)(NSManagedObjectContext *context))block;
+
 /**
  Sets the merge policy that is set by default to any context returned from <contextForCurrentThread>.
  
@@ -18,8 +18,11 @@
 #import "SMIncrementalStore.h"
 #import "SMError.h"
 #import "NSManagedObjectContext+Concurrency.h"
+#import "SMEntityMetadata.h"
+#import "SMCacheStatistics.h"
+#import "SMAutosaveCoordinator.h"
 
-#define DLog(fmt, ...) NSLog((@"Performing %s [Line %d] " fmt), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__);
+#define DEFAULT_MAX_POOLED_CONTEXTS 4
 
 static NSString *const SM_ManagedObjectContextKey = @"SM_ManagedObjectContextKey";
 NSString *const SMSetCachePolicyNotification = @"SMSetCachePolicyNotification";
@@ -31,8 +34,17 @@ BOOL SM_CACHE_ENABLED = NO;
 @property (nonatomic, strong) NSManagedObjectContext *privateContext;
 @property (nonatomic, strong) id defaultMergePolicy;
 @property (nonatomic) dispatch_queue_t cachePurgeQueue;
+@property (nonatomic, readwrite, strong) SMCacheStatistics *cacheStatistics;
+// Idle contexts for performBlockWithPooledContext:, with a semaphore counting those which may still be checked out
+@property (nonatomic, strong) NSMutableArray *idleContexts;
+@property (nonatomic) dispatch_semaphore_t contextPoolSemaphore;
+// Asynchronous blocks wait for a context here, in order, so only one thread is ever blocked waiting
+@property (nonatomic) dispatch_queue_t contextPoolQueue;
+@property (nonatomic, readwrite, strong) SMAutosaveCoordinator *autosaveCoordinator;
 
 - (NSManagedObjectContext *)SM_newPrivateQueueContextWithParent:(NSManagedObjectContext *)parent;
+- (NSManagedObjectContext *)SM_checkOutPooledContext;
+- (void)SM_checkInPooledContext:(NSManagedObjectContext *)context;
 - (void)SM_didReceiveSetCachePolicyNotification:(NSNotification *)notification;
 
 @end
@@ -47,14 +59,25 @@ BOOL SM_CACHE_ENABLED = NO;
 @synthesize defaultMergePolicy = _defaultMergePolicy;
 @synthesize cachePurgeQueue = _cachePurgeQueue;
 @synthesize cachePolicy = _cachePolicy;
+@synthesize cacheStatistics = _cacheStatistics;
+@synthesize maxPooledContexts = _maxPooledContexts;
+@synthesize idleContexts = _idleContexts;
+@synthesize contextPoolSemaphore = _contextPoolSemaphore;
+@synthesize contextPoolQueue = _contextPoolQueue;
+@synthesize autosaveCoordinator = _autosaveCoordinator;
 
 - (id)initWithAPIVersion:(NSString *)apiVersion session:(SMUserSession *)session managedObjectModel:(NSManagedObjectModel *)managedObjectModel
 {
     self = [super initWithAPIVersion:apiVersion session:session];
     if (self) {
         _managedObjectModel = managedObjectModel;
+        [SMEntityMetadata registerModel:managedObjectModel userSchema:[session userSchema] userPrimaryKeyField:[session userPrimaryKeyField]];
         _defaultMergePolicy = NSMergeByPropertyObjectTrumpMergePolicy;
         self.cachePurgeQueue = dispatch_queue_create("Purge Cache Of Object Queue", NULL);
+        self.cacheStatistics = [[SMCacheStatistics alloc] init];
+        self.maxPooledContexts = DEFAULT_MAX_POOLED_CONTEXTS;
+        self.idleContexts = [NSMutableArray array];
+        self.contextPoolQueue = dispatch_queue_create("com.stackmob.contextPoolQueue", NULL);
         [self setCachePolicy:SMCachePolicyTryNetworkOnly];
         
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(SM_didReceiveSetCachePolicyNotification:) name:SMSetCachePolicyNotification object:self.session.networkMonitor];
@@ -63,6 +86,14 @@ BOOL SM_CACHE_ENABLED = NO;
     return self;
 }
 
+- (void)dealloc
+{
+    if (_contextPoolSemaphore) {
+        dispatch_release(_contextPoolSemaphore);
+    }
+    dispatch_release(_contextPoolQueue);
+}
+
 - (NSPersistentStoreCoordinator *)persistentStoreCoordinator
 {
     if (_persistentStoreCoordinator == nil) {
@@ -120,6 +151,16 @@ BOOL SM_CACHE_ENABLED = NO;
     return _mainThreadContext;
 }
 
+- (SMAutosaveCoordinator *)autosaveCoordinator
+{
+    @synchronized(self) {
+        if (_autosaveCoordinator == nil) {
+            _autosaveCoordinator = [[SMAutosaveCoordinator alloc] initWithMainContext:self.mainThreadContext];
+        }
+    }
+    return _autosaveCoordinator;
+}
+
 - (NSManagedObjectContext *)SM_newPrivateQueueContextWithParent:(NSManagedObjectContext *)parent
 {
     NSManagedObjectContext *context = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
@@ -138,6 +179,12 @@ BOOL SM_CACHE_ENABLED = NO;
 	}
 	else
 	{
+		// Work running on a queue registered with contextForQueue: gets that queue's context, whichever pool thread it lands on
+		NSManagedObjectContext *queueContext = (__bridge NSManagedObjectContext *)dispatch_get_specific((__bridge const void *)self);
+		if (queueContext) {
+			return queueContext;
+		}
+		
 		NSMutableDictionary *threadDict = [[NSThread currentThread] threadDictionary];
 		NSManagedObjectContext *threadContext = [threadDict objectForKey:SM_ManagedObjectContextKey];
 		if (threadContext == nil)
@@ -149,6 +196,80 @@ BOOL SM_CACHE_ENABLED = NO;
 	}
 }
 
+- (NSManagedObjectContext *)contextForQueue:(dispatch_queue_t)queue
+{
+    if (queue == dispatch_get_main_queue()) {
+        return self.mainThreadContext;
+    }
+    
+    // The queue owns its context, so it is released with the queue rather than living as long as a pool thread
+    const void *key = (__bridge const void *)self;
+    @synchronized(self) {
+        NSManagedObjectContext *context = (__bridge NSManagedObjectContext *)dispatch_queue_get_specific(queue, key);
+        if (context == nil) {
+            context = [self SM_newPrivateQueueContextWithParent:self.mainThreadContext];
+            dispatch_queue_set_specific(queue, key, (__bridge_retained void *)context, (dispatch_function_t)CFRelease);
+        }
+        return context;
+    }
+}
+
+- (NSManagedObjectContext *)SM_checkOutPooledContext
+{
+    dispatch_semaphore_t semaphore = nil;
+    @synchronized(self.idleContexts) {
+        if (self.contextPoolSemaphore == nil) {
+            self.contextPoolSemaphore = dispatch_semaphore_create(MAX(self.maxPooledContexts, (NSUInteger)1));
+        }
+        semaphore = self.contextPoolSemaphore;
+    }
+    // Waits with no time limit, which is why performBlockAndWaitWithPooledContext: must not be called on the main thread
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    
+    NSManagedObjectContext *context = nil;
+    @synchronized(self.idleContexts) {
+        context = [self.idleContexts lastObject];
+        if (context) {
+            [self.idleContexts removeLastObject];
+        }
+    }
+    if (context == nil) {
+        context = [self SM_newPrivateQueueContextWithParent:self.mainThreadContext];
+    }
+    return context;
+}
+
+- (void)SM_checkInPooledContext:(NSManagedObjectContext *)context
+{
+    @synchronized(self.idleContexts) {
+        [self.idleContexts addObject:context];
+    }
+    dispatch_semaphore_signal(self.contextPoolSemaphore);
+}
+
+- (void)performBlockWithPooledContext:(void (^)(NSManagedObjectContext *context))block
+{
+    dispatch_async(self.contextPoolQueue, ^{
+        NSManagedObjectContext *context = [self SM_checkOutPooledContext];
+        [context performBlock:^{
+            block(context);
+            // Drop the objects the block registered so the next user starts with an empty row cache
+            [context reset];
+            [self SM_checkInPooledContext:context];
+        }];
+    });
+}
+
+- (void)performBlockAndWaitWithPooledContext:(void (^)(NSManagedObjectContext *context))block
+{
+    NSManagedObjectContext *context = [self SM_checkOutPooledContext];
+    [context performBlockAndWait:^{
+        block(context);
+        [context reset];
+    }];
+    [self SM_checkInPooledContext:context];
+}
+
 - (void)setDefaultMergePolicy:(id)mergePolicy applyToMainThreadContextAndParent:(BOOL)apply
 {
     if (mergePolicy != self.defaultMergePolicy) {
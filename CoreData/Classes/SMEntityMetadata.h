@@ -0,0 +1,106 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <CoreData/CoreData.h>
+
+@class SMResponseDeserializationPlan;
+
+/**
+ `SMEntityMetadata` holds the StackMob names for one entity: its schema, its primary key and the field name of every property, in both directions.
+ 
+ Working these out takes string scans and property lookups, and the serializers need them for every property of every object.  So they are compiled once per entity when an <SMCoreDataStore> is created with a model, and never change afterwards.  The `StackMobSerialization` categories on `NSEntityDescription` and `NSManagedObject` read from here when their entity has been registered, and work names out as before otherwise.
+ */
+@interface SMEntityMetadata : NSObject
+
+@property (nonatomic, readonly, copy) NSString *entityName;
+
+/**
+ The StackMob schema, which is the lowercased entity name.
+ */
+@property (nonatomic, readonly, copy) NSString *schema;
+
+/**
+ The attribute named lowercaseEntityNameId or lowercaseEntityName_id, or nil if there is none.
+ */
+@property (nonatomic, readonly, copy) NSString *declaredPrimaryKeyField;
+
+/**
+ The attribute holding the primary key: <declaredPrimaryKeyField> if there is one, otherwise the user primary key field when this is the user schema, otherwise nil.
+ */
+@property (nonatomic, readonly, copy) NSString *primaryKeyField;
+
+/**
+ The StackMob field name for <primaryKeyField>.
+ */
+@property (nonatomic, readonly, copy) NSString *SMPrimaryKeyField;
+
+/**
+ Whether this entity's schema is the user schema.
+ */
+@property (nonatomic, readonly) BOOL isUserSchema;
+
+/**
+ The plan for reading this entity's objects from StackMob responses.
+ */
+@property (nonatomic, readonly, strong) SMResponseDeserializationPlan *responseDeserializationPlan;
+
+/**
+ Registers metadata for every entity in a model.  Registering a model again replaces its metadata.
+ 
+ @param model The managed object model.
+ @param userSchema The schema flagged as the user object schema.
+ @param userPrimaryKeyField The primary key field for the user schema.
+ */
++ (void)registerModel:(NSManagedObjectModel *)model userSchema:(NSString *)userSchema userPrimaryKeyField:(NSString *)userPrimaryKeyField;
+
+/**
+ Returns the metadata for an entity.
+ 
+ @param entity The entity.
+ 
+ @return The metadata, or nil if the entity's model has not been registered.
+ */
++ (SMEntityMetadata *)metadataForEntity:(NSEntityDescription *)entity;
+
+/**
+ Returns the StackMob field name for a property, converting camelCase to lowercase with underscores.
+ 
+ @param propertyName The name of one of the entity's properties.
+ 
+ @return The field name, or nil if there is no such property or its name starts with an uppercase letter.
+ */
+- (NSString *)fieldNameForPropertyName:(NSString *)propertyName;
+
+/**
+ Returns the property for a StackMob field name.  A property whose name matches exactly is preferred over one whose camelCase name converts to it.
+ 
+ @param fieldName The field name.
+ 
+ @return The property, or nil if none matches.
+ */
+- (NSPropertyDescription *)propertyForFieldName:(NSString *)fieldName;
+
+/**
+ Returns the schema of a relationship's destination entity.
+ 
+ @param relationshipName The name of one of the entity's relationships.
+ 
+ @return The destination schema, or nil if there is no such relationship.
+ */
+- (NSString *)destinationSchemaForRelationshipName:(NSString *)relationshipName;
+
+@end
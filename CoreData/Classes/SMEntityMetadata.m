@@ -0,0 +1,170 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMEntityMetadata.h"
+#import "SMResponseDeserializationPlan.h"
+#import <objc/runtime.h>
+
+static char SMEntityMetadataRegistryKey;
+
+static NSString * SMFieldNameFromPropertyName(NSString *propertyName)
+{
+    NSUInteger length = [propertyName length];
+    if (length == 0 || [[NSCharacterSet uppercaseLetterCharacterSet] characterIsMember:[propertyName characterAtIndex:0]]) {
+        return nil;
+    }
+    
+    NSMutableString *fieldName = [NSMutableString stringWithCapacity:length + 4];
+    NSCharacterSet *uppercaseSet = [NSCharacterSet uppercaseLetterCharacterSet];
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar character = [propertyName characterAtIndex:i];
+        if ([uppercaseSet characterIsMember:character]) {
+            unichar lowercased = character + 32;
+            [fieldName appendString:@"_"];
+            [fieldName appendString:[NSString stringWithCharacters:&lowercased length:1]];
+        } else {
+            [fieldName appendString:[NSString stringWithCharacters:&character length:1]];
+        }
+    }
+    return fieldName;
+}
+
+@interface SMEntityMetadata ()
+
+@property (nonatomic, readwrite, copy) NSString *entityName;
+@property (nonatomic, readwrite, copy) NSString *schema;
+@property (nonatomic, readwrite, copy) NSString *declaredPrimaryKeyField;
+@property (nonatomic, readwrite, copy) NSString *primaryKeyField;
+@property (nonatomic, readwrite, copy) NSString *SMPrimaryKeyField;
+@property (nonatomic, readwrite) BOOL isUserSchema;
+@property (nonatomic, readwrite, strong) SMResponseDeserializationPlan *responseDeserializationPlan;
+@property (nonatomic, strong) NSDictionary *fieldNamesByPropertyName;
+@property (nonatomic, strong) NSDictionary *propertiesByFieldName;
+@property (nonatomic, strong) NSDictionary *destinationSchemasByRelationshipName;
+
+- (id)initWithEntity:(NSEntityDescription *)entity userSchema:(NSString *)userSchema userPrimaryKeyField:(NSString *)userPrimaryKeyField;
+
+@end
+
+@implementation SMEntityMetadata
+
+@synthesize entityName = _SM_entityName;
+@synthesize schema = _SM_schema;
+@synthesize declaredPrimaryKeyField = _SM_declaredPrimaryKeyField;
+@synthesize primaryKeyField = _SM_primaryKeyField;
+@synthesize SMPrimaryKeyField = _SM_SMPrimaryKeyField;
+@synthesize isUserSchema = _SM_isUserSchema;
+@synthesize responseDeserializationPlan = _SM_responseDeserializationPlan;
+@synthesize fieldNamesByPropertyName = _SM_fieldNamesByPropertyName;
+@synthesize propertiesByFieldName = _SM_propertiesByFieldName;
+@synthesize destinationSchemasByRelationshipName = _SM_destinationSchemasByRelationshipName;
+
++ (void)registerModel:(NSManagedObjectModel *)model userSchema:(NSString *)userSchema userPrimaryKeyField:(NSString *)userPrimaryKeyField
+{
+    if (model == nil) {
+        return;
+    }
+    
+    NSMutableDictionary *registry = [NSMutableDictionary dictionaryWithCapacity:[[model entities] count]];
+    for (NSEntityDescription *entity in [model entities]) {
+        SMEntityMetadata *metadata = [[SMEntityMetadata alloc] initWithEntity:entity userSchema:userSchema userPrimaryKeyField:userPrimaryKeyField];
+        [registry setObject:metadata forKey:[entity name]];
+    }
+    
+    // Entities keep a pointer back to their model, so hanging the registry off the model needs no lookup table of its own
+    objc_setAssociatedObject(model, &SMEntityMetadataRegistryKey, [registry copy], OBJC_ASSOCIATION_RETAIN);
+}
+
++ (SMEntityMetadata *)metadataForEntity:(NSEntityDescription *)entity
+{
+    NSManagedObjectModel *model = [entity managedObjectModel];
+    if (model == nil) {
+        return nil;
+    }
+    NSDictionary *registry = objc_getAssociatedObject(model, &SMEntityMetadataRegistryKey);
+    return [registry objectForKey:[entity name]];
+}
+
+- (id)initWithEntity:(NSEntityDescription *)entity userSchema:(NSString *)userSchema userPrimaryKeyField:(NSString *)userPrimaryKeyField
+{
+    self = [super init];
+    if (self) {
+        NSDictionary *propertiesByName = [entity propertiesByName];
+        
+        self.entityName = [entity name];
+        self.schema = [[entity name] lowercaseString];
+        self.isUserSchema = userSchema != nil && [self.schema isEqualToString:userSchema];
+        
+        NSString *camelCasePrimaryKeyField = [self.schema stringByAppendingString:@"Id"];
+        NSString *underscorePrimaryKeyField = [self.schema stringByAppendingString:@"_id"];
+        if ([propertiesByName objectForKey:camelCasePrimaryKeyField]) {
+            self.declaredPrimaryKeyField = camelCasePrimaryKeyField;
+        } else if ([propertiesByName objectForKey:underscorePrimaryKeyField]) {
+            self.declaredPrimaryKeyField = underscorePrimaryKeyField;
+        }
+        self.primaryKeyField = self.declaredPrimaryKeyField;
+        if (self.primaryKeyField == nil && self.isUserSchema) {
+            self.primaryKeyField = userPrimaryKeyField;
+        }
+        
+        NSMutableDictionary *fieldNamesByPropertyName = [NSMutableDictionary dictionaryWithCapacity:[propertiesByName count]];
+        NSMutableDictionary *propertiesByFieldName = [NSMutableDictionary dictionaryWithCapacity:[propertiesByName count] * 2];
+        NSMutableDictionary *destinationSchemasByRelationshipName = [NSMutableDictionary dictionary];
+        [propertiesByName enumerateKeysAndObjectsUsingBlock:^(NSString *propertyName, NSPropertyDescription *property, BOOL *stop) {
+            NSString *fieldName = SMFieldNameFromPropertyName(propertyName);
+            if (fieldName) {
+                [fieldNamesByPropertyName setObject:fieldName forKey:propertyName];
+                [propertiesByFieldName setObject:property forKey:fieldName];
+            }
+            if ([property isKindOfClass:[NSRelationshipDescription class]]) {
+                NSString *destinationSchema = [[[(NSRelationshipDescription *)property destinationEntity] name] lowercaseString];
+                if (destinationSchema) {
+                    [destinationSchemasByRelationshipName setObject:destinationSchema forKey:propertyName];
+                }
+            }
+        }];
+        // Exact matches take precedence over converted names
+        [propertiesByFieldName addEntriesFromDictionary:propertiesByName];
+        
+        self.fieldNamesByPropertyName = fieldNamesByPropertyName;
+        self.propertiesByFieldName = propertiesByFieldName;
+        self.destinationSchemasByRelationshipName = destinationSchemasByRelationshipName;
+        self.responseDeserializationPlan = [[SMResponseDeserializationPlan alloc] initWithEntity:entity fieldNamesByPropertyName:fieldNamesByPropertyName];
+        if (self.primaryKeyField) {
+            NSString *primaryKeyFieldName = [fieldNamesByPropertyName objectForKey:self.primaryKeyField];
+            self.SMPrimaryKeyField = primaryKeyFieldName ? primaryKeyFieldName : SMFieldNameFromPropertyName(self.primaryKeyField);
+        }
+    }
+    return self;
+}
+
+- (NSString *)fieldNameForPropertyName:(NSString *)propertyName
+{
+    return [self.fieldNamesByPropertyName objectForKey:propertyName];
+}
+
+- (NSPropertyDescription *)propertyForFieldName:(NSString *)fieldName
+{
+    return [self.propertiesByFieldName objectForKey:fieldName];
+}
+
+- (NSString *)destinationSchemaForRelationshipName:(NSString *)relationshipName
+{
+    return [self.destinationSchemasByRelationshipName objectForKey:relationshipName];
+}
+
+@end
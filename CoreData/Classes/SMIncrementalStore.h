@@ -32,6 +32,9 @@ extern NSString *const SMCachePurgeManagedObjectID;
 extern NSString *const SMCachePurgeArrayOfManageObjectIDs;
 extern NSString *const SMCachePurgeOfObjectsFromEntityName;
 
+/*
+ Deprecated: use SMLogger.  If SM_CORE_DATA_DEBUG is YES when a store is created, the CoreData and Cache subsystems are logged to the console at debug level.  SM_MAX_LOG_LENGTH, if changed, sets the logger's maximumMessageLength.
+ */
 extern BOOL SM_CORE_DATA_DEBUG;
 extern unsigned int SM_MAX_LOG_LENGTH;
 
@@ -24,8 +24,9 @@
 #import "SMDataStore+Protected.h"
 #import "AFHTTPClient.h"
 #import "SMIncrementalStoreNode.h"
-
-#define DLog(fmt, ...) NSLog((@"Performing %s [Line %d] " fmt), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__);
+#import "SMEntityMetadata.h"
+#import "SMResponseDeserializationPlan.h"
+#import "SMCacheStatistics.h"
 
 NSString *const SMIncrementalStoreType = @"SMIncrementalStore";
 NSString *const SM_DataStoreKey = @"SM_DataStoreKey";
@@ -63,10 +64,28 @@ NSString *const SMFailedRequestOriginalSuccessBlock = @"SMFailedRequestOriginalS
 BOOL SM_CORE_DATA_DEBUG = NO;
 unsigned int SM_MAX_LOG_LENGTH = 10000;
 
-NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
-    return [[NSString stringWithFormat:@"%@", objectToCheck] length] > SM_MAX_LOG_LENGTH ? [[[NSString stringWithFormat:@"%@", objectToCheck] substringToIndex:SM_MAX_LOG_LENGTH] stringByAppendingString:@" <MAX_LOG_LENGTH_REACHED>"] : objectToCheck;
+// Apps written before SMLogger set these globals, usually before creating the store
+static void SMApplyLegacyLogSettings(void)
+{
+    SMLogger *logger = [SMLogger sharedLogger];
+    if (SM_CORE_DATA_DEBUG) {
+        [logger setLevel:SMLogLevelDebug forSubsystem:SMLogSubsystemCoreData];
+        [logger setLevel:SMLogLevelDebug forSubsystem:SMLogSubsystemCache];
+        if (logger.consoleLevel < SMLogLevelDebug) {
+            logger.consoleLevel = SMLogLevelDebug;
+        }
+    }
+    if (SM_MAX_LOG_LENGTH != 10000) {
+        logger.maximumMessageLength = SM_MAX_LOG_LENGTH;
+    }
 }
 
+// Number of rows handed from the network to the deserializer at a time when fetching
+static NSUInteger const SMNetworkFetchBatchSize = 100;
+// Large sorted fetches are requested as pages of this many objects, with up to SMNetworkFetchConcurrentPages in flight
+static NSUInteger const SMNetworkFetchPageSize = 500;
+static NSUInteger const SMNetworkFetchConcurrentPages = 4;
+
 @interface SMIncrementalStore () {
     
 }
@@ -95,6 +114,11 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (id)SM_fetchObjects:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError * __autoreleasing *)error;
 - (id)SM_fetchObjectIDs:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError *__autoreleasing *)error;
+- (void)SM_purgeCacheResultsForFetchRequest:(NSFetchRequest *)fetchRequest;
+- (NSArray *)SM_managedObjectsForFetchedResults:(NSArray *)fetchedResults fetchRequest:(NSFetchRequest *)fetchRequest primaryKeyField:(NSString *)primaryKeyField context:(NSManagedObjectContext *)context cacheEntries:(NSMutableArray *)cacheEntries;
+- (void)SM_cacheFetchedEntries:(NSArray *)cacheEntries fetchRequest:(NSFetchRequest *)fetchRequest;
+
+- (NSString *)SM_primaryKeyFieldForEntity:(NSEntityDescription *)entity;
 
 - (void)SM_configureCache;
 - (NSURL *)SM_getStoreURLForCacheDatabase;
@@ -128,10 +152,11 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 - (void)SM_didRecievePurgeObjectFromCacheByEntityNotification:(NSNotification *)notification;
 - (void)SM_didRecieveCacheResetNotification:(NSNotification *)notification;
 
-- (BOOL)SM_purgeObjectsFromCacheByStackMobID:(NSArray *)arrayOfStackMobObjectIDs;
-- (BOOL)SM_purgeCacheManagedObjectsFromCache:(NSArray *)arrayOfManagedObjects;
-- (BOOL)SM_purgeObjectFromCacheWithStackMobID:(NSString *)objectID error:(NSError *__autoreleasing*)error;
-- (BOOL)SM_purgeCacheManagedObjectFromCache:(NSManagedObject *)object;
+- (BOOL)SM_purgeObjectsFromCacheByStackMobID:(NSArray *)arrayOfStackMobObjectIDs codePath:(NSString *)codePath;
+- (BOOL)SM_purgeCacheManagedObjectsFromCache:(NSArray *)arrayOfManagedObjects codePath:(NSString *)codePath;
+- (BOOL)SM_purgeObjectFromCacheWithStackMobID:(NSString *)objectID codePath:(NSString *)codePath error:(NSError *__autoreleasing*)error;
+- (BOOL)SM_purgeCacheManagedObjectFromCache:(NSManagedObject *)object codePath:(NSString *)codePath;
+- (void)SM_recordCacheEvent:(SMCacheEvent)event entityName:(NSString *)entityName codePath:(NSString *)codePath;
 
 - (NSString *)SM_remoteKeyForEntityName:(NSString *)entityName;
 - (NSDictionary *)SM_responseSerializationForDictionary:(NSDictionary *)theObject schemaEntityDescription:(NSEntityDescription *)entityDescription managedObjectContext:(NSManagedObjectContext *)context includeRelationships:(BOOL)includeRelationships;
@@ -169,7 +194,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 @synthesize isSaving = _isSaving;
 
 - (id)initWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)root configurationName:(NSString *)name URL:(NSURL *)url options:(NSDictionary *)options {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMApplyLegacyLogSettings();
+    SMLogEnter(SMLogSubsystemCoreData);
     
     self = [super initWithPersistentStoreCoordinator:root configurationName:name URL:url options:options];
     if (self) {
@@ -185,7 +211,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             [self SM_configureCache];
         }
         
-        if (SM_CORE_DATA_DEBUG) {DLog(@"STACKMOB SYSTEM UPDATE: Incremental Store initialized and ready to go.")}
+        SMLogInfo(SMLogSubsystemCoreData, @"STACKMOB SYSTEM UPDATE: Incremental Store initialized and ready to go.");
     }
     return self;
 }
@@ -222,18 +248,18 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_handleWillSave:(NSNotification *)notification
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     if ([[notification object] persistentStoreCoordinator] == [self.coreDataStore persistentStoreCoordinator]) {
-        if (SM_CORE_DATA_DEBUG) {DLog(@"Updating isSaving to YES")}
+        SMLogDebug(SMLogSubsystemCoreData, @"Updating isSaving to YES");
         self.isSaving = YES;
     }
 }
 
 - (void)SM_handleDidSave:(NSNotification *)notification
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     if ([[notification object] persistentStoreCoordinator] == [self.coreDataStore persistentStoreCoordinator]) {
-        if (SM_CORE_DATA_DEBUG) {DLog(@"Updating isSaving to NO")}
+        SMLogDebug(SMLogSubsystemCoreData, @"Updating isSaving to NO");
         self.isSaving = NO;
     }
 }
@@ -251,7 +277,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
  
  */
 - (BOOL)loadMetadata:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     NSString* uuid = [[NSProcessInfo processInfo] globallyUniqueString];
     [self setMetadata:[NSDictionary dictionaryWithObjectsAndKeys:
                        SMIncrementalStoreType, NSStoreTypeKey,
@@ -274,13 +300,17 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 - (id)executeRequest:(NSPersistentStoreRequest *)request
          withContext:(NSManagedObjectContext *)context
                error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     id result = nil;
+    SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"executeRequest" category:@"coredata"];
     switch (request.requestType) {
         case NSSaveRequestType:
+            [traceSpan setArgument:@"save" forKey:@"request_type"];
             result = [self SM_handleSaveRequest:request withContext:context error:error];
             break;
         case NSFetchRequestType:
+            [traceSpan setArgument:@"fetch" forKey:@"request_type"];
+            [traceSpan setArgument:[[(NSFetchRequest *)request entity] name] forKey:@"entity"];
             result = [self SM_handleFetchRequest:request withContext:context error:error];
             break;
         default:
@@ -303,8 +333,10 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     
     if (result == nil) {
         *error = (__bridge id)(__bridge_retained CFTypeRef)*error;
+        SMLogError(SMLogSubsystemCoreData, @"Request failed with error %@", *error);
     }
     
+    [traceSpan end];
     return result;
 }
 
@@ -326,7 +358,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 - (id)SM_handleSaveRequest:(NSPersistentStoreRequest *)request
                withContext:(NSManagedObjectContext *)context
                      error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Reset options and failed operations queue
     [self.globalOptions setTryRefreshToken:YES];
@@ -335,21 +367,30 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     
     NSSet *insertedObjects = [saveRequest insertedObjects];
     if ([insertedObjects count] > 0) {
+        SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"insert" category:@"coredata"];
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[insertedObjects count]] forKey:@"object_count"];
         BOOL insertSuccess = [self SM_handleInsertedObjects:insertedObjects inContext:context error:error];
+        [traceSpan end];
         if (!insertSuccess) {
             return nil;
         }
     }
     NSSet *updatedObjects = [saveRequest updatedObjects];
     if ([updatedObjects count] > 0) {
+        SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"update" category:@"coredata"];
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[updatedObjects count]] forKey:@"object_count"];
         BOOL updateSuccess = [self SM_handleUpdatedObjects:updatedObjects inContext:context error:error];
+        [traceSpan end];
         if (!updateSuccess) {
             return nil;
         }
     }
     NSSet *deletedObjects = [saveRequest deletedObjects];
     if ([deletedObjects count] > 0) {
+        SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"delete" category:@"coredata"];
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[deletedObjects count]] forKey:@"object_count"];
         BOOL deleteSuccess = [self SM_handleDeletedObjects:deletedObjects inContext:context error:error];
+        [traceSpan end];
         if (!deleteSuccess) {
             return nil;
         }
@@ -360,8 +401,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_handleInsertedObjects:(NSSet *)insertedObjects inContext:(NSManagedObjectContext *)context error:(NSError *__autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
-    if (SM_CORE_DATA_DEBUG) { DLog(@"objects to be inserted are %@", truncateOutputIfExceedsMaxLogLength(insertedObjects))}
+    SMLogEnter(SMLogSubsystemCoreData);
+    SMLogDebug(SMLogSubsystemCoreData, @"objects to be inserted are %@", insertedObjects);
     
     __block BOOL success = YES;
     
@@ -396,7 +437,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         }
         
         if (!*stop) {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Serialized object dictionary: %@", truncateOutputIfExceedsMaxLogLength(serializedObjDict)) }
+            SMLogDebug(SMLogSubsystemCoreData, @"Serialized object dictionary: %@", serializedObjDict);
             // add relationship headers if needed
             NSMutableDictionary *headerDict = [NSMutableDictionary dictionary];
             if ([serializedObjDict objectForKey:StackMobRelationsKey]) {
@@ -405,7 +446,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             }
             
             SMResultSuccessBlock operationSuccesBlock = ^(NSDictionary *theObject){
-                if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore inserted object %@ on schema %@", truncateOutputIfExceedsMaxLogLength(theObject) , schemaName) }
+                SMLogDebug(SMLogSubsystemCoreData, @"SMIncrementalStore inserted object %@ on schema %@", theObject , schemaName);
                 if ([managedObject isKindOfClass:[SMUserManagedObject class]]) {
                     [managedObject removePassword];
                 }
@@ -414,10 +455,10 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
             SMCoreDataSaveFailureBlock operationFailureBlock = ^(NSURLRequest *theRequest, NSError *theError, NSDictionary *theObject, SMRequestOptions *theOptions, SMResultSuccessBlock originalSuccessBlock){
                 
-                if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore failed to insert object %@ on schema %@", truncateOutputIfExceedsMaxLogLength(theObject), schemaName) }
-                if (SM_CORE_DATA_DEBUG) { DLog(@"the error userInfo is %@", [theError userInfo]) }
+                SMLogWarning(SMLogSubsystemCoreData, @"SMIncrementalStore failed to insert object %@ on schema %@", theObject, schemaName);
+                SMLogWarning(SMLogSubsystemCoreData, @"the error userInfo is %@", [theError userInfo]);
                 
-                NSDictionary *failedRequestDict = [NSDictionary dictionaryWithObjectsAndKeys:theRequest, SMFailedRequest, theError, SMFailedRequestError, insertedObjectID, SMFailedRequestObjectPrimaryKey, [managedObject entity], SMFailedRequestObjectEntity, theOptions, SMFailedRequestOptions, originalSuccessBlock, SMFailedRequestOriginalSuccessBlock, nil];
+                NSDictionary *failedRequestDict = [NSDictionary dictionaryWithObjectsAndKeys:theError, SMFailedRequestError, insertedObjectID, SMFailedRequestObjectPrimaryKey, [managedObject entity], SMFailedRequestObjectEntity, theOptions, SMFailedRequestOptions, theRequest, SMFailedRequest, originalSuccessBlock, SMFailedRequestOriginalSuccessBlock, nil];
                 
                 // Add failed request to correct array
                 if ([theError code] == SMErrorUnauthorized) {
@@ -430,7 +471,10 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
             AFJSONRequestOperation *op = [[self coreDataStore] postOperationForObject:[serializedObjDict objectForKey:SerializedDictKey] inSchema:schemaName options:options successCallbackQueue:queue failureCallbackQueue:queue onSuccess:operationSuccesBlock onFailure:operationFailureBlock];
             
-            options.isSecure ? [secureOperations addObject:op] : [regularOperations addObject:op];
+            // No operation is made when a binary field cannot be read, and the failure block has already recorded why
+            if (op) {
+                options.isSecure ? [secureOperations addObject:op] : [regularOperations addObject:op];
+            }
             
         } else {
             success = NO;
@@ -448,8 +492,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_handleUpdatedObjects:(NSSet *)updatedObjects inContext:(NSManagedObjectContext *)context error:(NSError *__autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
-    if (SM_CORE_DATA_DEBUG) { DLog(@"objects to be updated are %@", truncateOutputIfExceedsMaxLogLength(updatedObjects)) }
+    SMLogEnter(SMLogSubsystemCoreData);
+    SMLogDebug(SMLogSubsystemCoreData, @"objects to be updated are %@", updatedObjects);
     __block BOOL success = YES;
     
     // create a group dispatch and queue
@@ -470,20 +514,20 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         __block NSString *updatedObjectID = [managedObject SMObjectId];
         __block SMRequestOptions *options = [SMRequestOptions options];
         
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Serialized object dictionary: %@", truncateOutputIfExceedsMaxLogLength(serializedObjDict)) }
+        SMLogDebug(SMLogSubsystemCoreData, @"Serialized object dictionary: %@", serializedObjDict);
         
         // Create success/failure blocks
         SMResultSuccessBlock operationSuccesBlock = ^(NSDictionary *theObject){
-            if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore updated object %@ on schema %@", truncateOutputIfExceedsMaxLogLength(theObject) , schemaName) }
+            SMLogDebug(SMLogSubsystemCoreData, @"SMIncrementalStore updated object %@ on schema %@", theObject , schemaName);
             
         };
         
         SMCoreDataSaveFailureBlock operationFailureBlock = ^(NSURLRequest *theRequest, NSError *theError, NSDictionary *theObject, SMRequestOptions *theOptions, SMResultSuccessBlock originalSuccessBlock){
             
-            if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore failed to update object %@ on schema %@", truncateOutputIfExceedsMaxLogLength(theObject), schemaName) }
-            if (SM_CORE_DATA_DEBUG) { DLog(@"the error userInfo is %@", [theError userInfo]) }
+            SMLogWarning(SMLogSubsystemCoreData, @"SMIncrementalStore failed to update object %@ on schema %@", theObject, schemaName);
+            SMLogWarning(SMLogSubsystemCoreData, @"the error userInfo is %@", [theError userInfo]);
             
-            NSDictionary *failedRequestDict = [NSDictionary dictionaryWithObjectsAndKeys:theRequest, SMFailedRequest, theError, SMFailedRequestError, updatedObjectID, SMFailedRequestObjectPrimaryKey, [managedObject entity], SMFailedRequestObjectEntity, theOptions, SMFailedRequestOptions, originalSuccessBlock, SMFailedRequestOriginalSuccessBlock, nil];
+            NSDictionary *failedRequestDict = [NSDictionary dictionaryWithObjectsAndKeys:theError, SMFailedRequestError, updatedObjectID, SMFailedRequestObjectPrimaryKey, [managedObject entity], SMFailedRequestObjectEntity, theOptions, SMFailedRequestOptions, theRequest, SMFailedRequest, originalSuccessBlock, SMFailedRequestOriginalSuccessBlock, nil];
             
             // Add failed request to correct array
             if ([theError code] == SMErrorUnauthorized) {
@@ -514,7 +558,9 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
         }
         
-        options.isSecure ? [secureOperations addObject:op] : [regularOperations addObject:op];
+        if (op) {
+            options.isSecure ? [secureOperations addObject:op] : [regularOperations addObject:op];
+        }
         
     }];
     
@@ -528,8 +574,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_handleDeletedObjects:(NSSet *)deletedObjects inContext:(NSManagedObjectContext *)context error:(NSError *__autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
-    if (SM_CORE_DATA_DEBUG) { DLog(@"objects to be deleted are %@", truncateOutputIfExceedsMaxLogLength(deletedObjects)) }
+    SMLogEnter(SMLogSubsystemCoreData);
+    SMLogDebug(SMLogSubsystemCoreData, @"objects to be deleted are %@", deletedObjects);
     
     __block BOOL success = YES;
     
@@ -552,11 +598,11 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         __block NSString *deletedObjectID = [managedObject SMObjectId];
         __block SMRequestOptions *options = [SMRequestOptions options];
         
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Serialized object dictionary: %@", truncateOutputIfExceedsMaxLogLength(serializedObjDict)) }
+        SMLogDebug(SMLogSubsystemCoreData, @"Serialized object dictionary: %@", serializedObjDict);
         
         // Create success/failure blocks
         SMResultSuccessBlock operationSuccesBlock = ^(NSDictionary *theObject){
-            if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore deleted object %@ on schema %@", deletedObjectID , schemaName) }
+            SMLogDebug(SMLogSubsystemCoreData, @"SMIncrementalStore deleted object %@ on schema %@", deletedObjectID , schemaName);
             
             // Purge cache of object
             [deletedObjectIDs addObject:deletedObjectID];
@@ -565,8 +611,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         SMCoreDataSaveFailureBlock operationFailureBlock = ^(NSURLRequest *theRequest, NSError *theError, NSDictionary *theObject, SMRequestOptions *theOptions, SMResultSuccessBlock originalSuccessBlock){
             
-            if (SM_CORE_DATA_DEBUG) { DLog(@"SMIncrementalStore failed to update object %@ on schema %@", truncateOutputIfExceedsMaxLogLength(theObject), schemaName) }
-            if (SM_CORE_DATA_DEBUG) { DLog(@"the error userInfo is %@", [theError userInfo]) }
+            SMLogWarning(SMLogSubsystemCoreData, @"SMIncrementalStore failed to update object %@ on schema %@", theObject, schemaName);
+            SMLogWarning(SMLogSubsystemCoreData, @"the error userInfo is %@", [theError userInfo]);
             
             NSDictionary *failedRequestDict = [NSDictionary dictionaryWithObjectsAndKeys:theRequest, SMFailedRequest, theError, SMFailedRequestError, deletedObjectID, SMFailedRequestObjectPrimaryKey, [managedObject entity], SMFailedRequestObjectEntity, theOptions, SMFailedRequestOptions, originalSuccessBlock, SMFailedRequestOriginalSuccessBlock, nil];
             
@@ -589,7 +635,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     success = [self SM_enqueueRegularOperations:regularOperations secureOperations:secureOperations withGroup:group queue:queue refreshAndRetryUnauthorizedRequests:failedRequestsWithUnauthorizedResponse failedRequests:failedRequests error:error];
     
     if ([deletedObjectIDs count] > 0) {
-        [self SM_purgeObjectsFromCacheByStackMobID:deletedObjectIDs];
+        [self SM_purgeObjectsFromCacheByStackMobID:deletedObjectIDs codePath:SMCacheCodePathSave];
     }
     
     dispatch_release(group);
@@ -600,7 +646,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_enqueueRegularOperations:(NSMutableArray *)regularOperations secureOperations:(NSMutableArray *)secureOperations withGroup:(dispatch_group_t)group queue:(dispatch_queue_t)queue refreshAndRetryUnauthorizedRequests:(NSMutableArray *)failedRequestsWithUnauthorizedResponse failedRequests:(NSMutableArray *)failedRequests error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Refresh access token if needed before initial enqueue of operations
     __block BOOL success = [self SM_doTokenRefreshIfNeededWithGroup:group queue:queue error:error];
@@ -704,7 +750,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_setErrorAndUserInfoWithFailedOperations:(NSMutableArray *)failedOperations errorCode:(int)errorCode error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     if (error != NULL) {
         __block NSMutableArray *failedInsertedObjects = [NSMutableArray array];
@@ -722,7 +768,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_waitForRefreshingWithTimeout:(int)timeout
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     if (timeout == 0 || !self.coreDataStore.session.refreshing) {
         return;
@@ -736,7 +782,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_enqueueOperations:(NSArray *)ops dispatchGroup:(dispatch_group_t)group completionBlockQueue:(dispatch_queue_t)queue secure:(BOOL)isSecure
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     if ([ops count] > 0) {
         dispatch_group_enter(group);
@@ -750,7 +796,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_doTokenRefreshIfNeededWithGroup:(dispatch_group_t)group queue:(dispatch_queue_t)queue error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block BOOL success = YES;
     if ([self.coreDataStore.session eligibleForTokenRefresh:self.globalOptions]) {
@@ -808,7 +854,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 - (id)SM_handleFetchRequest:(NSPersistentStoreRequest *)request
                 withContext:(NSManagedObjectContext *)context
                       error:(NSError * __autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     NSFetchRequest *fetchRequest = (NSFetchRequest *)request;
     switch (fetchRequest.resultType) {
         case NSManagedObjectResultType:
@@ -832,10 +878,12 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (id)SM_fetchObjectsFromNetwork:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError * __autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Build query for StackMob
+    SMTraceSpan *translateSpan = [[SMTracer sharedTracer] beginSpanWithName:@"translatePredicate" category:@"coredata"];
     SMQuery *query = [self queryForFetchRequest:fetchRequest error:error];
+    [translateSpan end];
     
     if (query == nil) {
         if (error) {
@@ -844,143 +892,196 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         return nil;
     }
     
-    __block NSArray *resultsWithoutOID;
+    // Obtain the primary key for the entity
+    NSString *primaryKeyField = nil;
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:fetchRequest.entity];
+    if (metadata.SMPrimaryKeyField) {
+        primaryKeyField = metadata.SMPrimaryKeyField;
+    } else {
+        @try {
+            primaryKeyField = [fetchRequest.entity SMFieldNameForProperty:[[fetchRequest.entity propertiesByName] objectForKey:[fetchRequest.entity primaryKeyField]]];
+        }
+        @catch (NSException *exception) {
+            primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
+        }
+    }
     
-    // create a group dispatch and queue
-    dispatch_queue_t queue = dispatch_queue_create("Fetch Objects Queue", NULL);
-    dispatch_group_t group = dispatch_group_create();
+    // The response is parsed as it downloads and handed over in batches, so objects are materialized on this thread while the rest of the results are still arriving.
+    __block NSMutableArray *pendingBatches = [NSMutableArray array];
+    __block BOOL queryFinished = NO;
     
-    dispatch_group_enter(group);
-    [self.coreDataStore performQuery:query options:[SMRequestOptions options] successCallbackQueue:queue failureCallbackQueue:queue onSuccess:^(NSArray *results) {
-        resultsWithoutOID = results;
-        dispatch_group_leave(group);
-    } onFailure:^(NSError *queryError) {
+    // create a serial queue for the callbacks and a semaphore signalled once per batch and once on completion
+    dispatch_queue_t queue = dispatch_queue_create("Fetch Objects Queue", NULL);
+    dispatch_semaphore_t batchSemaphore = dispatch_semaphore_create(0);
+    
+    // A fetch blocks its context until it returns, so it goes ahead of queued saves
+    SMRequestOptions *options = [SMRequestOptions options];
+    options.priority = SMRequestPriorityInteractive;
+    options.streamingBatchSize = SMNetworkFetchBatchSize;
+    // Later pages are requested from callback queues, so they need to be told which span they belong to
+    options.parentTraceSpan = [[SMTracer sharedTracer] currentSpan];
+    
+    SMResultsSuccessBlock batchBlock = ^(NSArray *results) {
+        [pendingBatches addObject:results];
+        dispatch_semaphore_signal(batchSemaphore);
+    };
+    SMSuccessBlock successBlock = ^{
+        queryFinished = YES;
+        dispatch_semaphore_signal(batchSemaphore);
+    };
+    SMFailureBlock failureBlock = ^(NSError *queryError) {
         
         if (error != NULL) {
             *error = (__bridge id)(__bridge_retained CFTypeRef)queryError;
         }
-        dispatch_group_leave(group);
-    }];
+        queryFinished = YES;
+        dispatch_semaphore_signal(batchSemaphore);
+    };
+    
+    if ([fetchRequest.sortDescriptors count] > 0) {
+        // Pages are separate requests, so they only line up if the order is total.  The primary key breaks ties between equal sort values.
+        NSArray *orderBy = [[query.requestHeaders objectForKey:@"X-StackMob-OrderBy"] componentsSeparatedByString:@","];
+        if (![orderBy containsObject:[primaryKeyField stringByAppendingString:@":asc"]] && ![orderBy containsObject:[primaryKeyField stringByAppendingString:@":desc"]]) {
+            [query orderByField:primaryKeyField ascending:YES];
+        }
+        [self.coreDataStore performQuery:query options:options pageSize:SMNetworkFetchPageSize maxConcurrentPages:SMNetworkFetchConcurrentPages successCallbackQueue:queue failureCallbackQueue:queue onPage:batchBlock onSuccess:successBlock onFailure:failureBlock];
+    } else {
+        // Without an order the server may return rows differently from one request to the next, so the results are fetched with a single request
+        [self.coreDataStore performQuery:query options:options batchSize:SMNetworkFetchBatchSize successCallbackQueue:queue failureCallbackQueue:queue onBatch:batchBlock onSuccess:successBlock onFailure:failureBlock];
+    }
     
-    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    NSMutableArray *results = [NSMutableArray array];
+    // Rows for the cache are held back until the whole fetch has succeeded, so a failure part way through leaves the cache as it was
+    NSMutableArray *cacheEntries = SM_CACHE_ENABLED ? [NSMutableArray array] : nil;
+    
+    while (YES) {
+        dispatch_semaphore_wait(batchSemaphore, DISPATCH_TIME_FOREVER);
+        
+        __block NSArray *batch = nil;
+        __block BOOL finished = NO;
+        dispatch_sync(queue, ^{
+            if ([pendingBatches count] > 0) {
+                batch = [pendingBatches objectAtIndex:0];
+                [pendingBatches removeObjectAtIndex:0];
+            } else {
+                finished = queryFinished;
+            }
+        });
+        
+        if (finished) {
+            break;
+        }
+        
+        @autoreleasepool {
+            SMTraceSpan *deserializeSpan = [[SMTracer sharedTracer] beginSpanWithName:@"deserialize" category:@"coredata"];
+            [deserializeSpan setArgument:[NSNumber numberWithUnsignedInteger:[batch count]] forKey:@"row_count"];
+            [results addObjectsFromArray:[self SM_managedObjectsForFetchedResults:batch fetchRequest:fetchRequest primaryKeyField:primaryKeyField context:context cacheEntries:cacheEntries]];
+            [deserializeSpan end];
+        }
+    }
     
     dispatch_release(queue);
-    dispatch_release(group);
+    dispatch_release(batchSemaphore);
     
     if (*error != nil) {
+        if (SM_CACHE_ENABLED) {
+            [self.localManagedObjectContext rollback];
+        }
         return nil;
     }
     
     if (SM_CACHE_ENABLED) {
-        
-        // Network fetch was successful, run same fetch on local cache and delete results
-        NSError *fetchOnCacheError = nil;
-        NSArray *cacheResults = [self.localManagedObjectContext executeFetchRequest:fetchRequest error:&fetchOnCacheError];
-        
-        if (fetchOnCacheError) {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Error fetching from cache, %@", fetchOnCacheError) }
-        }
-        
-        if ([cacheResults count] > 0) {
-            NSMutableArray *cacheObjectsToBeDeleted = [NSMutableArray array];
-            [cacheResults enumerateObjectsUsingBlock:^(id cacheObject, NSUInteger idx, BOOL *stop) {
-                [cacheObjectsToBeDeleted addObject:cacheObject];
-            }];
-            
-            BOOL purgeSuccess = [self SM_purgeCacheManagedObjectsFromCache:cacheObjectsToBeDeleted];
-            if (!purgeSuccess) {
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Purge Unsuccessful") }
-            }
-        }
-        
-        // Obtain the primary key for the entity
-        __block NSString *primaryKeyField = nil;
-        
-        @try {
-            primaryKeyField = [fetchRequest.entity SMFieldNameForProperty:[[fetchRequest.entity propertiesByName] objectForKey:[fetchRequest.entity primaryKeyField]]];
-        }
-        @catch (NSException *exception) {
-            primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
-        }
-        
-        // For each result of the fetch
-        NSArray *results = [resultsWithoutOID map:^(id item) {
-            
-            id remoteID = [item objectForKey:primaryKeyField];
-            
-            if (!remoteID) {
-                [NSException raise:SMExceptionIncompatibleObject format:@"No key for supposed primary key field %@ for item %@", primaryKeyField, item];
-            }
-            
-            NSManagedObjectID *sm_managedObjectID = [self newObjectIDForEntity:fetchRequest.entity referenceObject:remoteID];
-            NSManagedObject *sm_managedObject = [context objectWithID:sm_managedObjectID];
-            NSDictionary *serializedObjectDict = [self SM_responseSerializationForDictionary:item schemaEntityDescription:fetchRequest.entity managedObjectContext:context includeRelationships:YES];
-            
-            // If the object is not marked faulted, it exists in memory and its values should be replaced with up-to-date fetched values.
-            if (![sm_managedObject isFault]) {
-                [self SM_populateManagedObject:sm_managedObject withDictionary:serializedObjectDict entity:[sm_managedObject entity]];
-            }
-            
-            // Obtain cache object representation, or create if needed
-            
-            NSManagedObject *cacheManagedObject = [self.localManagedObjectContext objectWithID:[self SM_retrieveCacheObjectForRemoteID:remoteID entityName:[[sm_managedObject entity] name]]];
-            
-            [self SM_populateCacheManagedObject:cacheManagedObject withDictionary:serializedObjectDict entity:fetchRequest.entity];
-            return sm_managedObject;
-            
-        }];
+        // Network fetch was successful, so replace what the cache holds for the same fetch
+        [self SM_purgeCacheResultsForFetchRequest:fetchRequest];
+        [self SM_cacheFetchedEntries:cacheEntries fetchRequest:fetchRequest];
         
         NSError *cacheSaveError = nil;
         [self SM_saveCache:&cacheSaveError];
         if (cacheSaveError) {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Cache save unsuccessful, %@", cacheSaveError) }
+            SMLogWarning(SMLogSubsystemCache, @"Cache save unsuccessful, %@", cacheSaveError);
+        }
+    }
+    
+    return results;
+    
+}
+
+- (void)SM_purgeCacheResultsForFetchRequest:(NSFetchRequest *)fetchRequest
+{
+    // Run same fetch on local cache and delete results
+    NSError *fetchOnCacheError = nil;
+    NSArray *cacheResults = [self.localManagedObjectContext executeFetchRequest:fetchRequest error:&fetchOnCacheError];
+    
+    if (fetchOnCacheError) {
+        SMLogWarning(SMLogSubsystemCache, @"Error fetching from cache, %@", fetchOnCacheError);
+    }
+    
+    if ([cacheResults count] > 0) {
+        BOOL purgeSuccess = [self SM_purgeCacheManagedObjectsFromCache:cacheResults codePath:SMCacheCodePathFetch];
+        if (!purgeSuccess) {
+            SMLogWarning(SMLogSubsystemCache, @"Purge Unsuccessful");
         }
+    }
+}
+
+- (NSString *)SM_primaryKeyFieldForEntity:(NSEntityDescription *)entity
+{
+    // Compiled metadata already accounts for the user schema, which saves raising and catching an exception for user entities
+    SMEntityMetadata *metadata = [SMEntityMetadata metadataForEntity:entity];
+    if (metadata.primaryKeyField) {
+        return metadata.primaryKeyField;
+    }
+    
+    NSString *primaryKeyField = nil;
+    @try {
+        primaryKeyField = [entity primaryKeyField];
+    }
+    @catch (NSException *exception) {
+        primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
+    }
+    return primaryKeyField;
+}
+
+- (NSArray *)SM_managedObjectsForFetchedResults:(NSArray *)fetchedResults fetchRequest:(NSFetchRequest *)fetchRequest primaryKeyField:(NSString *)primaryKeyField context:(NSManagedObjectContext *)context cacheEntries:(NSMutableArray *)cacheEntries
+{
+    // For each result of the fetch
+    return [fetchedResults map:^(id item) {
         
-        return results;
+        id remoteID = [item objectForKey:primaryKeyField];
         
-    } else {
+        if (!remoteID) {
+            [NSException raise:SMExceptionIncompatibleObject format:@"No key for supposed primary key field %@ for item %@", primaryKeyField, item];
+        }
         
-        // Obtain the primary key for the entity
-        __block NSString *primaryKeyField = nil;
+        NSManagedObjectID *sm_managedObjectID = [self newObjectIDForEntity:fetchRequest.entity referenceObject:remoteID];
+        NSManagedObject *sm_managedObject = [context objectWithID:sm_managedObjectID];
+        NSDictionary *serializedObjectDict = [self SM_responseSerializationForDictionary:item schemaEntityDescription:fetchRequest.entity managedObjectContext:context includeRelationships:YES];
         
-        @try {
-            primaryKeyField = [fetchRequest.entity SMFieldNameForProperty:[[fetchRequest.entity propertiesByName] objectForKey:[fetchRequest.entity primaryKeyField]]];
-        }
-        @catch (NSException *exception) {
-            primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
+        // If the object is not marked faulted, it exists in memory and its values should be replaced with up-to-date fetched values.
+        if (![sm_managedObject isFault]) {
+            [self SM_populateManagedObject:sm_managedObject withDictionary:serializedObjectDict entity:[sm_managedObject entity]];
         }
         
-        // For each result of the fetch
-        NSArray *results = [resultsWithoutOID map:^(id item) {
-            
-            id remoteID = [item objectForKey:primaryKeyField];
-            
-            if (!remoteID) {
-                [NSException raise:SMExceptionIncompatibleObject format:@"No key for supposed primary key field %@ for item %@", primaryKeyField, item];
-            }
-            
-            NSManagedObjectID *sm_managedObjectID = [self newObjectIDForEntity:fetchRequest.entity referenceObject:remoteID];
-            NSManagedObject *sm_managedObject = [context objectWithID:sm_managedObjectID];
-            NSDictionary *serializedObjectDict = [self SM_responseSerializationForDictionary:item schemaEntityDescription:fetchRequest.entity managedObjectContext:context includeRelationships:YES];
-            
-            // If the object is not marked faulted, it exists in memory and its values should be replaced with up-to-date fetched values.
-            if (![sm_managedObject isFault]) {
-                [self SM_populateManagedObject:sm_managedObject withDictionary:serializedObjectDict entity:[sm_managedObject entity]];
-            }
-            
-            return sm_managedObject;
-            
-        }];
+        [cacheEntries addObject:[NSDictionary dictionaryWithObjectsAndKeys:remoteID, @"remoteID", [[sm_managedObject entity] name], @"entityName", serializedObjectDict, @"values", nil]];
+        
+        return sm_managedObject;
         
-        return results;
+    }];
+}
 
-    }
-    
+- (void)SM_cacheFetchedEntries:(NSArray *)cacheEntries fetchRequest:(NSFetchRequest *)fetchRequest
+{
+    [cacheEntries enumerateObjectsUsingBlock:^(id entry, NSUInteger idx, BOOL *stop) {
+        // Obtain cache object representation, or create if needed
+        NSManagedObject *cacheManagedObject = [self.localManagedObjectContext objectWithID:[self SM_retrieveCacheObjectForRemoteID:[entry objectForKey:@"remoteID"] entityName:[entry objectForKey:@"entityName"]]];
+        
+        [self SM_populateCacheManagedObject:cacheManagedObject withDictionary:[entry objectForKey:@"values"] entity:fetchRequest.entity];
+    }];
 }
 
 - (id)SM_fetchObjectsFromCache:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError * __autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block NSArray *localCacheResults = nil;
     __block NSError *localCacheError = nil;
@@ -996,13 +1097,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         return nil;
     }
     
-    NSString *primaryKeyField = nil;
-    @try {
-        primaryKeyField = [fetchRequest.entity primaryKeyField];
-    }
-    @catch (NSException *exception) {
-        primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
-    }
+    NSString *primaryKeyField = [self SM_primaryKeyFieldForEntity:fetchRequest.entity];
     
     NSArray *results = [localCacheResults map:^id(id item) {
         id remoteID = [item valueForKey:primaryKeyField];
@@ -1017,6 +1112,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         return sm_managedObject;
     }];
     
+    [self SM_recordCacheEvent:[results count] > 0 ? SMCacheEventHit : SMCacheEventMiss entityName:[[fetchRequest entity] name] codePath:SMCacheCodePathFetch];
+    
     return results;
     
 }
@@ -1024,29 +1121,29 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 // Returns NSArray<NSManagedObject>
 - (id)SM_fetchObjects:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError * __autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     
     if (SM_CACHE_ENABLED) {
         id resultsToReturn = nil;
         NSError *tempError = nil;
         switch ([self.coreDataStore cachePolicy]) {
             case SMCachePolicyTryNetworkOnly:
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch switch: SMCachePolicyTryNetworkOnly") }
+                SMLogDebug(SMLogSubsystemCoreData, @"Fetch switch: SMCachePolicyTryNetworkOnly");
                 resultsToReturn = [self SM_fetchObjectsFromNetwork:fetchRequest withContext:context error:error];
                 break;
             case SMCachePolicyTryCacheOnly:
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch switch: SMCachePolicyTryCacheOnly") }
+                SMLogDebug(SMLogSubsystemCoreData, @"Fetch switch: SMCachePolicyTryCacheOnly");
                 resultsToReturn = [self SM_fetchObjectsFromCache:fetchRequest withContext:context error:error];
                 break;
             case SMCachePolicyTryNetworkElseCache:
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch switch: SMCachePolicyTryNetworkElseCache") }
+                SMLogDebug(SMLogSubsystemCoreData, @"Fetch switch: SMCachePolicyTryNetworkElseCache");
                 resultsToReturn = [self SM_fetchObjectsFromNetwork:fetchRequest withContext:context error:&tempError];
                 if (tempError && [tempError code] == SMErrorNetworkNotReachable) {
                     resultsToReturn = [self SM_fetchObjectsFromCache:fetchRequest withContext:context error:error];
                 }
                 break;
             case SMCachePolicyTryCacheElseNetwork:
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch switch: SMCachePolicyTryCacheElseNetwork") }
+                SMLogDebug(SMLogSubsystemCoreData, @"Fetch switch: SMCachePolicyTryCacheElseNetwork");
                 resultsToReturn = [self SM_fetchObjectsFromCache:fetchRequest withContext:context error:error];
                 if (*error) {
                     return nil;
@@ -1056,7 +1153,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 }
                 break;
             default:
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch switch: default") }
+                SMLogWarning(SMLogSubsystemCoreData, @"Fetch switch: default");
                 if (error != NULL) {
                     NSError *errorToReturn = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorRefreshTokenFailed userInfo:nil];
                     *error = (__bridge id)(__bridge_retained CFTypeRef)errorToReturn;
@@ -1064,7 +1161,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 break;
         }
         
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Fetch results to return are %@ with error %@", resultsToReturn, *error) }
+        SMLogDebug(SMLogSubsystemCoreData, @"Fetch results to return are %@ with error %@", resultsToReturn, *error);
         return resultsToReturn;
     } else {
         id resultsToReturn = nil;
@@ -1075,7 +1172,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 // Returns NSArray<NSManagedObjectID>
 - (id)SM_fetchObjectIDs:(NSFetchRequest *)fetchRequest withContext:(NSManagedObjectContext *)context error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog() }
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSFetchRequest *fetchCopy = [fetchRequest copy];
     
@@ -1117,7 +1214,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                                          withContext:(NSManagedObjectContext *)context
                                                error:(NSError *__autoreleasing *)error {
     
-    if (SM_CORE_DATA_DEBUG) { DLog(@"new values for object with id %@", [context objectWithID:objectID]) }
+    SMLogDebug(SMLogSubsystemCoreData, @"new values for object with id %@", [context objectWithID:objectID]);
     
     __block NSManagedObject *sm_managedObject = [context objectWithID:objectID];
     __block NSString *sm_managedObjectReferenceID = [self referenceObjectForObjectID:objectID];
@@ -1130,6 +1227,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
             if (!cacheObjectID) {
                 // Scenario: Got here because object was refreshed and is now a fault, but was never cached in the first place.  Grab from the server if possible.
+                [self SM_recordCacheEvent:SMCacheEventMiss entityName:[[sm_managedObject entity] name] codePath:SMCacheCodePathObjectValues];
                 
                 NSDictionary *serializedObjectDict = [self SM_retrieveAndSerializeObjectWithID:sm_managedObjectReferenceID entity:[sm_managedObject entity] options:[SMRequestOptions options] context:context includeRelationships:NO cacheResult:!self.isSaving error:error];
                 
@@ -1156,13 +1254,14 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 primaryKeyField = [sm_managedObject primaryKeyField];
             }
             @catch (NSException *exception) {
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Could not find primary key field for managed object, checking whether user object") }
+                SMLogDebug(SMLogSubsystemCoreData, @"Could not find primary key field for managed object, checking whether user object");
                 if ([sm_managedObject isKindOfClass:[SMUserManagedObject class]]) {
                     primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
                 }
             }
             
             if (![objectFromCache valueForKey:primaryKeyField]) {
+                [self SM_recordCacheEvent:SMCacheEventReferenceOnlyFetch entityName:[[sm_managedObject entity] name] codePath:SMCacheCodePathObjectValues];
                 
                 NSDictionary *serializedObjectDict = [self SM_retrieveAndSerializeObjectWithID:sm_managedObjectReferenceID entity:[sm_managedObject entity] options:[SMRequestOptions options] context:context includeRelationships:NO cacheResult:YES error:error];
                 
@@ -1176,6 +1275,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 
             }
             
+            [self SM_recordCacheEvent:SMCacheEventHit entityName:[[sm_managedObject entity] name] codePath:SMCacheCodePathObjectValues];
+            
             // Create dictionary of keys and values for incremental store node
             NSMutableDictionary *dictionaryRepresentationOfCacheObject = [NSMutableDictionary dictionary];
             
@@ -1269,7 +1370,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
               forObjectWithID:(NSManagedObjectID *)objectID
                   withContext:(NSManagedObjectContext *)context
                         error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     id result = nil;
     @try {
@@ -1294,7 +1395,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                  forObjectWithID:(NSManagedObjectID *)objectID
                      withContext:(NSManagedObjectContext *)context
                            error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog(@"new value for relationship %@ for object with id %@", relationship, objectID) }
+    SMLogDebug(SMLogSubsystemCoreData, @"new value for relationship %@ for object with id %@", relationship, objectID);
     
     __block NSManagedObject *sm_managedObject = [context objectWithID:objectID];
     __block NSString *sm_managedObjectReferenceID = [self referenceObjectForObjectID:objectID];
@@ -1306,8 +1407,10 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             // Retreive parent object from cache
             NSString *cacheMapReferenceID = [self.cacheMappingTable objectForKey:sm_managedObjectReferenceID];
             NSManagedObjectID *cacheObjectID = [[self localPersistentStoreCoordinator] managedObjectIDForURIRepresentation:[NSURL URLWithString:cacheMapReferenceID]];
+            NSString *sourceEntityName = [[sm_managedObject entity] name];
             
             if (!cacheObjectID) {
+                [self SM_recordCacheEvent:SMCacheEventMiss entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                 if (NULL != error) {
                     *error = [[NSError alloc] initWithDomain:SMErrorDomain code:SMErrorCacheIDNotFound userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"No cache ID was found for the provided object ID: %@", objectID], NSLocalizedDescriptionKey, nil]];
                     *error = (__bridge id)(__bridge_retained CFTypeRef)*error;
@@ -1318,19 +1421,15 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             NSManagedObject *objectFromCache = [self.localManagedObjectContext objectWithID:cacheObjectID];
             
             // Get primary key field of relationship
-            NSString *primaryKeyField = nil;
-            @try {
-                primaryKeyField = [[relationship destinationEntity] primaryKeyField];
-            }
-            @catch (NSException *exception) {
-                primaryKeyField = [self.coreDataStore.session userPrimaryKeyField];
-            }
+            NSString *primaryKeyField = [self SM_primaryKeyFieldForEntity:[relationship destinationEntity]];
             
             if ([relationship isToMany]) {
                 // to-many: pull related object set from cache
                 // value should be the cache object reference for the related object, if the relationship value is not nil
                 NSArray *relatedObjectCacheReferenceSet = [[objectFromCache valueForKey:[relationship name]] allObjects];
                 if ([relatedObjectCacheReferenceSet count] == 0) {
+                    [self SM_recordCacheEvent:SMCacheEventHit entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromCache entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                     return [NSArray array];
                 }
                 __block NSMutableArray *arrayToReturn = [NSMutableArray array];
@@ -1355,9 +1454,14 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 }];
                 
                 if (shouldRetreiveFromNetwork) {
+                    [self SM_recordCacheEvent:SMCacheEventReferenceOnlyFetch entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromNetwork entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                     [arrayToReturn removeAllObjects];
                     id resultToReturn =  [self SM_retrieveAndCacheRelatedObjectForRelationship:relationship parentObject:sm_managedObject referenceID:sm_managedObjectReferenceID context:context error:error];
                     arrayToReturn = resultToReturn;
+                } else {
+                    [self SM_recordCacheEvent:SMCacheEventHit entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromCache entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                 }
                 
                 return arrayToReturn;
@@ -1367,6 +1471,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                 // value should be the cache object reference for the related object, if the relationship value is not nil
                 NSManagedObject *relatedObjectCacheReferenceObject = [objectFromCache valueForKey:[relationship name]];
                 if (!relatedObjectCacheReferenceObject) {
+                    [self SM_recordCacheEvent:SMCacheEventHit entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromCache entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                     return [NSNull null];
                 } else {
                     // get remoteID for object in context
@@ -1374,11 +1480,16 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
                     
                     // If there is no primary key id, this was just a reference and we need to retreive online, if possible
                     if (!relatedObjectRemoteID) {
+                        [self SM_recordCacheEvent:SMCacheEventReferenceOnlyFetch entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                        [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromNetwork entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
                         // Retreive object from server
                         id resultToReturn =  [self SM_retrieveAndCacheRelatedObjectForRelationship:relationship parentObject:sm_managedObject referenceID:sm_managedObjectReferenceID context:context error:error];
                         return resultToReturn;
                     }
                     
+                    [self SM_recordCacheEvent:SMCacheEventHit entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromCache entityName:sourceEntityName codePath:SMCacheCodePathRelationship];
+                    
                     // Use primary key id to create in-memory context managed object ID equivalent
                     NSManagedObjectID *sm_managedObjectID = [self newObjectIDForEntity:[relationship destinationEntity] referenceObject:relatedObjectRemoteID];
                     
@@ -1401,6 +1512,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             }
         } else {
             // Retreive object from server
+            [self SM_recordCacheEvent:SMCacheEventRelationshipFaultFromNetwork entityName:[[sm_managedObject entity] name] codePath:SMCacheCodePathRelationship];
             result = [self SM_retrieveRelatedObjectForRelationship:relationship parentObject:sm_managedObject referenceID:sm_managedObjectReferenceID context:context error:error];
         }
         
@@ -1423,14 +1535,14 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
  */
 - (NSArray *)obtainPermanentIDsForObjects:(NSArray *)array
                                     error:(NSError *__autoreleasing *)error {
-    if (SM_CORE_DATA_DEBUG) { DLog(@"obtain permanent ids for objects: %@", truncateOutputIfExceedsMaxLogLength(array)) }
+    SMLogDebug(SMLogSubsystemCoreData, @"obtain permanent ids for objects: %@", array);
     // check if array is null, return empty array if so
     if (array == nil) {
         return [NSArray array];
     }
     
     if (*error) {
-        if (SM_CORE_DATA_DEBUG) { DLog(@"error with obtaining perm ids is %@", *error) }
+        SMLogWarning(SMLogSubsystemCoreData, @"error with obtaining perm ids is %@", *error);
         *error = (__bridge id)(__bridge_retained CFTypeRef)*error;
     }
     
@@ -1441,7 +1553,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         }
         
         NSManagedObjectID *returnId = [self newObjectIDForEntity:[item entity] referenceObject:itemId];
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Permanent ID assigned is %@", returnId) }
+        SMLogDebug(SMLogSubsystemCoreData, @"Permanent ID assigned is %@", returnId);
         
         return returnId;
     }];
@@ -1453,13 +1565,13 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_configureCache
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     _localManagedObjectModel = self.localManagedObjectModel;
     _localManagedObjectContext = self.localManagedObjectContext;
     _localPersistentStoreCoordinator = self.localPersistentStoreCoordinator;
     [self SM_readCacheMap];
-    if (SM_CORE_DATA_DEBUG) {DLog(@"STACKMOB SYSTEM UPDATE: Cache initialized and ready to go.")}
+    SMLogInfo(SMLogSubsystemCache, @"STACKMOB SYSTEM UPDATE: Cache initialized and ready to go.");
     
 }
 
@@ -1509,7 +1621,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (NSURL *)SM_getStoreURLForCacheDatabase
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSString *applicationName = [[[NSBundle mainBundle] infoDictionary] valueForKey:(NSString *)kCFBundleNameKey];
     NSString *applicationDocumentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
@@ -1544,7 +1656,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (NSURL *)SM_getStoreURLForCacheMapTable
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSString *applicationName = [[[NSBundle mainBundle] infoDictionary] valueForKey:(NSString *)kCFBundleNameKey];
     NSString *applicationDocumentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
@@ -1578,7 +1690,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_createStoreURLPathIfNeeded:(NSURL *)storeURL
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSFileManager *fileManager = [NSFileManager defaultManager];
     NSURL *pathToStore = [storeURL URLByDeletingLastPathComponent];
@@ -1609,7 +1721,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_readCacheMap
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSString *errorDesc = nil;
     NSPropertyListFormat format;
@@ -1637,7 +1749,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_saveCacheMap
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSString *errorDesc = nil;
     NSError *error = nil;
@@ -1664,7 +1776,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (NSDictionary *)SM_retrieveAndSerializeObjectWithID:(NSString *)objectID entity:(NSEntityDescription *)entity options:(SMRequestOptions *)options context:(NSManagedObjectContext *)context includeRelationships:(BOOL)includeRelationships cacheResult:(BOOL)cacheResult error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSDictionary *serializedObjectDictionary = nil;
     NSDictionary *objectFromServer = [self SM_retrieveObjectWithID:objectID entity:entity options:options context:context error:error];
@@ -1685,7 +1797,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (NSDictionary *)SM_retrieveObjectWithID:(NSString *)objectID entity:(NSEntityDescription *)entity options:(SMRequestOptions *)options context:(NSManagedObjectContext *)context error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block NSEntityDescription *sm_managedObjectEntity = entity;
     __block NSString *schemaName = [[sm_managedObjectEntity name] lowercaseString];
@@ -1703,7 +1815,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         readSuccess = YES;
         dispatch_group_leave(group);
     } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Could not read the object with objectId %@ and error userInfo %@", theObjectId, [theError userInfo]) }
+        SMLogWarning(SMLogSubsystemCoreData, @"Could not read the object with objectId %@ and error userInfo %@", theObjectId, [theError userInfo]);
         readSuccess = NO;
         blockError = theError;
         dispatch_group_leave(group);
@@ -1728,7 +1840,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (id)SM_retrieveRelatedObjectForRelationship:(NSRelationshipDescription *)relationship parentObject:(NSManagedObject *)parentObject referenceID:(NSString *)referenceID context:(NSManagedObjectContext *)context error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block NSEntityDescription *sm_managedObjectEntity = [parentObject entity];
     // No expansion,
@@ -1769,7 +1881,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (id)SM_retrieveAndCacheRelatedObjectForRelationship:(NSRelationshipDescription *)relationship parentObject:(NSManagedObject *)parentObject referenceID:(NSString *)referenceID context:(NSManagedObjectContext *)context error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block NSEntityDescription *sm_managedObjectEntity = [parentObject entity];
     __block NSDictionary *objectDictionaryFromRead = nil;
@@ -1794,7 +1906,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         [relationshipContentsFromCache enumerateObjectsUsingBlock:^(id obj, BOOL *stop) {
             [cacheObjectsToBePurged addObject:obj];
         }];
-        [self SM_purgeCacheManagedObjectsFromCache:cacheObjectsToBePurged];
+        [self SM_purgeCacheManagedObjectsFromCache:cacheObjectsToBePurged codePath:SMCacheCodePathRelationship];
         __block NSMutableSet *newRelationshipContents = [cacheParentObject mutableSetValueForKey:[relationship name]];
         [newRelationshipContents removeAllObjects];
         
@@ -1828,7 +1940,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         NSManagedObject *relationshipContentsFromCache = [cacheParentObject valueForKey:[relationship name]];
         if (relationshipContentsFromCache) {
-            [self SM_purgeCacheManagedObjectFromCache:relationshipContentsFromCache];
+            [self SM_purgeCacheManagedObjectFromCache:relationshipContentsFromCache codePath:SMCacheCodePathRelationship];
         }
         
         if (relationshipContents) {
@@ -1856,7 +1968,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_cacheObjectWithID:(NSString *)objectID values:(NSDictionary *)values entity:(NSEntityDescription *)entity context:(NSManagedObjectContext *)context
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Get cached managed object or create if needed
     NSManagedObject *cacheManagedObject = [self.localManagedObjectContext objectWithID:[self SM_retrieveCacheObjectForRemoteID:objectID entityName:[entity name]]];
@@ -1870,7 +1982,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_populateManagedObject:(NSManagedObject *)object withDictionary:(NSDictionary *)dictionary entity:(NSEntityDescription *)entity
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Enumerate through properties and set internal storage
     [dictionary enumerateKeysAndObjectsUsingBlock:^(id propertyName, id propertyValue, BOOL *stop) {
@@ -1904,7 +2016,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (void)SM_populateCacheManagedObject:(NSManagedObject *)object withDictionary:(NSDictionary *)dictionary entity:(NSEntityDescription *)entity
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     [[entity propertiesByName] enumerateKeysAndObjectsUsingBlock:^(id propertyName, id property, BOOL *stop) {
         id propertyValueFromSerializedDict = [dictionary objectForKey:propertyName];
@@ -1939,12 +2051,12 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     NSError *saveError = nil;
     BOOL saveSuccess = [self SM_saveCache:&saveError];
     if (!saveSuccess) {
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Did Not Save Cache") }
+        SMLogWarning(SMLogSubsystemCache, @"Did Not Save Cache");
     }
 }
 /*
  - (NSManagedObjectID *)SM_retrieveCacheObjectForRemoteID:(NSString *)remoteID entityName:(NSString *)entityName {
- if (SM_CORE_DATA_DEBUG) {DLog()}
+ SMLogEnter(SMLogSubsystemCoreData);
  
  NSManagedObject *cacheObject = nil;
  NSString *cacheReferenceId = [self.cacheMappingTable objectForKey:remoteID];
@@ -1964,7 +2076,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
  [self SM_saveCacheMap];
  NSError *saveError = nil;
  [self SM_saveCache:&saveError];
- if (SM_CORE_DATA_DEBUG) { DLog(@"Creating new cache object, %@", cacheObject) }
+ SMLogDebug(SMLogSubsystemCache, @"Creating new cache object, %@", cacheObject);
  }
  
  return [cacheObject objectID];
@@ -1972,7 +2084,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
  */
 
 - (NSManagedObjectID *)SM_retrieveCacheObjectForRemoteID:(NSString *)remoteID entityName:(NSString *)entityName {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSManagedObject *cacheObject = nil;
     NSString *cacheReferenceId = [self.cacheMappingTable objectForKey:remoteID];
@@ -1992,12 +2104,12 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         NSError *fetchError = nil;
         NSArray *results = [self.localManagedObjectContext executeFetchRequest:fetchRequest error:&fetchError];
-        NSLog(@"results are %@", results);
         if ([results count] == 0) {
             // delete object we are replacing
             NSManagedObjectID *cacheObjectId = [[self localPersistentStoreCoordinator] managedObjectIDForURIRepresentation:[NSURL URLWithString:cacheReferenceId]];
             NSManagedObject *objectToDelete = [self.localManagedObjectContext objectWithID:cacheObjectId];
-            [self SM_purgeCacheManagedObjectFromCache:objectToDelete];
+            // The mapped row no longer matches its primary key, so whichever path is writing to the cache replaces it
+            [self SM_purgeCacheManagedObjectFromCache:objectToDelete codePath:nil];
             // remove from cache map
             [self.cacheMappingTable removeObjectForKey:remoteID];
             
@@ -2012,7 +2124,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
             [self.cacheMappingTable setObject:[[[cacheObject objectID] URIRepresentation] absoluteString] forKey:remoteID];
             [self SM_saveCacheMap];
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Creating new cache object, %@", cacheObject) }
+            SMLogDebug(SMLogSubsystemCache, @"Creating new cache object, %@", cacheObject);
         } else {
             return [[results objectAtIndex:0] objectID];
         }
@@ -2027,13 +2139,13 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         [self.cacheMappingTable setObject:[[[cacheObject objectID] URIRepresentation] absoluteString] forKey:remoteID];
         [self SM_saveCacheMap];
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Creating new cache object, %@", cacheObject) }
+        SMLogDebug(SMLogSubsystemCache, @"Creating new cache object, %@", cacheObject);
     }
     
     NSError *saveError = nil;
     BOOL saveSuccess = [self SM_saveCache:&saveError];
     if (!saveSuccess) {
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Did Not Save Cache") }
+        SMLogWarning(SMLogSubsystemCache, @"Did Not Save Cache");
     }
     return [cacheObject objectID];
 }
@@ -2041,25 +2153,42 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 
 - (BOOL)SM_saveCache:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     // Save Cache if has changes
     if ([self.localManagedObjectContext hasChanges]) {
         __block BOOL localCacheSaveSuccess;
+        __block NSMutableSet *changedEntityNames = [NSMutableSet set];
+        SMTraceSpan *traceSpan = [[SMTracer sharedTracer] beginSpanWithName:@"saveCache" category:@"cache"];
         [self.localManagedObjectContext performBlockAndWait:^{
+            for (NSSet *changedObjects in [NSArray arrayWithObjects:[self.localManagedObjectContext insertedObjects], [self.localManagedObjectContext updatedObjects], [self.localManagedObjectContext deletedObjects], nil]) {
+                for (NSManagedObject *object in changedObjects) {
+                    [changedEntityNames addObject:[[object entity] name]];
+                }
+            }
             localCacheSaveSuccess = [self.localManagedObjectContext save:error];
         }];
+        [traceSpan setArgument:[NSNumber numberWithUnsignedInteger:[changedEntityNames count]] forKey:@"entity_count"];
+        [traceSpan end];
         if (!localCacheSaveSuccess) {
             if (NULL != error) {
                 *error = (__bridge id)(__bridge_retained CFTypeRef)*error;
             }
             return NO;
         }
+        for (NSString *entityName in changedEntityNames) {
+            [self SM_recordCacheEvent:SMCacheEventSave entityName:entityName codePath:nil];
+        }
     }
     
     return YES;
 }
 
+- (void)SM_recordCacheEvent:(SMCacheEvent)event entityName:(NSString *)entityName codePath:(NSString *)codePath
+{
+    [self.coreDataStore.cacheStatistics recordEvent:event entityName:entityName codePath:codePath];
+}
+
 #pragma mark - Purging the Cache
 
 - (void)SM_didRecievePurgeObjectFromCacheNotification:(NSNotification *)notification
@@ -2070,7 +2199,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     if ([[objectID persistentStore] class] == [SMIncrementalStore class]) {
         NSString *objectIDReference = [(SMIncrementalStore *)[objectID persistentStore] referenceObjectForObjectID:objectID];
         NSError *purgeError = nil;
-        [self SM_purgeObjectFromCacheWithStackMobID:objectIDReference error:&purgeError];
+        [self SM_purgeObjectFromCacheWithStackMobID:objectIDReference codePath:SMCacheCodePathPurgeRequest error:&purgeError];
     }
 }
 
@@ -2092,7 +2221,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         }
     }];
     
-    [self SM_purgeCacheManagedObjectsFromCache:cacheObjectsToPurge];
+    [self SM_purgeCacheManagedObjectsFromCache:cacheObjectsToPurge codePath:SMCacheCodePathPurgeRequest];
     
     
 }
@@ -2104,7 +2233,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     NSError *error = nil;
     NSArray *results = [self.localManagedObjectContext executeFetchRequest:request error:&error];
     if (!error) {
-        [self SM_purgeCacheManagedObjectsFromCache:results];
+        [self SM_purgeCacheManagedObjectsFromCache:results codePath:SMCacheCodePathPurgeRequest];
     }
 }
 
@@ -2124,9 +2253,9 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     _localManagedObjectContext = self.localManagedObjectContext;
 }
 
-- (BOOL)SM_purgeCacheManagedObjectFromCache:(NSManagedObject *)object
+- (BOOL)SM_purgeCacheManagedObjectFromCache:(NSManagedObject *)object codePath:(NSString *)codePath
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     BOOL success = YES;
     
@@ -2136,6 +2265,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     
     // Remove the entry from map table
     if (success) {
+        [self SM_recordCacheEvent:SMCacheEventPurge entityName:[[object entity] name] codePath:codePath];
+        
         // Convert ID to string rep, get StackMob ID key and delete
         NSString *stringRepOfRelationshipCacheID = [[[object objectID] URIRepresentation] absoluteString];
         
@@ -2150,15 +2281,15 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         [self.cacheMappingTable removeObjectForKey:[matchingKeys lastObject]];
         [self SM_saveCacheMap];
     } else {
-        if (SM_CORE_DATA_DEBUG) { DLog(@"Error saving cache: %@", anError) }
+        SMLogWarning(SMLogSubsystemCache, @"Error saving cache: %@", anError);
     }
     
     return success;
 }
 
-- (BOOL)SM_purgeObjectFromCacheWithStackMobID:(NSString *)objectID error:(NSError *__autoreleasing*)error
+- (BOOL)SM_purgeObjectFromCacheWithStackMobID:(NSString *)objectID codePath:(NSString *)codePath error:(NSError *__autoreleasing*)error
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     BOOL success = YES;
     NSString *cacheReferenceIDString = [self.cacheMappingTable objectForKey:objectID];
@@ -2168,7 +2299,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         NSError *anError = nil;
         NSManagedObject *cacheObject = [self.localManagedObjectContext existingObjectWithID:cacheObjectID error:&anError];
         if (anError) {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Did not get cache object with error %@", anError) }
+            SMLogWarning(SMLogSubsystemCache, @"Did not get cache object with error %@", anError);
             success = NO;
             if (error != NULL) {
                 *error = (__bridge id)(__bridge_retained CFTypeRef)anError;
@@ -2181,10 +2312,11 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             
             // Remove the entry from map table
             if (success) {
+                [self SM_recordCacheEvent:SMCacheEventPurge entityName:[[cacheObject entity] name] codePath:codePath];
                 [self.cacheMappingTable removeObjectForKey:objectID];
                 [self SM_saveCacheMap];
             } else {
-                if (SM_CORE_DATA_DEBUG) { DLog(@"Error saving cache: %@", anError) }
+                SMLogWarning(SMLogSubsystemCache, @"Error saving cache: %@", anError);
                 if (error != NULL) {
                     *error = (__bridge id)(__bridge_retained CFTypeRef)anError;
                 }
@@ -2196,9 +2328,9 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 }
 
 
-- (BOOL)SM_purgeCacheManagedObjectsFromCache:(NSArray *)arrayOfManagedObjects
+- (BOOL)SM_purgeCacheManagedObjectsFromCache:(NSArray *)arrayOfManagedObjects codePath:(NSString *)codePath
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block BOOL success = YES;
     
@@ -2213,6 +2345,8 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         if (success) {
             [arrayOfManagedObjects enumerateObjectsUsingBlock:^(id object, NSUInteger idx, BOOL *stop) {
+                [self SM_recordCacheEvent:SMCacheEventPurge entityName:[[object entity] name] codePath:codePath];
+                
                 // Convert ID to string rep, get StackMob ID key and delete
                 NSString *stringRepOfRelationshipCacheID = [[[object objectID] URIRepresentation] absoluteString];
                 
@@ -2227,7 +2361,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             }];
             [self SM_saveCacheMap];
         } else {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Error saving cache: %@", anError) }
+            SMLogWarning(SMLogSubsystemCache, @"Error saving cache: %@", anError);
         }
         
     }
@@ -2236,11 +2370,12 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
     return success;
 }
 
-- (BOOL)SM_purgeObjectsFromCacheByStackMobID:(NSArray *)arrayOfStackMobObjectIDs
+- (BOOL)SM_purgeObjectsFromCacheByStackMobID:(NSArray *)arrayOfStackMobObjectIDs codePath:(NSString *)codePath
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     __block BOOL success = YES;
+    __block NSMutableArray *purgedEntityNames = [NSMutableArray arrayWithCapacity:[arrayOfStackMobObjectIDs count]];
     
     [arrayOfStackMobObjectIDs enumerateObjectsUsingBlock:^(id objectID, NSUInteger idx, BOOL *stop) {
         NSString *cacheReferenceIDString = [self.cacheMappingTable objectForKey:objectID];
@@ -2249,12 +2384,13 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
             NSError *anError = nil;
             NSManagedObject *cacheObject = [self.localManagedObjectContext existingObjectWithID:cacheObjectID error:&anError];
             if (anError) {
-                DLog(@"Did not get cache object with error %@", anError)
+                SMLogWarning(SMLogSubsystemCache, @"Did not get cache object with error %@", anError);
                 success = NO;
                 *stop = YES;
             } else {
                 // delete object from cache
                 [self.localManagedObjectContext deleteObject:cacheObject];
+                [purgedEntityNames addObject:[[cacheObject entity] name]];
             }
         }
     }];
@@ -2265,12 +2401,15 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
         
         // Remove the entry from map table
         if (success) {
+            for (NSString *entityName in purgedEntityNames) {
+                [self SM_recordCacheEvent:SMCacheEventPurge entityName:entityName codePath:codePath];
+            }
             [arrayOfStackMobObjectIDs enumerateObjectsUsingBlock:^(id objectID, NSUInteger idx, BOOL *stop) {
                 [self.cacheMappingTable removeObjectForKey:objectID];
             }];
             [self SM_saveCacheMap];
         } else {
-            if (SM_CORE_DATA_DEBUG) { DLog(@"Error saving cache: %@", anError) }
+            SMLogWarning(SMLogSubsystemCache, @"Error saving cache: %@", anError);
         }
     }
     
@@ -2283,7 +2422,7 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
 ////////////////////////////
 
 - (NSString *)SM_remoteKeyForEntityName:(NSString *)entityName {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     return [[entityName lowercaseString] stringByAppendingString:@"_id"];
 }
@@ -2293,65 +2432,19 @@ NSString* truncateOutputIfExceedsMaxLogLength(id objectToCheck) {
  */
 - (NSDictionary *)SM_responseSerializationForDictionary:(NSDictionary *)theObject schemaEntityDescription:(NSEntityDescription *)entityDescription managedObjectContext:(NSManagedObjectContext *)context includeRelationships:(BOOL)includeRelationships
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
-    
-    __block NSMutableDictionary *serializedDictionary = [NSMutableDictionary dictionary];
-    
-    [entityDescription.attributesByName enumerateKeysAndObjectsUsingBlock:^(id attributeName, id attributeValue, BOOL *stop) {
-        NSAttributeDescription *attributeDescription = (NSAttributeDescription *)attributeValue;
-        if (attributeDescription.attributeType != NSUndefinedAttributeType) {
-            if ([[theObject allKeys] indexOfObject:[entityDescription SMFieldNameForProperty:attributeDescription]] != NSNotFound) {
-                id value = [theObject valueForKey:[entityDescription SMFieldNameForProperty:attributeDescription]];
-                if (value && attributeDescription.attributeType == NSDateAttributeType) {
-                    unsigned long long convertedValue = [value unsignedLongLongValue] / 1000;
-                    NSDate *convertedDate = [NSDate dateWithTimeIntervalSince1970:convertedValue];
-                    [serializedDictionary setObject:convertedDate forKey:attributeName];
-                } else {
-                    [serializedDictionary setObject:value forKey:attributeName];
-                }
-            }
-        }
-    }];
+    SMLogEnter(SMLogSubsystemCoreData);
     
-    [entityDescription.relationshipsByName enumerateKeysAndObjectsUsingBlock:^(id relationshipName, id relationshipValue, BOOL *stop) {
-        NSRelationshipDescription *relationshipDescription = (NSRelationshipDescription *)relationshipValue;
-        // get the relationship contents for the property
-        id relationshipContents = [theObject valueForKey:[entityDescription SMFieldNameForProperty:relationshipDescription]];
-        if (![relationshipDescription isToMany]) {
-            if (relationshipContents) {
-                NSEntityDescription *entityDescriptionForRelationship = [NSEntityDescription entityForName:[[relationshipValue destinationEntity] name] inManagedObjectContext:context];
-                if ([relationshipContents isKindOfClass:[NSString class]]) {
-                    NSManagedObjectID *relationshipObjectID = [self newObjectIDForEntity:entityDescriptionForRelationship referenceObject:relationshipContents];
-                    [serializedDictionary setObject:relationshipObjectID forKey:relationshipName];
-                }
-            } else {
-                [serializedDictionary setObject:[NSNull null] forKey:relationshipName];
-            }
-        } else if (relationshipContents && includeRelationships) {
-            // to many relationship
-            if (![relationshipContents isKindOfClass:[NSArray class]]) {
-                [NSException raise:SMExceptionIncompatibleObject format:@"Relationship contents should be an array for a to-many relationship. The relationship passed has contents that are of class type %@. Confirm that this relationship was meant to be to-many.", [relationshipContents class]];
-            }
-            NSMutableArray *relatedObjects = [NSMutableArray array];
-            [(NSSet *)relationshipContents enumerateObjectsUsingBlock:^(id stringIdReference, BOOL *stopEnumOfRelatedObjects) {
-                NSManagedObjectID *relationshipObjectID = [self newObjectIDForEntity:[relationshipDescription destinationEntity] referenceObject:stringIdReference];
-                [relatedObjects addObject:relationshipObjectID];
-            }];
-            [serializedDictionary setObject:[NSSet setWithArray:relatedObjects] forKey:relationshipName];
-        }
-    }];
+    NSDictionary *serializedDictionary = [[SMResponseDeserializationPlan planForEntity:entityDescription] valuesForObject:theObject includeRelationships:includeRelationships store:self];
     
-    if (SM_CORE_DATA_DEBUG) {
-        DLog(@"read object from server is %@", theObject)
-        DLog(@"serialized dictionary to return is %@", serializedDictionary)
-    }
+    SMLogDebug(SMLogSubsystemCoreData, @"read object from server is %@", theObject);
+    SMLogDebug(SMLogSubsystemCoreData, @"serialized dictionary to return is %@", serializedDictionary);
     
-    return [NSDictionary dictionaryWithDictionary:serializedDictionary];
+    return serializedDictionary;
 }
 
 - (BOOL)SM_addPasswordToSerializedDictionary:(NSDictionary **)originalDictionary originalObject:(SMUserManagedObject *)object
 {
-    if (SM_CORE_DATA_DEBUG) {DLog()}
+    SMLogEnter(SMLogSubsystemCoreData);
     
     NSMutableDictionary *dictionaryToReturn = [*originalDictionary mutableCopy];
     
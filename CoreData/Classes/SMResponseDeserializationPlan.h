@@ -0,0 +1,61 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <CoreData/CoreData.h>
+
+/**
+ `SMResponseDeserializationPlan` turns objects read from StackMob into the attribute and relationship values of one entity.
+ 
+ The plan is worked out once per entity: which field each attribute and relationship is read from, how each attribute's value is converted, and the destination entity of each relationship.  Reading a row is then a single dictionary lookup per property.  Fields which are not properties of the entity, such as `createddate` and `lastmoddate`, are left out.
+ 
+ @note Used internally by <SMIncrementalStore>.  Plans for entities in a registered model are built with their <SMEntityMetadata>.
+ */
+@interface SMResponseDeserializationPlan : NSObject
+
+/**
+ Returns the plan for an entity, from its <SMEntityMetadata> if the entity's model has been registered, otherwise newly built.
+ 
+ @param entity The entity.
+ 
+ @return The plan.
+ */
++ (SMResponseDeserializationPlan *)planForEntity:(NSEntityDescription *)entity;
+
+/**
+ Initialize a plan.
+ 
+ @param entity The entity.
+ @param fieldNames The StackMob field name for every property of the entity, keyed by property name.
+ 
+ @return A new plan.
+ */
+- (id)initWithEntity:(NSEntityDescription *)entity fieldNamesByPropertyName:(NSDictionary *)fieldNames;
+
+/**
+ Reads an object from StackMob.
+ 
+ Dates are converted from milliseconds since 1970, and booleans and numbers given as strings are converted to `NSNumber`.  Related objects are given as managed object IDs from the store; a missing to-one relationship is given as `NSNull`.
+ 
+ @param object The object as read from StackMob.
+ @param includeRelationships Whether to-many relationships are included.
+ @param store The store which provides managed object IDs for related objects.
+ 
+ @return The values, keyed by property name.
+ */
+- (NSDictionary *)valuesForObject:(NSDictionary *)object includeRelationships:(BOOL)includeRelationships store:(NSIncrementalStore *)store;
+
+@end
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMResponseDeserializationPlan.h"
+#import "SMEntityMetadata.h"
+#import "SMError.h"
+#import "NSEntityDescription+StackMobSerialization.h"
+
+typedef enum {
+    SMValueConversionNone = 0,
+    SMValueConversionDate,
+    SMValueConversionBoolean,
+    SMValueConversionInteger,
+    SMValueConversionDecimal,
+    SMValueConversionDouble,
+} SMValueConversion;
+
+/*
+ One attribute or relationship, and where its value comes from.
+ */
+@interface SMDeserializationStep : NSObject
+
+@property (nonatomic, copy) NSString *propertyName;
+@property (nonatomic, copy) NSString *fieldName;
+@property (nonatomic) SMValueConversion conversion;
+@property (nonatomic, strong) NSEntityDescription *destinationEntity;
+@property (nonatomic) BOOL toMany;
+
+@end
+
+@implementation SMDeserializationStep
+
+@synthesize propertyName = _SM_propertyName;
+@synthesize fieldName = _SM_fieldName;
+@synthesize conversion = _SM_conversion;
+@synthesize destinationEntity = _SM_destinationEntity;
+@synthesize toMany = _SM_toMany;
+
+@end
+
+static id SMConvertedValue(id value, SMValueConversion conversion)
+{
+    switch (conversion) {
+        case SMValueConversionDate:
+            if ([value respondsToSelector:@selector(unsignedLongLongValue)]) {
+                // Whole seconds, as StackMob's millisecond timestamps always have been read
+                return [NSDate dateWithTimeIntervalSince1970:[value unsignedLongLongValue] / 1000];
+            }
+            return value;
+        case SMValueConversionBoolean:
+            if ([value isKindOfClass:[NSString class]]) {
+                return [NSNumber numberWithBool:[value boolValue]];
+            }
+            return value;
+        case SMValueConversionInteger:
+            if ([value isKindOfClass:[NSString class]]) {
+                return [NSNumber numberWithLongLong:[value longLongValue]];
+            }
+            return value;
+        case SMValueConversionDecimal:
+            if ([value isKindOfClass:[NSString class]]) {
+                return [NSDecimalNumber decimalNumberWithString:value];
+            }
+            return value;
+        case SMValueConversionDouble:
+            if ([value isKindOfClass:[NSString class]]) {
+                return [NSNumber numberWithDouble:[value doubleValue]];
+            }
+            return value;
+        default:
+            return value;
+    }
+}
+
+@interface SMResponseDeserializationPlan ()
+
+@property (nonatomic, strong) NSArray *attributeSteps;
+@property (nonatomic, strong) NSArray *relationshipSteps;
+@property (nonatomic) NSUInteger capacity;
+
+@end
+
+@implementation SMResponseDeserializationPlan
+
+@synthesize attributeSteps = _SM_attributeSteps;
+@synthesize relationshipSteps = _SM_relationshipSteps;
+@synthesize capacity = _SM_capacity;
+
++ (SMResponseDeserializationPlan *)planForEntity:(NSEntityDescription *)entity
+{
+    SMResponseDeserializationPlan *plan = [[SMEntityMetadata metadataForEntity:entity] responseDeserializationPlan];
+    if (plan) {
+        return plan;
+    }
+    
+    NSMutableDictionary *fieldNames = [NSMutableDictionary dictionary];
+    [[entity propertiesByName] enumerateKeysAndObjectsUsingBlock:^(id propertyName, id property, BOOL *stop) {
+        NSString *fieldName = [entity SMFieldNameForProperty:property];
+        if (fieldName) {
+            [fieldNames setObject:fieldName forKey:propertyName];
+        }
+    }];
+    return [[SMResponseDeserializationPlan alloc] initWithEntity:entity fieldNamesByPropertyName:fieldNames];
+}
+
+- (id)initWithEntity:(NSEntityDescription *)entity fieldNamesByPropertyName:(NSDictionary *)fieldNames
+{
+    self = [super init];
+    if (self) {
+        NSMutableArray *attributeSteps = [NSMutableArray array];
+        [[entity attributesByName] enumerateKeysAndObjectsUsingBlock:^(id attributeName, id attribute, BOOL *stop) {
+            NSAttributeType attributeType = [(NSAttributeDescription *)attribute attributeType];
+            NSString *fieldName = [fieldNames objectForKey:attributeName];
+            if (attributeType == NSUndefinedAttributeType || fieldName == nil) {
+                return;
+            }
+            
+            SMDeserializationStep *step = [[SMDeserializationStep alloc] init];
+            step.propertyName = attributeName;
+            step.fieldName = fieldName;
+            switch (attributeType) {
+                case NSDateAttributeType:
+                    step.conversion = SMValueConversionDate;
+                    break;
+                case NSBooleanAttributeType:
+                    step.conversion = SMValueConversionBoolean;
+                    break;
+                case NSInteger16AttributeType:
+                case NSInteger32AttributeType:
+                case NSInteger64AttributeType:
+                    step.conversion = SMValueConversionInteger;
+                    break;
+                case NSDecimalAttributeType:
+                    step.conversion = SMValueConversionDecimal;
+                    break;
+                case NSDoubleAttributeType:
+                case NSFloatAttributeType:
+                    step.conversion = SMValueConversionDouble;
+                    break;
+                default:
+                    step.conversion = SMValueConversionNone;
+                    break;
+            }
+            [attributeSteps addObject:step];
+        }];
+        
+        NSMutableArray *relationshipSteps = [NSMutableArray array];
+        [[entity relationshipsByName] enumerateKeysAndObjectsUsingBlock:^(id relationshipName, id relationship, BOOL *stop) {
+            NSString *fieldName = [fieldNames objectForKey:relationshipName];
+            if (fieldName == nil) {
+                return;
+            }
+            
+            SMDeserializationStep *step = [[SMDeserializationStep alloc] init];
+            step.propertyName = relationshipName;
+            step.fieldName = fieldName;
+            step.destinationEntity = [(NSRelationshipDescription *)relationship destinationEntity];
+            step.toMany = [(NSRelationshipDescription *)relationship isToMany];
+            [relationshipSteps addObject:step];
+        }];
+        
+        self.attributeSteps = attributeSteps;
+        self.relationshipSteps = relationshipSteps;
+        self.capacity = [attributeSteps count] + [relationshipSteps count];
+    }
+    return self;
+}
+
+- (NSDictionary *)valuesForObject:(NSDictionary *)object includeRelationships:(BOOL)includeRelationships store:(NSIncrementalStore *)store
+{
+    NSMutableDictionary *values = [NSMutableDictionary dictionaryWithCapacity:self.capacity];
+    
+    for (SMDeserializationStep *step in self.attributeSteps) {
+        id value = [object objectForKey:step.fieldName];
+        if (value) {
+            [values setObject:SMConvertedValue(value, step.conversion) forKey:step.propertyName];
+        }
+    }
+    
+    for (SMDeserializationStep *step in self.relationshipSteps) {
+        id relationshipContents = [object objectForKey:step.fieldName];
+        if (!step.toMany) {
+            if (relationshipContents == nil) {
+                [values setObject:[NSNull null] forKey:step.propertyName];
+            } else if ([relationshipContents isKindOfClass:[NSString class]]) {
+                [values setObject:[store newObjectIDForEntity:step.destinationEntity referenceObject:relationshipContents] forKey:step.propertyName];
+            }
+        } else if (relationshipContents && includeRelationships) {
+            if (![relationshipContents isKindOfClass:[NSArray class]]) {
+                [NSException raise:SMExceptionIncompatibleObject format:@"Relationship contents should be an array for a to-many relationship. The relationship passed has contents that are of class type %@. Confirm that this relationship was meant to be to-many.", [relationshipContents class]];
+            }
+            NSMutableSet *relatedObjectIDs = [NSMutableSet setWithCapacity:[relationshipContents count]];
+            for (id referenceObject in relationshipContents) {
+                [relatedObjectIDs addObject:[store newObjectIDForEntity:step.destinationEntity referenceObject:referenceObject]];
+            }
+            [values setObject:relatedObjectIDs forKey:step.propertyName];
+        }
+    }
+    
+    return values;
+}
+
+@end
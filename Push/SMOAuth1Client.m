@@ -246,8 +246,9 @@ static const NSString *kOAuthVersion1_0 = @"1.0";
     
     CCHmac(kCCHmacAlgSHA1, keyBytes, strlen(keyBytes), baseStringBytes, strlen(baseStringBytes), digestBytes);
     
-    NSData *digestData = [NSData dataWithBytes:digestBytes length:CC_SHA1_DIGEST_LENGTH];
-    return Base64EncodedStringFromData(digestData);
+    char signatureBytes[Base64EncodedLength(CC_SHA1_DIGEST_LENGTH)];
+    size_t signatureLength = Base64EncodeBytes(digestBytes, CC_SHA1_DIGEST_LENGTH, signatureBytes);
+    return [[NSString alloc] initWithBytes:signatureBytes length:signatureLength encoding:NSASCIIStringEncoding];
 }
 
 - (NSString *) baseURLforAddress:(NSURL *)url {
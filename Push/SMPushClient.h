@@ -19,6 +19,26 @@
 
 #define DEFAULT_PUSH_HOST @"push.stackmob.com"
 
+/**
+ Called when a chunk of a bulk send has been delivered, with the recipients it held.
+ */
+typedef void (^SMPushChunkSuccessBlock)(NSArray *recipients);
+
+/**
+ Called when a chunk of a bulk send has failed for good, with the recipients it held and the last error.
+ */
+typedef void (^SMPushChunkFailureBlock)(NSArray *recipients, NSError *error);
+
+/**
+ Called after each chunk of a bulk send finishes, with the number of recipients delivered and failed so far and the number in the whole send.
+ */
+typedef void (^SMPushProgressBlock)(NSUInteger sentCount, NSUInteger failedCount, NSUInteger totalCount);
+
+/**
+ Called once every chunk of a bulk send has finished, with the recipients of every failed chunk.  Pass them to another bulk send to retry them.
+ */
+typedef void (^SMPushBulkCompletionBlock)(NSArray *failedRecipients);
+
 /**
  An `SMPushClient` provides a high level interface to interacting with StackMob's push service. A new client must be given an API Version and OAuth credentials in order to communicate with your StackMob application.
  
@@ -83,6 +103,10 @@
  * sendMessage:toUsers:onSuccess:onFailure:
  * sendMessage:toTokens:onSuccess:onFailure:
  
+ ### Send to many recipients ###
+ 
+ sendMessage:toUsers:onSuccess:onFailure: and sendMessage:toTokens:onSuccess:onFailure: send every recipient in one request, which succeeds or fails as a whole.  For large sends, use sendBulkMessage:toTokens:onChunkSuccess:onChunkFailure:onProgress:onCompletion: or sendBulkMessage:toUsers:onChunkSuccess:onChunkFailure:onProgress:onCompletion: instead.  Recipients are split into chunks of <bulkBatchSize>.  At most <bulkMaxConcurrentRequests> chunks are sent at once, and chunks which fail before the server could have sent them are retried with backoff (see <bulkNumberOfRetries>).  Each chunk reports success or failure on its own, so only the recipients of failed chunks need to be sent again.
+ 
  */
 @interface SMPushClient : NSObject
 
@@ -91,6 +115,31 @@
 @property(nonatomic, readonly, copy) NSString *privateKey;
 @property(nonatomic, readonly, copy) NSString *host;
 
+/**
+ The most recipients sent in one request by the bulk send methods.  Default is 1000.
+ */
+@property(nonatomic) NSUInteger bulkBatchSize;
+
+/**
+ The most requests a bulk send has in flight at once, retries waiting for their backoff included.  Default is 4.
+ */
+@property(nonatomic) NSUInteger bulkMaxConcurrentRequests;
+
+/**
+ The number of times a chunk of a bulk send is retried after a 429 or 503 status, or after failing to reach the server at all (`NSURLErrorCannotConnectToHost`, `NSURLErrorDNSLookupFailed` or `NSURLErrorNotConnectedToInternet`).  A timeout or any other status fails the chunk straight away, since its pushes may already have gone out.  Default is 3.
+ */
+@property(nonatomic) NSUInteger bulkNumberOfRetries;
+
+/**
+ The delay before the first retry of a chunk, in seconds.  Each later retry doubles it, up to <bulkRetryMaxDelay>, and the actual wait is chosen at random between zero and that value.  A `Retry-After` header on a 429 or 503 response is used instead when present.  Default is 0.5 seconds.
+ */
+@property(nonatomic) NSTimeInterval bulkRetryBaseDelay;
+
+/**
+ The longest delay before a retry, in seconds.  Default is 30 seconds.
+ */
+@property(nonatomic) NSTimeInterval bulkRetryMaxDelay;
+
 ///--------------------
 /// @name Initialize
 ///--------------------
@@ -197,6 +246,37 @@
 - (void)sendMessage:(NSDictionary *)message toTokens:(NSArray *)tokens onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock;
 
 
+/**
+ Send a message to many users, in chunks of <bulkBatchSize> users.
+ 
+ Chunks are sent as with sendMessage:toUsers:onSuccess:onFailure:, with at most <bulkMaxConcurrentRequests> in flight, and retried as described under <bulkNumberOfRetries>.  Blocks are called on the main thread.  Settings are read when the send starts.
+ 
+ @param message The message to send. See [Apple's docs](http://developer.apple.com/library/mac/#documentation/NetworkingInternet/Conceptual/RemoteNotificationsPG/ApplePushService/ApplePushService.html) for details on format.
+ @param users An array of username strings to push to.
+ @param chunkSuccessBlock The block to call each time a chunk is delivered.
+ @param chunkFailureBlock The block to call each time a chunk fails for good.
+ @param progressBlock The block to call after each chunk finishes.
+ @param completionBlock The block to call once every chunk has finished.
+ 
+ */
+- (void)sendBulkMessage:(NSDictionary *)message toUsers:(NSArray *)users onChunkSuccess:(SMPushChunkSuccessBlock)chunkSuccessBlock onChunkFailure:(SMPushChunkFailureBlock)chunkFailureBlock onProgress:(SMPushProgressBlock)progressBlock onCompletion:(SMPushBulkCompletionBlock)completionBlock;
+
+/**
+ Send a message to many tokens, in chunks of <bulkBatchSize> tokens.
+ 
+ Chunks are sent as with sendMessage:toTokens:onSuccess:onFailure:, with at most <bulkMaxConcurrentRequests> in flight, and retried as described under <bulkNumberOfRetries>.  Blocks are called on the main thread.  Settings are read when the send starts.
+ 
+ @param message The message to send. See [Apple's docs](http://developer.apple.com/library/mac/#documentation/NetworkingInternet/Conceptual/RemoteNotificationsPG/ApplePushService/ApplePushService.html) for details on format.
+ @param tokens An array containing either device token strings or SMPushToken objects to push to.
+ @param chunkSuccessBlock The block to call each time a chunk is delivered.
+ @param chunkFailureBlock The block to call each time a chunk fails for good.
+ @param progressBlock The block to call after each chunk finishes.
+ @param completionBlock The block to call once every chunk has finished.
+ 
+ */
+- (void)sendBulkMessage:(NSDictionary *)message toTokens:(NSArray *)tokens onChunkSuccess:(SMPushChunkSuccessBlock)chunkSuccessBlock onChunkFailure:(SMPushChunkFailureBlock)chunkFailureBlock onProgress:(SMPushProgressBlock)progressBlock onCompletion:(SMPushBulkCompletionBlock)completionBlock;
+
+
 ///--------------------
 /// @name Retrieving Tokens For Users
 ///--------------------
@@ -22,6 +22,12 @@
 #import "SMVersion.h"
 #import "SystemInformation.h"
 
+#define DEFAULT_BULK_BATCH_SIZE 1000
+#define DEFAULT_BULK_MAX_CONCURRENT_REQUESTS 4
+#define DEFAULT_BULK_NUMBER_OF_RETRIES 3
+#define DEFAULT_BULK_RETRY_BASE_DELAY 0.5
+#define DEFAULT_BULK_RETRY_MAX_DELAY 30.0
+
 static SMPushClient *defaultClient = nil;
 
 @interface SMPushClient ()
@@ -32,6 +38,200 @@ static SMPushClient *defaultClient = nil;
 @property(nonatomic, readwrite, copy) NSString *host;
 @property(nonatomic, retain) SMOAuth1Client *oauthClient;
 
+- (NSURLRequest *)SM_requestToSendMessage:(NSDictionary *)message toUsers:(NSArray *)users;
+- (NSURLRequest *)SM_requestToSendMessage:(NSDictionary *)message toTokens:(NSArray *)tokens;
+- (void)SM_enqueueRequest:(NSURLRequest *)request callbackQueue:(dispatch_queue_t)callbackQueue onSuccess:(SMResultSuccessBlock)successBlock onFailure:(void (^)(NSHTTPURLResponse *response, NSError *error, NSError *connectionError))failureBlock;
+
+@end
+
+/*
+ One call to sendBulkMessage:..., which keeps itself alive through the blocks of its requests until every chunk has finished.  Its state is only touched on bulkQueue.
+ */
+@interface SMPushBulkSend : NSObject
+
+@property (nonatomic, strong) SMPushClient *client;
+@property (nonatomic, copy) NSURLRequest *(^requestForChunk)(NSArray *chunk);
+@property (nonatomic, copy) SMPushChunkSuccessBlock chunkSuccessBlock;
+@property (nonatomic, copy) SMPushChunkFailureBlock chunkFailureBlock;
+@property (nonatomic, copy) SMPushProgressBlock progressBlock;
+@property (nonatomic, copy) SMPushBulkCompletionBlock completionBlock;
+@property (nonatomic) dispatch_queue_t bulkQueue;
+@property (nonatomic, strong) NSMutableArray *pendingChunks;
+@property (nonatomic, strong) NSMutableArray *failedRecipients;
+@property (nonatomic) NSUInteger totalCount;
+@property (nonatomic) NSUInteger sentCount;
+@property (nonatomic) NSUInteger failedCount;
+@property (nonatomic) NSUInteger requestsInFlight;
+@property (nonatomic) NSUInteger maxConcurrentRequests;
+@property (nonatomic) NSUInteger numberOfRetries;
+@property (nonatomic) NSTimeInterval retryBaseDelay;
+@property (nonatomic) NSTimeInterval retryMaxDelay;
+
+- (id)initWithClient:(SMPushClient *)client recipients:(NSArray *)recipients requestForChunk:(NSURLRequest *(^)(NSArray *chunk))requestForChunk;
+- (void)start;
+- (void)SM_sendChunksWhileSlotsAreFree;
+- (void)SM_sendChunk:(NSArray *)chunk retriesAttempted:(NSUInteger)retriesAttempted;
+- (void)SM_finishChunk:(NSArray *)chunk error:(NSError *)error;
+- (BOOL)SM_shouldRetryResponse:(NSHTTPURLResponse *)response connectionError:(NSError *)connectionError;
+- (NSTimeInterval)SM_retryDelayForResponse:(NSHTTPURLResponse *)response retriesAttempted:(NSUInteger)retriesAttempted;
+
+@end
+
+@implementation SMPushBulkSend
+
+@synthesize client = _SM_client;
+@synthesize requestForChunk = _SM_requestForChunk;
+@synthesize chunkSuccessBlock = _SM_chunkSuccessBlock;
+@synthesize chunkFailureBlock = _SM_chunkFailureBlock;
+@synthesize progressBlock = _SM_progressBlock;
+@synthesize completionBlock = _SM_completionBlock;
+@synthesize bulkQueue = _SM_bulkQueue;
+@synthesize pendingChunks = _SM_pendingChunks;
+@synthesize failedRecipients = _SM_failedRecipients;
+@synthesize totalCount = _SM_totalCount;
+@synthesize sentCount = _SM_sentCount;
+@synthesize failedCount = _SM_failedCount;
+@synthesize requestsInFlight = _SM_requestsInFlight;
+@synthesize maxConcurrentRequests = _SM_maxConcurrentRequests;
+@synthesize numberOfRetries = _SM_numberOfRetries;
+@synthesize retryBaseDelay = _SM_retryBaseDelay;
+@synthesize retryMaxDelay = _SM_retryMaxDelay;
+
+- (id)initWithClient:(SMPushClient *)client recipients:(NSArray *)recipients requestForChunk:(NSURLRequest *(^)(NSArray *chunk))requestForChunk
+{
+    self = [super init];
+    if (self) {
+        self.client = client;
+        self.requestForChunk = requestForChunk;
+        self.bulkQueue = dispatch_queue_create("com.stackmob.pushBulkSendQueue", NULL);
+        self.failedRecipients = [NSMutableArray array];
+        self.totalCount = [recipients count];
+        self.maxConcurrentRequests = MAX(client.bulkMaxConcurrentRequests, 1);
+        self.numberOfRetries = client.bulkNumberOfRetries;
+        self.retryBaseDelay = client.bulkRetryBaseDelay;
+        self.retryMaxDelay = client.bulkRetryMaxDelay;
+        
+        NSUInteger batchSize = MAX(client.bulkBatchSize, 1);
+        self.pendingChunks = [NSMutableArray arrayWithCapacity:[recipients count] / batchSize + 1];
+        for (NSUInteger location = 0; location < [recipients count]; location += batchSize) {
+            [self.pendingChunks addObject:[recipients subarrayWithRange:NSMakeRange(location, MIN(batchSize, [recipients count] - location))]];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_bulkQueue);
+}
+
+- (void)start
+{
+    dispatch_async(self.bulkQueue, ^{
+        [self SM_sendChunksWhileSlotsAreFree];
+    });
+}
+
+- (void)SM_sendChunksWhileSlotsAreFree
+{
+    while (self.requestsInFlight < self.maxConcurrentRequests && [self.pendingChunks count] > 0) {
+        NSArray *chunk = [self.pendingChunks objectAtIndex:0];
+        [self.pendingChunks removeObjectAtIndex:0];
+        self.requestsInFlight = self.requestsInFlight + 1;
+        [self SM_sendChunk:chunk retriesAttempted:0];
+    }
+    
+    if (self.requestsInFlight == 0 && [self.pendingChunks count] == 0) {
+        SMPushBulkCompletionBlock completionBlock = self.completionBlock;
+        NSArray *failedRecipients = [self.failedRecipients copy];
+        if (completionBlock) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionBlock(failedRecipients);
+            });
+        }
+    }
+}
+
+- (void)SM_sendChunk:(NSArray *)chunk retriesAttempted:(NSUInteger)retriesAttempted
+{
+    // Requests are built for every attempt, so each carries a fresh signature
+    NSURLRequest *request = self.requestForChunk(chunk);
+    [self.client SM_enqueueRequest:request callbackQueue:self.bulkQueue onSuccess:^(NSDictionary *result) {
+        [self SM_finishChunk:chunk error:nil];
+    } onFailure:^(NSHTTPURLResponse *response, NSError *error, NSError *connectionError) {
+        if (retriesAttempted < self.numberOfRetries && [self SM_shouldRetryResponse:response connectionError:connectionError]) {
+            // The chunk keeps its slot while it waits, so retries never add to the load
+            NSTimeInterval delayInSeconds = [self SM_retryDelayForResponse:response retriesAttempted:retriesAttempted];
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delayInSeconds * NSEC_PER_SEC)), self.bulkQueue, ^{
+                [self SM_sendChunk:chunk retriesAttempted:retriesAttempted + 1];
+            });
+        } else {
+            [self SM_finishChunk:chunk error:error];
+        }
+    }];
+}
+
+- (BOOL)SM_shouldRetryResponse:(NSHTTPURLResponse *)response connectionError:(NSError *)connectionError
+{
+    // Only failures where the server cannot have acted on the chunk.  A timeout or another 5xx may come after the pushes went out, and a retry would send them twice.
+    if (response) {
+        return [response statusCode] == 429 || [response statusCode] == 503;
+    }
+    if (![[connectionError domain] isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    switch ([connectionError code]) {
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorDNSLookupFailed:
+        case NSURLErrorNotConnectedToInternet:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (NSTimeInterval)SM_retryDelayForResponse:(NSHTTPURLResponse *)response retriesAttempted:(NSUInteger)retriesAttempted
+{
+    NSString *retryAfter = [[response allHeaderFields] objectForKey:@"Retry-After"];
+    if (retryAfter && [retryAfter doubleValue] > 0) {
+        return MIN([retryAfter doubleValue], self.retryMaxDelay);
+    }
+    double ceiling = MIN(self.retryMaxDelay, self.retryBaseDelay * pow(2, retriesAttempted));
+    return ceiling * ((double)arc4random() / ((double)UINT32_MAX + 1));
+}
+
+- (void)SM_finishChunk:(NSArray *)chunk error:(NSError *)error
+{
+    self.requestsInFlight = self.requestsInFlight - 1;
+    if (error) {
+        self.failedCount = self.failedCount + [chunk count];
+        [self.failedRecipients addObjectsFromArray:chunk];
+    } else {
+        self.sentCount = self.sentCount + [chunk count];
+    }
+    
+    SMPushChunkSuccessBlock chunkSuccessBlock = self.chunkSuccessBlock;
+    SMPushChunkFailureBlock chunkFailureBlock = self.chunkFailureBlock;
+    SMPushProgressBlock progressBlock = self.progressBlock;
+    NSUInteger sentCount = self.sentCount;
+    NSUInteger failedCount = self.failedCount;
+    NSUInteger totalCount = self.totalCount;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (error) {
+            if (chunkFailureBlock) {
+                chunkFailureBlock(chunk, error);
+            }
+        } else if (chunkSuccessBlock) {
+            chunkSuccessBlock(chunk);
+        }
+        if (progressBlock) {
+            progressBlock(sentCount, failedCount, totalCount);
+        }
+    });
+    
+    [self SM_sendChunksWhileSlotsAreFree];
+}
+
 @end
 
 @implementation SMPushClient
@@ -41,6 +241,11 @@ static SMPushClient *defaultClient = nil;
 @synthesize publicKey = _SM_publicKey;
 @synthesize host = _SM_host;
 @synthesize oauthClient = _SM_oauthClient;
+@synthesize bulkBatchSize = _SM_bulkBatchSize;
+@synthesize bulkMaxConcurrentRequests = _SM_bulkMaxConcurrentRequests;
+@synthesize bulkNumberOfRetries = _SM_bulkNumberOfRetries;
+@synthesize bulkRetryBaseDelay = _SM_bulkRetryBaseDelay;
+@synthesize bulkRetryMaxDelay = _SM_bulkRetryMaxDelay;
 
 - (id)initWithAPIVersion:(NSString *)appAPIVersion publicKey:(NSString *)publicKey privateKey:(NSString *)privateKey
 {
@@ -55,6 +260,11 @@ static SMPushClient *defaultClient = nil;
         self.publicKey = publicKey;
         self.privateKey = privateKey;
         self.host = pushHost;
+        self.bulkBatchSize = DEFAULT_BULK_BATCH_SIZE;
+        self.bulkMaxConcurrentRequests = DEFAULT_BULK_MAX_CONCURRENT_REQUESTS;
+        self.bulkNumberOfRetries = DEFAULT_BULK_NUMBER_OF_RETRIES;
+        self.bulkRetryBaseDelay = DEFAULT_BULK_RETRY_BASE_DELAY;
+        self.bulkRetryMaxDelay = DEFAULT_BULK_RETRY_MAX_DELAY;
         NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@", pushHost]];
         self.oauthClient = [[SMOAuth1Client alloc] initWithBaseURL:url consumerKey:publicKey secret:privateKey];
         NSString *acceptHeader = [NSString stringWithFormat:@"application/vnd.stackmob+json; version=%@", appAPIVersion];
@@ -110,12 +320,47 @@ static SMPushClient *defaultClient = nil;
 
 - (void)sendMessage:(NSDictionary *)message toUsers:(NSArray *)users onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
 {
-    NSDictionary *args = [NSDictionary dictionaryWithObjectsAndKeys:message, @"kvPairs", users, @"userIds", nil]; 
-    NSURLRequest *request = [self.oauthClient requestWithMethod:@"POST" path:@"push_users_universal" parameters:args];
+    NSURLRequest *request = [self SM_requestToSendMessage:message toUsers:users];
     [self enqueueRequest:request onSuccess:^(NSDictionary *results) {successBlock();} onFailure:failureBlock];
 }
 
 - (void)sendMessage:(NSDictionary *)message toTokens:(NSArray *)tokens onSuccess:(SMSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    NSURLRequest *request = [self SM_requestToSendMessage:message toTokens:tokens];
+    [self enqueueRequest:request onSuccess:^(NSDictionary *results) {successBlock();} onFailure:failureBlock];
+}
+
+- (void)sendBulkMessage:(NSDictionary *)message toUsers:(NSArray *)users onChunkSuccess:(SMPushChunkSuccessBlock)chunkSuccessBlock onChunkFailure:(SMPushChunkFailureBlock)chunkFailureBlock onProgress:(SMPushProgressBlock)progressBlock onCompletion:(SMPushBulkCompletionBlock)completionBlock
+{
+    SMPushBulkSend *bulkSend = [[SMPushBulkSend alloc] initWithClient:self recipients:users requestForChunk:^NSURLRequest *(NSArray *chunk) {
+        return [self SM_requestToSendMessage:message toUsers:chunk];
+    }];
+    bulkSend.chunkSuccessBlock = chunkSuccessBlock;
+    bulkSend.chunkFailureBlock = chunkFailureBlock;
+    bulkSend.progressBlock = progressBlock;
+    bulkSend.completionBlock = completionBlock;
+    [bulkSend start];
+}
+
+- (void)sendBulkMessage:(NSDictionary *)message toTokens:(NSArray *)tokens onChunkSuccess:(SMPushChunkSuccessBlock)chunkSuccessBlock onChunkFailure:(SMPushChunkFailureBlock)chunkFailureBlock onProgress:(SMPushProgressBlock)progressBlock onCompletion:(SMPushBulkCompletionBlock)completionBlock
+{
+    SMPushBulkSend *bulkSend = [[SMPushBulkSend alloc] initWithClient:self recipients:tokens requestForChunk:^NSURLRequest *(NSArray *chunk) {
+        return [self SM_requestToSendMessage:message toTokens:chunk];
+    }];
+    bulkSend.chunkSuccessBlock = chunkSuccessBlock;
+    bulkSend.chunkFailureBlock = chunkFailureBlock;
+    bulkSend.progressBlock = progressBlock;
+    bulkSend.completionBlock = completionBlock;
+    [bulkSend start];
+}
+
+- (NSURLRequest *)SM_requestToSendMessage:(NSDictionary *)message toUsers:(NSArray *)users
+{
+    NSDictionary *args = [NSDictionary dictionaryWithObjectsAndKeys:message, @"kvPairs", users, @"userIds", nil];
+    return [self.oauthClient requestWithMethod:@"POST" path:@"push_users_universal" parameters:args];
+}
+
+- (NSURLRequest *)SM_requestToSendMessage:(NSDictionary *)message toTokens:(NSArray *)tokens
 {
     NSDictionary *payload = [NSDictionary dictionaryWithObject:message forKey:@"kvPairs"];
     NSMutableArray * tokensArray = [NSMutableArray array];
@@ -126,8 +371,7 @@ static SMPushClient *defaultClient = nil;
         [tokensArray addObject:tokenDict];
     }];
     NSDictionary *args = [NSDictionary dictionaryWithObjectsAndKeys:tokensArray, @"tokens", payload, @"payload", nil];
-    NSURLRequest *request = [self.oauthClient requestWithMethod:@"POST" path:@"push_tokens_universal" parameters:args];
-    [self enqueueRequest:request onSuccess:^(NSDictionary *results) {successBlock();} onFailure:failureBlock];
+    return [self.oauthClient requestWithMethod:@"POST" path:@"push_tokens_universal" parameters:args];
 }
 
 - (void)getTokensForUsers:(NSArray *)users onSuccess:(SMResultSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
@@ -168,13 +412,24 @@ static SMPushClient *defaultClient = nil;
 }
 
 - (void)enqueueRequest:(NSURLRequest *)request onSuccess:(SMResultSuccessBlock)successBlock onFailure:(SMFailureBlock)failureBlock
+{
+    [self SM_enqueueRequest:request callbackQueue:nil onSuccess:successBlock onFailure:^(NSHTTPURLResponse *response, NSError *error, NSError *connectionError) {
+        failureBlock(error);
+    }];
+}
+
+- (void)SM_enqueueRequest:(NSURLRequest *)request callbackQueue:(dispatch_queue_t)callbackQueue onSuccess:(SMResultSuccessBlock)successBlock onFailure:(void (^)(NSHTTPURLResponse *response, NSError *error, NSError *connectionError))failureBlock
 {
     AFJSONRequestOperation *op = [SMJSONRequestOperation JSONRequestOperationWithRequest:request success:^(NSURLRequest *urlRequest, NSHTTPURLResponse *response, id JSON) {
         successBlock(JSON);
     }failure:^(NSURLRequest *urlRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
-        failureBlock([NSError errorWithDomain:@"SMError" code:[response statusCode] userInfo:JSON]);
+        failureBlock(response, [NSError errorWithDomain:@"SMError" code:[response statusCode] userInfo:JSON], error);
     }];
-    [self.oauthClient enqueueHTTPRequestOperation:op];  
+    if (callbackQueue) {
+        op.successCallbackQueue = callbackQueue;
+        op.failureCallbackQueue = callbackQueue;
+    }
+    [self.oauthClient enqueueHTTPRequestOperation:op];
 }
 
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "Base64EncodedStringFromData.h"
+
+static NSData * SMRandomData(NSUInteger length)
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    arc4random_buf([data mutableBytes], length);
+    return data;
+}
+
+SPEC_BEGIN(Base64EncodedStringFromDataSpec)
+
+describe(@"Base64 encoding", ^{
+    it(@"matches the RFC 4648 test vectors", ^{
+        NSDictionary *vectors = [NSDictionary dictionaryWithObjectsAndKeys:
+                                 @"", @"",
+                                 @"Zg==", @"f",
+                                 @"Zm8=", @"fo",
+                                 @"Zm9v", @"foo",
+                                 @"Zm9vYg==", @"foob",
+                                 @"Zm9vYmE=", @"fooba",
+                                 @"Zm9vYmFy", @"foobar",
+                                 @"Zm9vYmFyZm9vYmFyZm9vYmFy", @"foobarfoobarfoobar", nil];
+        [vectors enumerateKeysAndObjectsUsingBlock:^(NSString *plain, NSString *encoded, BOOL *stop) {
+            NSData *data = [plain dataUsingEncoding:NSUTF8StringEncoding];
+            [[Base64EncodedStringFromData(data) should] equal:encoded];
+            [[DataFromBase64EncodedString(encoded) should] equal:data];
+        }];
+    });
+    it(@"round trips every length up to a few groups", ^{
+        for (NSUInteger length = 0; length < 64; length++) {
+            NSData *data = SMRandomData(length);
+            [[DataFromBase64EncodedString(Base64EncodedStringFromData(data)) should] equal:data];
+        }
+    });
+    it(@"round trips a kilobyte of random data", ^{
+        NSData *data = SMRandomData(1024);
+        NSString *encoded = Base64EncodedStringFromData(data);
+        [[theValue([encoded length]) should] equal:theValue(1368)];
+        [[DataFromBase64EncodedString(encoded) should] equal:data];
+    });
+    it(@"encodes a stream the same as the data it contains", ^{
+        NSData *data = SMRandomData(200000);
+        NSInputStream *stream = [NSInputStream inputStreamWithData:data];
+        [[Base64EncodedStringFromInputStream(stream) should] equal:Base64EncodedStringFromData(data)];
+    });
+});
+
+describe(@"Base64 decoding", ^{
+    it(@"ignores whitespace and missing padding", ^{
+        NSData *data = [@"foobar!" dataUsingEncoding:NSUTF8StringEncoding];
+        [[DataFromBase64EncodedString(@"Zm9v\r\nYmFy\nIQ") should] equal:data];
+    });
+    it(@"rejects invalid input", ^{
+        [DataFromBase64EncodedString(@"Zm9v*mFy") shouldBeNil];
+        [DataFromBase64EncodedString(@"Zm=v") shouldBeNil];
+        [DataFromBase64EncodedString(@"Zm9vY") shouldBeNil];
+    });
+});
+
+SPEC_END
@@ -286,6 +286,22 @@ describe(@"NSManagedObject_StackMobSerialization", ^{
                     [[[dictionary valueForKey:@"owner"] should] equal:[NSNull null]];
                 });
                  */
+                it(@"lists every serialized relationship once in the relations header", ^{
+                    NSString *header = [[iMadeYouACookie SMDictionarySerialization] objectForKey:@"X-StackMob-Relations"];
+                    NSArray *relations = [header componentsSeparatedByString:@"&"];
+                    [[relations should] contain:@"photo=photo"];
+                    [[relations should] contain:@"photo.photographer=user"];
+                    [[relations should] contain:@"photo.photographer.lolcats=lolcat"];
+                    [[relations should] contain:@"tags=tag"];
+                    [[theValue([relations count]) should] equal:theValue([[NSSet setWithArray:relations] count])];
+                });
+                it(@"nests unsaved to-one objects and lists to-many objects by id", ^{
+                    NSDictionary *photo = [dictionary objectForKey:@"photo"];
+                    [[[photo objectForKey:@"photo_id"] should] equal:[kittenPhoto valueForKey:@"photo_id"]];
+                    [[[[photo objectForKey:@"photographer"] objectForKey:@"user_id"] should] equal:@"hooman"];
+                    [[[dictionary objectForKey:@"tags"] should] haveCountOf:2];
+                    [[[dictionary objectForKey:@"tags"] should] contain:[cookieTag valueForKey:@"tag_id"]];
+                });
                 describe(@"circular relationships", ^{
                     it(@"survives circular references", ^{
                         [[[[[[hooman valueForKey:@"lolcats"] anyObject] valueForKey:@"photo"] valueForKey:@"photographer"] should] equal:hooman];
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "SMAutosaveCoordinator.h"
+
+static NSManagedObjectContext *SMAutosaveSpecMainContext()
+{
+    NSAttributeDescription *textAttribute = [[NSAttributeDescription alloc] init];
+    [textAttribute setName:@"text"];
+    [textAttribute setAttributeType:NSStringAttributeType];
+    [textAttribute setOptional:YES];
+    NSEntityDescription *noteEntity = [[NSEntityDescription alloc] init];
+    [noteEntity setName:@"Note"];
+    [noteEntity setProperties:[NSArray arrayWithObject:textAttribute]];
+    NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+    [model setEntities:[NSArray arrayWithObject:noteEntity]];
+    
+    NSPersistentStoreCoordinator *coordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
+    [coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:nil URL:nil options:nil error:NULL];
+    NSManagedObjectContext *privateContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+    [privateContext setPersistentStoreCoordinator:coordinator];
+    NSManagedObjectContext *mainContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSMainQueueConcurrencyType];
+    [mainContext setParentContext:privateContext];
+    return mainContext;
+}
+
+static NSUInteger SMAutosaveSpecStoredNoteCount(NSManagedObjectContext *mainContext)
+{
+    NSManagedObjectContext *privateContext = [mainContext parentContext];
+    __block NSUInteger count = 0;
+    [privateContext performBlockAndWait:^{
+        NSManagedObjectContext *storeContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSConfinementConcurrencyType];
+        [storeContext setPersistentStoreCoordinator:[privateContext persistentStoreCoordinator]];
+        count = [storeContext countForFetchRequest:[NSFetchRequest fetchRequestWithEntityName:@"Note"] error:NULL];
+    }];
+    return count;
+}
+
+SPEC_BEGIN(SMAutosaveCoordinatorSpec)
+
+describe(@"SMAutosaveCoordinator", ^{
+    __block NSManagedObjectContext *mainContext = nil;
+    __block SMAutosaveCoordinator *coordinator = nil;
+    beforeEach(^{
+        mainContext = SMAutosaveSpecMainContext();
+        coordinator = [[SMAutosaveCoordinator alloc] initWithMainContext:mainContext];
+    });
+    it(@"coalesces saves close together into one store save", ^{
+        coordinator.debounceInterval = 0.2;
+        __block int successCount = 0;
+        for (int i = 0; i < 10; i++) {
+            NSManagedObject *note = [NSEntityDescription insertNewObjectForEntityForName:@"Note" inManagedObjectContext:mainContext];
+            [note setValue:@"edit" forKey:@"text"];
+            [coordinator saveContext:mainContext onSuccess:^{
+                successCount++;
+            } onFailure:^(NSError *error) {
+                [error shouldBeNil];
+            }];
+        }
+        
+        [[expectFutureValue(theValue(successCount)) shouldEventuallyBeforeTimingOutAfter(5.0)] equal:theValue(10)];
+        [[theValue([coordinator persistentStoreSaveCount]) should] equal:theValue(1)];
+        [[theValue(SMAutosaveSpecStoredNoteCount(mainContext)) should] equal:theValue(10)];
+        [[theValue([coordinator pendingSaveCount]) should] equal:theValue(0)];
+    });
+    it(@"saves within the maximum latency while saves keep coming in", ^{
+        coordinator.debounceInterval = 0.5;
+        coordinator.maximumLatency = 0.3;
+        NSDate *end = [NSDate dateWithTimeIntervalSinceNow:1.5];
+        while ([end timeIntervalSinceNow] > 0) {
+            [NSEntityDescription insertNewObjectForEntityForName:@"Note" inManagedObjectContext:mainContext];
+            [coordinator saveContext:mainContext onSuccess:nil onFailure:nil];
+            [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+        }
+        
+        [[theValue([coordinator persistentStoreSaveCount]) should] beGreaterThanOrEqualTo:theValue(2)];
+    });
+    it(@"pushes child contexts into the main context and saves on flush", ^{
+        coordinator.debounceInterval = 60.0;
+        coordinator.maximumLatency = 60.0;
+        NSManagedObjectContext *childContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+        [childContext setParentContext:mainContext];
+        [childContext performBlockAndWait:^{
+            [NSEntityDescription insertNewObjectForEntityForName:@"Note" inManagedObjectContext:childContext];
+        }];
+        
+        __block BOOL saved = NO;
+        [coordinator saveContext:childContext onSuccess:^{
+            saved = YES;
+        } onFailure:^(NSError *error) {
+            [error shouldBeNil];
+        }];
+        
+        [[expectFutureValue(theValue([coordinator pendingSaveCount])) shouldEventually] equal:theValue(1)];
+        [[theValue([[mainContext insertedObjects] count]) should] equal:theValue(1)];
+        [[theValue(saved) should] beNo];
+        
+        [coordinator flush];
+        [[expectFutureValue(theValue(saved)) shouldEventually] beYes];
+        [[theValue(SMAutosaveSpecStoredNoteCount(mainContext)) should] equal:theValue(1)];
+    });
+    it(@"rejects contexts which are not the main context or its children", ^{
+        NSManagedObjectContext *otherContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+        [[theBlock(^{
+            [coordinator saveContext:otherContext onSuccess:nil onFailure:nil];
+        }) should] raise];
+    });
+});
+
+SPEC_END
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ The outcome of one benchmark: the median time and allocation count per operation over several runs.
+ */
+@interface SMBenchmarkResult : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) NSUInteger iterations;
+@property (nonatomic) double nanosecondsPerOperation;
+@property (nonatomic) double allocationsPerOperation;
+
+/**
+ The result as a JSON object.
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/**
+ `SMBenchmarkSuite` times blocks of SDK code and counts the heap allocations they make.
+ 
+ Each benchmark is warmed up, then run several times with a fresh autorelease pool, and the median run is kept so results can be compared from one build to the next.  Allocations are counted by wrapping the default malloc zone, so allocations made at the same time on other threads are counted too.
+ 
+ Results are written as JSON:
+ 
+    {"benchmarks": [{"name": "base64.encode.4k", "iterations": 10000, "ns_per_op": 2150.3, "allocs_per_op": 2.0}, ...]}
+ */
+@interface SMBenchmarkSuite : NSObject
+
+@property (nonatomic, readonly, strong) NSArray *results;
+
+/**
+ Runs a benchmark and records its result.
+ 
+ @param name The name of the benchmark, written to the JSON output.
+ @param iterations The number of times to call the block in each run.
+ @param block The operation to measure.
+ 
+ @return The result.
+ */
+- (SMBenchmarkResult *)measure:(NSString *)name iterations:(NSUInteger)iterations block:(void (^)(void))block;
+
+/**
+ Writes the recorded results as JSON.
+ 
+ @param path The file to write to.
+ @param error If the file cannot be written, the reason is placed here.
+ 
+ @return Whether the file was written.
+ */
+- (BOOL)writeJSONToPath:(NSString *)path error:(NSError *__autoreleasing *)error;
+
+@end
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMBenchmark.h"
+#import <malloc/malloc.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <libkern/OSAtomic.h>
+
+#define BENCHMARK_RUNS 5
+
+static volatile int64_t SMAllocationCount = 0;
+static void *(*SMZoneMalloc)(malloc_zone_t *zone, size_t size);
+static void *(*SMZoneCalloc)(malloc_zone_t *zone, size_t count, size_t size);
+static void *(*SMZoneValloc)(malloc_zone_t *zone, size_t size);
+static void *(*SMZoneRealloc)(malloc_zone_t *zone, void *pointer, size_t size);
+static unsigned (*SMZoneBatchMalloc)(malloc_zone_t *zone, size_t size, void **results, unsigned count);
+static void *(*SMZoneMemalign)(malloc_zone_t *zone, size_t alignment, size_t size);
+
+static void * SMCountingMalloc(malloc_zone_t *zone, size_t size)
+{
+    OSAtomicIncrement64(&SMAllocationCount);
+    return SMZoneMalloc(zone, size);
+}
+
+static void * SMCountingCalloc(malloc_zone_t *zone, size_t count, size_t size)
+{
+    OSAtomicIncrement64(&SMAllocationCount);
+    return SMZoneCalloc(zone, count, size);
+}
+
+static void * SMCountingValloc(malloc_zone_t *zone, size_t size)
+{
+    OSAtomicIncrement64(&SMAllocationCount);
+    return SMZoneValloc(zone, size);
+}
+
+static void * SMCountingRealloc(malloc_zone_t *zone, void *pointer, size_t size)
+{
+    OSAtomicIncrement64(&SMAllocationCount);
+    return SMZoneRealloc(zone, pointer, size);
+}
+
+static unsigned SMCountingBatchMalloc(malloc_zone_t *zone, size_t size, void **results, unsigned count)
+{
+    unsigned allocated = SMZoneBatchMalloc(zone, size, results, count);
+    OSAtomicAdd64(allocated, &SMAllocationCount);
+    return allocated;
+}
+
+static void * SMCountingMemalign(malloc_zone_t *zone, size_t alignment, size_t size)
+{
+    OSAtomicIncrement64(&SMAllocationCount);
+    return SMZoneMemalign(zone, alignment, size);
+}
+
+static void SMInstallAllocationCounter(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // The zone's function table is read-only once it is set up
+        malloc_zone_t *zone = malloc_default_zone();
+        if (vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS) {
+            return;
+        }
+        SMZoneMalloc = zone->malloc;
+        SMZoneCalloc = zone->calloc;
+        SMZoneValloc = zone->valloc;
+        SMZoneRealloc = zone->realloc;
+        zone->malloc = SMCountingMalloc;
+        zone->calloc = SMCountingCalloc;
+        zone->valloc = SMCountingValloc;
+        zone->realloc = SMCountingRealloc;
+        if (zone->batch_malloc) {
+            SMZoneBatchMalloc = zone->batch_malloc;
+            zone->batch_malloc = SMCountingBatchMalloc;
+        }
+        // memalign was added in version 5 of the zone structure
+        if (zone->version >= 5 && zone->memalign) {
+            SMZoneMemalign = zone->memalign;
+            zone->memalign = SMCountingMemalign;
+        }
+        vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+    });
+}
+
+static double SMNanosecondsFromAbsoluteTime(uint64_t elapsed)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (double)elapsed * timebase.numer / timebase.denom;
+}
+
+static int SMCompareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a;
+    double second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+@implementation SMBenchmarkResult
+
+@synthesize name = _SM_name;
+@synthesize iterations = _SM_iterations;
+@synthesize nanosecondsPerOperation = _SM_nanosecondsPerOperation;
+@synthesize allocationsPerOperation = _SM_allocationsPerOperation;
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            self.name, @"name",
+            [NSNumber numberWithUnsignedInteger:self.iterations], @"iterations",
+            [NSNumber numberWithDouble:self.nanosecondsPerOperation], @"ns_per_op",
+            [NSNumber numberWithDouble:self.allocationsPerOperation], @"allocs_per_op",
+            nil];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"%@: %.1f ns/op, %.1f allocs/op (%lu iterations)", self.name, self.nanosecondsPerOperation, self.allocationsPerOperation, (unsigned long)self.iterations];
+}
+
+@end
+
+@interface SMBenchmarkSuite ()
+
+@property (nonatomic, strong) NSMutableArray *recordedResults;
+
+@end
+
+@implementation SMBenchmarkSuite
+
+@synthesize recordedResults = _SM_recordedResults;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.recordedResults = [NSMutableArray array];
+        SMInstallAllocationCounter();
+    }
+    return self;
+}
+
+- (NSArray *)results
+{
+    return [NSArray arrayWithArray:self.recordedResults];
+}
+
+- (SMBenchmarkResult *)measure:(NSString *)name iterations:(NSUInteger)iterations block:(void (^)(void))block
+{
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < iterations / 10 + 1; i++) {
+            block();
+        }
+    }
+    
+    double nanoseconds[BENCHMARK_RUNS];
+    double allocations[BENCHMARK_RUNS];
+    for (int run = 0; run < BENCHMARK_RUNS; run++) {
+        int64_t allocationsBefore = SMAllocationCount;
+        uint64_t start = mach_absolute_time();
+        @autoreleasepool {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                block();
+            }
+        }
+        uint64_t elapsed = mach_absolute_time() - start;
+        nanoseconds[run] = SMNanosecondsFromAbsoluteTime(elapsed) / iterations;
+        allocations[run] = (double)(SMAllocationCount - allocationsBefore) / iterations;
+    }
+    qsort(nanoseconds, BENCHMARK_RUNS, sizeof(double), SMCompareDoubles);
+    qsort(allocations, BENCHMARK_RUNS, sizeof(double), SMCompareDoubles);
+    
+    SMBenchmarkResult *result = [[SMBenchmarkResult alloc] init];
+    result.name = name;
+    result.iterations = iterations;
+    result.nanosecondsPerOperation = nanoseconds[BENCHMARK_RUNS / 2];
+    result.allocationsPerOperation = allocations[BENCHMARK_RUNS / 2];
+    [self.recordedResults addObject:result];
+    NSLog(@"Benchmark %@", result);
+    return result;
+}
+
+- (BOOL)writeJSONToPath:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    NSMutableArray *benchmarks = [NSMutableArray arrayWithCapacity:[self.recordedResults count]];
+    for (SMBenchmarkResult *result in self.recordedResults) {
+        [benchmarks addObject:[result dictionaryRepresentation]];
+    }
+    NSData *data = [NSJSONSerialization dataWithJSONObject:[NSDictionary dictionaryWithObject:benchmarks forKey:@"benchmarks"] options:NSJSONWritingPrettyPrinted error:error];
+    if (data == nil) {
+        return NO;
+    }
+    return [data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+@end
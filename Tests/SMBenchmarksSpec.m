@@ -0,0 +1,313 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "SMBenchmark.h"
+#import "SMQuery.h"
+#import "SMIncrementalStore.h"
+#import "SMIncrementalStore+Query.h"
+#import "SMEntityMetadata.h"
+#import "SMResponseDeserializationPlan.h"
+#import "SMOAuth2Client.h"
+#import "NSManagedObject+StackMobSerialization.h"
+#import "Base64EncodedStringFromData.h"
+#import "StackMob.h"
+#import <pthread.h>
+
+/*
+ Microbenchmarks for the SDK's CPU hot paths.  They only run when SM_BENCHMARK is set in the environment (see `rake test:benchmark`), and write their results as JSON to SM_BENCHMARK_OUTPUT, or to stackmob-benchmarks.json in the temporary directory.
+ */
+
+static NSAttributeDescription * SMBenchmarkAttribute(NSString *name, NSAttributeType type)
+{
+    NSAttributeDescription *attribute = [[NSAttributeDescription alloc] init];
+    [attribute setName:name];
+    [attribute setAttributeType:type];
+    [attribute setOptional:YES];
+    return attribute;
+}
+
+static void * SMBenchmarkThreadMain(void *context)
+{
+    void (^block)(void) = (__bridge_transfer id)context;
+    @autoreleasepool {
+        block();
+    }
+    return NULL;
+}
+
+// Runs the block on its own pthread for each index and waits for all of them, so contention does not depend on how many threads GCD decides to start
+static void SMBenchmarkRunOnThreads(NSUInteger threadCount, void (^block)(NSUInteger index))
+{
+    pthread_t threads[threadCount];
+    for (NSUInteger i = 0; i < threadCount; i++) {
+        void (^threadBlock)(void) = [^{
+            block(i);
+        } copy];
+        pthread_create(&threads[i], NULL, SMBenchmarkThreadMain, (__bridge_retained void *)threadBlock);
+    }
+    for (NSUInteger i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// The cache map is only read and written inside the store
+@interface SMIncrementalStore (SMBenchmarks)
+
+@property (nonatomic, strong) NSMutableDictionary *cacheMappingTable;
+
+- (NSURL *)SM_getStoreURLForCacheMapTable;
+- (void)SM_createStoreURLPathIfNeeded:(NSURL *)storeURL;
+- (void)SM_saveCacheMap;
+- (void)SM_readCacheMap;
+
+@end
+
+SPEC_BEGIN(SMBenchmarksSpec)
+
+describe(@"benchmarks", ^{
+    NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+    if ([environment objectForKey:@"SM_BENCHMARK"] == nil) {
+        return;
+    }
+    
+    __block SMBenchmarkSuite *suite = nil;
+    __block NSEntityDescription *todoEntity = nil;
+    __block NSEntityDescription *tagEntity = nil;
+    beforeAll(^{
+        suite = [[SMBenchmarkSuite alloc] init];
+        
+        todoEntity = [[NSEntityDescription alloc] init];
+        [todoEntity setName:@"Todo"];
+        tagEntity = [[NSEntityDescription alloc] init];
+        [tagEntity setName:@"Tag"];
+        
+        NSRelationshipDescription *tags = [[NSRelationshipDescription alloc] init];
+        [tags setName:@"tags"];
+        [tags setMaxCount:0];
+        [tags setDestinationEntity:tagEntity];
+        
+        [todoEntity setProperties:[NSArray arrayWithObjects:SMBenchmarkAttribute(@"todoId", NSStringAttributeType), SMBenchmarkAttribute(@"title", NSStringAttributeType), SMBenchmarkAttribute(@"notes", NSStringAttributeType), SMBenchmarkAttribute(@"dueDate", NSDateAttributeType), SMBenchmarkAttribute(@"done", NSBooleanAttributeType), SMBenchmarkAttribute(@"priority", NSInteger32AttributeType), SMBenchmarkAttribute(@"estimate", NSDoubleAttributeType), tags, nil]];
+        [tagEntity setProperties:[NSArray arrayWithObjects:SMBenchmarkAttribute(@"tagId", NSStringAttributeType), nil]];
+        
+        NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObjects:todoEntity, tagEntity, nil]];
+        [SMEntityMetadata registerModel:model userSchema:@"user" userPrimaryKeyField:@"username"];
+    });
+    afterAll(^{
+        NSString *path = [environment objectForKey:@"SM_BENCHMARK_OUTPUT"];
+        if (path == nil) {
+            path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"stackmob-benchmarks.json"];
+        }
+        NSError *error = nil;
+        if ([suite writeJSONToPath:path error:&error]) {
+            NSLog(@"Benchmark results written to %@", path);
+        } else {
+            NSLog(@"Could not write benchmark results to %@: %@", path, error);
+        }
+    });
+    
+    it(@"builds queries", ^{
+        [suite measure:@"query.build" iterations:20000 block:^{
+            SMQuery *query = [[SMQuery alloc] initWithSchema:@"todo"];
+            [query where:@"done" isEqualTo:[NSNumber numberWithBool:NO]];
+            [query where:@"priority" isGreaterThan:[NSNumber numberWithInt:2]];
+            [query where:@"todo_id" isIn:[NSArray arrayWithObjects:@"1", @"2", @"3", nil]];
+            [query orderByField:@"due_date" ascending:YES];
+            [query fromIndex:0 toIndex:49];
+        }];
+    });
+    
+    it(@"translates predicates", ^{
+        SMIncrementalStore *store = [[SMIncrementalStore alloc] init];
+        NSPredicate *predicate = [NSPredicate predicateWithFormat:@"done == NO AND priority > 2 AND todoId IN %@", [NSArray arrayWithObjects:@"1", @"2", @"3", nil]];
+        [suite measure:@"query.translate_predicate" iterations:20000 block:^{
+            NSError *error = nil;
+            [store queryForEntity:todoEntity predicate:predicate error:&error];
+        }];
+    });
+    
+    it(@"serializes objects for saving", ^{
+        NSManagedObject *todo = [[NSManagedObject alloc] initWithEntity:todoEntity insertIntoManagedObjectContext:nil];
+        [todo setValue:@"1234" forKey:@"todoId"];
+        [todo setValue:@"Buy milk" forKey:@"title"];
+        [todo setValue:@"Semi-skimmed, two pints" forKey:@"notes"];
+        [todo setValue:[NSDate date] forKey:@"dueDate"];
+        [todo setValue:[NSNumber numberWithBool:NO] forKey:@"done"];
+        [todo setValue:[NSNumber numberWithInt:3] forKey:@"priority"];
+        [todo setValue:[NSNumber numberWithDouble:0.5] forKey:@"estimate"];
+        NSMutableSet *tags = [todo mutableSetValueForKey:@"tags"];
+        for (int i = 0; i < 10; i++) {
+            NSManagedObject *tag = [[NSManagedObject alloc] initWithEntity:tagEntity insertIntoManagedObjectContext:nil];
+            [tag setValue:[NSString stringWithFormat:@"tag%d", i] forKey:@"tagId"];
+            [tags addObject:tag];
+        }
+        [suite measure:@"serialization.outbound" iterations:10000 block:^{
+            [todo SMDictionarySerialization];
+        }];
+    });
+    
+    it(@"reads objects from responses", ^{
+        SMResponseDeserializationPlan *plan = [SMResponseDeserializationPlan planForEntity:todoEntity];
+        NSDictionary *row = [NSDictionary dictionaryWithObjectsAndKeys:@"1234", @"todo_id", @"Buy milk", @"title", @"Semi-skimmed, two pints", @"notes", [NSNumber numberWithLongLong:1349990000000], @"due_date", [NSNumber numberWithBool:NO], @"done", [NSNumber numberWithInt:3], @"priority", [NSNumber numberWithDouble:0.5], @"estimate", [NSNumber numberWithLongLong:1349990000000], @"createddate", [NSNumber numberWithLongLong:1349990000000], @"lastmoddate", nil];
+        [suite measure:@"serialization.inbound" iterations:50000 block:^{
+            [plan valuesForObject:row includeRelationships:NO store:nil];
+        }];
+        
+        NSMutableArray *rows = [NSMutableArray arrayWithCapacity:10000];
+        for (int i = 0; i < 10000; i++) {
+            NSMutableDictionary *numberedRow = [row mutableCopy];
+            [numberedRow setObject:[NSString stringWithFormat:@"%d", i] forKey:@"todo_id"];
+            [rows addObject:numberedRow];
+        }
+        [suite measure:@"serialization.inbound.10000_rows" iterations:10 block:^{
+            for (NSDictionary *numberedRow in rows) {
+                [plan valuesForObject:numberedRow includeRelationships:NO store:nil];
+            }
+        }];
+    });
+    
+    it(@"signs requests", ^{
+        SMOAuth2Client *client = [[SMOAuth2Client alloc] initWithAPIVersion:@"0" scheme:@"https" apiHost:@"api.stackmob.com" publicKey:@"benchmark"];
+        client.accessToken = @"1234567890abcdef";
+        client.macKey = @"fedcba0987654321";
+        [suite measure:@"mac.sign" iterations:20000 block:^{
+            [client createMACHeaderForHttpMethod:@"GET" path:@"/todo?done=false"];
+        }];
+        // Without the clock and nonce generation, only the HMAC and header formatting
+        [suite measure:@"mac.sign.fixed_nonce" iterations:20000 block:^{
+            [client createMACHeaderForHttpMethod:@"GET" path:@"/todo?done=false" timestamp:1337 nonce:@"n0123456789abcdef"];
+        }];
+    });
+    
+    it(@"encodes and decodes base64", ^{
+        NSMutableData *data = [NSMutableData dataWithLength:4096];
+        arc4random_buf([data mutableBytes], [data length]);
+        NSString *encoded = Base64EncodedStringFromData(data);
+        [suite measure:@"base64.encode.4k" iterations:20000 block:^{
+            Base64EncodedStringFromData(data);
+        }];
+        [suite measure:@"base64.decode.4k" iterations:20000 block:^{
+            DataFromBase64EncodedString(encoded);
+        }];
+    });
+    
+    it(@"encodes and decodes base64 of 1 KB, 1 MB and 50 MB", ^{
+        NSArray *names = [NSArray arrayWithObjects:@"1k", @"1m", @"50m", nil];
+        NSArray *lengths = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInteger:1024], [NSNumber numberWithUnsignedInteger:1024 * 1024], [NSNumber numberWithUnsignedInteger:50 * 1024 * 1024], nil];
+        [names enumerateObjectsUsingBlock:^(NSString *name, NSUInteger idx, BOOL *stop) {
+            NSUInteger length = [[lengths objectAtIndex:idx] unsignedIntegerValue];
+            NSMutableData *data = [NSMutableData dataWithLength:length];
+            arc4random_buf([data mutableBytes], length);
+            NSString *encoded = Base64EncodedStringFromData(data);
+            // About 64 MB per run, whatever the input size
+            NSUInteger iterations = MAX(1, (64 * 1024 * 1024) / length);
+            [suite measure:[NSString stringWithFormat:@"base64.encode.%@", name] iterations:iterations block:^{
+                @autoreleasepool {
+                    Base64EncodedStringFromData(data);
+                }
+            }];
+            [suite measure:[NSString stringWithFormat:@"base64.decode.%@", name] iterations:iterations block:^{
+                @autoreleasepool {
+                    DataFromBase64EncodedString(encoded);
+                }
+            }];
+        }];
+    });
+    
+    it(@"reads and writes the cache map", ^{
+        NSEntityDescription *itemEntity = [[NSEntityDescription alloc] init];
+        [itemEntity setName:@"Item"];
+        [itemEntity setProperties:[NSArray arrayWithObject:SMBenchmarkAttribute(@"itemId", NSStringAttributeType)]];
+        NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObject:itemEntity]];
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"benchmark-cachemap"];
+        SMCoreDataStore *coreDataStore = [client coreDataStoreWithManagedObjectModel:model];
+        SMIncrementalStore *store = [[coreDataStore.persistentStoreCoordinator persistentStores] lastObject];
+        
+        // Remote ids mapped to cache object URIs; the whole map is written out each time an entry changes
+        NSMutableDictionary *cacheMap = [NSMutableDictionary dictionaryWithCapacity:10000];
+        for (int i = 0; i < 10000; i++) {
+            [cacheMap setObject:[NSString stringWithFormat:@"x-coredata://CACHE/Item/p%d", i] forKey:[NSString stringWithFormat:@"%d", i]];
+        }
+        store.cacheMappingTable = cacheMap;
+        NSURL *cacheMapURL = [store SM_getStoreURLForCacheMapTable];
+        [store SM_createStoreURLPathIfNeeded:cacheMapURL];
+        
+        [suite measure:@"cachemap.save.10000_entries" iterations:20 block:^{
+            [store SM_saveCacheMap];
+        }];
+        [suite measure:@"cachemap.read.10000_entries" iterations:20 block:^{
+            [store SM_readCacheMap];
+        }];
+        [[NSFileManager defaultManager] removeItemAtURL:cacheMapURL error:nil];
+    });
+    
+    it(@"hands out background contexts under contention", ^{
+        // 64 threads each doing a few units of work which register 20 objects; per-thread contexts keep every object they have seen, pooled contexts are reset after each unit
+        NSEntityDescription *noteEntity = [[NSEntityDescription alloc] init];
+        [noteEntity setName:@"Note"];
+        [noteEntity setProperties:[NSArray arrayWithObjects:SMBenchmarkAttribute(@"noteId", NSStringAttributeType), SMBenchmarkAttribute(@"text", NSStringAttributeType), nil]];
+        NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObject:noteEntity]];
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"benchmark"];
+        SMCoreDataStore *coreDataStore = [client coreDataStoreWithManagedObjectModel:model];
+        void (^unitOfWork)(NSManagedObjectContext *) = ^(NSManagedObjectContext *context) {
+            for (int i = 0; i < 20; i++) {
+                [NSEntityDescription insertNewObjectForEntityForName:@"Note" inManagedObjectContext:context];
+            }
+        };
+        
+        __block NSUInteger objectsLeftRegistered = 0;
+        [suite measure:@"contexts.per_thread.64_threads" iterations:10 block:^{
+            SMBenchmarkRunOnThreads(64, ^(NSUInteger index) {
+                NSManagedObjectContext *context = [coreDataStore contextForCurrentThread];
+                for (int unit = 0; unit < 5; unit++) {
+                    [context performBlockAndWait:^{
+                        unitOfWork(context);
+                    }];
+                }
+                [context performBlockAndWait:^{
+                    @synchronized(coreDataStore) {
+                        objectsLeftRegistered += [[context registeredObjects] count];
+                    }
+                }];
+            });
+        }];
+        NSLog(@"contexts.per_thread.64_threads: %lu objects left registered", (unsigned long)objectsLeftRegistered);
+        
+        objectsLeftRegistered = 0;
+        [suite measure:@"contexts.pool.64_threads" iterations:10 block:^{
+            SMBenchmarkRunOnThreads(64, ^(NSUInteger index) {
+                for (int unit = 0; unit < 5; unit++) {
+                    [coreDataStore performBlockAndWaitWithPooledContext:unitOfWork];
+                }
+            });
+        }];
+        [coreDataStore performBlockAndWaitWithPooledContext:^(NSManagedObjectContext *context) {
+            objectsLeftRegistered += [[context registeredObjects] count];
+        }];
+        NSLog(@"contexts.pool.64_threads: %lu objects left registered", (unsigned long)objectsLeftRegistered);
+    });
+    
+    it(@"records every benchmark under its own name", ^{
+        [[theValue([suite.results count]) should] beGreaterThan:theValue(0)];
+        [[[NSSet setWithArray:[suite.results valueForKey:@"name"]] should] haveCountOf:[suite.results count]];
+    });
+});
+
+SPEC_END
@@ -16,6 +16,7 @@
 
 #import <Kiwi/Kiwi.h>
 #import "SMBinaryDataConversion.h"
+#import "Base64EncodedStringFromData.h"
 
 SPEC_BEGIN(SMBinaryDataConversionSpec)
 
@@ -39,6 +40,13 @@ describe(@"SMBinaryDataConversion init", ^{
         it(@"data should not be nil", ^{
             [fieldValueForBinaryData shouldNotBeNil];
         });
+        it(@"should carry the data base64 encoded after the headers", ^{
+            NSRange bodyStart = [fieldValueForBinaryData rangeOfString:@"\n\n"];
+            [[theValue(bodyStart.location) shouldNot] equal:theValue(NSNotFound)];
+            [[[fieldValueForBinaryData substringToIndex:bodyStart.location] should] equal:@"Content-Type: image/jpeg\nContent-Disposition: attachment; filename=goatPic.jpeg\nContent-Transfer-Encoding: base64"];
+            NSString *body = [fieldValueForBinaryData substringFromIndex:NSMaxRange(bodyStart)];
+            [[DataFromBase64EncodedString(body) should] equal:theData];
+        });
     });
 });
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+
+SPEC_BEGIN(SMCacheStatisticsSpec)
+
+describe(@"SMCacheStatistics", ^{
+    __block SMCacheStatistics *statistics = nil;
+    beforeEach(^{
+        statistics = [[SMCacheStatistics alloc] init];
+    });
+    it(@"counts events in total, per entity and per code path", ^{
+        [statistics recordEvent:SMCacheEventHit entityName:@"Todo" codePath:SMCacheCodePathObjectValues];
+        [statistics recordEvent:SMCacheEventHit entityName:@"Todo" codePath:SMCacheCodePathRelationship];
+        [statistics recordEvent:SMCacheEventHit entityName:@"Person" codePath:SMCacheCodePathObjectValues];
+        [statistics recordEvent:SMCacheEventMiss entityName:@"Todo" codePath:SMCacheCodePathFetch];
+        
+        [[theValue([statistics countForEvent:SMCacheEventHit]) should] equal:theValue(3)];
+        [[theValue([statistics countForEvent:SMCacheEventHit entityName:@"Todo"]) should] equal:theValue(2)];
+        [[theValue([statistics countForEvent:SMCacheEventHit codePath:SMCacheCodePathObjectValues]) should] equal:theValue(2)];
+        [[theValue([statistics countForEvent:SMCacheEventMiss codePath:SMCacheCodePathFetch]) should] equal:theValue(1)];
+        [[theValue([statistics countForEvent:SMCacheEventMiss entityName:@"Person"]) should] equal:theValue(0)];
+        [[theValue([statistics countForEvent:SMCacheEventPurge entityName:@"Unknown"]) should] equal:theValue(0)];
+    });
+    it(@"counts events without an entity or code path in the total only", ^{
+        [statistics recordEvent:SMCacheEventSave entityName:nil codePath:nil];
+        [statistics recordEvent:SMCacheEventPurge entityName:@"Todo" codePath:nil];
+        [[theValue([statistics countForEvent:SMCacheEventSave]) should] equal:theValue(1)];
+        [[theValue([statistics countForEvent:SMCacheEventPurge entityName:@"Todo"]) should] equal:theValue(1)];
+        [[[[statistics dictionaryRepresentation] objectForKey:@"codePaths"] should] beEmpty];
+    });
+    it(@"computes hit rates with reference-only rows as lookups", ^{
+        [[theValue([statistics hitRateForEntityName:@"Todo"]) should] equal:theValue(0)];
+        [statistics recordEvent:SMCacheEventHit entityName:@"Todo" codePath:nil];
+        [statistics recordEvent:SMCacheEventHit entityName:@"Todo" codePath:nil];
+        [statistics recordEvent:SMCacheEventMiss entityName:@"Todo" codePath:nil];
+        [statistics recordEvent:SMCacheEventReferenceOnlyFetch entityName:@"Todo" codePath:nil];
+        [statistics recordEvent:SMCacheEventMiss entityName:@"Person" codePath:nil];
+        [[theValue([statistics hitRateForEntityName:@"Todo"]) should] equal:theValue(0.5)];
+        [[theValue([statistics hitRateForEntityName:nil]) should] equal:theValue(0.4)];
+    });
+    it(@"describes itself as a dictionary", ^{
+        [statistics recordEvent:SMCacheEventRelationshipFaultFromNetwork entityName:@"Todo" codePath:SMCacheCodePathRelationship];
+        NSDictionary *dictionary = [statistics dictionaryRepresentation];
+        [[[[dictionary objectForKey:@"total"] objectForKey:@"relationshipFaultsFromNetwork"] should] equal:[NSNumber numberWithInt:1]];
+        [[[[[dictionary objectForKey:@"entities"] objectForKey:@"Todo"] objectForKey:@"relationshipFaultsFromNetwork"] should] equal:[NSNumber numberWithInt:1]];
+        [[[[[dictionary objectForKey:@"codePaths"] objectForKey:SMCacheCodePathRelationship] objectForKey:@"hits"] should] equal:[NSNumber numberWithInt:0]];
+    });
+    it(@"resets", ^{
+        [statistics recordEvent:SMCacheEventHit entityName:@"Todo" codePath:SMCacheCodePathFetch];
+        [statistics reset];
+        [[theValue([statistics countForEvent:SMCacheEventHit]) should] equal:theValue(0)];
+        [[[[statistics dictionaryRepresentation] objectForKey:@"entities"] should] beEmpty];
+    });
+    it(@"is created with each SMCoreDataStore", ^{
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"1" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        SMCoreDataStore *coreDataStore = [client coreDataStoreWithManagedObjectModel:[NSManagedObjectModel mergedModelFromBundles:[NSBundle allBundles]]];
+        [[coreDataStore cacheStatistics] shouldNotBeNil];
+    });
+});
+
+SPEC_END
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "SMCircuitBreaker.h"
+
+static NSHTTPURLResponse *SMResponseWithStatusCode(NSURLRequest *request, NSInteger statusCode)
+{
+    return [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:nil];
+}
+
+SPEC_BEGIN(SMCircuitBreakerSpec)
+
+describe(@"SMCircuitBreaker", ^{
+    __block SMCircuitBreaker *breaker = nil;
+    __block NSURLRequest *request = nil;
+    __block NSString *key = nil;
+    beforeEach(^{
+        breaker = [[SMCircuitBreaker alloc] init];
+        request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://api.stackmob.com/Todo/1234"]];
+        key = [SMCircuitBreaker keyForRequest:request];
+    });
+    it(@"groups requests by host and schema", ^{
+        [[key should] equal:@"api.stackmob.com/todo"];
+        NSURLRequest *otherObject = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://api.stackmob.com/todo?name=a"]];
+        [[[SMCircuitBreaker keyForRequest:otherObject] should] equal:key];
+    });
+    it(@"opens after consecutive failures", ^{
+        for (int i = 0; i < 4; i++) {
+            [breaker recordResponse:SMResponseWithStatusCode(request, 503) error:nil forRequest:request];
+        }
+        [[theValue([breaker allowRequest:request]) should] beYes];
+        [breaker recordResponse:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil] forRequest:request];
+        [[theValue([breaker stateForKey:key]) should] equal:theValue(SMCircuitStateOpen)];
+        [[theValue([breaker allowRequest:request]) should] beNo];
+    });
+    it(@"opens when the error rate is too high", ^{
+        for (int i = 0; i < 10; i++) {
+            NSInteger statusCode = i % 2 == 0 ? 500 : 200;
+            [breaker recordResponse:SMResponseWithStatusCode(request, statusCode) error:nil forRequest:request];
+        }
+        [[theValue([breaker stateForKey:key]) should] equal:theValue(SMCircuitStateOpen)];
+    });
+    it(@"does not count client errors or other schemas", ^{
+        NSURLRequest *otherSchema = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://api.stackmob.com/user"]];
+        for (int i = 0; i < 10; i++) {
+            [breaker recordResponse:SMResponseWithStatusCode(request, 404) error:nil forRequest:request];
+            [breaker recordResponse:SMResponseWithStatusCode(otherSchema, 500) error:nil forRequest:otherSchema];
+        }
+        [[theValue([breaker allowRequest:request]) should] beYes];
+        [[theValue([breaker allowRequest:otherSchema]) should] beNo];
+    });
+    context(@"once the open interval has passed", ^{
+        beforeEach(^{
+            breaker.openInterval = 0;
+            for (int i = 0; i < 5; i++) {
+                [breaker recordResponse:SMResponseWithStatusCode(request, 500) error:nil forRequest:request];
+            }
+        });
+        it(@"lets a single probe through", ^{
+            breaker.openInterval = 0.5;
+            [NSThread sleepForTimeInterval:0.6];
+            [[theValue([breaker allowRequest:request]) should] beYes];
+            [[theValue([breaker stateForKey:key]) should] equal:theValue(SMCircuitStateHalfOpen)];
+            [[theValue([breaker allowRequest:request]) should] beNo];
+        });
+        it(@"closes when the probe succeeds", ^{
+            [[theValue([breaker allowRequest:request]) should] beYes];
+            [breaker recordResponse:SMResponseWithStatusCode(request, 200) error:nil forRequest:request];
+            [[theValue([breaker stateForKey:key]) should] equal:theValue(SMCircuitStateClosed)];
+        });
+        it(@"reopens when the probe fails", ^{
+            [[theValue([breaker allowRequest:request]) should] beYes];
+            [breaker recordResponse:SMResponseWithStatusCode(request, 502) error:nil forRequest:request];
+            [[theValue([breaker stateForKey:key]) should] equal:theValue(SMCircuitStateOpen)];
+        });
+    });
+});
+
+SPEC_END
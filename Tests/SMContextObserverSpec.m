@@ -0,0 +1,175 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "SMContextObserver.h"
+#import "NSManagedObjectContext+Concurrency.h"
+
+static NSEntityDescription *SMContextObserverSpecEntity(NSString *name, NSString *attributeName)
+{
+    NSAttributeDescription *attribute = [[NSAttributeDescription alloc] init];
+    [attribute setName:attributeName];
+    [attribute setAttributeType:NSStringAttributeType];
+    [attribute setOptional:YES];
+    NSEntityDescription *entity = [[NSEntityDescription alloc] init];
+    [entity setName:name];
+    [entity setProperties:[NSArray arrayWithObject:attribute]];
+    return entity;
+}
+
+static NSManagedObjectID *SMContextObserverSpecSave(NSManagedObjectContext *context, NSString *entityName, NSString *key, NSString *value)
+{
+    __block NSManagedObjectID *objectID = nil;
+    [context performBlockAndWait:^{
+        NSManagedObject *object = [NSEntityDescription insertNewObjectForEntityForName:entityName inManagedObjectContext:context];
+        [object setValue:value forKey:key];
+        [context obtainPermanentIDsForObjects:[NSArray arrayWithObject:object] error:NULL];
+        [context save:NULL];
+        objectID = [object objectID];
+    }];
+    return objectID;
+}
+
+SPEC_BEGIN(SMContextObserverSpec)
+
+describe(@"SMContextObserver", ^{
+    __block NSManagedObjectContext *savingContext = nil;
+    __block NSManagedObjectContext *observingContext = nil;
+    __block NSMutableArray *changeNotifications = nil;
+    __block id changeObserver = nil;
+    beforeEach(^{
+        NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObjects:SMContextObserverSpecEntity(@"Note", @"text"), SMContextObserverSpecEntity(@"Tag", @"name"), nil]];
+        NSPersistentStoreCoordinator *coordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
+        [coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:nil URL:nil options:nil error:NULL];
+        savingContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+        [savingContext setPersistentStoreCoordinator:coordinator];
+        observingContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSMainQueueConcurrencyType];
+        [observingContext setPersistentStoreCoordinator:coordinator];
+        
+        changeNotifications = [NSMutableArray array];
+        changeObserver = [[NSNotificationCenter defaultCenter] addObserverForName:NSManagedObjectContextObjectsDidChangeNotification object:observingContext queue:nil usingBlock:^(NSNotification *note) {
+            [changeNotifications addObject:note];
+        }];
+    });
+    afterEach(^{
+        [observingContext stopObservingContext:savingContext];
+        [[NSNotificationCenter defaultCenter] removeObserver:changeObserver];
+    });
+    it(@"merges only inserts of observed entities which match the predicate", ^{
+        [observingContext observeContext:savingContext entityNames:[NSArray arrayWithObject:@"Note"] predicate:[NSPredicate predicateWithFormat:@"text BEGINSWITH 'a'"] mergeInterval:0];
+        NSManagedObjectID *appleID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apple");
+        SMContextObserverSpecSave(savingContext, @"Note", @"text", @"banana");
+        SMContextObserverSpecSave(savingContext, @"Tag", @"name", @"avocado");
+        
+        [[expectFutureValue(theValue([changeNotifications count])) shouldEventually] beGreaterThan:theValue(0)];
+        NSSet *inserted = [[[changeNotifications objectAtIndex:0] userInfo] objectForKey:NSInsertedObjectsKey];
+        [[theValue([inserted count]) should] equal:theValue(1)];
+        [[[[inserted anyObject] objectID] should] equal:appleID];
+    });
+    it(@"refreshes only updated objects the observing context has registered", ^{
+        NSManagedObjectID *registeredID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apple");
+        NSManagedObjectID *unregisteredID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apricot");
+        NSManagedObject *registered = [observingContext existingObjectWithID:registeredID error:NULL];
+        [[[registered valueForKey:@"text"] should] equal:@"apple"];
+        
+        [observingContext observeContext:savingContext entityNames:nil predicate:nil mergeInterval:0];
+        [savingContext performBlockAndWait:^{
+            [[savingContext objectWithID:registeredID] setValue:@"avocado" forKey:@"text"];
+            [[savingContext objectWithID:unregisteredID] setValue:@"almond" forKey:@"text"];
+            [savingContext save:NULL];
+        }];
+        
+        [[expectFutureValue([registered valueForKey:@"text"]) shouldEventually] equal:@"avocado"];
+        [[observingContext objectRegisteredForID:unregisteredID] shouldBeNil];
+    });
+    it(@"refreshes registered objects edited so they no longer match the predicate", ^{
+        NSManagedObjectID *registeredID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apple");
+        NSManagedObject *registered = [observingContext existingObjectWithID:registeredID error:NULL];
+        [[[registered valueForKey:@"text"] should] equal:@"apple"];
+        
+        [observingContext observeContext:savingContext entityNames:nil predicate:[NSPredicate predicateWithFormat:@"text BEGINSWITH 'a'"] mergeInterval:0];
+        [savingContext performBlockAndWait:^{
+            [[savingContext objectWithID:registeredID] setValue:@"banana" forKey:@"text"];
+            [savingContext save:NULL];
+        }];
+        
+        [[expectFutureValue([registered valueForKey:@"text"]) shouldEventually] equal:@"banana"];
+    });
+    it(@"merges unregistered objects edited so they match the predicate", ^{
+        NSManagedObjectID *unregisteredID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"banana");
+        NSManagedObjectID *unmatchedID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"cherry");
+        
+        [observingContext observeContext:savingContext entityNames:nil predicate:[NSPredicate predicateWithFormat:@"text BEGINSWITH 'a'"] mergeInterval:0];
+        [savingContext performBlockAndWait:^{
+            [[savingContext objectWithID:unregisteredID] setValue:@"apple" forKey:@"text"];
+            [[savingContext objectWithID:unmatchedID] setValue:@"coconut" forKey:@"text"];
+            [savingContext save:NULL];
+        }];
+        
+        [[expectFutureValue([observingContext objectRegisteredForID:unregisteredID]) shouldEventually] beNonNil];
+        [[observingContext objectRegisteredForID:unmatchedID] shouldBeNil];
+    });
+    it(@"forgets the observing context once invalidated", ^{
+        SMContextObserver *observer = [[SMContextObserver alloc] initWithObservingContext:observingContext observedContext:savingContext entityNames:nil predicate:nil mergeInterval:0.2];
+        SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apple");
+        [observer invalidate];
+        
+        [observer.observingContext shouldBeNil];
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+        [[theValue([changeNotifications count]) should] equal:theValue(0)];
+    });
+    it(@"does not merge into an observing context which has been deallocated", ^{
+        @autoreleasepool {
+            NSManagedObjectContext *shortLivedContext = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+            [shortLivedContext setPersistentStoreCoordinator:[savingContext persistentStoreCoordinator]];
+            [shortLivedContext observeContext:savingContext entityNames:nil predicate:nil mergeInterval:0.2];
+            SMContextObserverSpecSave(savingContext, @"Note", @"text", @"apple");
+        }
+        
+        // The pending merge is dropped rather than sent to the deallocated context
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+        SMContextObserverSpecSave(savingContext, @"Note", @"text", @"banana");
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    });
+    it(@"merges saves made within the merge interval together", ^{
+        [observingContext observeContext:savingContext entityNames:nil predicate:nil mergeInterval:0.5];
+        for (int i = 0; i < 5; i++) {
+            SMContextObserverSpecSave(savingContext, @"Note", @"text", [NSString stringWithFormat:@"note %d", i]);
+        }
+        NSManagedObjectID *deletedID = SMContextObserverSpecSave(savingContext, @"Note", @"text", @"short lived");
+        [savingContext performBlockAndWait:^{
+            [savingContext deleteObject:[savingContext objectWithID:deletedID]];
+            [savingContext save:NULL];
+        }];
+        
+        [[expectFutureValue(theValue([changeNotifications count])) shouldEventuallyBeforeTimingOutAfter(3.0)] beGreaterThan:theValue(0)];
+        NSDictionary *userInfo = [[changeNotifications objectAtIndex:0] userInfo];
+        [[theValue([[userInfo objectForKey:NSInsertedObjectsKey] count]) should] equal:theValue(5)];
+        [[theValue([[userInfo objectForKey:NSDeletedObjectsKey] count]) should] equal:theValue(0)];
+    });
+    it(@"stops merging after stopObservingContext:", ^{
+        [observingContext observeContext:savingContext entityNames:nil predicate:nil mergeInterval:0.2];
+        SMContextObserverSpecSave(savingContext, @"Note", @"text", @"dropped");
+        [observingContext stopObservingContext:savingContext];
+        SMContextObserverSpecSave(savingContext, @"Note", @"text", @"ignored");
+        
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+        [[theValue([changeNotifications count]) should] equal:theValue(0)];
+    });
+});
+
+SPEC_END
@@ -75,6 +75,56 @@ describe(@"SMCoreDataStore", ^{
             });
 
         });
+        describe(@"queue contexts", ^{
+            it(@"gives each queue its own context", ^{
+                dispatch_queue_t firstQueue = dispatch_queue_create("com.stackmob.spec.first", NULL);
+                dispatch_queue_t secondQueue = dispatch_queue_create("com.stackmob.spec.second", NULL);
+                NSManagedObjectContext *firstContext = [coreDataStore contextForQueue:firstQueue];
+                [[theValue([firstContext concurrencyType]) should] equal:theValue(NSPrivateQueueConcurrencyType)];
+                [[[firstContext parentContext] should] equal:coreDataStore.mainThreadContext];
+                [[theValue([coreDataStore contextForQueue:firstQueue] == firstContext) should] beYes];
+                [[theValue([coreDataStore contextForQueue:secondQueue] == firstContext) should] beNo];
+                [[theValue([coreDataStore contextForQueue:dispatch_get_main_queue()] == coreDataStore.mainThreadContext) should] beYes];
+                
+                __block NSManagedObjectContext *currentContext = nil;
+                dispatch_sync(firstQueue, ^{
+                    currentContext = [coreDataStore contextForCurrentThread];
+                });
+                [[theValue(currentContext == firstContext) should] beYes];
+                dispatch_release(firstQueue);
+                dispatch_release(secondQueue);
+            });
+        });
+        describe(@"pooled contexts", ^{
+            it(@"reuses a bounded number of contexts and resets them between uses", ^{
+                coreDataStore.maxPooledContexts = 2;
+                NSString *entityName = [[[mom entities] objectAtIndex:0] name];
+                NSMutableSet *contextsUsed = [NSMutableSet set];
+                __block NSUInteger dirtyContexts = 0;
+                dispatch_group_t group = dispatch_group_create();
+                for (int i = 0; i < 64; i++) {
+                    dispatch_group_enter(group);
+                    [coreDataStore performBlockWithPooledContext:^(NSManagedObjectContext *context) {
+                        @synchronized(contextsUsed) {
+                            [contextsUsed addObject:[NSValue valueWithNonretainedObject:context]];
+                            if ([[context registeredObjects] count] > 0) {
+                                dirtyContexts++;
+                            }
+                        }
+                        [NSEntityDescription insertNewObjectForEntityForName:entityName inManagedObjectContext:context];
+                        dispatch_group_leave(group);
+                    }];
+                }
+                dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+                dispatch_release(group);
+                [coreDataStore performBlockAndWaitWithPooledContext:^(NSManagedObjectContext *context) {
+                    [contextsUsed addObject:[NSValue valueWithNonretainedObject:context]];
+                    [[[context registeredObjects] should] beEmpty];
+                }];
+                [[theValue([contextsUsed count]) should] beLessThanOrEqualTo:theValue(2)];
+                [[theValue(dirtyContexts) should] equal:theValue(0)];
+            });
+        });
         describe(@"after initializing, can set merge policy", ^{
             NSManagedObjectContext *theContext = [coreDataStore contextForCurrentThread];
             [theContext shouldNotBeNil];
@@ -16,6 +16,7 @@
 
 #import <Kiwi/Kiwi.h>
 #import "StackMob.h"
+#import "SMDataStore+Protected.h"
 
 SPEC_BEGIN(SMDataStoreSpec)
 
@@ -324,6 +325,183 @@ describe(@"performing counts", ^{
     });        
 });
 
+describe(@"single-flight reads", ^{
+    __block SMDataStore *dataStore = nil;
+    __block NSMutableURLRequest *request = nil;
+    beforeEach(^{
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        dataStore = [[SMDataStore alloc] initWithAPIVersion:@"0" session:client.session];
+        dataStore.session.regularOAuthClient = [SMOAuth2Client nullMock];
+        request = [[NSMutableURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://stackmob.com/book/1234"]];
+        [request setHTTPMethod:@"GET"];
+    });
+    it(@"ignores the Authorization header when building the key", ^{
+        NSMutableURLRequest *otherRequest = [request mutableCopy];
+        [request setValue:@"MAC id=\"a\",nonce=\"n1\"" forHTTPHeaderField:@"Authorization"];
+        [otherRequest setValue:@"MAC id=\"a\",nonce=\"n2\"" forHTTPHeaderField:@"Authorization"];
+        [[[dataStore singleFlightKeyForRequest:request] should] equal:[dataStore singleFlightKeyForRequest:otherRequest]];
+    });
+    it(@"distinguishes requests with different Range headers", ^{
+        NSMutableURLRequest *otherRequest = [request mutableCopy];
+        [request setValue:@"objects=0-9" forHTTPHeaderField:@"Range"];
+        [otherRequest setValue:@"objects=10-19" forHTTPHeaderField:@"Range"];
+        [[[dataStore singleFlightKeyForRequest:request] shouldNot] equal:[dataStore singleFlightKeyForRequest:otherRequest]];
+    });
+    it(@"enqueues one operation for identical concurrent reads", ^{
+        [[dataStore.session.regularOAuthClient should] receive:@selector(requestWithMethod:path:parameters:) andReturn:request withCount:2];
+        AFJSONRequestOperation *operation = [[AFJSONRequestOperation alloc] init];
+        [[SMJSONRequestOperation should] receive:@selector(JSONRequestOperationWithRequest:success:failure:) andReturn:operation withCount:1];
+        [[dataStore.session.regularOAuthClient should] receive:@selector(enqueueHTTPRequestOperation:) withCount:1];
+        [dataStore readObjectWithId:@"1234" inSchema:@"book" onSuccess:nil onFailure:nil];
+        [dataStore readObjectWithId:@"1234" inSchema:@"book" onSuccess:nil onFailure:nil];
+    });
+    it(@"fans the response out to every caller", ^{
+        [[dataStore.session.regularOAuthClient should] receive:@selector(requestWithMethod:path:parameters:) andReturn:request withCount:2];
+        KWCaptureSpy *successSpy = [SMJSONRequestOperation captureArgument:@selector(JSONRequestOperationWithRequest:success:failure:) atIndex:1];
+        __block int successBlockCalls = 0;
+        SMDataStoreSuccessBlock successBlock = ^(NSDictionary *theObject, NSString *schema) {
+            [[[theObject objectForKey:@"book_id"] should] equal:@"1234"];
+            successBlockCalls++;
+        };
+        [dataStore readObjectWithId:@"1234" inSchema:@"book" onSuccess:successBlock onFailure:nil];
+        [dataStore readObjectWithId:@"1234" inSchema:@"book" onSuccess:successBlock onFailure:nil];
+        
+        SMFullResponseSuccessBlock sharedSuccessBlock = successSpy.argument;
+        sharedSuccessBlock(request, nil, [NSDictionary dictionaryWithObject:@"1234" forKey:@"book_id"]);
+        [[expectFutureValue(theValue(successBlockCalls)) shouldEventually] equal:theValue(2)];
+    });
+    it(@"does not share non-GET requests", ^{
+        NSMutableURLRequest *postRequest = [[NSMutableURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://stackmob.com/book"]];
+        [postRequest setHTTPMethod:@"POST"];
+        [[dataStore.session.regularOAuthClient should] receive:@selector(requestWithMethod:path:parameters:) andReturn:postRequest withCount:2];
+        [[dataStore.session.regularOAuthClient should] receive:@selector(enqueueHTTPRequestOperation:) withCount:2];
+        NSDictionary *book = [NSDictionary dictionaryWithObject:@"title" forKey:@"title"];
+        [dataStore createObject:book inSchema:@"book" onSuccess:nil onFailure:nil];
+        [dataStore createObject:book inSchema:@"book" onSuccess:nil onFailure:nil];
+    });
+});
+
+describe(@"circuit breaking", ^{
+    __block SMDataStore *dataStore = nil;
+    __block NSMutableURLRequest *request = nil;
+    beforeEach(^{
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        dataStore = [[SMDataStore alloc] initWithAPIVersion:@"0" session:client.session];
+        dataStore.session.regularOAuthClient = [SMOAuth2Client nullMock];
+        request = [[NSMutableURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://stackmob.com/book/1234"]];
+        [request setHTTPMethod:@"GET"];
+        NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:503 HTTPVersion:@"HTTP/1.1" headerFields:nil];
+        for (int i = 0; i < 5; i++) {
+            [dataStore.session.circuitBreaker recordResponse:response error:nil forRequest:request];
+        }
+    });
+    it(@"fails fast as not reachable while the circuit is open", ^{
+        [[dataStore.session.regularOAuthClient should] receive:@selector(requestWithMethod:path:parameters:) andReturn:request];
+        [[dataStore.session.regularOAuthClient shouldNot] receive:@selector(enqueueHTTPRequestOperation:)];
+        __block NSError *readError = nil;
+        [dataStore readObjectWithId:@"1234" inSchema:@"book" onSuccess:nil onFailure:^(NSError *theError, NSString *objectId, NSString *schema) {
+            readError = theError;
+        }];
+        [[expectFutureValue(theValue([readError code])) shouldEventually] equal:theValue(SMErrorNetworkNotReachable)];
+    });
+    it(@"still sends requests for other schemas", ^{
+        NSMutableURLRequest *otherRequest = [[NSMutableURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://stackmob.com/author/1234"]];
+        [otherRequest setHTTPMethod:@"GET"];
+        [[dataStore.session.regularOAuthClient should] receive:@selector(requestWithMethod:path:parameters:) andReturn:otherRequest];
+        [[dataStore.session.regularOAuthClient should] receive:@selector(enqueueHTTPRequestOperation:) withCount:1];
+        [dataStore readObjectWithId:@"1234" inSchema:@"author" onSuccess:nil onFailure:nil];
+    });
+});
+
+describe(@"paged queries", ^{
+    __block SMDataStore *dataStore = nil;
+    beforeEach(^{
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        dataStore = [[SMDataStore alloc] initWithAPIVersion:@"0" session:client.session];
+    });
+    it(@"fails with a page size of zero", ^{
+        __block NSError *pageError = nil;
+        SMQuery *query = [[SMQuery alloc] initWithSchema:@"book"];
+        [dataStore performQuery:query options:[SMRequestOptions options] pageSize:0 maxConcurrentPages:4 successCallbackQueue:nil failureCallbackQueue:nil onPage:nil onSuccess:nil onFailure:^(NSError *error) {
+            pageError = error;
+        }];
+        [[theValue([pageError code]) should] equal:theValue(SMErrorInvalidArguments)];
+    });
+    it(@"requests the first page on its own", ^{
+        KWCaptureSpy *requestSpy = [dataStore captureArgument:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:0];
+        [[dataStore should] receive:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) withCount:1];
+        SMQuery *query = [[SMQuery alloc] initWithSchema:@"book"];
+        [dataStore performQuery:query options:[SMRequestOptions options] pageSize:50 maxConcurrentPages:4 successCallbackQueue:nil failureCallbackQueue:nil onPage:nil onSuccess:nil onFailure:nil];
+        [[expectFutureValue([requestSpy.argument valueForHTTPHeaderField:@"Range"]) shouldEventually] equal:@"objects=0-49"];
+    });
+    it(@"parses each page as it downloads", ^{
+        KWCaptureSpy *optionsSpy = [dataStore captureArgument:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:1];
+        [[dataStore should] receive:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) withCount:1];
+        SMQuery *query = [[SMQuery alloc] initWithSchema:@"book"];
+        [dataStore performQuery:query options:[SMRequestOptions options] pageSize:50 maxConcurrentPages:4 successCallbackQueue:nil failureCallbackQueue:nil onPage:nil onSuccess:nil onFailure:nil];
+        [[expectFutureValue([optionsSpy.argument streamingBatchBlock]) shouldEventually] beNonNil];
+    });
+});
+
+describe(@"refreshing and retrying", ^{
+    __block SMDataStore *dataStore = nil;
+    __block NSMutableURLRequest *request = nil;
+    __block SMRequestOptions *options = nil;
+    beforeEach(^{
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        dataStore = [[SMDataStore alloc] initWithAPIVersion:@"0" session:client.session];
+        dataStore.session.regularOAuthClient = [SMOAuth2Client nullMock];
+        request = [[NSMutableURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://stackmob.com/book"]];
+        [request setHTTPMethod:@"GET"];
+        options = [SMRequestOptions options];
+        options.streamingBatchBlock = ^(NSArray *results) {};
+        options.streamingBatchSize = 10;
+    });
+    it(@"streams the retried query after a 401", ^{
+        KWCaptureSpy *failureSpy = [SMStreamingJSONRequestOperation captureArgument:@selector(JSONRequestOperationWithRequest:batchSize:batchBlock:success:failure:) atIndex:4];
+        [[SMStreamingJSONRequestOperation should] receive:@selector(JSONRequestOperationWithRequest:batchSize:batchBlock:success:failure:) withCount:2];
+        KWCaptureSpy *refreshSpy = [dataStore.session captureArgument:@selector(refreshTokenWithSuccessCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:2];
+        [[dataStore.session should] receive:@selector(refreshTokenWithSuccessCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) withCount:1];
+        [dataStore queueRequest:request options:options successCallbackQueue:nil failureCallbackQueue:nil onSuccess:nil onFailure:nil];
+
+        SMFullResponseFailureBlock failureBlock = failureSpy.argument;
+        NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:401 HTTPVersion:@"HTTP/1.1" headerFields:nil];
+        failureBlock(request, response, nil, nil);
+
+        void (^refreshSuccessBlock)(NSDictionary *) = refreshSpy.argument;
+        refreshSuccessBlock(nil);
+    });
+    it(@"does not refresh again for the retried query", ^{
+        KWCaptureSpy *optionsSpy = [dataStore captureArgument:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:1];
+        [[dataStore should] receive:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) withCount:1];
+        KWCaptureSpy *refreshSpy = [dataStore.session captureArgument:@selector(refreshTokenWithSuccessCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:2];
+        [dataStore.session stub:@selector(refreshTokenWithSuccessCallbackQueue:failureCallbackQueue:onSuccess:onFailure:)];
+        [dataStore refreshAndRetry:request options:options originalError:nil requestSuccessCallbackQueue:nil requestFailureCallbackQueue:nil onSuccess:nil onFailure:nil];
+
+        void (^refreshSuccessBlock)(NSDictionary *) = refreshSpy.argument;
+        refreshSuccessBlock(nil);
+        SMRequestOptions *retryOptions = optionsSpy.argument;
+        [[theValue(retryOptions.tryRefreshToken) should] beNo];
+        [[retryOptions.streamingBatchBlock should] equal:options.streamingBatchBlock];
+        [[theValue(retryOptions.streamingBatchSize) should] equal:theValue(10)];
+        [[theValue(options.tryRefreshToken) should] beYes];
+    });
+    it(@"does not retry a query which fails mid-stream", ^{
+        SMStreamingJSONRequestOperation *operation = [SMStreamingJSONRequestOperation nullMock];
+        [operation stub:@selector(hasDeliveredRows) andReturn:theValue(YES)];
+        KWCaptureSpy *failureSpy = [SMStreamingJSONRequestOperation captureArgument:@selector(JSONRequestOperationWithRequest:batchSize:batchBlock:success:failure:) atIndex:4];
+        [[SMStreamingJSONRequestOperation should] receive:@selector(JSONRequestOperationWithRequest:batchSize:batchBlock:success:failure:) andReturn:operation withCount:1];
+        __block NSError *queryError = nil;
+        [dataStore queueRequest:request options:options successCallbackQueue:nil failureCallbackQueue:nil onSuccess:nil onFailure:^(NSURLRequest *failedRequest, NSHTTPURLResponse *response, NSError *error, id JSON) {
+            queryError = error;
+        }];
+
+        SMFullResponseFailureBlock failureBlock = failureSpy.argument;
+        failureBlock(request, nil, [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil], nil);
+        [[theValue([queryError code]) should] equal:theValue(NSURLErrorNetworkConnectionLost)];
+    });
+});
+
 describe(@"perform custom code request", ^{
     context(@"given a custom code request", ^{
         __block SMCustomCodeRequest *customCodeRequest = nil;
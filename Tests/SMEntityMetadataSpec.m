@@ -0,0 +1,103 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "SMError.h"
+#import "SMEntityMetadata.h"
+#import "NSEntityDescription+StackMobSerialization.h"
+
+static NSAttributeDescription * SMStringAttribute(NSString *name)
+{
+    NSAttributeDescription *attribute = [[NSAttributeDescription alloc] init];
+    [attribute setName:name];
+    [attribute setAttributeType:NSStringAttributeType];
+    return attribute;
+}
+
+SPEC_BEGIN(SMEntityMetadataSpec)
+
+describe(@"SMEntityMetadata", ^{
+    __block NSManagedObjectModel *model = nil;
+    __block NSEntityDescription *mapEntity = nil;
+    __block NSEntityDescription *userEntity = nil;
+    beforeEach(^{
+        mapEntity = [[NSEntityDescription alloc] init];
+        [mapEntity setName:@"Map"];
+        NSRelationshipDescription *owner = [[NSRelationshipDescription alloc] init];
+        [owner setName:@"mapOwner"];
+        [mapEntity setProperties:[NSArray arrayWithObjects:SMStringAttribute(@"mapId"), SMStringAttribute(@"name"), SMStringAttribute(@"camelCase"), SMStringAttribute(@"camel_case"), SMStringAttribute(@"PoorlyNamed"), owner, nil]];
+        
+        userEntity = [[NSEntityDescription alloc] init];
+        [userEntity setName:@"User"];
+        [userEntity setProperties:[NSArray arrayWithObjects:SMStringAttribute(@"username"), SMStringAttribute(@"firstName"), nil]];
+        [owner setDestinationEntity:userEntity];
+        
+        model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObjects:mapEntity, userEntity, nil]];
+    });
+    
+    it(@"is only available once the model is registered", ^{
+        [[SMEntityMetadata metadataForEntity:mapEntity] shouldBeNil];
+        [SMEntityMetadata registerModel:model userSchema:@"user" userPrimaryKeyField:@"username"];
+        [[SMEntityMetadata metadataForEntity:mapEntity] shouldNotBeNil];
+    });
+    
+    context(@"once registered", ^{
+        __block SMEntityMetadata *mapMetadata = nil;
+        __block SMEntityMetadata *userMetadata = nil;
+        beforeEach(^{
+            [SMEntityMetadata registerModel:model userSchema:@"user" userPrimaryKeyField:@"username"];
+            mapMetadata = [SMEntityMetadata metadataForEntity:mapEntity];
+            userMetadata = [SMEntityMetadata metadataForEntity:userEntity];
+        });
+        it(@"compiles the schema and primary key", ^{
+            [[mapMetadata.schema should] equal:@"map"];
+            [[mapMetadata.primaryKeyField should] equal:@"mapId"];
+            [[mapMetadata.SMPrimaryKeyField should] equal:@"map_id"];
+            [[theValue(mapMetadata.isUserSchema) should] beNo];
+        });
+        it(@"uses the user primary key for the user schema", ^{
+            [userMetadata.declaredPrimaryKeyField shouldBeNil];
+            [[userMetadata.primaryKeyField should] equal:@"username"];
+            [[theValue(userMetadata.isUserSchema) should] beYes];
+        });
+        it(@"maps field names in both directions", ^{
+            [[[mapMetadata fieldNameForPropertyName:@"mapOwner"] should] equal:@"map_owner"];
+            [[[[mapMetadata propertyForFieldName:@"map_owner"] name] should] equal:@"mapOwner"];
+            [[mapMetadata propertyForFieldName:@"missing"] shouldBeNil];
+        });
+        it(@"prefers properties whose names match exactly", ^{
+            [[[[mapMetadata propertyForFieldName:@"camel_case"] name] should] equal:@"camel_case"];
+        });
+        it(@"records relationship destinations", ^{
+            [[[mapMetadata destinationSchemaForRelationshipName:@"mapOwner"] should] equal:@"user"];
+        });
+        it(@"is used by the serialization category", ^{
+            [[[mapEntity primaryKeyField] should] equal:@"mapId"];
+            [[[mapEntity SMPrimaryKeyField] should] equal:@"map_id"];
+            [[mapEntity propertyForSMFieldName:@"first_name"] shouldBeNil];
+            [[[[userEntity propertyForSMFieldName:@"first_name"] name] should] equal:@"firstName"];
+        });
+        it(@"still raises for properties beginning with a capital letter", ^{
+            [[theBlock(^{
+                [mapEntity SMFieldNameForProperty:[[mapEntity propertiesByName] objectForKey:@"PoorlyNamed"]];
+            }) should] raiseWithName:SMExceptionIncompatibleObject];
+        });
+    });
+});
+
+SPEC_END
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+#import "SMJSONBodyStream.h"
+#import "Base64EncodedStringFromData.h"
+
+static NSData * SMDataFromBodyStream(NSInputStream *stream)
+{
+    NSMutableData *body = [NSMutableData data];
+    uint8_t buffer[1000];
+    [stream open];
+    NSInteger bytesRead;
+    while ((bytesRead = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+        [body appendBytes:buffer length:bytesRead];
+    }
+    [stream close];
+    return body;
+}
+
+SPEC_BEGIN(SMJSONBodyStreamSpec)
+
+describe(@"SMJSONBodyStream", ^{
+    __block NSData *content = nil;
+    __block NSURL *fileURL = nil;
+    beforeEach(^{
+        NSMutableData *randomContent = [NSMutableData dataWithLength:100001];
+        arc4random_buf([randomContent mutableBytes], [randomContent length]);
+        content = randomContent;
+        fileURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"SMJSONBodyStreamSpec.bin"]];
+        [content writeToURL:fileURL atomically:YES];
+    });
+    afterEach(^{
+        [[NSFileManager defaultManager] removeItemAtURL:fileURL error:nil];
+    });
+    it(@"only streams objects with binary content", ^{
+        NSDictionary *plain = [NSDictionary dictionaryWithObject:@"Content-Type: is just text" forKey:@"title"];
+        [[theValue([SMJSONBodyStream JSONObjectRequiresStreaming:plain]) should] beNo];
+        NSDictionary *reference = [NSDictionary dictionaryWithObject:[SMBinaryDataConversion stringForBinaryDataAtURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"] forKey:@"file"];
+        [[theValue([SMJSONBodyStream JSONObjectRequiresStreaming:reference]) should] beYes];
+    });
+    it(@"streams the same body as encoding the data up front", ^{
+        SMStreamingBinaryData *binaryData = [SMStreamingBinaryData binaryDataWithContentsOfURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"];
+        NSDictionary *object = [NSDictionary dictionaryWithObjectsAndKeys:@"hello", @"title", binaryData, @"file", [NSNumber numberWithInt:3], @"count", nil];
+        SMJSONBodyStream *stream = [[SMJSONBodyStream alloc] initWithJSONObject:object];
+        NSData *body = SMDataFromBodyStream(stream);
+        [[theValue([body length]) should] equal:theValue(stream.contentLength)];
+        
+        NSDictionary *sent = [NSJSONSerialization JSONObjectWithData:body options:0 error:nil];
+        [[[sent objectForKey:@"title"] should] equal:@"hello"];
+        [[[sent objectForKey:@"count"] should] equal:[NSNumber numberWithInt:3]];
+        [[[sent objectForKey:@"file"] should] equal:[SMBinaryDataConversion stringForBinaryData:content name:@"a.bin" contentType:@"application/octet-stream"]];
+    });
+    it(@"reads a reference string's file", ^{
+        NSDictionary *object = [NSDictionary dictionaryWithObject:[SMBinaryDataConversion stringForBinaryDataAtURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"] forKey:@"file"];
+        NSData *body = SMDataFromBodyStream([[SMJSONBodyStream alloc] initWithJSONObject:object]);
+        NSDictionary *sent = [NSJSONSerialization JSONObjectWithData:body options:0 error:nil];
+        [[[sent objectForKey:@"file"] should] equal:[SMBinaryDataConversion stringForBinaryData:content name:@"a.bin" contentType:@"application/octet-stream"]];
+    });
+    it(@"starts again from the beginning when copied", ^{
+        NSDictionary *object = [NSDictionary dictionaryWithObject:[SMStreamingBinaryData binaryDataWithContentsOfURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"] forKey:@"file"];
+        SMJSONBodyStream *stream = [[SMJSONBodyStream alloc] initWithJSONObject:object];
+        NSData *body = SMDataFromBodyStream(stream);
+        [[SMDataFromBodyStream([stream copy]) should] equal:body];
+    });
+    it(@"asks for a new stream each time a copy is sent", ^{
+        __block NSUInteger streamsProvided = 0;
+        SMStreamingBinaryData *binaryData = [SMStreamingBinaryData binaryDataWithStreamProvider:^NSInputStream *{
+            streamsProvided++;
+            return [NSInputStream inputStreamWithData:content];
+        } length:[content length] name:@"a.bin" contentType:@"application/octet-stream"];
+        SMJSONBodyStream *stream = [[SMJSONBodyStream alloc] initWithJSONObject:[NSDictionary dictionaryWithObject:binaryData forKey:@"file"]];
+        NSData *body = SMDataFromBodyStream(stream);
+        [[SMDataFromBodyStream([stream copy]) should] equal:body];
+        [[theValue(streamsProvided) should] equal:theValue(2)];
+    });
+    it(@"is used for the body of requests with binary content", ^{
+        SMOAuth2Client *client = [[SMOAuth2Client alloc] initWithAPIVersion:@"0" scheme:@"http" apiHost:@"host" publicKey:@"publicKey"];
+        NSDictionary *object = [NSDictionary dictionaryWithObject:[SMStreamingBinaryData binaryDataWithContentsOfURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"] forKey:@"file"];
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"blob" parameters:object];
+        [[request HTTPBody] shouldBeNil];
+        [[[request HTTPBodyStream] should] beKindOfClass:[SMJSONBodyStream class]];
+        [[[request valueForHTTPHeaderField:@"Content-Length"] should] equal:[NSString stringWithFormat:@"%llu", [(SMJSONBodyStream *)[request HTTPBodyStream] contentLength]]];
+    });
+    it(@"fails the request rather than sending a reference string whose file cannot be read", ^{
+        SMOAuth2Client *client = [[SMOAuth2Client alloc] initWithAPIVersion:@"0" scheme:@"http" apiHost:@"host" publicKey:@"publicKey"];
+        NSDictionary *object = [NSDictionary dictionaryWithObject:[SMBinaryDataConversion stringForBinaryDataAtURL:fileURL name:@"a.bin" contentType:@"application/octet-stream"] forKey:@"file"];
+        [[NSFileManager defaultManager] removeItemAtURL:fileURL error:nil];
+        NSError *error = nil;
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"blob" parameters:object error:&error];
+        [request shouldBeNil];
+        [[theValue([error code]) should] equal:theValue(SMErrorInvalidArguments)];
+        [[client requestWithMethod:@"POST" path:@"blob" parameters:object] shouldBeNil];
+    });
+});
+
+SPEC_END
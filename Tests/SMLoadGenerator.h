@@ -0,0 +1,65 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ The outcome of a load run: throughput and latency percentiles over every operation.
+ */
+@interface SMLoadReport : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) NSUInteger operations;
+@property (nonatomic) NSUInteger failures;
+@property (nonatomic) NSTimeInterval duration;
+@property (nonatomic) double operationsPerSecond;
+@property (nonatomic) double p50Milliseconds;
+@property (nonatomic) double p99Milliseconds;
+
+/**
+ The report as a JSON object.
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/**
+ `SMLoadGenerator` runs an operation many times from several threads at once and reports how quickly it completes.
+ 
+ Used with <SMMockAPIServer> to drive `SMIncrementalStore` saves and fetches reproducibly.
+ 
+ @note Test support only; not part of the SDK.
+ */
+@interface SMLoadGenerator : NSObject
+
+/**
+ The number of operations run at the same time.  Default is 4.
+ */
+@property (nonatomic) NSUInteger concurrency;
+
+/**
+ Runs an operation and waits for every run to finish.
+ 
+ @param name The name of the run, used in the report.
+ @param count The number of times to run the operation.
+ @param operation Called once for each run, with the run's index, on a background queue.  Returns whether the run succeeded.
+ 
+ @return The report.
+ */
+- (SMLoadReport *)run:(NSString *)name count:(NSUInteger)count operation:(BOOL (^)(NSUInteger index))operation;
+
+@end
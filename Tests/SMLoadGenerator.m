@@ -0,0 +1,122 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMLoadGenerator.h"
+#import <mach/mach_time.h>
+#import <libkern/OSAtomic.h>
+
+#define DEFAULT_CONCURRENCY 4
+
+static int SMCompareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a;
+    double second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+@implementation SMLoadReport
+
+@synthesize name = _SM_name;
+@synthesize operations = _SM_operations;
+@synthesize failures = _SM_failures;
+@synthesize duration = _SM_duration;
+@synthesize operationsPerSecond = _SM_operationsPerSecond;
+@synthesize p50Milliseconds = _SM_p50Milliseconds;
+@synthesize p99Milliseconds = _SM_p99Milliseconds;
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            self.name, @"name",
+            [NSNumber numberWithUnsignedInteger:self.operations], @"operations",
+            [NSNumber numberWithUnsignedInteger:self.failures], @"failures",
+            [NSNumber numberWithDouble:self.duration], @"seconds",
+            [NSNumber numberWithDouble:self.operationsPerSecond], @"ops_per_sec",
+            [NSNumber numberWithDouble:self.p50Milliseconds], @"p50_ms",
+            [NSNumber numberWithDouble:self.p99Milliseconds], @"p99_ms",
+            nil];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"%@: %lu operations (%lu failed) in %.2fs, %.1f ops/s, p50 %.1f ms, p99 %.1f ms", self.name, (unsigned long)self.operations, (unsigned long)self.failures, self.duration, self.operationsPerSecond, self.p50Milliseconds, self.p99Milliseconds];
+}
+
+@end
+
+@implementation SMLoadGenerator
+
+@synthesize concurrency = _SM_concurrency;
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.concurrency = DEFAULT_CONCURRENCY;
+    }
+    return self;
+}
+
+- (SMLoadReport *)run:(NSString *)name count:(NSUInteger)count operation:(BOOL (^)(NSUInteger index))operation
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    
+    double *latencies = calloc(MAX(count, 1), sizeof(double));
+    __block int32_t failures = 0;
+    dispatch_semaphore_t slots = dispatch_semaphore_create(MAX(self.concurrency, 1));
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    
+    uint64_t start = mach_absolute_time();
+    for (NSUInteger i = 0; i < count; i++) {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        dispatch_group_async(group, queue, ^{
+            @autoreleasepool {
+                uint64_t operationStart = mach_absolute_time();
+                if (!operation(i)) {
+                    OSAtomicIncrement32(&failures);
+                }
+                // Each run writes only its own slot
+                latencies[i] = (double)(mach_absolute_time() - operationStart) * timebase.numer / timebase.denom / NSEC_PER_MSEC;
+            }
+            dispatch_semaphore_signal(slots);
+        });
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    double elapsed = (double)(mach_absolute_time() - start) * timebase.numer / timebase.denom / NSEC_PER_SEC;
+    dispatch_release(group);
+    dispatch_release(slots);
+    
+    qsort(latencies, count, sizeof(double), SMCompareDoubles);
+    SMLoadReport *report = [[SMLoadReport alloc] init];
+    report.name = name;
+    report.operations = count;
+    report.failures = failures;
+    report.duration = elapsed;
+    report.operationsPerSecond = elapsed > 0 ? count / elapsed : 0;
+    if (count > 0) {
+        report.p50Milliseconds = latencies[(count - 1) / 2];
+        report.p99Milliseconds = latencies[(NSUInteger)((count - 1) * 0.99)];
+    }
+    free(latencies);
+    
+    NSLog(@"Load %@", report);
+    return report;
+}
+
+@end
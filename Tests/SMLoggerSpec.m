@@ -0,0 +1,84 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+
+static int SMLoggerSpecEvaluations = 0;
+
+static NSString *SMLoggerSpecCountedDescription(void)
+{
+    SMLoggerSpecEvaluations++;
+    return @"expensive";
+}
+
+SPEC_BEGIN(SMLoggerSpec)
+
+describe(@"SMLogger", ^{
+    __block SMLogger *logger = nil;
+    beforeEach(^{
+        logger = [SMLogger sharedLogger];
+        [logger setLevelForAllSubsystems:SMLogLevelWarning];
+        logger.bufferCapacity = 500;
+        SMLoggerSpecEvaluations = 0;
+    });
+    afterEach(^{
+        [logger setLevelForAllSubsystems:SMLogLevelWarning];
+        logger.maximumMessageLength = 10000;
+        [logger clearRecentMessages];
+    });
+    it(@"does not evaluate arguments for disabled levels", ^{
+        SMLogDebug(SMLogSubsystemCoreData, @"%@", SMLoggerSpecCountedDescription());
+        [[theValue(SMLoggerSpecEvaluations) should] equal:theValue(0)];
+        [[[logger recentMessages] should] beEmpty];
+        SMLogWarning(SMLogSubsystemCoreData, @"%@", SMLoggerSpecCountedDescription());
+        [[theValue(SMLoggerSpecEvaluations) should] equal:theValue(1)];
+        [[[logger recentMessages] should] haveCountOf:1];
+    });
+    it(@"keeps a level for each subsystem", ^{
+        [logger setLevel:SMLogLevelError forSubsystem:SMLogSubsystemCache];
+        [[theValue([logger levelForSubsystem:SMLogSubsystemCache]) should] equal:theValue(SMLogLevelError)];
+        [[theValue([logger levelForSubsystem:SMLogSubsystemCoreData]) should] equal:theValue(SMLogLevelWarning)];
+        SMLogWarning(SMLogSubsystemCache, @"dropped");
+        SMLogWarning(SMLogSubsystemCoreData, @"kept");
+        NSString *message = [[logger recentMessages] lastObject];
+        [[theValue([[logger recentMessages] count]) should] equal:theValue(1)];
+        [[theValue([message rangeOfString:@"WARN [CoreData]"].location != NSNotFound) should] beYes];
+        [[theValue([message hasSuffix:@"kept"]) should] beYes];
+    });
+    it(@"keeps only the most recent messages, oldest first", ^{
+        logger.bufferCapacity = 3;
+        for (int i = 0; i < 5; i++) {
+            SMLogError(SMLogSubsystemNetwork, @"message %d", i);
+        }
+        NSArray *messages = [logger recentMessages];
+        [[messages should] haveCountOf:3];
+        [[theValue([[messages objectAtIndex:0] hasSuffix:@"message 2"]) should] beYes];
+        [[theValue([[messages lastObject] hasSuffix:@"message 4"]) should] beYes];
+    });
+    it(@"truncates long messages", ^{
+        logger.maximumMessageLength = 10;
+        [logger logMessage:@"0123456789abcdef" subsystem:SMLogSubsystemAuth level:SMLogLevelError];
+        [[theValue([[[logger recentMessages] lastObject] hasSuffix:@"0123456789 <MAX_LOG_LENGTH_REACHED>"]) should] beYes];
+    });
+    it(@"rejects unknown subsystems", ^{
+        [[theBlock(^{
+            [logger setLevel:SMLogLevelDebug forSubsystem:(SMLogSubsystem)SMLogSubsystemCount];
+        }) should] raiseWithName:NSInvalidArgumentException];
+    });
+});
+
+SPEC_END
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `SMMockAPIServer` stands in for the StackMob API, so saves and fetches can be exercised and measured without a StackMob account or a network.
+ 
+ Requests to <hosts> are answered in-process by an `NSURLProtocol`, which AFNetworking's connections pick up once the server is started.  The server handles:
+ 
+ * Schema CRUD: `GET`, `POST`, `PUT` and `DELETE` on /schema and /schema/id.  Nested objects listed in `X-StackMob-Relations` are created in their own schemas.
+ * Queries: equality, `[ne]`, `[lt]`, `[lte]`, `[gt]`, `[gte]`, `[in]` and `[null]` filters, and the `Range`, `X-StackMob-OrderBy`, `X-StackMob-Select` and `X-StackMob-Expand` headers.
+ * OAuth2 MAC tokens: /user/accessToken and /user/refreshToken.
+ * Push: device token registration, removal and lookup, and pushes to users, tokens and everyone, which are recorded in <sentPushes>.
+ 
+ Responses can be slowed down with <latency> and <bandwidth>, and failures injected with <errorRate>.
+ 
+ @note Test support only; not part of the SDK.
+ */
+@interface SMMockAPIServer : NSObject
+
+/**
+ The hosts whose requests are answered.  Default is `api.stackmob.com` and `push.stackmob.com`.
+ */
+@property (atomic, copy) NSSet *hosts;
+
+/**
+ The schema flagged as the user object schema.  Default is `@"user"`.
+ */
+@property (atomic, copy) NSString *userSchema;
+
+/**
+ The primary key field of the user schema.  Default is `@"username"`.
+ */
+@property (atomic, copy) NSString *userPrimaryKeyField;
+
+/**
+ The password field of the user schema.  Default is `@"password"`.
+ */
+@property (atomic, copy) NSString *userPasswordField;
+
+/**
+ The time taken before any response starts, in seconds.  Default is 0.
+ */
+@property (atomic) NSTimeInterval latency;
+
+/**
+ The rate at which response bodies are sent, in bytes per second.  Default is 0, which means no limit.
+ */
+@property (atomic) double bandwidth;
+
+/**
+ The fraction of requests, from 0 to 1, answered with <errorStatusCode> instead of being handled.  Default is 0.
+ */
+@property (atomic) double errorRate;
+
+/**
+ The status code of injected failures.  Default is 503.
+ */
+@property (atomic) NSInteger errorStatusCode;
+
+/**
+ Whether schema and push requests must carry a MAC Authorization header for an unexpired access token.  Default is `NO`.
+ */
+@property (atomic) BOOL requiresAuthentication;
+
+/**
+ How long issued access tokens last, in seconds.  Default is 3600.
+ */
+@property (atomic) NSTimeInterval tokenLifetime;
+
+/**
+ The number of requests answered since the server was started or reset.
+ */
+@property (atomic, readonly) NSUInteger requestCount;
+
+/**
+ Every push sent, as the decoded request body with a `@"path"` key naming the endpoint.
+ */
+@property (atomic, readonly, copy) NSArray *sentPushes;
+
+/**
+ Returns the shared server.
+ */
++ (SMMockAPIServer *)sharedServer;
+
+/**
+ Starts answering requests to <hosts>.
+ */
+- (void)start;
+
+/**
+ Stops answering requests.  Stored objects are kept.
+ */
+- (void)stop;
+
+/**
+ Removes all stored objects, tokens and pushes, and restores the default settings.
+ */
+- (void)reset;
+
+/**
+ Stores objects directly, as though they had been created through the API.
+ 
+ @param objects The objects to store.  Objects without a primary key are given one.
+ @param schema The schema to store them in.
+ */
+- (void)addObjects:(NSArray *)objects toSchema:(NSString *)schema;
+
+/**
+ Returns the stored objects of a schema.
+ 
+ @param schema The schema.
+ 
+ @return The objects, in no particular order.
+ */
+- (NSArray *)objectsInSchema:(NSString *)schema;
+
+/**
+ Answers a request.  Used by the URL protocol; exposed so the API can be tested without a connection.
+ 
+ @param request The request.
+ @param body The request body, already read and decompressed.
+ @param responseBody Set to the JSON response body.
+ 
+ @return The response.
+ */
+- (NSHTTPURLResponse *)responseForRequest:(NSURLRequest *)request body:(NSData *)body responseBody:(NSData *__autoreleasing *)responseBody;
+
+@end
@@ -0,0 +1,703 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "SMMockAPIServer.h"
+#import <zlib.h>
+
+#define DEFAULT_ERROR_STATUS_CODE 503
+#define DEFAULT_TOKEN_LIFETIME 3600
+#define BODY_STREAM_BUFFER_SIZE 32768
+
+static NSString *const SMMockRequestHandledKey = @"SMMockAPIServerHandled";
+
+@interface SMMockAPIServer ()
+
+@property (atomic, readwrite) NSUInteger requestCount;
+@property (nonatomic, strong) NSMutableDictionary *objectsBySchema;
+// schema -> field -> related schema, learned from X-StackMob-Relations
+@property (nonatomic, strong) NSMutableDictionary *relatedSchemasBySchema;
+// access token -> {username, expiration}
+@property (nonatomic, strong) NSMutableDictionary *accessTokens;
+// refresh token -> username
+@property (nonatomic, strong) NSMutableDictionary *refreshTokens;
+// username -> array of {token, type, registered_milliseconds}
+@property (nonatomic, strong) NSMutableDictionary *pushTokensByUser;
+@property (nonatomic, strong) NSMutableArray *recordedPushes;
+@property (nonatomic) dispatch_queue_t stateQueue;
+
+- (NSData *)SM_bodyOfRequest:(NSURLRequest *)request;
+
+@end
+
+/*
+ Hands requests for the mock hosts to the shared server, and delivers its responses after the configured latency and transfer time.
+ */
+@interface SMMockAPIURLProtocol : NSURLProtocol
+
+@property (atomic) BOOL stopped;
+
+@end
+
+@implementation SMMockAPIURLProtocol
+
+@synthesize stopped = _SM_stopped;
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    if ([NSURLProtocol propertyForKey:SMMockRequestHandledKey inRequest:request]) {
+        return NO;
+    }
+    return [[[SMMockAPIServer sharedServer] hosts] containsObject:[[[request URL] host] lowercaseString]];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (void)startLoading
+{
+    SMMockAPIServer *server = [SMMockAPIServer sharedServer];
+    NSData *responseBody = nil;
+    NSHTTPURLResponse *response = [server responseForRequest:[self request] body:[server SM_bodyOfRequest:[self request]] responseBody:&responseBody];
+    
+    NSTimeInterval delay = server.latency;
+    if (server.bandwidth > 0) {
+        delay += [responseBody length] / server.bandwidth;
+    }
+    
+    // The client expects its callbacks on the thread which started loading
+    NSThread *clientThread = [NSThread currentThread];
+    NSArray *modes = [NSArray arrayWithObject:NSRunLoopCommonModes];
+    NSArray *delivery = [NSArray arrayWithObjects:response, responseBody, nil];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [self performSelector:@selector(SM_deliver:) onThread:clientThread withObject:delivery waitUntilDone:NO modes:modes];
+    });
+}
+
+- (void)SM_deliver:(NSArray *)delivery
+{
+    if (self.stopped) {
+        return;
+    }
+    [[self client] URLProtocol:self didReceiveResponse:[delivery objectAtIndex:0] cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [[self client] URLProtocol:self didLoadData:[delivery objectAtIndex:1]];
+    [[self client] URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading
+{
+    self.stopped = YES;
+}
+
+@end
+
+static NSData * SMInflatedData(NSData *data)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 16 + MAX_WBITS accepts a gzip header
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return nil;
+    }
+    NSMutableData *inflated = [NSMutableData dataWithLength:[data length] * 4 + 1024];
+    stream.next_in = (Bytef *)[data bytes];
+    stream.avail_in = (uInt)[data length];
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (stream.total_out >= [inflated length]) {
+            [inflated increaseLengthBy:[inflated length]];
+        }
+        stream.next_out = (Bytef *)[inflated mutableBytes] + stream.total_out;
+        stream.avail_out = (uInt)([inflated length] - stream.total_out);
+        status = inflate(&stream, Z_SYNC_FLUSH);
+    }
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        return nil;
+    }
+    [inflated setLength:stream.total_out];
+    return inflated;
+}
+
+static NSDictionary * SMParametersFromQueryString(NSString *queryString)
+{
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+    for (NSString *pair in [queryString componentsSeparatedByString:@"&"]) {
+        if ([pair length] == 0) {
+            continue;
+        }
+        NSRange separator = [pair rangeOfString:@"="];
+        NSString *key = separator.location == NSNotFound ? pair : [pair substringToIndex:separator.location];
+        NSString *value = separator.location == NSNotFound ? @"" : [pair substringFromIndex:separator.location + 1];
+        key = [[key stringByReplacingOccurrencesOfString:@"+" withString:@" "] stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        value = [[value stringByReplacingOccurrencesOfString:@"+" withString:@" "] stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        if (key) {
+            [parameters setObject:value ? value : @"" forKey:key];
+        }
+    }
+    return parameters;
+}
+
+static NSNumber * SMCurrentTimeInMilliseconds(void)
+{
+    return [NSNumber numberWithUnsignedLongLong:(unsigned long long)([[NSDate date] timeIntervalSince1970] * 1000)];
+}
+
+static NSString * SMRandomToken(void)
+{
+    uint64_t first;
+    uint64_t second;
+    arc4random_buf(&first, sizeof(first));
+    arc4random_buf(&second, sizeof(second));
+    return [NSString stringWithFormat:@"%016llx%016llx", (unsigned long long)first, (unsigned long long)second];
+}
+
+/*
+ Compares a stored value with a query parameter, numerically when both are numbers or booleans, otherwise as strings.
+ */
+static NSComparisonResult SMCompareStoredValue(id stored, NSString *parameter)
+{
+    if ([stored isKindOfClass:[NSNumber class]]) {
+        double parameterValue = 0;
+        if ([parameter isEqualToString:@"true"]) {
+            parameterValue = 1;
+        } else if ([parameter isEqualToString:@"false"]) {
+            parameterValue = 0;
+        } else {
+            NSScanner *scanner = [NSScanner scannerWithString:parameter];
+            if (![scanner scanDouble:&parameterValue] || ![scanner isAtEnd]) {
+                return [[stored stringValue] compare:parameter];
+            }
+        }
+        double storedValue = [stored doubleValue];
+        return storedValue < parameterValue ? NSOrderedAscending : (storedValue > parameterValue ? NSOrderedDescending : NSOrderedSame);
+    }
+    return [[stored description] compare:parameter];
+}
+
+static BOOL SMObjectMatchesParameter(NSDictionary *object, NSString *key, NSString *parameter)
+{
+    NSRange bracket = [key rangeOfString:@"["];
+    if (bracket.location == NSNotFound || ![key hasSuffix:@"]"]) {
+        id stored = [object objectForKey:key];
+        return stored != nil && stored != [NSNull null] && SMCompareStoredValue(stored, parameter) == NSOrderedSame;
+    }
+    
+    NSString *field = [key substringToIndex:bracket.location];
+    NSString *operator = [key substringWithRange:NSMakeRange(bracket.location + 1, [key length] - bracket.location - 2)];
+    id stored = [object objectForKey:field];
+    BOOL isNull = stored == nil || stored == [NSNull null];
+    
+    if ([operator isEqualToString:@"null"]) {
+        return isNull == [parameter isEqualToString:@"true"];
+    }
+    if (isNull) {
+        return [operator isEqualToString:@"ne"];
+    }
+    if ([operator isEqualToString:@"in"]) {
+        for (NSString *candidate in [parameter componentsSeparatedByString:@","]) {
+            if (SMCompareStoredValue(stored, candidate) == NSOrderedSame) {
+                return YES;
+            }
+        }
+        return NO;
+    }
+    
+    NSComparisonResult comparison = SMCompareStoredValue(stored, parameter);
+    if ([operator isEqualToString:@"ne"]) {
+        return comparison != NSOrderedSame;
+    } else if ([operator isEqualToString:@"lt"]) {
+        return comparison == NSOrderedAscending;
+    } else if ([operator isEqualToString:@"lte"]) {
+        return comparison != NSOrderedDescending;
+    } else if ([operator isEqualToString:@"gt"]) {
+        return comparison == NSOrderedDescending;
+    } else if ([operator isEqualToString:@"gte"]) {
+        return comparison != NSOrderedAscending;
+    }
+    // Geo queries are not modelled, so they match everything
+    return YES;
+}
+
+@implementation SMMockAPIServer
+
+@synthesize hosts = _SM_hosts;
+@synthesize userSchema = _SM_userSchema;
+@synthesize userPrimaryKeyField = _SM_userPrimaryKeyField;
+@synthesize userPasswordField = _SM_userPasswordField;
+@synthesize latency = _SM_latency;
+@synthesize bandwidth = _SM_bandwidth;
+@synthesize errorRate = _SM_errorRate;
+@synthesize errorStatusCode = _SM_errorStatusCode;
+@synthesize requiresAuthentication = _SM_requiresAuthentication;
+@synthesize tokenLifetime = _SM_tokenLifetime;
+@synthesize requestCount = _SM_requestCount;
+@synthesize objectsBySchema = _SM_objectsBySchema;
+@synthesize relatedSchemasBySchema = _SM_relatedSchemasBySchema;
+@synthesize accessTokens = _SM_accessTokens;
+@synthesize refreshTokens = _SM_refreshTokens;
+@synthesize pushTokensByUser = _SM_pushTokensByUser;
+@synthesize recordedPushes = _SM_recordedPushes;
+@synthesize stateQueue = _SM_stateQueue;
+
++ (SMMockAPIServer *)sharedServer
+{
+    static SMMockAPIServer *sharedServer = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedServer = [[SMMockAPIServer alloc] init];
+    });
+    return sharedServer;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        self.stateQueue = dispatch_queue_create("com.stackmob.mockAPIServer", NULL);
+        [self reset];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_release(_SM_stateQueue);
+}
+
+- (void)start
+{
+    [NSURLProtocol registerClass:[SMMockAPIURLProtocol class]];
+}
+
+- (void)stop
+{
+    [NSURLProtocol unregisterClass:[SMMockAPIURLProtocol class]];
+}
+
+- (void)reset
+{
+    dispatch_sync(self.stateQueue, ^{
+        self.objectsBySchema = [NSMutableDictionary dictionary];
+        self.relatedSchemasBySchema = [NSMutableDictionary dictionary];
+        self.accessTokens = [NSMutableDictionary dictionary];
+        self.refreshTokens = [NSMutableDictionary dictionary];
+        self.pushTokensByUser = [NSMutableDictionary dictionary];
+        self.recordedPushes = [NSMutableArray array];
+    });
+    self.hosts = [NSSet setWithObjects:@"api.stackmob.com", @"push.stackmob.com", nil];
+    self.userSchema = @"user";
+    self.userPrimaryKeyField = @"username";
+    self.userPasswordField = @"password";
+    self.latency = 0;
+    self.bandwidth = 0;
+    self.errorRate = 0;
+    self.errorStatusCode = DEFAULT_ERROR_STATUS_CODE;
+    self.requiresAuthentication = NO;
+    self.tokenLifetime = DEFAULT_TOKEN_LIFETIME;
+    self.requestCount = 0;
+}
+
+- (NSArray *)sentPushes
+{
+    __block NSArray *pushes = nil;
+    dispatch_sync(self.stateQueue, ^{
+        pushes = [NSArray arrayWithArray:self.recordedPushes];
+    });
+    return pushes;
+}
+
+- (void)addObjects:(NSArray *)objects toSchema:(NSString *)schema
+{
+    dispatch_sync(self.stateQueue, ^{
+        for (NSDictionary *object in objects) {
+            [self SM_storeObject:object inSchema:schema relations:nil keyPath:nil];
+        }
+    });
+}
+
+- (NSArray *)objectsInSchema:(NSString *)schema
+{
+    __block NSArray *objects = nil;
+    dispatch_sync(self.stateQueue, ^{
+        objects = [[self.objectsBySchema objectForKey:schema] allValues];
+    });
+    return objects ? objects : [NSArray array];
+}
+
+#pragma mark - Requests
+
+- (NSData *)SM_bodyOfRequest:(NSURLRequest *)request
+{
+    NSData *body = [request HTTPBody];
+    if (body == nil && [request HTTPBodyStream]) {
+        NSInputStream *stream = [request HTTPBodyStream];
+        NSMutableData *streamedBody = [NSMutableData data];
+        uint8_t buffer[BODY_STREAM_BUFFER_SIZE];
+        [stream open];
+        NSInteger length = 0;
+        while ((length = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+            [streamedBody appendBytes:buffer length:length];
+        }
+        [stream close];
+        body = streamedBody;
+    }
+    if ([[request valueForHTTPHeaderField:@"Content-Encoding"] isEqualToString:@"gzip"]) {
+        body = SMInflatedData(body);
+    }
+    return body;
+}
+
+- (NSHTTPURLResponse *)responseForRequest:(NSURLRequest *)request body:(NSData *)body responseBody:(NSData *__autoreleasing *)responseBody
+{
+    __block NSInteger statusCode = 200;
+    __block id result = nil;
+    NSMutableDictionary *headers = [NSMutableDictionary dictionaryWithObject:@"application/json" forKey:@"Content-Type"];
+    
+    dispatch_sync(self.stateQueue, ^{
+        self.requestCount = self.requestCount + 1;
+        if (self.errorRate > 0 && (double)arc4random() / UINT32_MAX < self.errorRate) {
+            statusCode = self.errorStatusCode;
+            result = [NSDictionary dictionaryWithObject:@"Injected failure" forKey:@"error"];
+            return;
+        }
+        
+        NSMutableArray *components = [[[request URL] pathComponents] mutableCopy];
+        [components removeObject:@"/"];
+        NSString *method = [request HTTPMethod];
+        
+        if ([components count] == 2 && [[components objectAtIndex:0] isEqualToString:self.userSchema] && ([[components objectAtIndex:1] isEqualToString:@"accessToken"] || [[components objectAtIndex:1] isEqualToString:@"refreshToken"])) {
+            NSString *form = [[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding];
+            result = [self SM_tokenResponseForEndpoint:[components objectAtIndex:1] parameters:SMParametersFromQueryString(form) statusCode:&statusCode];
+            return;
+        }
+        
+        if (self.requiresAuthentication && ![self SM_isAuthorized:request]) {
+            statusCode = 401;
+            result = [NSDictionary dictionaryWithObject:@"Invalid or expired access token" forKey:@"error"];
+            return;
+        }
+        
+        id JSONBody = nil;
+        if ([body length] > 0) {
+            JSONBody = [NSJSONSerialization JSONObjectWithData:body options:NSJSONReadingMutableContainers error:NULL];
+        }
+        
+        if ([components count] == 1 && [[components objectAtIndex:0] hasSuffix:@"_universal"]) {
+            result = [self SM_pushResponseForEndpoint:[components objectAtIndex:0] arguments:JSONBody query:SMParametersFromQueryString([[request URL] query]) statusCode:&statusCode];
+        } else if ([components count] == 1 && [method isEqualToString:@"GET"]) {
+            result = [self SM_queryResponseForSchema:[components objectAtIndex:0] parameters:SMParametersFromQueryString([[request URL] query]) request:request responseHeaders:headers];
+        } else if ([components count] == 1 && [method isEqualToString:@"POST"] && [JSONBody isKindOfClass:[NSDictionary class]]) {
+            NSDictionary *relations = SMParametersFromQueryString([request valueForHTTPHeaderField:@"X-StackMob-Relations"]);
+            result = [self SM_storeObject:JSONBody inSchema:[components objectAtIndex:0] relations:relations keyPath:nil];
+            statusCode = 201;
+        } else if ([components count] == 2) {
+            result = [self SM_objectResponseForMethod:method schema:[components objectAtIndex:0] objectId:[components objectAtIndex:1] update:JSONBody request:request statusCode:&statusCode];
+        } else {
+            statusCode = 404;
+            result = [NSDictionary dictionaryWithObject:@"Unknown endpoint" forKey:@"error"];
+        }
+    });
+    
+    *responseBody = [NSJSONSerialization dataWithJSONObject:result ? result : [NSDictionary dictionary] options:0 error:NULL];
+    return [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headers];
+}
+
+#pragma mark - Objects
+
+- (NSString *)SM_primaryKeyFieldForSchema:(NSString *)schema
+{
+    if ([schema isEqualToString:self.userSchema]) {
+        return self.userPrimaryKeyField;
+    }
+    return [schema stringByAppendingString:@"_id"];
+}
+
+- (NSMutableDictionary *)SM_objectsInSchema:(NSString *)schema
+{
+    NSMutableDictionary *objects = [self.objectsBySchema objectForKey:schema];
+    if (objects == nil) {
+        objects = [NSMutableDictionary dictionary];
+        [self.objectsBySchema setObject:objects forKey:schema];
+    }
+    return objects;
+}
+
+/*
+ Stores an object, first storing the nested objects named in relations (key path -> schema) and replacing them with their primary keys.
+ */
+- (NSDictionary *)SM_storeObject:(NSDictionary *)object inSchema:(NSString *)schema relations:(NSDictionary *)relations keyPath:(NSString *)keyPath
+{
+    NSMutableDictionary *stored = [object mutableCopy];
+    [object enumerateKeysAndObjectsUsingBlock:^(id field, id value, BOOL *stop) {
+        NSString *fieldKeyPath = keyPath ? [NSString stringWithFormat:@"%@.%@", keyPath, field] : field;
+        NSString *relatedSchema = [relations objectForKey:fieldKeyPath];
+        if (relatedSchema == nil) {
+            return;
+        }
+        NSMutableDictionary *relatedSchemas = [self.relatedSchemasBySchema objectForKey:schema];
+        if (relatedSchemas == nil) {
+            relatedSchemas = [NSMutableDictionary dictionary];
+            [self.relatedSchemasBySchema setObject:relatedSchemas forKey:schema];
+        }
+        [relatedSchemas setObject:relatedSchema forKey:field];
+        if ([value isKindOfClass:[NSDictionary class]]) {
+            NSDictionary *related = [self SM_storeObject:value inSchema:relatedSchema relations:relations keyPath:fieldKeyPath];
+            [stored setObject:[related objectForKey:[self SM_primaryKeyFieldForSchema:relatedSchema]] forKey:field];
+        }
+    }];
+    
+    NSString *primaryKeyField = [self SM_primaryKeyFieldForSchema:schema];
+    NSString *objectId = [stored objectForKey:primaryKeyField];
+    if (objectId == nil) {
+        objectId = [[NSProcessInfo processInfo] globallyUniqueString];
+        [stored setObject:objectId forKey:primaryKeyField];
+    }
+    
+    NSMutableDictionary *objects = [self SM_objectsInSchema:schema];
+    NSDictionary *existing = [objects objectForKey:objectId];
+    NSNumber *now = SMCurrentTimeInMilliseconds();
+    [stored setObject:existing ? [existing objectForKey:@"createddate"] : now forKey:@"createddate"];
+    [stored setObject:now forKey:@"lastmoddate"];
+    [objects setObject:stored forKey:objectId];
+    return [self SM_visibleObject:stored inSchema:schema];
+}
+
+- (NSDictionary *)SM_visibleObject:(NSDictionary *)object inSchema:(NSString *)schema
+{
+    if ([schema isEqualToString:self.userSchema] && [object objectForKey:self.userPasswordField]) {
+        NSMutableDictionary *visible = [object mutableCopy];
+        [visible removeObjectForKey:self.userPasswordField];
+        return visible;
+    }
+    return [object copy];
+}
+
+- (id)SM_objectResponseForMethod:(NSString *)method schema:(NSString *)schema objectId:(NSString *)objectId update:(id)update request:(NSURLRequest *)request statusCode:(NSInteger *)statusCode
+{
+    NSMutableDictionary *objects = [self SM_objectsInSchema:schema];
+    NSDictionary *existing = [objects objectForKey:objectId];
+    if (existing == nil && ![method isEqualToString:@"PUT"]) {
+        *statusCode = 404;
+        return [NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"%@ with id %@ does not exist", schema, objectId] forKey:@"error"];
+    }
+    
+    if ([method isEqualToString:@"GET"]) {
+        NSInteger depth = [[request valueForHTTPHeaderField:@"X-StackMob-Expand"] integerValue];
+        return [self SM_object:existing inSchema:schema expandedToDepth:depth selecting:[request valueForHTTPHeaderField:@"X-StackMob-Select"]];
+    } else if ([method isEqualToString:@"PUT"]) {
+        if (![update isKindOfClass:[NSDictionary class]]) {
+            *statusCode = 400;
+            return [NSDictionary dictionaryWithObject:@"Update must be an object" forKey:@"error"];
+        }
+        NSMutableDictionary *merged = existing ? [existing mutableCopy] : [NSMutableDictionary dictionary];
+        [merged addEntriesFromDictionary:update];
+        [merged setObject:objectId forKey:[self SM_primaryKeyFieldForSchema:schema]];
+        return [self SM_storeObject:merged inSchema:schema relations:nil keyPath:nil];
+    } else if ([method isEqualToString:@"DELETE"]) {
+        [objects removeObjectForKey:objectId];
+        return [NSDictionary dictionary];
+    }
+    *statusCode = 405;
+    return [NSDictionary dictionaryWithObject:@"Method not allowed" forKey:@"error"];
+}
+
+- (NSDictionary *)SM_object:(NSDictionary *)object inSchema:(NSString *)schema expandedToDepth:(NSInteger)depth selecting:(NSString *)selectHeader
+{
+    NSMutableDictionary *result = [[self SM_visibleObject:object inSchema:schema] mutableCopy];
+    if (depth > 0) {
+        [[self.relatedSchemasBySchema objectForKey:schema] enumerateKeysAndObjectsUsingBlock:^(id field, id relatedSchema, BOOL *stop) {
+            NSDictionary *relatedObjects = [self.objectsBySchema objectForKey:relatedSchema];
+            id value = [result objectForKey:field];
+            if ([value isKindOfClass:[NSArray class]]) {
+                NSMutableArray *expanded = [NSMutableArray arrayWithCapacity:[value count]];
+                for (id relatedId in value) {
+                    NSDictionary *related = [relatedObjects objectForKey:relatedId];
+                    [expanded addObject:related ? [self SM_object:related inSchema:relatedSchema expandedToDepth:depth - 1 selecting:nil] : relatedId];
+                }
+                [result setObject:expanded forKey:field];
+            } else if (value && [relatedObjects objectForKey:value]) {
+                [result setObject:[self SM_object:[relatedObjects objectForKey:value] inSchema:relatedSchema expandedToDepth:depth - 1 selecting:nil] forKey:field];
+            }
+        }];
+    }
+    if ([selectHeader length] > 0) {
+        NSMutableSet *selected = [NSMutableSet setWithArray:[selectHeader componentsSeparatedByString:@","]];
+        [selected addObject:[self SM_primaryKeyFieldForSchema:schema]];
+        for (NSString *field in [result allKeys]) {
+            if (![selected containsObject:field]) {
+                [result removeObjectForKey:field];
+            }
+        }
+    }
+    return result;
+}
+
+- (NSArray *)SM_queryResponseForSchema:(NSString *)schema parameters:(NSDictionary *)parameters request:(NSURLRequest *)request responseHeaders:(NSMutableDictionary *)headers
+{
+    NSMutableArray *matches = [NSMutableArray array];
+    for (NSDictionary *object in [[self.objectsBySchema objectForKey:schema] allValues]) {
+        __block BOOL matchesAll = YES;
+        [parameters enumerateKeysAndObjectsUsingBlock:^(id key, id parameter, BOOL *stop) {
+            if (!SMObjectMatchesParameter(object, key, parameter)) {
+                matchesAll = NO;
+                *stop = YES;
+            }
+        }];
+        if (matchesAll) {
+            [matches addObject:object];
+        }
+    }
+    
+    // Order by the header's fields, then by primary key so results are stable
+    NSMutableArray *sortDescriptors = [NSMutableArray array];
+    for (NSString *ordering in [[request valueForHTTPHeaderField:@"X-StackMob-OrderBy"] componentsSeparatedByString:@","]) {
+        NSArray *parts = [ordering componentsSeparatedByString:@":"];
+        if ([[parts objectAtIndex:0] length] > 0) {
+            BOOL ascending = [parts count] < 2 || ![[parts objectAtIndex:1] isEqualToString:@"desc"];
+            [sortDescriptors addObject:[NSSortDescriptor sortDescriptorWithKey:[parts objectAtIndex:0] ascending:ascending]];
+        }
+    }
+    [sortDescriptors addObject:[NSSortDescriptor sortDescriptorWithKey:[self SM_primaryKeyFieldForSchema:schema] ascending:YES]];
+    [matches sortUsingDescriptors:sortDescriptors];
+    
+    NSUInteger total = [matches count];
+    NSString *rangeHeader = [request valueForHTTPHeaderField:@"Range"];
+    if ([rangeHeader hasPrefix:@"objects="]) {
+        NSArray *bounds = [[rangeHeader substringFromIndex:[@"objects=" length]] componentsSeparatedByString:@"-"];
+        NSUInteger start = MIN((NSUInteger)[[bounds objectAtIndex:0] integerValue], total);
+        NSUInteger end = total;
+        if ([bounds count] > 1 && [[bounds objectAtIndex:1] length] > 0) {
+            end = MIN((NSUInteger)[[bounds objectAtIndex:1] integerValue] + 1, total);
+        }
+        end = MAX(start, end);
+        matches = [[matches subarrayWithRange:NSMakeRange(start, end - start)] mutableCopy];
+        [headers setObject:[NSString stringWithFormat:@"objects %lu-%lu/%lu", (unsigned long)start, (unsigned long)(end > start ? end - 1 : start), (unsigned long)total] forKey:@"Content-Range"];
+    }
+    
+    NSInteger depth = [[request valueForHTTPHeaderField:@"X-StackMob-Expand"] integerValue];
+    NSString *selectHeader = [request valueForHTTPHeaderField:@"X-StackMob-Select"];
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:[matches count]];
+    for (NSDictionary *object in matches) {
+        [results addObject:[self SM_object:object inSchema:schema expandedToDepth:depth selecting:selectHeader]];
+    }
+    return results;
+}
+
+#pragma mark - Tokens
+
+- (NSDictionary *)SM_tokenResponseForEndpoint:(NSString *)endpoint parameters:(NSDictionary *)parameters statusCode:(NSInteger *)statusCode
+{
+    NSString *username = nil;
+    if ([endpoint isEqualToString:@"accessToken"]) {
+        username = [parameters objectForKey:self.userPrimaryKeyField];
+        NSDictionary *user = username ? [[self.objectsBySchema objectForKey:self.userSchema] objectForKey:username] : nil;
+        NSString *password = [user objectForKey:self.userPasswordField];
+        if (user == nil || (password && ![password isEqualToString:[parameters objectForKey:self.userPasswordField]])) {
+            *statusCode = 401;
+            return [NSDictionary dictionaryWithObjectsAndKeys:@"invalid_grant", @"error", @"Invalid username or password.", @"error_description", nil];
+        }
+    } else {
+        NSString *refreshToken = [parameters objectForKey:@"refresh_token"];
+        username = refreshToken ? [self.refreshTokens objectForKey:refreshToken] : nil;
+        if (username == nil) {
+            *statusCode = 401;
+            return [NSDictionary dictionaryWithObjectsAndKeys:@"invalid_grant", @"error", @"Invalid refresh token.", @"error_description", nil];
+        }
+        [self.refreshTokens removeObjectForKey:refreshToken];
+    }
+    
+    NSString *accessToken = SMRandomToken();
+    NSString *refreshToken = SMRandomToken();
+    [self.accessTokens setObject:[NSDictionary dictionaryWithObjectsAndKeys:username, @"username", [NSDate dateWithTimeIntervalSinceNow:self.tokenLifetime], @"expiration", nil] forKey:accessToken];
+    [self.refreshTokens setObject:username forKey:refreshToken];
+    
+    NSDictionary *user = [self SM_visibleObject:[[self.objectsBySchema objectForKey:self.userSchema] objectForKey:username] inSchema:self.userSchema];
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            accessToken, @"access_token",
+            refreshToken, @"refresh_token",
+            SMRandomToken(), @"mac_key",
+            @"hmac-sha-1", @"mac_algorithm",
+            @"mac", @"token_type",
+            [NSNumber numberWithDouble:self.tokenLifetime], @"expires_in",
+            [NSDictionary dictionaryWithObject:user forKey:@"user"], @"stackmob",
+            nil];
+}
+
+- (BOOL)SM_isAuthorized:(NSURLRequest *)request
+{
+    NSString *authorization = [request valueForHTTPHeaderField:@"Authorization"];
+    NSRange idStart = [authorization rangeOfString:@"id=\""];
+    if (idStart.location == NSNotFound) {
+        return NO;
+    }
+    NSString *rest = [authorization substringFromIndex:NSMaxRange(idStart)];
+    NSRange idEnd = [rest rangeOfString:@"\""];
+    if (idEnd.location == NSNotFound) {
+        return NO;
+    }
+    NSDictionary *token = [self.accessTokens objectForKey:[rest substringToIndex:idEnd.location]];
+    return token != nil && [[token objectForKey:@"expiration"] timeIntervalSinceNow] > 0;
+}
+
+#pragma mark - Push
+
+- (id)SM_pushResponseForEndpoint:(NSString *)endpoint arguments:(NSDictionary *)arguments query:(NSDictionary *)query statusCode:(NSInteger *)statusCode
+{
+    if ([endpoint isEqualToString:@"register_device_token_universal"]) {
+        NSString *userId = [arguments objectForKey:@"userId"];
+        NSDictionary *token = [arguments objectForKey:@"token"];
+        if (userId == nil || token == nil) {
+            *statusCode = 400;
+            return [NSDictionary dictionaryWithObject:@"userId and token are required" forKey:@"error"];
+        }
+        NSMutableDictionary *registeredToken = [token mutableCopy];
+        [registeredToken setObject:SMCurrentTimeInMilliseconds() forKey:@"registered_milliseconds"];
+        NSMutableArray *tokens = [self.pushTokensByUser objectForKey:userId];
+        if (tokens == nil || [[arguments objectForKey:@"overwrite"] boolValue]) {
+            tokens = [NSMutableArray array];
+            [self.pushTokensByUser setObject:tokens forKey:userId];
+        }
+        [tokens addObject:registeredToken];
+        return [NSDictionary dictionary];
+    } else if ([endpoint isEqualToString:@"remove_token_universal"]) {
+        NSString *tokenString = [arguments objectForKey:@"token"];
+        [self.pushTokensByUser enumerateKeysAndObjectsUsingBlock:^(id userId, id tokens, BOOL *stop) {
+            [tokens filterUsingPredicate:[NSPredicate predicateWithFormat:@"token != %@", tokenString]];
+        }];
+        return [NSDictionary dictionary];
+    } else if ([endpoint isEqualToString:@"get_tokens_for_users_universal"]) {
+        NSMutableDictionary *tokens = [NSMutableDictionary dictionary];
+        for (NSString *userId in [[query objectForKey:@"userIds"] componentsSeparatedByString:@","]) {
+            NSArray *userTokens = [self.pushTokensByUser objectForKey:userId];
+            if ([userTokens count] > 0) {
+                [tokens setObject:userTokens forKey:userId];
+            }
+        }
+        return [NSDictionary dictionaryWithObject:tokens forKey:@"tokens"];
+    } else if ([endpoint isEqualToString:@"push_broadcast_universal"] || [endpoint isEqualToString:@"push_users_universal"] || [endpoint isEqualToString:@"push_tokens_universal"]) {
+        NSMutableDictionary *push = arguments ? [arguments mutableCopy] : [NSMutableDictionary dictionary];
+        [push setObject:endpoint forKey:@"path"];
+        [self.recordedPushes addObject:push];
+        return [NSDictionary dictionary];
+    }
+    *statusCode = 404;
+    return [NSDictionary dictionaryWithObject:@"Unknown push endpoint" forKey:@"error"];
+}
+
+@end
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+#import "Synchronization.h"
+#import "SMMockAPIServer.h"
+#import "SMLoadGenerator.h"
+
+static id SMMockRequest(NSString *method, NSString *URLString, NSDictionary *headers, id body, NSInteger *statusCode, NSDictionary *__autoreleasing *responseHeaders)
+{
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:URLString]];
+    [request setHTTPMethod:method];
+    [headers enumerateKeysAndObjectsUsingBlock:^(id field, id value, BOOL *stop) {
+        [request setValue:value forHTTPHeaderField:field];
+    }];
+    NSData *bodyData = nil;
+    if ([body isKindOfClass:[NSString class]]) {
+        bodyData = [body dataUsingEncoding:NSUTF8StringEncoding];
+    } else if (body) {
+        bodyData = [NSJSONSerialization dataWithJSONObject:body options:0 error:NULL];
+    }
+    NSData *responseBody = nil;
+    NSHTTPURLResponse *response = [[SMMockAPIServer sharedServer] responseForRequest:request body:bodyData responseBody:&responseBody];
+    if (statusCode) {
+        *statusCode = [response statusCode];
+    }
+    if (responseHeaders) {
+        *responseHeaders = [response allHeaderFields];
+    }
+    return [NSJSONSerialization JSONObjectWithData:responseBody options:0 error:NULL];
+}
+
+SPEC_BEGIN(SMMockAPIServerSpec)
+
+describe(@"SMMockAPIServer", ^{
+    __block SMMockAPIServer *server = nil;
+    __block NSInteger statusCode = 0;
+    beforeEach(^{
+        server = [SMMockAPIServer sharedServer];
+        [server reset];
+        statusCode = 0;
+    });
+    
+    context(@"schema CRUD", ^{
+        it(@"creates, reads, updates and deletes objects", ^{
+            NSDictionary *created = SMMockRequest(@"POST", @"http://api.stackmob.com/todo", nil, [NSDictionary dictionaryWithObject:@"Buy milk" forKey:@"title"], &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(201)];
+            NSString *todoId = [created objectForKey:@"todo_id"];
+            [todoId shouldNotBeNil];
+            [[created objectForKey:@"createddate"] shouldNotBeNil];
+            
+            NSString *objectURL = [@"http://api.stackmob.com/todo/" stringByAppendingString:todoId];
+            [[[SMMockRequest(@"GET", objectURL, nil, nil, &statusCode, NULL) objectForKey:@"title"] should] equal:@"Buy milk"];
+            
+            SMMockRequest(@"PUT", objectURL, nil, [NSDictionary dictionaryWithObject:[NSNumber numberWithBool:YES] forKey:@"done"], &statusCode, NULL);
+            NSDictionary *updated = SMMockRequest(@"GET", objectURL, nil, nil, &statusCode, NULL);
+            [[[updated objectForKey:@"done"] should] equal:[NSNumber numberWithBool:YES]];
+            [[[updated objectForKey:@"title"] should] equal:@"Buy milk"];
+            
+            SMMockRequest(@"DELETE", objectURL, nil, nil, &statusCode, NULL);
+            SMMockRequest(@"GET", objectURL, nil, nil, &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(404)];
+        });
+        it(@"creates nested objects listed in the relations header", ^{
+            NSDictionary *photo = [NSDictionary dictionaryWithObjectsAndKeys:@"p1", @"photo_id", @"http://example.com/cat.jpg", @"url", nil];
+            NSDictionary *lolcat = [NSDictionary dictionaryWithObjectsAndKeys:@"c1", @"lolcat_id", photo, @"photo", nil];
+            NSDictionary *created = SMMockRequest(@"POST", @"http://api.stackmob.com/lolcat", [NSDictionary dictionaryWithObject:@"photo=photo" forKey:@"X-StackMob-Relations"], lolcat, &statusCode, NULL);
+            [[[created objectForKey:@"photo"] should] equal:@"p1"];
+            [[[server objectsInSchema:@"photo"] should] haveCountOf:1];
+            
+            NSDictionary *expanded = SMMockRequest(@"GET", @"http://api.stackmob.com/lolcat/c1", [NSDictionary dictionaryWithObject:@"1" forKey:@"X-StackMob-Expand"], nil, &statusCode, NULL);
+            [[[[expanded objectForKey:@"photo"] objectForKey:@"url"] should] equal:@"http://example.com/cat.jpg"];
+        });
+    });
+    
+    context(@"queries", ^{
+        beforeEach(^{
+            NSMutableArray *todos = [NSMutableArray array];
+            for (int i = 0; i < 10; i++) {
+                [todos addObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"t%d", i], @"todo_id", [NSNumber numberWithInt:i], @"priority", @"secret", @"notes", nil]];
+            }
+            [server addObjects:todos toSchema:@"todo"];
+        });
+        it(@"filters with [gt] and [in]", ^{
+            [[SMMockRequest(@"GET", @"http://api.stackmob.com/todo?priority%5Bgt%5D=6", nil, nil, &statusCode, NULL) should] haveCountOf:3];
+            [[SMMockRequest(@"GET", @"http://api.stackmob.com/todo?todo_id%5Bin%5D=t1,t3,t11", nil, nil, &statusCode, NULL) should] haveCountOf:2];
+        });
+        it(@"orders, pages and reports the total", ^{
+            NSDictionary *headers = [NSDictionary dictionaryWithObjectsAndKeys:@"priority:desc", @"X-StackMob-OrderBy", @"objects=2-4", @"Range", nil];
+            NSDictionary *responseHeaders = nil;
+            NSArray *results = SMMockRequest(@"GET", @"http://api.stackmob.com/todo", headers, nil, &statusCode, &responseHeaders);
+            [[results should] haveCountOf:3];
+            [[[[results objectAtIndex:0] objectForKey:@"priority"] should] equal:[NSNumber numberWithInt:7]];
+            [[[responseHeaders objectForKey:@"Content-Range"] should] equal:@"objects 2-4/10"];
+        });
+        it(@"selects fields", ^{
+            NSArray *results = SMMockRequest(@"GET", @"http://api.stackmob.com/todo", [NSDictionary dictionaryWithObject:@"priority" forKey:@"X-StackMob-Select"], nil, &statusCode, NULL);
+            [[[results objectAtIndex:0] objectForKey:@"notes"] shouldBeNil];
+            [[[results objectAtIndex:0] objectForKey:@"todo_id"] shouldNotBeNil];
+        });
+    });
+    
+    context(@"tokens", ^{
+        beforeEach(^{
+            [server addObjects:[NSArray arrayWithObject:[NSDictionary dictionaryWithObjectsAndKeys:@"bob", @"username", @"1234", @"password", nil]] toSchema:@"user"];
+            server.requiresAuthentication = YES;
+        });
+        it(@"issues and refreshes MAC tokens", ^{
+            NSDictionary *tokens = SMMockRequest(@"POST", @"https://api.stackmob.com/user/accessToken", nil, @"username=bob&password=1234&token_type=mac", &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(200)];
+            [[tokens objectForKey:@"mac_key"] shouldNotBeNil];
+            [[[[[tokens objectForKey:@"stackmob"] objectForKey:@"user"] objectForKey:@"username"] should] equal:@"bob"];
+            [[[[tokens objectForKey:@"stackmob"] objectForKey:@"user"] objectForKey:@"password"] shouldBeNil];
+            
+            NSString *authorization = [NSString stringWithFormat:@"MAC id=\"%@\",ts=\"1\",nonce=\"n\",mac=\"m\"", [tokens objectForKey:@"access_token"]];
+            SMMockRequest(@"GET", @"http://api.stackmob.com/todo", [NSDictionary dictionaryWithObject:authorization forKey:@"Authorization"], nil, &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(200)];
+            
+            NSString *refresh = [NSString stringWithFormat:@"refresh_token=%@&token_type=mac", [tokens objectForKey:@"refresh_token"]];
+            NSDictionary *refreshed = SMMockRequest(@"POST", @"https://api.stackmob.com/user/refreshToken", nil, refresh, &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(200)];
+            [[[refreshed objectForKey:@"access_token"] shouldNot] equal:[tokens objectForKey:@"access_token"]];
+        });
+        it(@"rejects bad credentials and missing tokens", ^{
+            SMMockRequest(@"POST", @"https://api.stackmob.com/user/accessToken", nil, @"username=bob&password=wrong", &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(401)];
+            SMMockRequest(@"GET", @"http://api.stackmob.com/todo", nil, nil, &statusCode, NULL);
+            [[theValue(statusCode) should] equal:theValue(401)];
+        });
+    });
+    
+    context(@"push", ^{
+        it(@"registers tokens and records pushes", ^{
+            NSDictionary *token = [NSDictionary dictionaryWithObjectsAndKeys:@"abcd", @"token", @"ios", @"type", nil];
+            SMMockRequest(@"POST", @"http://push.stackmob.com/register_device_token_universal", nil, [NSDictionary dictionaryWithObjectsAndKeys:@"bob", @"userId", token, @"token", nil], &statusCode, NULL);
+            NSDictionary *tokens = SMMockRequest(@"GET", @"http://push.stackmob.com/get_tokens_for_users_universal?userIds=bob", nil, nil, &statusCode, NULL);
+            [[[[tokens objectForKey:@"tokens"] objectForKey:@"bob"] should] haveCountOf:1];
+            
+            SMMockRequest(@"POST", @"http://push.stackmob.com/push_users_universal", nil, [NSDictionary dictionaryWithObjectsAndKeys:[NSArray arrayWithObject:@"bob"], @"userIds", [NSDictionary dictionaryWithObject:@"hi" forKey:@"alert"], @"kvPairs", nil], &statusCode, NULL);
+            [[server.sentPushes should] haveCountOf:1];
+            [[[[server.sentPushes lastObject] objectForKey:@"path"] should] equal:@"push_users_universal"];
+        });
+    });
+    
+    it(@"injects errors", ^{
+        server.errorRate = 1;
+        SMMockRequest(@"GET", @"http://api.stackmob.com/todo", nil, nil, &statusCode, NULL);
+        [[theValue(statusCode) should] equal:theValue(503)];
+    });
+    
+    context(@"serving the SDK", ^{
+        __block SMClient *client = nil;
+        beforeEach(^{
+            [server start];
+            client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"mock-public-key"];
+        });
+        afterEach(^{
+            [server stop];
+        });
+        it(@"answers SMDataStore requests", ^{
+            __block NSDictionary *read = nil;
+            syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+                [[client dataStore] createObject:[NSDictionary dictionaryWithObjectsAndKeys:@"t1", @"todo_id", @"Buy milk", @"title", nil] inSchema:@"todo" onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                    [[client dataStore] readObjectWithId:@"t1" inSchema:@"todo" onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                        read = theObject;
+                        syncReturn(semaphore);
+                    } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+                        syncReturn(semaphore);
+                    }];
+                } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                }];
+            });
+            [[[read objectForKey:@"title"] should] equal:@"Buy milk"];
+        });
+    });
+});
+
+describe(@"load", ^{
+    NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+    if ([environment objectForKey:@"SM_LOAD_TEST"] == nil) {
+        return;
+    }
+    
+    it(@"saves and fetches through SMIncrementalStore", ^{
+        SMMockAPIServer *server = [SMMockAPIServer sharedServer];
+        [server reset];
+        server.latency = [[environment objectForKey:@"SM_LOAD_LATENCY"] doubleValue];
+        server.errorRate = [[environment objectForKey:@"SM_LOAD_ERROR_RATE"] doubleValue];
+        [server start];
+        
+        NSEntityDescription *todoEntity = [[NSEntityDescription alloc] init];
+        [todoEntity setName:@"Todo"];
+        [todoEntity setManagedObjectClassName:@"NSManagedObject"];
+        NSAttributeDescription *todoId = [[NSAttributeDescription alloc] init];
+        [todoId setName:@"todoId"];
+        [todoId setAttributeType:NSStringAttributeType];
+        NSAttributeDescription *title = [[NSAttributeDescription alloc] init];
+        [title setName:@"title"];
+        [title setAttributeType:NSStringAttributeType];
+        NSAttributeDescription *priority = [[NSAttributeDescription alloc] init];
+        [priority setName:@"priority"];
+        [priority setAttributeType:NSInteger32AttributeType];
+        [todoEntity setProperties:[NSArray arrayWithObjects:todoId, title, priority, nil]];
+        NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObject:todoEntity]];
+        
+        SMClient *client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"mock-public-key"];
+        SMCoreDataStore *coreDataStore = [client coreDataStoreWithManagedObjectModel:model];
+        
+        NSUInteger count = [[environment objectForKey:@"SM_LOAD_COUNT"] integerValue];
+        if (count == 0) {
+            count = 500;
+        }
+        SMLoadGenerator *generator = [[SMLoadGenerator alloc] init];
+        NSUInteger concurrency = [[environment objectForKey:@"SM_LOAD_CONCURRENCY"] integerValue];
+        if (concurrency > 0) {
+            generator.concurrency = concurrency;
+        }
+        
+        SMLoadReport *saves = [generator run:@"incrementalstore.save" count:count operation:^BOOL(NSUInteger index) {
+            NSManagedObjectContext *context = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+            [context setPersistentStoreCoordinator:coreDataStore.persistentStoreCoordinator];
+            __block BOOL saved = NO;
+            [context performBlockAndWait:^{
+                NSManagedObject *todo = [NSEntityDescription insertNewObjectForEntityForName:@"Todo" inManagedObjectContext:context];
+                [todo setValue:[todo assignObjectId] forKey:[todo primaryKeyField]];
+                [todo setValue:[NSString stringWithFormat:@"Todo %lu", (unsigned long)index] forKey:@"title"];
+                [todo setValue:[NSNumber numberWithUnsignedInteger:index % 10] forKey:@"priority"];
+                saved = [context save:NULL];
+            }];
+            return saved;
+        }];
+        
+        SMLoadReport *fetches = [generator run:@"incrementalstore.fetch" count:count operation:^BOOL(NSUInteger index) {
+            NSManagedObjectContext *context = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+            [context setPersistentStoreCoordinator:coreDataStore.persistentStoreCoordinator];
+            __block NSArray *results = nil;
+            [context performBlockAndWait:^{
+                NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
+                [fetchRequest setPredicate:[NSPredicate predicateWithFormat:@"priority > %d", (int)(index % 10)]];
+                [fetchRequest setFetchLimit:25];
+                results = [context executeFetchRequest:fetchRequest error:NULL];
+            }];
+            return results != nil;
+        }];
+        
+        [server stop];
+        
+        NSString *path = [environment objectForKey:@"SM_LOAD_OUTPUT"];
+        if (path) {
+            NSArray *reports = [NSArray arrayWithObjects:[saves dictionaryRepresentation], [fetches dictionaryRepresentation], nil];
+            [[NSJSONSerialization dataWithJSONObject:[NSDictionary dictionaryWithObject:reports forKey:@"load"] options:NSJSONWritingPrettyPrinted error:NULL] writeToFile:path atomically:YES];
+        }
+        
+        [[theValue(saves.operations) should] equal:theValue(count)];
+        if (server.errorRate == 0) {
+            [[theValue(saves.failures) should] equal:theValue(0)];
+        }
+        // Injected failures are answered before anything is stored
+        [[[server objectsInSchema:@"todo"] should] haveCountOf:saves.operations - saves.failures];
+    });
+});
+
+SPEC_END
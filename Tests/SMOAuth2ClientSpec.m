@@ -57,6 +57,27 @@ describe(@"Generating a mac key", ^{
     it(@"should match this particular precomputed value", ^{
         [[[client createMACHeaderForHttpMethod:@"POST" path:@"hello" timestamp:1337 nonce:@"noncenonce"] should] equal:@"MAC id=\"accessToken\",ts=\"1337\",nonce=\"noncenonce\",mac=\"ZpsJivPXcc4cTc6I50bC5XpQfEU=\""]; 
     });
+    it(@"should match the precomputed value after the mac key changes", ^{
+        client.macKey = @"otherKey";
+        client.macKey = @"macKey";
+        [[[client createMACHeaderForHttpMethod:@"POST" path:@"hello" timestamp:1337 nonce:@"noncenonce"] should] equal:@"MAC id=\"accessToken\",ts=\"1337\",nonce=\"noncenonce\",mac=\"ZpsJivPXcc4cTc6I50bC5XpQfEU=\""];
+    });
+    it(@"should not repeat nonces", ^{
+        NSMutableSet *nonces = [NSMutableSet set];
+        for (int i = 0; i < 10000; i++) {
+            [nonces addObject:[client createNonce]];
+        }
+        [[theValue([nonces count]) should] equal:theValue(10000)];
+    });
+    it(@"should match the precomputed value for a path with a query string", ^{
+        [[[client createMACHeaderForHttpMethod:@"GET" path:@"/todo?name=hello" timestamp:1337 nonce:@"noncenonce"] should] equal:@"MAC id=\"accessToken\",ts=\"1337\",nonce=\"noncenonce\",mac=\"qGMMFwS/BJCClsgogBq2SqFHIHE=\""];
+    });
+    it(@"should sign the same request the same way every time", ^{
+        NSString *header = [client createMACHeaderForHttpMethod:@"GET" path:@"/todo?name=hello" timestamp:1337 nonce:@"noncenonce"];
+        for (int i = 0; i < 100; i++) {
+            [[[client createMACHeaderForHttpMethod:@"GET" path:@"/todo?name=hello" timestamp:1337 nonce:@"noncenonce"] should] equal:header];
+        }
+    });
 });
 
 describe(@"has valid credentials", ^{
@@ -118,6 +139,58 @@ describe(@"Generating a request", ^{
     });
 });
 
+describe(@"Compressing request bodies", ^{
+    __block SMOAuth2Client *client  = nil;
+    __block NSDictionary *largeBody = nil;
+    beforeEach(^{
+        client = [[SMOAuth2Client alloc] initWithAPIVersion:@"1" scheme:@"https" apiHost:@"host" publicKey:@"XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"];
+        client.accessToken = @"accessToken";
+        client.macKey = @"macKey";
+        NSString *longValue = [@"" stringByPaddingToLength:4096 withString:@"stackmob" startingAtIndex:0];
+        largeBody = [NSDictionary dictionaryWithObjectsAndKeys:longValue, @"hello", nil];
+    });
+    it(@"should ask for compressed responses", ^{
+        NSMutableURLRequest *request = [client requestWithMethod:@"GET" path:@"hello" parameters:nil];
+        [[[request valueForHTTPHeaderField:@"Accept-Encoding"] should] equal:@"gzip, deflate"];
+    });
+    it(@"should not gzip by default", ^{
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"hello" parameters:largeBody];
+        [[request valueForHTTPHeaderField:@"Content-Encoding"] shouldBeNil];
+    });
+    it(@"should gzip bodies over the threshold", ^{
+        client.compressesRequestBodies = YES;
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"hello" parameters:largeBody];
+        [[[request valueForHTTPHeaderField:@"Content-Encoding"] should] equal:@"gzip"];
+        const unsigned char *bytes = [[request HTTPBody] bytes];
+        [[theValue(bytes[0]) should] equal:theValue(0x1f)];
+        [[theValue(bytes[1]) should] equal:theValue(0x8b)];
+        [[[request valueForHTTPHeaderField:@"Authorization"] should] beNonNil];
+    });
+    it(@"should not gzip small bodies", ^{
+        client.compressesRequestBodies = YES;
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"hello" parameters:[NSDictionary dictionaryWithObjectsAndKeys:@"world", @"hello", nil]];
+        [[request valueForHTTPHeaderField:@"Content-Encoding"] shouldBeNil];
+    });
+    it(@"should not gzip when turned off", ^{
+        client.compressesRequestBodies = NO;
+        NSMutableURLRequest *request = [client requestWithMethod:@"POST" path:@"hello" parameters:largeBody];
+        [[request valueForHTTPHeaderField:@"Content-Encoding"] shouldBeNil];
+    });
+    it(@"should record the bytes saved when metrics are enabled", ^{
+        client.compressesRequestBodies = YES;
+        client.compressionMetrics = [[SMCompressionMetrics alloc] init];
+        client.compressionMetrics.enabled = YES;
+        [client requestWithMethod:@"POST" path:@"hello" parameters:largeBody];
+        [[theValue([client.compressionMetrics requestBytesSaved]) should] beGreaterThan:theValue(0)];
+    });
+    it(@"should not record anything when metrics are disabled", ^{
+        client.compressesRequestBodies = YES;
+        client.compressionMetrics = [[SMCompressionMetrics alloc] init];
+        [client requestWithMethod:@"POST" path:@"hello" parameters:largeBody];
+        [[theValue([client.compressionMetrics requestBytesBeforeCompression]) should] equal:theValue(0)];
+    });
+});
+
 describe(@"-customCodeRequest:options", ^{
     context(@"given a custom code request", ^{
         __block SMCustomCodeRequest *request = nil;
@@ -16,6 +16,7 @@
 
 #import <Kiwi/Kiwi.h>
 #import "SMPushClient.h"
+#import "SMMockAPIServer.h"
 
 SPEC_BEGIN(SMPushClientSpec)
 
@@ -95,4 +96,97 @@ describe(@"configuration", ^{
     });
 });
 
-SPEC_END
\ No newline at end of file
+describe(@"sendBulkMessage", ^{
+    __block SMPushClient *client = nil;
+    __block SMMockAPIServer *server = nil;
+    __block NSMutableArray *users = nil;
+    beforeEach(^{
+        server = [SMMockAPIServer sharedServer];
+        [server reset];
+        [server start];
+        client = [[SMPushClient alloc] initWithAPIVersion:@"0" publicKey:@"public" privateKey:@"private"];
+        client.bulkBatchSize = 10;
+        client.bulkMaxConcurrentRequests = 2;
+        users = [NSMutableArray array];
+        for (int i = 0; i < 25; i++) {
+            [users addObject:[NSString stringWithFormat:@"user%d", i]];
+        }
+    });
+    afterEach(^{
+        [server stop];
+    });
+    
+    it(@"should send one request per chunk and report progress", ^{
+        __block NSArray *failed = nil;
+        __block NSUInteger chunksSent = 0;
+        __block NSUInteger lastSentCount = 0;
+        [client sendBulkMessage:[NSDictionary dictionaryWithObject:@"hello" forKey:@"alert"] toUsers:users onChunkSuccess:^(NSArray *recipients) {
+            chunksSent++;
+        } onChunkFailure:nil onProgress:^(NSUInteger sentCount, NSUInteger failedCount, NSUInteger totalCount) {
+            lastSentCount = sentCount;
+        } onCompletion:^(NSArray *failedRecipients) {
+            failed = failedRecipients;
+        }];
+        [[expectFutureValue(failed) shouldEventuallyBeforeTimingOutAfter(10.0)] beNonNil];
+        [[theValue([failed count]) should] equal:theValue(0)];
+        [[theValue(chunksSent) should] equal:theValue(3)];
+        [[theValue(lastSentCount) should] equal:theValue(25)];
+        [[theValue([[server sentPushes] count]) should] equal:theValue(3)];
+        [[[[[server sentPushes] lastObject] objectForKey:@"path"] should] equal:@"push_users_universal"];
+    });
+    
+    it(@"should complete straight away with no recipients", ^{
+        __block NSArray *failed = nil;
+        [client sendBulkMessage:[NSDictionary dictionaryWithObject:@"hello" forKey:@"alert"] toUsers:[NSArray array] onChunkSuccess:nil onChunkFailure:nil onProgress:nil onCompletion:^(NSArray *failedRecipients) {
+            failed = failedRecipients;
+        }];
+        [[expectFutureValue(failed) shouldEventuallyBeforeTimingOutAfter(5.0)] beNonNil];
+        [[theValue(server.requestCount) should] equal:theValue(0)];
+    });
+    
+    it(@"should not retry client errors and should return every recipient as failed", ^{
+        server.errorRate = 1;
+        server.errorStatusCode = 400;
+        __block NSArray *failed = nil;
+        __block NSUInteger chunksFailed = 0;
+        [client sendBulkMessage:[NSDictionary dictionaryWithObject:@"hello" forKey:@"alert"] toUsers:users onChunkSuccess:nil onChunkFailure:^(NSArray *recipients, NSError *error) {
+            chunksFailed++;
+        } onProgress:nil onCompletion:^(NSArray *failedRecipients) {
+            failed = failedRecipients;
+        }];
+        [[expectFutureValue(failed) shouldEventuallyBeforeTimingOutAfter(10.0)] beNonNil];
+        [[theValue(chunksFailed) should] equal:theValue(3)];
+        [[[NSSet setWithArray:failed] should] equal:[NSSet setWithArray:users]];
+        [[theValue(server.requestCount) should] equal:theValue(3)];
+    });
+    
+    it(@"should retry server errors before giving up on a chunk", ^{
+        server.errorRate = 1;
+        server.errorStatusCode = 503;
+        client.bulkNumberOfRetries = 2;
+        client.bulkRetryBaseDelay = 0.01;
+        __block NSArray *failed = nil;
+        [client sendBulkMessage:[NSDictionary dictionaryWithObject:@"hello" forKey:@"alert"] toUsers:users onChunkSuccess:nil onChunkFailure:nil onProgress:nil onCompletion:^(NSArray *failedRecipients) {
+            failed = failedRecipients;
+        }];
+        [[expectFutureValue(failed) shouldEventuallyBeforeTimingOutAfter(10.0)] beNonNil];
+        [[theValue([failed count]) should] equal:theValue(25)];
+        [[theValue(server.requestCount) should] equal:theValue(9)];
+    });
+    
+    it(@"should not retry server errors other than 503", ^{
+        server.errorRate = 1;
+        server.errorStatusCode = 500;
+        client.bulkNumberOfRetries = 2;
+        client.bulkRetryBaseDelay = 0.01;
+        __block NSArray *failed = nil;
+        [client sendBulkMessage:[NSDictionary dictionaryWithObject:@"hello" forKey:@"alert"] toUsers:users onChunkSuccess:nil onChunkFailure:nil onProgress:nil onCompletion:^(NSArray *failedRecipients) {
+            failed = failedRecipients;
+        }];
+        [[expectFutureValue(failed) shouldEventuallyBeforeTimingOutAfter(10.0)] beNonNil];
+        [[theValue([failed count]) should] equal:theValue(25)];
+        [[theValue(server.requestCount) should] equal:theValue(3)];
+    });
+});
+
+SPEC_END
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+#import "SMDataStore+Protected.h"
+
+SPEC_BEGIN(SMQueryCursorSpec)
+
+describe(@"SMQueryCursor", ^{
+    __block SMDataStore *dataStore = nil;
+    __block SMQuery *query = nil;
+    beforeEach(^{
+        dataStore = [SMDataStore nullMock];
+        query = [[SMQuery alloc] initWithSchema:@"book"];
+    });
+    it(@"raises for a page size of zero", ^{
+        [[theBlock(^{
+            SMQueryCursor *cursor = [[SMQueryCursor alloc] initWithQuery:query dataStore:dataStore options:nil pageSize:0];
+            [cursor hasMore];
+        }) should] raiseWithName:NSInvalidArgumentException];
+    });
+    it(@"prefetches the first page as soon as it is created", ^{
+        KWCaptureSpy *querySpy = [dataStore captureArgument:@selector(requestFromQuery:options:) atIndex:0];
+        SMQueryCursor *cursor = [[SMQueryCursor alloc] initWithQuery:query dataStore:dataStore options:nil pageSize:2];
+        [[theValue([cursor hasMore]) should] beYes];
+        [[expectFutureValue([[querySpy.argument requestHeaders] objectForKey:@"Range"]) shouldEventually] equal:@"objects=0-1"];
+    });
+    it(@"stops after a short page", ^{
+        KWCaptureSpy *successSpy = [dataStore captureArgument:@selector(queueRequest:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) atIndex:4];
+        SMQueryCursor *cursor = [[SMQueryCursor alloc] initWithQuery:query dataStore:dataStore options:nil pageSize:2];
+        [[expectFutureValue(successSpy.argument) shouldEventually] beNonNil];
+        
+        SMFullResponseSuccessBlock pageSuccessBlock = successSpy.argument;
+        pageSuccessBlock(nil, nil, [NSArray arrayWithObject:[NSDictionary dictionaryWithObject:@"1234" forKey:@"book_id"]]);
+        
+        __block NSArray *page = nil;
+        [cursor nextPageOnSuccess:^(NSArray *results) {
+            page = results;
+        } onFailure:nil];
+        [[expectFutureValue(theValue([page count])) shouldEventually] equal:theValue(1)];
+        [[theValue([cursor hasMore]) should] beNo];
+    });
+});
+
+SPEC_END
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+#import "Synchronization.h"
+#import "SMMockAPIServer.h"
+
+@interface SMRecordingMetricsObserver : NSObject <SMRequestMetricsObserver>
+
+@property (atomic, strong) NSArray *samples;
+
+@end
+
+@implementation SMRecordingMetricsObserver
+
+@synthesize samples = _SM_samples;
+
+- (void)requestMetrics:(SMRequestMetrics *)metrics didRecordSample:(SMRequestMetricsSample *)sample
+{
+    self.samples = self.samples ? [self.samples arrayByAddingObject:sample] : [NSArray arrayWithObject:sample];
+}
+
+@end
+
+static SMRequestMetricsSample *SMSample(NSString *method, NSString *schema, NSInteger statusCode, NSTimeInterval totalTime)
+{
+    SMRequestMetricsSample *sample = [[SMRequestMetricsSample alloc] init];
+    sample.method = method;
+    sample.schema = schema;
+    sample.statusCode = statusCode;
+    sample.totalTime = totalTime;
+    sample.timeToFirstByte = totalTime / 2;
+    return sample;
+}
+
+SPEC_BEGIN(SMRequestMetricsSpec)
+
+describe(@"SMHistogram", ^{
+    __block SMHistogram *histogram = nil;
+    beforeEach(^{
+        histogram = [[SMHistogram alloc] init];
+    });
+    it(@"is empty to begin with", ^{
+        [[theValue(histogram.count) should] equal:theValue(0)];
+        [[theValue([histogram valueAtPercentile:50]) should] equal:theValue(0)];
+    });
+    it(@"keeps exact count, sum and extremes", ^{
+        for (int i = 1; i <= 100; i++) {
+            [histogram recordValue:i];
+        }
+        [[theValue(histogram.count) should] equal:theValue(100)];
+        [[theValue(histogram.sum) should] equal:theValue(5050)];
+        [[theValue(histogram.minimum) should] equal:theValue(1)];
+        [[theValue(histogram.maximum) should] equal:theValue(100)];
+        [[theValue(histogram.mean) should] equal:theValue(50.5)];
+    });
+    it(@"estimates percentiles to within a bucket", ^{
+        for (int i = 1; i <= 10000; i++) {
+            [histogram recordValue:i];
+        }
+        [[theValue([histogram valueAtPercentile:50]) should] beBetween:theValue(5000) and:theValue(5000 * 1.1)];
+        [[theValue([histogram valueAtPercentile:99]) should] beBetween:theValue(9900) and:theValue(10000)];
+        [[theValue([histogram valueAtPercentile:100]) should] equal:theValue(10000)];
+        [[theValue([histogram valueAtPercentile:0]) should] equal:theValue(1)];
+    });
+    it(@"copies independently", ^{
+        [histogram recordValue:10];
+        SMHistogram *copy = [histogram copy];
+        [histogram recordValue:20];
+        [[theValue(copy.count) should] equal:theValue(1)];
+        [[theValue(copy.maximum) should] equal:theValue(10)];
+    });
+});
+
+describe(@"SMRequestMetrics", ^{
+    __block SMRequestMetrics *metrics = nil;
+    __block SMRecordingMetricsObserver *observer = nil;
+    beforeEach(^{
+        metrics = [[SMRequestMetrics alloc] init];
+        observer = [[SMRecordingMetricsObserver alloc] init];
+    });
+    it(@"only collects while enabled or observed", ^{
+        [[theValue(metrics.isCollecting) should] beNo];
+        [metrics addObserver:observer];
+        [[theValue(metrics.isCollecting) should] beYes];
+        [metrics removeObserver:observer];
+        [[theValue(metrics.isCollecting) should] beNo];
+        metrics.enabled = YES;
+        [[theValue(metrics.isCollecting) should] beYes];
+    });
+    it(@"summarizes samples by method and schema", ^{
+        [metrics recordSample:SMSample(@"GET", @"todo", 200, 0.1)];
+        [metrics recordSample:SMSample(@"GET", @"todo", 500, 0.3)];
+        SMRequestMetricsSample *retriedSample = SMSample(@"POST", @"todo", 201, 0.2);
+        retriedSample.retryCount = 1;
+        retriedSample.tokenRefreshed = YES;
+        [metrics recordSample:retriedSample];
+        
+        NSDictionary *snapshot = [metrics snapshot];
+        [[snapshot should] haveCountOf:3];
+        SMRequestMetricsSummary *reads = [snapshot objectForKey:@"GET todo"];
+        [[theValue(reads.requestCount) should] equal:theValue(2)];
+        [[theValue(reads.failureCount) should] equal:theValue(1)];
+        [[theValue(reads.totalTime.maximum) should] equal:theValue(300000)];
+        SMRequestMetricsSummary *allRequests = [snapshot objectForKey:SMRequestMetricsAllRequestsKey];
+        [[theValue(allRequests.requestCount) should] equal:theValue(3)];
+        [[theValue(allRequests.retryCount) should] equal:theValue(1)];
+        [[theValue(allRequests.tokenRefreshCount) should] equal:theValue(1)];
+        
+        [metrics reset];
+        [[[metrics snapshot] should] beEmpty];
+    });
+    it(@"passes samples to observers", ^{
+        [metrics addObserver:observer];
+        SMRequestMetricsSample *sample = SMSample(@"DELETE", @"todo", 0, 1);
+        sample.error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+        [metrics recordSample:sample];
+        [metrics snapshot];
+        [[observer.samples should] haveCountOf:1];
+        [[theValue([[observer.samples lastObject] failed]) should] beYes];
+        SMRequestMetricsSummary *deletes = [[metrics snapshot] objectForKey:@"DELETE todo"];
+        // No response, so no time to first byte
+        [[theValue(deletes.timeToFirstByte.count) should] equal:theValue(0)];
+    });
+    context(@"measuring SMDataStore requests", ^{
+        __block SMMockAPIServer *server = nil;
+        __block SMClient *client = nil;
+        beforeEach(^{
+            server = [SMMockAPIServer sharedServer];
+            [server reset];
+            [server start];
+            client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"mock-public-key"];
+        });
+        afterEach(^{
+            [server stop];
+        });
+        it(@"records schema, status and sizes", ^{
+            [client.session.requestMetrics addObserver:observer];
+            syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+                [[client dataStore] createObject:[NSDictionary dictionaryWithObjectsAndKeys:@"t1", @"todo_id", @"Buy milk", @"title", nil] inSchema:@"todo" onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                }];
+            });
+            [client.session.requestMetrics snapshot];
+            [[observer.samples should] haveCountOf:1];
+            SMRequestMetricsSample *sample = [observer.samples lastObject];
+            [[sample.schema should] equal:@"todo"];
+            [[sample.method should] equal:@"POST"];
+            [[theValue(sample.statusCode) should] equal:theValue(201)];
+            [[theValue(sample.requestBytes) should] beGreaterThan:theValue(0)];
+            [[theValue(sample.responseBytes) should] beGreaterThan:theValue(0)];
+            [[theValue(sample.totalTime) should] beGreaterThanOrEqualTo:theValue(sample.queueWait + sample.timeToFirstByte)];
+        });
+        it(@"measures nothing without an observer", ^{
+            syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+                [[client dataStore] readObjectWithId:@"missing" inSchema:@"todo" onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+                    syncReturn(semaphore);
+                }];
+            });
+            [[[client.session.requestMetrics snapshot] should] beEmpty];
+        });
+    });
+});
+
+SPEC_END
@@ -29,6 +29,34 @@ describe(@"SMRequestOptions", ^{
         [[theValue(options.tryRefreshToken) should] equal:theValue(YES)];
         [options.retryBlock shouldBeNil];
     });
+    it(@"does not stream by default", ^{
+        SMRequestOptions *options = [SMRequestOptions options];
+        [options.streamingBatchBlock shouldBeNil];
+        [[theValue(options.streamingBatchSize) should] equal:theValue(100)];
+    });
+    it(@"backs off from half a second up to thirty by default", ^{
+        SMRequestOptions *options = [SMRequestOptions options];
+        [[theValue(options.retryBaseDelay) should] equal:theValue(0.5)];
+        [[theValue(options.retryMaxDelay) should] equal:theValue(30.0)];
+        [[theValue(options.retriesAttempted) should] equal:theValue(0)];
+    });
+    it(@"has default priority", ^{
+        SMRequestOptions *options = [SMRequestOptions options];
+        [[theValue(options.priority) should] equal:theValue(SMRequestPriorityDefault)];
+    });
+    it(@"copies every option", ^{
+        SMRequestOptions *options = [SMRequestOptions optionsWithHTTPS];
+        options.headers = [NSDictionary dictionaryWithObjectsAndKeys:@"headerValue", @"header", nil];
+        options.numberOfRetries = 1;
+        options.tryRefreshToken = NO;
+        options.streamingBatchSize = 10;
+        SMRequestOptions *copy = [options copy];
+        [[copy.headers should] equal:options.headers];
+        [[theValue(copy.isSecure) should] equal:theValue(YES)];
+        [[theValue(copy.numberOfRetries) should] equal:theValue(1)];
+        [[theValue(copy.tryRefreshToken) should] equal:theValue(NO)];
+        [[theValue(copy.streamingBatchSize) should] equal:theValue(10)];
+    });
     it(@"+optionsWithHeaders", ^{
         NSDictionary *headersDict = [NSDictionary dictionaryWithObjectsAndKeys:@"headerValue", @"header", nil];
         SMRequestOptions *options = [SMRequestOptions optionsWithHeaders:headersDict];
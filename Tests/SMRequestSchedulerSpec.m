@@ -0,0 +1,91 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+
+static AFHTTPRequestOperation *operationForURL(NSString *url, SMRequestPriority priority) {
+    AFHTTPRequestOperation *operation = [[AFHTTPRequestOperation alloc] initWithRequest:[NSURLRequest requestWithURL:[NSURL URLWithString:url]]];
+    [operation setQueuePriority:[SMRequestScheduler queuePriorityForRequestPriority:priority]];
+    return operation;
+}
+
+SPEC_BEGIN(SMRequestSchedulerSpec)
+
+describe(@"SMRequestScheduler", ^{
+    __block SMRequestScheduler *scheduler = nil;
+    __block NSOperationQueue *queue = nil;
+    beforeEach(^{
+        scheduler = [[SMRequestScheduler alloc] init];
+        // Suspended so nothing actually goes on the wire
+        queue = [[NSOperationQueue alloc] init];
+        [queue setSuspended:YES];
+    });
+    afterEach(^{
+        [queue cancelAllOperations];
+    });
+    it(@"maps request priorities onto queue priorities", ^{
+        [[theValue([SMRequestScheduler queuePriorityForRequestPriority:SMRequestPriorityInteractive]) should] equal:theValue(NSOperationQueuePriorityHigh)];
+        [[theValue([SMRequestScheduler queuePriorityForRequestPriority:SMRequestPriorityDefault]) should] equal:theValue(NSOperationQueuePriorityNormal)];
+        [[theValue([SMRequestScheduler queuePriorityForRequestPriority:SMRequestPriorityBackground]) should] equal:theValue(NSOperationQueuePriorityLow)];
+    });
+    it(@"holds requests beyond the global limit", ^{
+        scheduler.maxConcurrentRequests = 1;
+        [scheduler enqueueOperation:operationForURL(@"http://api.stackmob.com/a", SMRequestPriorityDefault) onQueue:queue];
+        [scheduler enqueueOperation:operationForURL(@"http://api.stackmob.com/b", SMRequestPriorityDefault) onQueue:queue];
+        [[theValue([scheduler numberOfPendingRequests]) should] equal:theValue(1)];
+        [[theValue([queue operationCount]) should] equal:theValue(1)];
+    });
+    it(@"holds requests beyond the per host limit", ^{
+        scheduler.maxConcurrentRequestsPerHost = 1;
+        [scheduler enqueueOperation:operationForURL(@"http://api.stackmob.com/a", SMRequestPriorityDefault) onQueue:queue];
+        [scheduler enqueueOperation:operationForURL(@"http://api.stackmob.com/b", SMRequestPriorityDefault) onQueue:queue];
+        [scheduler enqueueOperation:operationForURL(@"http://push.stackmob.com/c", SMRequestPriorityDefault) onQueue:queue];
+        [[theValue([scheduler numberOfPendingRequests]) should] equal:theValue(1)];
+        [[theValue([queue operationCount]) should] equal:theValue(2)];
+    });
+    it(@"starts interactive requests ahead of background ones", ^{
+        scheduler.maxConcurrentRequests = 1;
+        AFHTTPRequestOperation *first = operationForURL(@"http://api.stackmob.com/a", SMRequestPriorityDefault);
+        AFHTTPRequestOperation *background = operationForURL(@"http://api.stackmob.com/b", SMRequestPriorityBackground);
+        AFHTTPRequestOperation *interactive = operationForURL(@"http://api.stackmob.com/c", SMRequestPriorityInteractive);
+        [scheduler enqueueOperation:first onQueue:queue];
+        [scheduler enqueueOperation:background onQueue:queue];
+        [scheduler enqueueOperation:interactive onQueue:queue];
+        [[theValue([scheduler numberOfPendingRequests]) should] equal:theValue(2)];
+        
+        [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingOperationDidFinishNotification object:first];
+        [[expectFutureValue([queue operations]) shouldEventually] contain:interactive];
+        [[[queue operations] shouldNot] contain:background];
+    });
+    it(@"cancels operations which are waiting to be started", ^{
+        scheduler.maxConcurrentRequests = 1;
+        AFHTTPRequestOperation *first = operationForURL(@"http://api.stackmob.com/a", SMRequestPriorityDefault);
+        AFHTTPRequestOperation *waiting = operationForURL(@"http://api.stackmob.com/b", SMRequestPriorityDefault);
+        [scheduler enqueueOperation:first onQueue:queue];
+        [scheduler enqueueOperation:waiting onQueue:queue];
+        [scheduler cancelPendingOperationsOnQueue:queue passingTest:^BOOL(AFHTTPRequestOperation *operation) {
+            return [[[[operation request] URL] path] isEqualToString:@"/b"];
+        }];
+        [[theValue([scheduler numberOfPendingRequests]) should] equal:theValue(0)];
+        [[theValue([waiting isCancelled]) should] beYes];
+        [[theValue([first isCancelled]) should] beNo];
+        [[[queue operations] should] contain:waiting];
+    });
+});
+
+SPEC_END
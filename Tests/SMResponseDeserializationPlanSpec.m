@@ -0,0 +1,148 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "SMError.h"
+#import "SMEntityMetadata.h"
+#import "SMResponseDeserializationPlan.h"
+
+static NSAttributeDescription * SMAttribute(NSString *name, NSAttributeType type)
+{
+    NSAttributeDescription *attribute = [[NSAttributeDescription alloc] init];
+    [attribute setName:name];
+    [attribute setAttributeType:type];
+    return attribute;
+}
+
+SPEC_BEGIN(SMResponseDeserializationPlanSpec)
+
+describe(@"SMResponseDeserializationPlan", ^{
+    __block NSEntityDescription *todoEntity = nil;
+    __block NSEntityDescription *personEntity = nil;
+    __block NSManagedObjectModel *model = nil;
+    beforeEach(^{
+        todoEntity = [[NSEntityDescription alloc] init];
+        [todoEntity setName:@"Todo"];
+        personEntity = [[NSEntityDescription alloc] init];
+        [personEntity setName:@"Person"];
+        
+        NSRelationshipDescription *owner = [[NSRelationshipDescription alloc] init];
+        [owner setName:@"owner"];
+        [owner setMaxCount:1];
+        [owner setDestinationEntity:personEntity];
+        NSRelationshipDescription *watchers = [[NSRelationshipDescription alloc] init];
+        [watchers setName:@"watchers"];
+        [watchers setMaxCount:0];
+        [watchers setDestinationEntity:personEntity];
+        
+        [todoEntity setProperties:[NSArray arrayWithObjects:SMAttribute(@"todoId", NSStringAttributeType), SMAttribute(@"title", NSStringAttributeType), SMAttribute(@"dueDate", NSDateAttributeType), SMAttribute(@"done", NSBooleanAttributeType), SMAttribute(@"priority", NSInteger32AttributeType), SMAttribute(@"weight", NSDoubleAttributeType), owner, watchers, nil]];
+        [personEntity setProperties:[NSArray arrayWithObjects:SMAttribute(@"personId", NSStringAttributeType), nil]];
+        
+        model = [[NSManagedObjectModel alloc] init];
+        [model setEntities:[NSArray arrayWithObjects:todoEntity, personEntity, nil]];
+    });
+    
+    context(@"reading attributes", ^{
+        __block SMResponseDeserializationPlan *plan = nil;
+        beforeEach(^{
+            plan = [SMResponseDeserializationPlan planForEntity:todoEntity];
+        });
+        it(@"reads fields by their StackMob names and drops the rest", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObjectsAndKeys:@"1234", @"todo_id", @"Buy milk", @"title", [NSNumber numberWithLongLong:1349990000000], @"createddate", nil];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:NO store:nil];
+            [[[values objectForKey:@"todoId"] should] equal:@"1234"];
+            [[[values objectForKey:@"title"] should] equal:@"Buy milk"];
+            [[values objectForKey:@"createddate"] shouldBeNil];
+            [[values objectForKey:@"createdDate"] shouldBeNil];
+        });
+        it(@"converts dates from milliseconds to whole seconds", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObject:[NSNumber numberWithLongLong:1349990000999] forKey:@"due_date"];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:NO store:nil];
+            [[[values objectForKey:@"dueDate"] should] equal:[NSDate dateWithTimeIntervalSince1970:1349990000]];
+        });
+        it(@"converts booleans and numbers sent as strings", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObjectsAndKeys:@"true", @"done", @"3", @"priority", @"2.5", @"weight", nil];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:NO store:nil];
+            [[[values objectForKey:@"done"] should] equal:[NSNumber numberWithBool:YES]];
+            [[[values objectForKey:@"priority"] should] equal:[NSNumber numberWithInt:3]];
+            [[[values objectForKey:@"weight"] should] equal:[NSNumber numberWithDouble:2.5]];
+        });
+        it(@"passes null values through", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObject:[NSNull null] forKey:@"due_date"];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:NO store:nil];
+            [[[values objectForKey:@"dueDate"] should] equal:[NSNull null]];
+        });
+    });
+    
+    context(@"reading relationships", ^{
+        __block SMResponseDeserializationPlan *plan = nil;
+        __block id store = nil;
+        beforeEach(^{
+            plan = [SMResponseDeserializationPlan planForEntity:todoEntity];
+            store = [NSIncrementalStore nullMock];
+            [store stub:@selector(newObjectIDForEntity:referenceObject:) andReturn:@"objectID"];
+        });
+        it(@"gives null for a missing to-one relationship", ^{
+            NSDictionary *values = [plan valuesForObject:[NSDictionary dictionary] includeRelationships:YES store:store];
+            [[[values objectForKey:@"owner"] should] equal:[NSNull null]];
+            [[values objectForKey:@"watchers"] shouldBeNil];
+        });
+        it(@"asks the store for object IDs of related objects", ^{
+            [[store should] receive:@selector(newObjectIDForEntity:referenceObject:) andReturn:@"objectID" withCount:3];
+            NSDictionary *object = [NSDictionary dictionaryWithObjectsAndKeys:@"1", @"owner", [NSArray arrayWithObjects:@"2", @"3", nil], @"watchers", nil];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:YES store:store];
+            [[[values objectForKey:@"owner"] should] equal:@"objectID"];
+            [[[values objectForKey:@"watchers"] should] beKindOfClass:[NSSet class]];
+        });
+        it(@"leaves out to-many relationships unless asked for them", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObject:[NSArray arrayWithObject:@"2"] forKey:@"watchers"];
+            NSDictionary *values = [plan valuesForObject:object includeRelationships:NO store:store];
+            [[values objectForKey:@"watchers"] shouldBeNil];
+        });
+        it(@"raises when a to-many relationship is not an array", ^{
+            NSDictionary *object = [NSDictionary dictionaryWithObject:@"2" forKey:@"watchers"];
+            [[theBlock(^{
+                [plan valuesForObject:object includeRelationships:YES store:store];
+            }) should] raiseWithName:SMExceptionIncompatibleObject];
+        });
+    });
+    
+    it(@"is compiled with the entity metadata once the model is registered", ^{
+        [SMEntityMetadata registerModel:model userSchema:@"user" userPrimaryKeyField:@"username"];
+        SMResponseDeserializationPlan *plan = [SMResponseDeserializationPlan planForEntity:todoEntity];
+        [[plan should] beIdenticalTo:[[SMEntityMetadata metadataForEntity:todoEntity] responseDeserializationPlan]];
+        [[plan should] beIdenticalTo:[SMResponseDeserializationPlan planForEntity:todoEntity]];
+    });
+    
+    it(@"reads every row of a response", ^{
+        [SMEntityMetadata registerModel:model userSchema:@"user" userPrimaryKeyField:@"username"];
+        NSMutableArray *rows = [NSMutableArray arrayWithCapacity:100];
+        for (int i = 0; i < 100; i++) {
+            [rows addObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"%d", i], @"todo_id", @"Buy milk", @"title", [NSNumber numberWithLongLong:1349990000000], @"due_date", [NSNumber numberWithBool:NO], @"done", [NSNumber numberWithInt:i], @"priority", [NSNumber numberWithDouble:1.5], @"weight", [NSNumber numberWithLongLong:1349990000000], @"createddate", [NSNumber numberWithLongLong:1349990000000], @"lastmoddate", nil]];
+        }
+        
+        SMResponseDeserializationPlan *plan = [SMResponseDeserializationPlan planForEntity:todoEntity];
+        __block NSUInteger valueCount = 0;
+        [rows enumerateObjectsUsingBlock:^(id row, NSUInteger idx, BOOL *stop) {
+            valueCount += [[plan valuesForObject:row includeRelationships:NO store:nil] count];
+        }];
+        
+        [[theValue(valueCount) should] equal:theValue(100 * 7)];
+    });
+});
+
+SPEC_END
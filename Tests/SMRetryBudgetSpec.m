@@ -0,0 +1,56 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import <Kiwi/Kiwi.h>
+#import "SMRetryBudget.h"
+
+SPEC_BEGIN(SMRetryBudgetSpec)
+
+describe(@"SMRetryBudget", ^{
+    __block SMRetryBudget *budget = nil;
+    beforeEach(^{
+        budget = [[SMRetryBudget alloc] init];
+    });
+    it(@"starts with a full budget", ^{
+        for (int i = 0; i < 10; i++) {
+            [[theValue([budget withdrawRetry]) should] beYes];
+        }
+        [[theValue([budget withdrawRetry]) should] beNo];
+    });
+    it(@"earns a retry back for every ten requests", ^{
+        while ([budget withdrawRetry]);
+        for (int i = 0; i < 9; i++) {
+            [budget recordRequest];
+        }
+        [[theValue([budget withdrawRetry]) should] beNo];
+        // Ten tenths can fall just short of one in floating point, so record eleven
+        [budget recordRequest];
+        [budget recordRequest];
+        [[theValue([budget withdrawRetry]) should] beYes];
+    });
+    it(@"does not save up more than the maximum", ^{
+        for (int i = 0; i < 1000; i++) {
+            [budget recordRequest];
+        }
+        for (int i = 0; i < 10; i++) {
+            [budget withdrawRetry];
+        }
+        [[theValue([budget withdrawRetry]) should] beNo];
+    });
+});
+
+SPEC_END
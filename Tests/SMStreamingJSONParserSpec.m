@@ -0,0 +1,84 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "SMStreamingJSONParser.h"
+
+SPEC_BEGIN(SMStreamingJSONParserSpec)
+
+describe(@"SMStreamingJSONParser", ^{
+    __block NSMutableArray *batches = nil;
+    __block SMStreamingJSONParser *parser = nil;
+    beforeEach(^{
+        batches = [NSMutableArray array];
+        parser = [[SMStreamingJSONParser alloc] initWithBatchSize:2 batchBlock:^(NSArray *batch) {
+            [batches addObject:batch];
+        }];
+    });
+    context(@"given an array split across chunks", ^{
+        it(@"delivers the elements in order, in batches", ^{
+            NSString *json = @"[{\"name\":\"a,]\\\"[}\",\"tags\":[1,2]}, {\"name\":\"b\"} ,{\"name\":\"c\"}]";
+            NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+            for (NSUInteger i = 0; i < [data length]; i += 3) {
+                NSUInteger length = MIN(3, [data length] - i);
+                [[theValue([parser appendData:[data subdataWithRange:NSMakeRange(i, length)]]) should] beYes];
+            }
+            [[theValue([batches count]) should] equal:theValue(1)];
+            [[theValue([parser finish]) should] beYes];
+            
+            [[theValue([batches count]) should] equal:theValue(2)];
+            [[theValue([[batches objectAtIndex:0] count]) should] equal:theValue(2)];
+            [[[[[batches objectAtIndex:0] objectAtIndex:0] objectForKey:@"name"] should] equal:@"a,]\"[}"];
+            [[[[[batches objectAtIndex:1] objectAtIndex:0] objectForKey:@"name"] should] equal:@"c"];
+            [[theValue(parser.numberOfParsedObjects) should] equal:theValue(3)];
+            [[theValue(parser.isStreamingArray) should] beYes];
+            [parser.bufferedObject shouldBeNil];
+        });
+    });
+    context(@"given an empty array", ^{
+        it(@"delivers no batches", ^{
+            [parser appendData:[@" [ ] " dataUsingEncoding:NSUTF8StringEncoding]];
+            [[theValue([parser finish]) should] beYes];
+            [[theValue([batches count]) should] equal:theValue(0)];
+        });
+    });
+    context(@"given a body which is not an array", ^{
+        it(@"buffers and parses it at the end", ^{
+            [parser appendData:[@"{\"error\":" dataUsingEncoding:NSUTF8StringEncoding]];
+            [parser appendData:[@"\"not found\"}" dataUsingEncoding:NSUTF8StringEncoding]];
+            [[theValue([parser finish]) should] beYes];
+            [[theValue(parser.isStreamingArray) should] beNo];
+            [[[parser.bufferedObject objectForKey:@"error"] should] equal:@"not found"];
+            [[theValue([batches count]) should] equal:theValue(0)];
+        });
+    });
+    context(@"given a truncated array", ^{
+        it(@"fails on finish", ^{
+            [parser appendData:[@"[{\"name\":\"a\"},{\"na" dataUsingEncoding:NSUTF8StringEncoding]];
+            [[theValue([parser finish]) should] beNo];
+            [parser.error shouldNotBeNil];
+        });
+    });
+    context(@"given a malformed element", ^{
+        it(@"fails and ignores further data", ^{
+            [[theValue([parser appendData:[@"[{\"name\" \"a\"}," dataUsingEncoding:NSUTF8StringEncoding]]) should] beNo];
+            [parser.error shouldNotBeNil];
+            [[theValue([parser appendData:[@"{\"name\":\"b\"}]" dataUsingEncoding:NSUTF8StringEncoding]]) should] beNo];
+        });
+    });
+});
+
+SPEC_END
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Kiwi/Kiwi.h>
+#import "StackMob.h"
+#import "Synchronization.h"
+#import "SMMockAPIServer.h"
+
+static NSArray *SMTraceEventsWithPhase(SMTracer *tracer, NSString *phase)
+{
+    NSArray *events = [[tracer traceEventObject] objectForKey:@"traceEvents"];
+    return [events filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"ph == %@", phase]];
+}
+
+SPEC_BEGIN(SMTracerSpec)
+
+describe(@"SMTracer", ^{
+    __block SMTracer *tracer = nil;
+    beforeEach(^{
+        tracer = [[SMTracer alloc] init];
+        tracer.enabled = YES;
+    });
+    it(@"hands out nil spans while disabled", ^{
+        tracer.enabled = NO;
+        [[tracer beginSpanWithName:@"work" category:@"test"] shouldBeNil];
+        [[tracer beginDetachedSpanWithName:@"work" category:@"test" parent:nil] shouldBeNil];
+        [[SMTraceEventsWithPhase(tracer, @"X") should] beEmpty];
+    });
+    it(@"nests spans on the same thread", ^{
+        SMTraceSpan *outer = [tracer beginSpanWithName:@"outer" category:@"test"];
+        SMTraceSpan *inner = [tracer beginSpanWithName:@"inner" category:@"test"];
+        [[inner.parent should] equal:outer];
+        [[[tracer currentSpan] should] equal:inner];
+        [inner end];
+        [[[tracer currentSpan] should] equal:outer];
+        [outer end];
+        [[tracer currentSpan] shouldBeNil];
+        
+        NSArray *events = SMTraceEventsWithPhase(tracer, @"X");
+        [[events should] haveCountOf:2];
+        NSDictionary *innerEvent = [events objectAtIndex:0];
+        [[[innerEvent objectForKey:@"name"] should] equal:@"inner"];
+        [[[[innerEvent objectForKey:@"args"] objectForKey:@"parent_id"] should] equal:[NSNumber numberWithUnsignedLongLong:outer.spanID]];
+        [[[innerEvent objectForKey:@"tid"] should] equal:[NSNumber numberWithUnsignedInt:outer.threadID]];
+    });
+    it(@"records a span once however many times it is ended", ^{
+        SMTraceSpan *span = [tracer beginSpanWithName:@"work" category:@"test"];
+        [span setArgument:@"value" forKey:@"key"];
+        [span end];
+        [span end];
+        NSArray *events = SMTraceEventsWithPhase(tracer, @"X");
+        [[events should] haveCountOf:1];
+        [[[[[events lastObject] objectForKey:@"args"] objectForKey:@"key"] should] equal:@"value"];
+    });
+    it(@"draws detached spans as async slices", ^{
+        SMTraceSpan *parent = [tracer beginSpanWithName:@"parent" category:@"test"];
+        SMTraceSpan *detached = [tracer beginDetachedSpanWithName:@"request" category:@"http" parent:parent];
+        [[[tracer currentSpan] should] equal:parent];
+        syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                [detached end];
+                syncReturn(semaphore);
+            });
+        });
+        [parent end];
+        [[SMTraceEventsWithPhase(tracer, @"b") should] haveCountOf:1];
+        [[SMTraceEventsWithPhase(tracer, @"e") should] haveCountOf:1];
+        NSDictionary *begin = [SMTraceEventsWithPhase(tracer, @"b") lastObject];
+        [[[[begin objectForKey:@"args"] objectForKey:@"parent_id"] should] equal:[NSNumber numberWithUnsignedLongLong:parent.spanID]];
+    });
+    it(@"links children on other threads with flow events", ^{
+        SMTraceSpan *parent = [tracer beginSpanWithName:@"parent" category:@"test"];
+        __block SMTraceSpan *child = nil;
+        syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                child = [tracer beginSpanWithName:@"child" category:@"test" parent:parent];
+                [[[tracer currentSpan] should] equal:child];
+                [child end];
+                syncReturn(semaphore);
+            });
+        });
+        [parent end];
+        [[child.parent should] equal:parent];
+        NSDictionary *flowStart = [SMTraceEventsWithPhase(tracer, @"s") lastObject];
+        NSDictionary *flowEnd = [SMTraceEventsWithPhase(tracer, @"f") lastObject];
+        [[[flowStart objectForKey:@"tid"] should] equal:[NSNumber numberWithUnsignedInt:parent.threadID]];
+        [[[flowEnd objectForKey:@"tid"] should] equal:[NSNumber numberWithUnsignedInt:child.threadID]];
+        [[[flowEnd objectForKey:@"id"] should] equal:[flowStart objectForKey:@"id"]];
+    });
+    it(@"drops spans beyond the maximum", ^{
+        tracer.maximumSpanCount = 2;
+        for (int i = 0; i < 3; i++) {
+            [[tracer beginSpanWithName:@"work" category:@"test"] end];
+        }
+        [[SMTraceEventsWithPhase(tracer, @"X") should] haveCountOf:2];
+        [[theValue(tracer.droppedSpanCount) should] equal:theValue(1)];
+        [tracer reset];
+        [[SMTraceEventsWithPhase(tracer, @"X") should] beEmpty];
+        [[theValue(tracer.droppedSpanCount) should] equal:theValue(0)];
+    });
+    it(@"writes a trace-event file", ^{
+        [[tracer beginSpanWithName:@"work" category:@"test"] end];
+        NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SMTracerSpec.json"];
+        NSError *error = nil;
+        [[theValue([tracer writeTraceToPath:path error:&error]) should] beYes];
+        [error shouldBeNil];
+        NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:path] options:0 error:nil];
+        [[[trace objectForKey:@"traceEvents"] should] haveCountOf:2];
+        [[[[trace objectForKey:@"traceEvents"] valueForKey:@"ph"] should] containObjects:@"M", @"X", nil];
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    });
+    
+    context(@"with the mock API server", ^{
+        __block SMMockAPIServer *server = nil;
+        __block SMClient *client = nil;
+        beforeEach(^{
+            tracer = [SMTracer sharedTracer];
+            [tracer reset];
+            tracer.enabled = YES;
+            server = [SMMockAPIServer sharedServer];
+            [server reset];
+            [server start];
+            client = [[SMClient alloc] initWithAPIVersion:@"0" publicKey:@"mock-public-key"];
+        });
+        afterEach(^{
+            [server stop];
+            tracer.enabled = NO;
+            [tracer reset];
+        });
+        it(@"traces HTTP operations under the span which sent them", ^{
+            SMTraceSpan *parent = [tracer beginSpanWithName:@"create" category:@"test"];
+            syncWithSemaphore(^(dispatch_semaphore_t semaphore) {
+                [[client dataStore] createObject:[NSDictionary dictionaryWithObjectsAndKeys:@"t1", @"todo_id", nil] inSchema:@"todo" onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+                    syncReturn(semaphore);
+                }];
+            });
+            [parent end];
+            NSDictionary *begin = [SMTraceEventsWithPhase(tracer, @"b") lastObject];
+            [[[begin objectForKey:@"name"] should] equal:@"POST /todo"];
+            [[[begin objectForKey:@"cat"] should] equal:@"http"];
+            [[[[begin objectForKey:@"args"] objectForKey:@"parent_id"] should] equal:[NSNumber numberWithUnsignedLongLong:parent.spanID]];
+            [[[[begin objectForKey:@"args"] objectForKey:@"status_code"] should] equal:[NSNumber numberWithInt:201]];
+        });
+    });
+});
+
+SPEC_END
@@ -14,4 +14,29 @@
  * limitations under the License.
  */
 
+/**
+ The number of characters needed to base64 encode length bytes, including padding.
+ */
+#define Base64EncodedLength(length) ((((length) + 2) / 3) * 4)
+
+/**
+ Base64 encodes length bytes of input into output, which must have room for `Base64EncodedLength(length)` characters.  No terminating NUL is written.
+ 
+ Returns the number of characters written.
+ */
+size_t Base64EncodeBytes(const uint8_t *input, size_t length, char *output);
+
+/**
+ Returns the standard, padded base64 encoding of data.
+ */
 NSString * Base64EncodedStringFromData(NSData *data);
+
+/**
+ Reads stream to the end, in chunks, and returns the base64 encoding of its contents, or nil if the stream fails.  The stream is opened if needed but not closed.
+ */
+NSString * Base64EncodedStringFromInputStream(NSInputStream *stream);
+
+/**
+ Returns the data encoded in a standard base64 string, or nil if the string is not valid base64.  Whitespace is ignored and padding is optional.
+ */
+NSData * DataFromBase64EncodedString(NSString *string);
@@ -41,29 +41,212 @@
 // THE SOFTWARE.
 //
 
+#define BASE64_STREAM_CHUNK_SIZE (3 * 16384)
+#define BASE64_INVALID 0x80000000
+
+static char const kSMBase64EncodingTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Two output characters for every 12-bit value, so a 3-byte group is encoded with two lookups
+static uint16_t SMBase64EncodingPairs[4096];
+
+// The 6-bit value of each character, pre-shifted into its place in a 24-bit group, or BASE64_INVALID
+static uint32_t SMBase64DecodingTables[4][256];
+
+static void SMBase64BuildTables(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (int i = 0; i < 4096; i++) {
+            char pair[2] = { kSMBase64EncodingTable[i >> 6], kSMBase64EncodingTable[i & 0x3F] };
+            memcpy(&SMBase64EncodingPairs[i], pair, 2);
+        }
+        for (int position = 0; position < 4; position++) {
+            for (int c = 0; c < 256; c++) {
+                SMBase64DecodingTables[position][c] = BASE64_INVALID;
+            }
+            for (uint32_t value = 0; value < 64; value++) {
+                SMBase64DecodingTables[position][(uint8_t)kSMBase64EncodingTable[value]] = value << (6 * (3 - position));
+            }
+        }
+    });
+}
+
+size_t Base64EncodeBytes(const uint8_t *input, size_t length, char *output)
+{
+    SMBase64BuildTables();
+    
+    char *out = output;
+    size_t i = 0;
+    
+    // Four groups per iteration
+    for (; i + 12 <= length; i += 12, out += 16) {
+        uint32_t a = (input[i] << 16) | (input[i + 1] << 8) | input[i + 2];
+        uint32_t b = (input[i + 3] << 16) | (input[i + 4] << 8) | input[i + 5];
+        uint32_t c = (input[i + 6] << 16) | (input[i + 7] << 8) | input[i + 8];
+        uint32_t d = (input[i + 9] << 16) | (input[i + 10] << 8) | input[i + 11];
+        memcpy(out, &SMBase64EncodingPairs[a >> 12], 2);
+        memcpy(out + 2, &SMBase64EncodingPairs[a & 0xFFF], 2);
+        memcpy(out + 4, &SMBase64EncodingPairs[b >> 12], 2);
+        memcpy(out + 6, &SMBase64EncodingPairs[b & 0xFFF], 2);
+        memcpy(out + 8, &SMBase64EncodingPairs[c >> 12], 2);
+        memcpy(out + 10, &SMBase64EncodingPairs[c & 0xFFF], 2);
+        memcpy(out + 12, &SMBase64EncodingPairs[d >> 12], 2);
+        memcpy(out + 14, &SMBase64EncodingPairs[d & 0xFFF], 2);
+    }
+    for (; i + 3 <= length; i += 3, out += 4) {
+        uint32_t group = (input[i] << 16) | (input[i + 1] << 8) | input[i + 2];
+        memcpy(out, &SMBase64EncodingPairs[group >> 12], 2);
+        memcpy(out + 2, &SMBase64EncodingPairs[group & 0xFFF], 2);
+    }
+    
+    size_t remaining = length - i;
+    if (remaining > 0) {
+        uint32_t group = (input[i] << 16) | (remaining > 1 ? input[i + 1] << 8 : 0);
+        out[0] = kSMBase64EncodingTable[(group >> 18) & 0x3F];
+        out[1] = kSMBase64EncodingTable[(group >> 12) & 0x3F];
+        out[2] = remaining > 1 ? kSMBase64EncodingTable[(group >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    
+    return out - output;
+}
+
 NSString * Base64EncodedStringFromData(NSData *data)
 {
     NSUInteger length = [data length];
-    NSMutableData *mutableData = [NSMutableData dataWithLength:((length + 2) / 3) * 4];
+    if (length == 0) {
+        return @"";
+    }
     
-    uint8_t *input = (uint8_t *)[data bytes];
-    uint8_t *output = (uint8_t *)[mutableData mutableBytes];
+    // The string takes ownership of the buffer rather than copying it
+    size_t outputLength = Base64EncodedLength(length);
+    char *output = malloc(outputLength);
+    if (output == NULL) {
+        return nil;
+    }
+    Base64EncodeBytes([data bytes], length, output);
+    return [[NSString alloc] initWithBytesNoCopy:output length:outputLength encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+NSString * Base64EncodedStringFromInputStream(NSInputStream *stream)
+{
+    if ([stream streamStatus] == NSStreamStatusNotOpen) {
+        [stream open];
+    }
+    
+    uint8_t *chunk = malloc(BASE64_STREAM_CHUNK_SIZE);
+    size_t capacity = Base64EncodedLength(BASE64_STREAM_CHUNK_SIZE);
+    size_t outputLength = 0;
+    char *output = malloc(capacity);
+    if (chunk == NULL || output == NULL) {
+        free(chunk);
+        free(output);
+        return nil;
+    }
     
-    for (NSUInteger i = 0; i < length; i += 3) {
-        NSUInteger value = 0;
-        for (NSUInteger j = i; j < (i + 3); j++) {
-            value <<= 8;
-            if (j < length) value |= (0xFF & input[j]); 
+    // Bytes which did not make up a whole group are carried over to the front of the next chunk
+    size_t carried = 0;
+    BOOL failed = NO;
+    while (YES) {
+        NSInteger bytesRead = [stream read:chunk + carried maxLength:BASE64_STREAM_CHUNK_SIZE - carried];
+        if (bytesRead < 0) {
+            failed = YES;
+            break;
         }
         
-        static uint8_t const kAFBase64EncodingTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        size_t available = carried + bytesRead;
+        size_t encodable = bytesRead == 0 ? available : available - (available % 3);
+        if (outputLength + Base64EncodedLength(encodable) > capacity) {
+            capacity = MAX(capacity * 2, outputLength + Base64EncodedLength(encodable));
+            char *grown = realloc(output, capacity);
+            if (grown == NULL) {
+                failed = YES;
+                break;
+            }
+            output = grown;
+        }
+        outputLength += Base64EncodeBytes(chunk, encodable, output + outputLength);
+        carried = available - encodable;
+        memmove(chunk, chunk + encodable, carried);
         
-        NSUInteger idx = (i / 3) * 4;
-        output[idx + 0] = kAFBase64EncodingTable[(value >> 18) & 0x3F];
-        output[idx + 1] = kAFBase64EncodingTable[(value >> 12) & 0x3F];
-        output[idx + 2] = (i + 1) < length ? kAFBase64EncodingTable[(value >> 6)  & 0x3F] : '=';
-        output[idx + 3] = (i + 2) < length ? kAFBase64EncodingTable[(value >> 0)  & 0x3F] : '=';
+        if (bytesRead == 0) {
+            break;
+        }
+    }
+    free(chunk);
+    
+    if (failed) {
+        free(output);
+        return nil;
+    }
+    if (outputLength == 0) {
+        free(output);
+        return @"";
+    }
+    return [[NSString alloc] initWithBytesNoCopy:output length:outputLength encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+static NSData * SMDataFromBase64Characters(const uint8_t *input, size_t length)
+{
+    while (length > 0 && input[length - 1] == '=') {
+        length--;
+    }
+    if (length % 4 == 1) {
+        return nil;
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithLength:(length / 4) * 3 + (length % 4 == 0 ? 0 : (length % 4) - 1)];
+    uint8_t *out = [data mutableBytes];
+    size_t i = 0;
+    
+    for (; i + 4 <= length; i += 4, out += 3) {
+        uint32_t group = SMBase64DecodingTables[0][input[i]] | SMBase64DecodingTables[1][input[i + 1]] | SMBase64DecodingTables[2][input[i + 2]] | SMBase64DecodingTables[3][input[i + 3]];
+        if (group & BASE64_INVALID) {
+            return nil;
+        }
+        out[0] = group >> 16;
+        out[1] = group >> 8;
+        out[2] = group;
     }
     
-    return [[NSString alloc] initWithData:mutableData encoding:NSASCIIStringEncoding];
+    size_t remaining = length - i;
+    if (remaining > 0) {
+        uint32_t group = SMBase64DecodingTables[0][input[i]] | SMBase64DecodingTables[1][input[i + 1]] | (remaining > 2 ? SMBase64DecodingTables[2][input[i + 2]] : 0);
+        if (group & BASE64_INVALID) {
+            return nil;
+        }
+        out[0] = group >> 16;
+        if (remaining > 2) {
+            out[1] = group >> 8;
+        }
+    }
+    
+    return data;
+}
+
+NSData * DataFromBase64EncodedString(NSString *string)
+{
+    SMBase64BuildTables();
+    
+    NSData *characters = [string dataUsingEncoding:NSASCIIStringEncoding];
+    if (characters == nil) {
+        return nil;
+    }
+    
+    NSData *data = SMDataFromBase64Characters([characters bytes], [characters length]);
+    if (data == nil) {
+        // Only strip whitespace, such as MIME line breaks, when the fast path fails
+        NSMutableData *stripped = [NSMutableData dataWithCapacity:[characters length]];
+        const uint8_t *bytes = [characters bytes];
+        for (NSUInteger i = 0; i < [characters length]; i++) {
+            if (bytes[i] != ' ' && bytes[i] != '\n' && bytes[i] != '\r' && bytes[i] != '\t') {
+                [stripped appendBytes:&bytes[i] length:1];
+            }
+        }
+        if ([stripped length] < [characters length]) {
+            data = SMDataFromBase64Characters([stripped bytes], [stripped length]);
+        }
+    }
+    return data;
 }
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2012 StackMob
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#import "GzipCompressedDataFromData.h"
+#import <zlib.h>
+
+NSData * GzipCompressedDataFromData(NSData *data)
+{
+    if ([data length] == 0) {
+        return data;
+    }
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    
+    // 15 window bits, plus 16 to ask zlib for a gzip header and trailer instead of a zlib one
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nil;
+    }
+    
+    // deflateBound is large enough for a single call to deflate to finish
+    NSMutableData *compressedData = [NSMutableData dataWithLength:deflateBound(&stream, [data length])];
+    stream.next_in = (Bytef *)[data bytes];
+    stream.avail_in = (uInt)[data length];
+    stream.next_out = (Bytef *)[compressedData mutableBytes];
+    stream.avail_out = (uInt)[compressedData length];
+    
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        return nil;
+    }
+    
+    [compressedData setLength:stream.total_out];
+    return compressedData;
+}
@@ -508,7 +508,8 @@ describe(@"with fixtures", ^{
             });
             
             it(@"deletes objects with relationships", ^{
-                SM_CORE_DATA_DEBUG = YES;
+                [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+                [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
                 [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
                 __block Person *firstPerson;
                 __block NSString *firstPersonName;
@@ -670,7 +671,8 @@ describe(@"Testing CRUD on an entity with camelCase property names", ^{
     __block SMCoreDataStore *cds = nil;
     __block NSManagedObject *camelCaseObject = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
         cds = [client coreDataStoreWithManagedObjectModel:[NSManagedObjectModel mergedModelFromBundles:[NSBundle allBundles]]];
@@ -43,7 +43,8 @@ describe(@"LocalReadCacheInitialization", ^{
     __block SMCoreDataStore *cds = nil;
     __block NSManagedObjectContext *moc = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         SM_CACHE_ENABLED = YES;
         client = [SMIntegrationTestHelpers defaultClient];
     });
@@ -66,7 +67,8 @@ describe(@"Successful fetching replaces equivalent results of fetching from cach
     __block NSDictionary *fixtures;
     beforeEach(^{
         SM_CACHE_ENABLED = YES;
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         
         fixturesToLoad = [NSArray arrayWithObjects:@"person", nil];
         fixtures = [SMIntegrationTestHelpers loadFixturesNamed:fixturesToLoad];
@@ -149,7 +151,8 @@ describe(@"Fetch with Cache", ^{
     __block NSDictionary *fixtures;
     beforeEach(^{
         SM_CACHE_ENABLED = YES;
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         
         fixturesToLoad = [NSArray arrayWithObjects:@"person", nil];
         fixtures = [SMIntegrationTestHelpers loadFixturesNamed:fixturesToLoad];
@@ -171,7 +174,7 @@ describe(@"Fetch with Cache", ^{
             __block NSArray *fetchResults = nil;
             [cds setCachePolicy:SMCachePolicyTryCacheElseNetwork];
             
-            [[cds should] receive:@selector(performQuery:options:successCallbackQueue:failureCallbackQueue:onSuccess:onFailure:) withCount:1];
+            [[cds should] receive:@selector(performQuery:options:pageSize:maxConcurrentPages:successCallbackQueue:failureCallbackQueue:onPage:onSuccess:onFailure:) withCount:1];
             
             [SMCoreDataIntegrationTestHelpers executeSynchronousFetch:moc withRequest:[SMCoreDataIntegrationTestHelpers makePersonFetchRequest:nil context:moc] andBlock:^(NSArray *results, NSError *error) {
                 fetchResults = results;
@@ -795,7 +798,8 @@ describe(@"Fetch with Cache", ^{
         it(@"To-Many relationship fault fill without internet when related object has NOT been previously fetched remains a fault", ^{
             __block NSManagedObjectContext *testContext = moc;
             __block Person *jonObject = nil;
-            SM_CORE_DATA_DEBUG = YES;
+            [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+            [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
             [cds setCachePolicy:SMCachePolicyTryNetworkOnly];
             
             // fetch new object, which will fault
@@ -1026,7 +1030,8 @@ describe(@"Purging the Cache", ^{
     __block NSDictionary *fixtures;
     beforeEach(^{
         SM_CACHE_ENABLED = YES;
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
         [SMCoreDataIntegrationTestHelpers removeSQLiteDatabaseAndMapsWithPublicKey:client.publicKey];
@@ -1144,7 +1149,8 @@ describe(@"purging cache of multiple objects at a time", ^{
     __block NSDictionary *fixtures;
     beforeEach(^{
         SM_CACHE_ENABLED = YES;
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
         [SMCoreDataIntegrationTestHelpers removeSQLiteDatabaseAndMapsWithPublicKey:client.publicKey];
@@ -1231,7 +1237,8 @@ describe(@"calls to save when not online", ^{
     __block SMCoreDataStore *cds = nil;
     __block NSManagedObjectContext *moc = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
         NSBundle *classBundle = [NSBundle bundleForClass:[self class]];
@@ -1391,7 +1398,8 @@ describe(@"returning proper errors from reads", ^{
     __block SMCoreDataStore *cds = nil;
     __block NSManagedObjectContext *moc = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         NSBundle *classBundle = [NSBundle bundleForClass:[self class]];
         NSURL *modelURL = [classBundle URLForResource:@"SMCoreDataIntegrationTest" withExtension:@"momd"];
@@ -1434,7 +1442,8 @@ describe(@"cache enabling and disabling", ^{
     __block SMCoreDataStore *cds = nil;
     __block NSManagedObjectContext *moc = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         [SMCoreDataIntegrationTestHelpers removeSQLiteDatabaseAndMaps];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
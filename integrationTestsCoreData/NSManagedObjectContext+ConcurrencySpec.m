@@ -72,19 +72,82 @@ describe(@"fetching runs in the background", ^{
     });
     it(@"fetches, async method", ^{
         [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
-        dispatch_group_t group = dispatch_group_create();
         dispatch_queue_t queue = dispatch_queue_create("queue", NULL);
         NSFetchRequest *fetch = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
-        dispatch_group_enter(group);
+        __block BOOL finished = NO;
+        // Objects are materialized on moc's queue, which is the main queue here, so wait by running the run loop rather than blocking it
         [moc executeFetchRequest:fetch returnManagedObjectIDs:NO successCallbackQueue:queue failureCallbackQueue:queue onSuccess:^(NSArray *results) {
             [results shouldNotBeNil];
-            dispatch_group_leave(group);
+            finished = YES;
         } onFailure:^(NSError *error) {
             [error shouldBeNil];
-            dispatch_group_leave(group);
+            finished = YES;
         }];
         
-        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        [[expectFutureValue(theValue(finished)) shouldEventuallyBeforeTimingOutAfter(30.0)] beYes];
+        dispatch_release(queue);
+        
+    });
+    it(@"fetches in batches, async method", ^{
+        [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
+        dispatch_queue_t queue = dispatch_queue_create("queue", NULL);
+        NSFetchRequest *fetch = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
+        [fetch setFetchBatchSize:10];
+        NSMutableArray *batches = [NSMutableArray array];
+        __block NSArray *allResults = nil;
+        __block BOOL finished = NO;
+        [moc executeFetchRequest:fetch successCallbackQueue:queue failureCallbackQueue:queue onBatch:^(NSArray *results) {
+            [batches addObject:results];
+        } onSuccess:^(NSArray *results) {
+            allResults = results;
+            finished = YES;
+        } onFailure:^(NSError *error) {
+            [error shouldBeNil];
+            finished = YES;
+        }];
+        
+        [[expectFutureValue(theValue(finished)) shouldEventuallyBeforeTimingOutAfter(30.0)] beYes];
+        [allResults shouldNotBeNil];
+        [[theValue([allResults count]) should] beGreaterThanOrEqualTo:theValue(30)];
+        [[theValue([batches count]) should] equal:theValue(([allResults count] + 9) / 10)];
+        [[[batches objectAtIndex:0] should] haveCountOf:10];
+        [[[[batches objectAtIndex:0] objectAtIndex:0] should] equal:[allResults objectAtIndex:0]];
+        dispatch_release(queue);
+        
+    });
+    it(@"fetches unfaulted objects, sync method", ^{
+        [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
+        NSError *error = nil;
+        NSFetchRequest *fetch = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
+        [fetch setReturnsObjectsAsFaults:NO];
+        NSArray *results = [moc executeFetchRequestAndWait:fetch error:&error];
+        [error shouldBeNil];
+        [results enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+            [[theValue([obj isFault]) should] beNo];
+        }];
+        
+    });
+    it(@"fetches unfaulted objects, async method", ^{
+        [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
+        dispatch_queue_t queue = dispatch_queue_create("queue", NULL);
+        NSFetchRequest *fetch = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
+        [fetch setReturnsObjectsAsFaults:NO];
+        __block NSArray *fetchedObjects = nil;
+        __block BOOL finished = NO;
+        [moc executeFetchRequest:fetch returnManagedObjectIDs:NO successCallbackQueue:queue failureCallbackQueue:queue onSuccess:^(NSArray *results) {
+            fetchedObjects = results;
+            finished = YES;
+        } onFailure:^(NSError *error) {
+            [error shouldBeNil];
+            finished = YES;
+        }];
+        
+        [[expectFutureValue(theValue(finished)) shouldEventuallyBeforeTimingOutAfter(30.0)] beYes];
+        [[theValue([fetchedObjects count]) should] beGreaterThanOrEqualTo:theValue(30)];
+        [fetchedObjects enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+            [[theValue([obj isFault]) should] beNo];
+        }];
+        dispatch_release(queue);
         
     });
     
@@ -134,22 +197,20 @@ describe(@"Returning managed object vs. ids", ^{
         [[client.session.networkMonitor stubAndReturn:theValue(1)] currentNetworkStatus];
         NSFetchRequest *fetch = [[NSFetchRequest alloc] initWithEntityName:@"Todo"];
         dispatch_queue_t queue = dispatch_queue_create("queue", NULL);
-        dispatch_group_t group = dispatch_group_create();
+        __block BOOL finished = NO;
         
-        dispatch_group_enter(group);
         [moc executeFetchRequest:fetch returnManagedObjectIDs:NO successCallbackQueue:queue failureCallbackQueue:queue onSuccess:^(NSArray *results) {
             [results enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
                 [[theValue([obj class] == [NSManagedObject class]) should] beYes];
             }];
-            dispatch_group_leave(group);
+            finished = YES;
         } onFailure:^(NSError *error) {
             [error shouldBeNil];
-            dispatch_group_leave(group);
+            finished = YES;
         }];
         
-        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        [[expectFutureValue(theValue(finished)) shouldEventuallyBeforeTimingOutAfter(30.0)] beYes];
         
-        dispatch_release(group);
         dispatch_release(queue);
         
     });
@@ -119,7 +119,8 @@ describe(@"can set a client with different password field name and everything st
     __block User4 *person = nil;
     __block SMCoreDataStore *cds = nil;
     beforeEach(^{
-        SM_CORE_DATA_DEBUG = YES;
+        [[SMLogger sharedLogger] setLevelForAllSubsystems:SMLogLevelDebug];
+        [[SMLogger sharedLogger] setConsoleLevel:SMLogLevelDebug];
         client = [SMIntegrationTestHelpers defaultClient];
         [SMClient setDefaultClient:client];
         [SMCoreDataIntegrationTestHelpers removeSQLiteDatabaseAndMapsWithPublicKey:client.publicKey];